@@ -0,0 +1,37 @@
+// Minimal stand-in of Genius FVM_Node for node_order_bench.cc,
+// only what src/solution/fvm_node_order.cc uses.
+
+#ifndef __fvm_node_info_h__
+#define __fvm_node_info_h__
+
+#include <vector>
+#include <utility>
+
+#include "node.h"
+
+class FVM_Node
+{
+public:
+  typedef std::vector< std::pair<const FVM_Node *, Real> >::const_iterator fvm_neighbor_node_iterator;
+
+  FVM_Node(const Node *n=0) : _node(n) {}
+
+  const Node * root_node() const
+  { return _node; }
+
+  void add_fvm_node_neighbor(const FVM_Node *n)
+  { _fvm_node_neighbor.push_back(std::make_pair(n, 0.0)); }
+
+  fvm_neighbor_node_iterator neighbor_node_begin() const
+  { return _fvm_node_neighbor.begin(); }
+
+  fvm_neighbor_node_iterator neighbor_node_end() const
+  { return _fvm_node_neighbor.end(); }
+
+private:
+  const Node * _node;
+
+  std::vector< std::pair<const FVM_Node *, Real> > _fvm_node_neighbor;
+};
+
+#endif
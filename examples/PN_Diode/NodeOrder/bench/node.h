@@ -0,0 +1,22 @@
+// Minimal stand-in of Genius Node for node_order_bench.cc,
+// only what src/solution/fvm_node_order.cc uses.
+
+#ifndef __node_h__
+#define __node_h__
+
+typedef double Real;
+
+class Node
+{
+public:
+  Node(Real x=0, Real y=0, Real z=0)
+  { _x[0] = x; _x[1] = y; _x[2] = z; }
+
+  Real operator() (unsigned int i) const
+  { return _x[i]; }
+
+private:
+  Real _x[3];
+};
+
+#endif
@@ -0,0 +1,308 @@
+// Benchmark of the node.order option on a large 3D tetrahedral mesh.
+//
+// The mesh is the Kuhn (6 tetrahedra per cube) triangulation of an N^3 grid,
+// whose node ids are shuffled as they come from an unstructured mesh generator.
+// For each order the node rank is computed by src/solution/fvm_node_order.cc
+// itself, then two kernels are timed:
+//
+//   edge assembly : loop over edges sorted by the ranks of their end nodes
+//                   (as SimulationRegion::prepare_for_use does), read psi/n/p of
+//                   both nodes and scatter a Scharfetter-Gummel like flux into
+//                   the residual, 3 dofs per node as DDM1
+//   MatMult       : y = A*x with the CSR matrix of the node graph, rows and
+//                   columns numbered in dof order as the serial dof map does
+//
+// cache misses are read by perf_event_open when the hardware counters are
+// accessible, otherwise "n/a" is printed.
+//
+// build and run (from this directory):
+//   g++ -O2 -I. -I../../../../include/solution node_order_bench.cc ../../../../src/solution/fvm_node_order.cc -o node_order_bench
+//   ./node_order_bench [N=100] [passes=10]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <sys/time.h>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "node.h"
+#include "fvm_node_info.h"
+#include "fvm_node_order.h"
+
+
+static double wall_time()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+
+// hardware cache miss counter of this thread, -1 if not available
+class CacheMissCounter
+{
+public:
+  CacheMissCounter() : _fd(-1)
+  {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    _fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+  }
+
+  ~CacheMissCounter()
+  {
+#ifdef __linux__
+    if(_fd >= 0) close(_fd);
+#endif
+  }
+
+  void start()
+  {
+#ifdef __linux__
+    if(_fd < 0) return;
+    ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+  }
+
+  long long stop()
+  {
+#ifdef __linux__
+    if(_fd < 0) return -1;
+    ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+    long long count = 0;
+    if( read(_fd, &count, sizeof(count)) != sizeof(count) ) return -1;
+    return count;
+#else
+    return -1;
+#endif
+  }
+
+private:
+  int _fd;
+};
+
+
+// deterministic shuffle, the result does not depend on the C library
+static void shuffle(std::vector<unsigned int> & v)
+{
+  unsigned long long s = 20231018ull;
+  for(unsigned int i=v.size(); i>1; --i)
+  {
+    s = s*6364136223846793005ull + 1442695040888963407ull;
+    unsigned int j = static_cast<unsigned int>((s >> 33) % i);
+    std::swap(v[i-1], v[j]);
+  }
+}
+
+
+static Real bernoulli(Real x)
+{
+  if( std::fabs(x) < 1e-6 ) return 1.0 - 0.5*x;
+  return x/(std::exp(x) - 1.0);
+}
+
+
+struct Result
+{
+  double assembly, matmult;
+  long long assembly_miss, matmult_miss;
+  double edge_span;
+};
+
+
+static Result run(FVM_NodeOrder order, const std::vector<FVM_Node *> & fvm_nodes,
+                  const std::vector< std::pair<unsigned int, unsigned int> > & mesh_edges, unsigned int passes)
+{
+  const unsigned int n_nodes = fvm_nodes.size();
+
+  std::vector<unsigned int> rank;
+  fvm_node_order_rank(order, std::vector<const FVM_Node *>(fvm_nodes.begin(), fvm_nodes.end()), rank);
+
+  // edges in dof numbering, sorted by end node ranks
+  std::vector< std::pair<unsigned int, unsigned int> > edges(mesh_edges.size());
+  for(unsigned int e=0; e<mesh_edges.size(); ++e)
+  {
+    unsigned int a = rank[mesh_edges[e].first];
+    unsigned int b = rank[mesh_edges[e].second];
+    edges[e] = std::make_pair(std::min(a, b), std::max(a, b));
+  }
+  // mesh order keeps the edge order of node id pairs, which is the order of the input
+  if( order != MeshNodeOrder )
+    std::sort(edges.begin(), edges.end());
+
+  Result result;
+  double span = 0.0;
+  for(unsigned int e=0; e<edges.size(); ++e)
+    span += edges[e].second - edges[e].first;
+  result.edge_span = span/edges.size();
+
+  CacheMissCounter counter;
+
+  // edge assembly, 3 dofs (psi, n, p) per node
+  {
+    std::vector<Real> x(3*n_nodes), f(3*n_nodes, 0.0);
+    for(unsigned int i=0; i<n_nodes; ++i)
+    {
+      x[3*i+0] = 0.01*(i%97);
+      x[3*i+1] = 1.0 + (i%13);
+      x[3*i+2] = 1.0 + (i%17);
+    }
+
+    counter.start();
+    double t0 = wall_time();
+    for(unsigned int pass=0; pass<passes; ++pass)
+      for(unsigned int e=0; e<edges.size(); ++e)
+      {
+        const unsigned int a = 3*edges[e].first, b = 3*edges[e].second;
+        const Real dV = x[b] - x[a];
+        const Real Jn = bernoulli(dV)*x[b+1] - bernoulli(-dV)*x[a+1];
+        const Real Jp = bernoulli(-dV)*x[b+2] - bernoulli(dV)*x[a+2];
+        f[a]   += dV;   f[b]   -= dV;
+        f[a+1] += Jn;   f[b+1] -= Jn;
+        f[a+2] += Jp;   f[b+2] -= Jp;
+      }
+    result.assembly = wall_time() - t0;
+    result.assembly_miss = counter.stop();
+    if( f[0] == 12345.0 ) printf(" ");
+  }
+
+  // MatMult of the node graph laplacian
+  {
+    std::vector<unsigned int> row_ptr(n_nodes+1, 0);
+    for(unsigned int e=0; e<edges.size(); ++e)
+    {
+      row_ptr[edges[e].first+1]++;
+      row_ptr[edges[e].second+1]++;
+    }
+    for(unsigned int i=0; i<n_nodes; ++i)
+      row_ptr[i+1] += row_ptr[i] + 1;
+
+    std::vector<unsigned int> col(row_ptr[n_nodes]);
+    std::vector<Real> val(row_ptr[n_nodes]);
+    std::vector<unsigned int> fill(row_ptr.begin(), row_ptr.end()-1);
+    for(unsigned int i=0; i<n_nodes; ++i)
+      col[fill[i]++] = i;
+    for(unsigned int e=0; e<edges.size(); ++e)
+    {
+      col[fill[edges[e].first]++]  = edges[e].second;
+      col[fill[edges[e].second]++] = edges[e].first;
+    }
+    for(unsigned int i=0; i<n_nodes; ++i)
+    {
+      std::sort(&col[row_ptr[i]], &col[0] + row_ptr[i+1]);
+      for(unsigned int k=row_ptr[i]; k<row_ptr[i+1]; ++k)
+        val[k] = col[k] == i ? Real(row_ptr[i+1]-row_ptr[i]) : -1.0;
+    }
+
+    std::vector<Real> x(n_nodes, 1.0), y(n_nodes, 0.0);
+    for(unsigned int i=0; i<n_nodes; ++i)
+      x[i] = 1.0 + 1e-3*(i%101);
+
+    counter.start();
+    double t0 = wall_time();
+    for(unsigned int pass=0; pass<passes; ++pass)
+      for(unsigned int i=0; i<n_nodes; ++i)
+      {
+        Real sum = 0.0;
+        for(unsigned int k=row_ptr[i]; k<row_ptr[i+1]; ++k)
+          sum += val[k]*x[col[k]];
+        y[i] = sum;
+      }
+    result.matmult = wall_time() - t0;
+    result.matmult_miss = counter.stop();
+    if( y[0] == 12345.0 ) printf(" ");
+  }
+
+  return result;
+}
+
+
+static void print_miss(long long miss)
+{
+  if( miss < 0 ) printf("  %12s", "n/a");
+  else           printf("  %12lld", miss);
+}
+
+
+int main(int argc, char **argv)
+{
+  const unsigned int N      = argc > 1 ? atoi(argv[1]) : 100;
+  const unsigned int passes = argc > 2 ? atoi(argv[2]) : 10;
+  const unsigned int M = N+1;
+  const unsigned int n_nodes = M*M*M;
+
+  // grid index -> node id, shuffled
+  std::vector<unsigned int> id(n_nodes);
+  for(unsigned int i=0; i<n_nodes; ++i) id[i] = i;
+  shuffle(id);
+
+  std::vector<Node> nodes(n_nodes);
+  for(unsigned int k=0; k<M; ++k)
+    for(unsigned int j=0; j<M; ++j)
+      for(unsigned int i=0; i<M; ++i)
+        nodes[id[(k*M+j)*M+i]] = Node(i, j, k);
+
+  // edges of the Kuhn triangulation: 3 axis, 3 face diagonals and the cube diagonal
+  const int dir[7][3] = { {1,0,0}, {0,1,0}, {0,0,1}, {1,1,0}, {1,0,1}, {0,1,1}, {1,1,1} };
+  std::vector< std::pair<unsigned int, unsigned int> > edges;
+  edges.reserve(7*n_nodes);
+  for(unsigned int k=0; k<M; ++k)
+    for(unsigned int j=0; j<M; ++j)
+      for(unsigned int i=0; i<M; ++i)
+        for(unsigned int d=0; d<7; ++d)
+        {
+          unsigned int ii = i+dir[d][0], jj = j+dir[d][1], kk = k+dir[d][2];
+          if( ii >= M || jj >= M || kk >= M ) continue;
+          unsigned int a = id[(k*M+j)*M+i], b = id[(kk*M+jj)*M+ii];
+          edges.push_back( std::make_pair(std::min(a, b), std::max(a, b)) );
+        }
+  // region edges are kept in a map of node id pairs
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<FVM_Node *> fvm_nodes(n_nodes);
+  for(unsigned int n=0; n<n_nodes; ++n)
+    fvm_nodes[n] = new FVM_Node(&nodes[n]);
+  for(unsigned int e=0; e<edges.size(); ++e)
+  {
+    fvm_nodes[edges[e].first]->add_fvm_node_neighbor(fvm_nodes[edges[e].second]);
+    fvm_nodes[edges[e].second]->add_fvm_node_neighbor(fvm_nodes[edges[e].first]);
+  }
+
+  printf("Kuhn tetrahedral mesh %u^3 cells, %u nodes, %u edges, %u passes\n\n", N, n_nodes, (unsigned int)edges.size(), passes);
+  printf("%-8s  %10s  %10s  %12s  %10s  %12s\n", "order", "edge span", "assembly", "cache-misses", "MatMult", "cache-misses");
+
+  const char * name[4] = { "mesh", "rcm", "hilbert", "morton" };
+  const FVM_NodeOrder order[4] = { MeshNodeOrder, RCMNodeOrder, HilbertNodeOrder, MortonNodeOrder };
+  for(unsigned int o=0; o<4; ++o)
+  {
+    Result r = run(order[o], fvm_nodes, edges, passes);
+    printf("%-8s  %10.0f  %9.3fs", name[o], r.edge_span, r.assembly);
+    print_miss(r.assembly_miss);
+    printf("  %9.3fs", r.matmult);
+    print_miss(r.matmult_miss);
+    printf("\n");
+    fflush(stdout);
+  }
+
+  for(unsigned int n=0; n<n_nodes; ++n)
+    delete fvm_nodes[n];
+  return 0;
+}
@@ -82,6 +82,7 @@ extern bool consistent_bc_by_subdomain(const std::string & mat1, const std::stri
 // predefine
 class SimulationSystem;
 class SimulationRegion;
+class MatRowRedirect;
 
 /**
  * The base class of Boundary Condition
@@ -618,6 +619,18 @@ public:
   virtual bool is_inter_connect_hub() const
   { return false; }
 
+  /**
+   * set the row redirect table used by jacobian assembly, NULL if the matrix is assembled directly
+   */
+  void set_row_redirect(MatRowRedirect * redirect)
+  { _row_redirect = redirect; }
+
+  /**
+   * @return the row redirect table used by jacobian assembly, NULL if the matrix is assembled directly
+   */
+  MatRowRedirect * row_redirect() const
+  { return _row_redirect; }
+
   /**
    * @return pointer to inter_connect_hub
    */
@@ -650,6 +663,11 @@ private:
    */
   BoundaryCondition * _inter_connect_hub;
 
+  /**
+   * the row redirect table of jacobian matrix, set by the solver during assembly
+   */
+  MatRowRedirect * _row_redirect;
+
 
 
 
@@ -166,6 +166,14 @@ class Edge2 : public Edge
    */
   virtual void ray_hit(const Point & , const Point & , IntersectionResult &, unsigned int=3) const;
 
+  /**
+   * ray hit test of segment (a, b) without memory allocation, used by the ray hit test of 2D elements.
+   * the result is given by state and at most 2 hit points, the mark of vertex hit point is 0 for a and 1 for b.
+   * @return the number of hit points
+   */
+  static unsigned int ray_hit_segment(const Point &a, const Point &b, const Point & point, const Point & d,
+                                      IntersectionState & state, Hit_Point hit_points[2]);
+
 
   /**
    * @return the nearest point on this element to the given point p
@@ -45,6 +45,7 @@
 class MeshRefinement;
 class Elem;
 class FVM_Node;
+class ObjectPool;
 
 
 /**
@@ -104,6 +105,21 @@ class Elem :    public DofObject
    */
   virtual ~Elem();
 
+  /**
+   * elements are allocated from an arena, see ObjectPool
+   */
+  static void * operator new (size_t size);
+
+  /**
+   * return the memory to the arena
+   */
+  static void operator delete (void * p, size_t size);
+
+  /**
+   * @return the arena of elements
+   */
+  static ObjectPool & pool();
+
   /**
    * @returns the \p Point associated with local \p Node \p i.
    */
@@ -864,6 +880,25 @@ class Elem :    public DofObject
    */
   virtual void prepare_for_fvm() {}
 
+  /**
+   * @return the number of values of the geom information built by prepare_for_fvm(),
+   * 0 if the element can not save it
+   */
+  virtual unsigned int n_fvm_geometry() const
+  { return 0; }
+
+  /**
+   * save the geom information built by prepare_for_fvm() to \p data,
+   * which holds n_fvm_geometry() values
+   */
+  virtual void pack_fvm_geometry(Real * ) const {}
+
+  /**
+   * set the geom information from \p data saved by pack_fvm_geometry(),
+   * instead of calculating it by prepare_for_fvm()
+   */
+  virtual void unpack_fvm_geometry(const Real * ) {}
+
 
   /**
    * @returns the refinement level of the current element.  If the
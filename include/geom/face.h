@@ -81,7 +81,14 @@ public:
    */  
   virtual bool in_circle() const=0;
   
-  
+protected:
+
+  /**
+   * ray hit test when the ray lies in the plane of this face.
+   * the ray is tested against each side, without any memory allocation except
+   * the hit points appended to result.
+   */
+  void coplanar_ray_hit(const Point & point, const Point & d, IntersectionResult & result, unsigned int dim) const;
 
 };
 
@@ -93,6 +93,36 @@ public:
    */
   virtual AutoPtr<Elem> build_fvm_side (const unsigned int i, bool proxy=true) const;
 
+  /**
+   * non-virtual version of get_fvm_node(), for element kernels dispatched by elem type
+   */
+  FVM_Node * fvm_node(const unsigned int i) const
+  { return _fvm_node[i]; }
+
+  /**
+   * @return the number of nodes, non-virtual version for element kernels
+   */
+  unsigned int n_fvm_nodes() const
+  { return 4; }
+
+  /**
+   * @return the gradient of input variable in the cell by precomputed matrix,
+   * non-virtual version for element kernels
+   */
+  template <typename T>
+  VectorValue<T> gradient_kernel( const T * var) const
+  {
+    T dx = least_squares_gradient_matrix[0][0]*var[0] + least_squares_gradient_matrix[0][1]*var[1] + least_squares_gradient_matrix[0][2]*var[2] + least_squares_gradient_matrix[0][3]*var[3];
+    T dy = least_squares_gradient_matrix[1][0]*var[0] + least_squares_gradient_matrix[1][1]*var[1] + least_squares_gradient_matrix[1][2]*var[2] + least_squares_gradient_matrix[1][3]*var[3];
+    return VectorValue<T>(dx, dy, 0.0);
+  }
+
+  /**
+   * @return the precomputed coefficient of node \p i in the \p d (x or y) component of the gradient
+   */
+  Real gradient_coefficient(const unsigned int d, const unsigned int i) const
+  { return least_squares_gradient_matrix[d][i]; }
+
   /**
    * @return the gradient of input variable in the cell
    */
@@ -155,6 +185,21 @@ public:
    */
   virtual void prepare_for_fvm();
 
+  /**
+   * @return the number of values of the geom information built by prepare_for_fvm()
+   */
+  virtual unsigned int n_fvm_geometry() const;
+
+  /**
+   * save the geom information to \p data
+   */
+  virtual void pack_fvm_geometry(Real * data) const;
+
+  /**
+   * set the geom information from \p data saved by pack_fvm_geometry()
+   */
+  virtual void unpack_fvm_geometry(const Real * data);
+
   // For FVM usage, we need more Geom information of a QUAD4
 private:
 
@@ -186,9 +231,9 @@ private:
   Real vol;
 
   /**
-   * precomputed matrix inv[A^T.A].A^T
+   * precomputed matrix inv[A^T.A].A^T, only the rows for x and y gradient
    */
-  TNT::Array2D<Real> least_squares_gradient_matrix;
+  Real least_squares_gradient_matrix[2][4];
 
   /**
    * precomput matrix inv[A^T.A].A^T
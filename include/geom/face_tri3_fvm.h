@@ -92,6 +92,36 @@ public:
    */
   virtual AutoPtr<Elem> build_fvm_side (const unsigned int i, bool proxy=true) const;
 
+  /**
+   * non-virtual version of get_fvm_node(), for element kernels dispatched by elem type
+   */
+  FVM_Node * fvm_node(const unsigned int i) const
+  { return _fvm_node[i]; }
+
+  /**
+   * @return the number of nodes, non-virtual version for element kernels
+   */
+  unsigned int n_fvm_nodes() const
+  { return 3; }
+
+  /**
+   * @return the gradient of input variable in the cell by precomputed matrix,
+   * non-virtual version for element kernels
+   */
+  template <typename T>
+  VectorValue<T> gradient_kernel( const T * var) const
+  {
+    T dx = gradient_matrix[0][0]*var[0] + gradient_matrix[0][1]*var[1] + gradient_matrix[0][2]*var[2];
+    T dy = gradient_matrix[1][0]*var[0] + gradient_matrix[1][1]*var[1] + gradient_matrix[1][2]*var[2];
+    return VectorValue<T>(dx, dy, 0.0);
+  }
+
+  /**
+   * @return the precomputed coefficient of node \p i in the \p d (x or y) component of the gradient
+   */
+  Real gradient_coefficient(const unsigned int d, const unsigned int i) const
+  { return gradient_matrix[d][i]; }
+
   /**
    * @return the gradient of input variable in the cell
    */
@@ -170,6 +200,21 @@ public:
    */
   virtual void prepare_for_fvm();
 
+  /**
+   * @return the number of values of the geom information built by prepare_for_fvm()
+   */
+  virtual unsigned int n_fvm_geometry() const;
+
+  /**
+   * save the geom information to \p data
+   */
+  virtual void pack_fvm_geometry(Real * data) const;
+
+  /**
+   * set the geom information from \p data saved by pack_fvm_geometry()
+   */
+  virtual void unpack_fvm_geometry(const Real * data);
+
   // For FVM usage, we need more Geom information of a TRI3
   // memory storage is not a problem for 2D elem, here we buffer as many data as possible
 private:
@@ -221,6 +266,16 @@ private:
    */
   Real vol;
 
+  /**
+   * precomputed matrix for fast gradient computation
+   */
+  Real gradient_matrix[2][3];
+
+  /**
+   * precompute the gradient matrix
+   */
+  void prepare_for_gradient();
+
   /**
    * precomputed matrix inv[A^T.A].A^T for fast vector reconstruct computation
    */
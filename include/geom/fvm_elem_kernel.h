@@ -0,0 +1,150 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+
+#ifndef __fvm_elem_kernel_h__
+#define __fvm_elem_kernel_h__
+
+// C++ includes
+#include <vector>
+
+// Local includes
+#include "genius_common.h"
+#include "elem.h"
+#include "face_tri3_fvm.h"
+#include "face_cy_tri3_fvm.h"
+#include "face_quad4_fvm.h"
+#include "face_cy_quad4_fvm.h"
+
+
+/**
+ * max node number of the element, for stack buffers used by element kernels
+ */
+static const unsigned int fvm_elem_max_nodes = 8;
+
+
+/**
+ * wrap an element without devirtualized kernel interface,
+ * which forwards to the virtual functions of \p Elem
+ */
+class FVM_GenericElem
+{
+public:
+
+  FVM_GenericElem(const Elem * elem) : _elem(elem)
+  { genius_assert(elem->n_nodes() <= fvm_elem_max_nodes); }
+
+  /**
+   * @returns the pointer to local \p FVM_Node \p i.
+   */
+  FVM_Node * fvm_node(const unsigned int i) const
+  { return _elem->get_fvm_node(i); }
+
+  /**
+   * @return the number of nodes
+   */
+  unsigned int n_fvm_nodes() const
+  { return _elem->n_nodes(); }
+
+  /**
+   * @return the gradient of input variable in the cell
+   */
+  template <typename T>
+  VectorValue<T> gradient_kernel( const T * var) const
+  { return _elem->gradient(std::vector<T>(var, var+_elem->n_nodes())); }
+
+  /**
+   * @return the gradient of independent AD variables in the cell,
+   * see fvm_gradient_ad()
+   */
+  VectorValue<AutoDScalar> gradient_ad_kernel( const PetscScalar * var, unsigned int ad_offset, unsigned int ad_stride) const
+  {
+    std::vector<AutoDScalar> ad_var(var, var+_elem->n_nodes());
+    for(unsigned int i=0; i<ad_var.size(); ++i)
+      ad_var[i].setADValue(ad_offset+ad_stride*i, 1.0);
+    return _elem->gradient(ad_var);
+  }
+
+private:
+
+  const Elem * _elem;
+};
+
+
+/**
+ * @return the gradient in the cell of AD variables, which are the independent
+ * variables themselves: the value of node i is var[i], and its AD index is
+ * ad_offset + ad_stride*i. the result is the same as gradient_kernel() with
+ * seeded AutoDScalar, but the derivatives are the precomputed gradient
+ * coefficients, no AD arithmetic is done.
+ */
+template <typename ElemT>
+inline VectorValue<AutoDScalar> fvm_gradient_ad(const ElemT & elem, const PetscScalar * var,
+                                                unsigned int ad_offset, unsigned int ad_stride)
+{
+  AutoDScalar dx, dy;
+  PetscScalar vx=0, vy=0;
+  for(unsigned int i=0; i<elem.n_fvm_nodes(); ++i)
+  {
+    const Real gx = elem.gradient_coefficient(0, i);
+    const Real gy = elem.gradient_coefficient(1, i);
+    vx += gx*var[i];
+    vy += gy*var[i];
+    dx.setADValue(ad_offset+ad_stride*i, gx);
+    dy.setADValue(ad_offset+ad_stride*i, gy);
+  }
+  dx.setValue(vx);
+  dy.setValue(vy);
+  return VectorValue<AutoDScalar>(dx, dy, 0.0);
+}
+
+
+/**
+ * general version of fvm_gradient_ad() by AD arithmetic
+ */
+inline VectorValue<AutoDScalar> fvm_gradient_ad(const FVM_GenericElem & elem, const PetscScalar * var,
+                                                unsigned int ad_offset, unsigned int ad_stride)
+{ return elem.gradient_ad_kernel(var, ad_offset, ad_stride); }
+
+
+/**
+ * call kernel(e) once for the element, with e casted to its FVM type.
+ * Kernel::operator() should be templated on the element type and use the
+ * non-virtual interface: fvm_node(i), n_fvm_nodes() and gradient_kernel(var),
+ * so the loops inside are inlined for Tri3/Quad4 elements.
+ * other elements are wrapped by FVM_GenericElem.
+ */
+template <typename Kernel>
+inline void fvm_elem_dispatch(const Elem * elem, Kernel & kernel)
+{
+  switch(elem->type())
+  {
+    case TRI3_FVM     : kernel(*static_cast<const Tri3_FVM *>(elem));     break;
+    case TRI3_CY_FVM  : kernel(*static_cast<const Tri3_CY_FVM *>(elem));  break;
+    case QUAD4_FVM    : kernel(*static_cast<const Quad4_FVM *>(elem));    break;
+    case QUAD4_CY_FVM : kernel(*static_cast<const Quad4_CY_FVM *>(elem)); break;
+    default           : kernel(FVM_GenericElem(elem));                    break;
+  }
+}
+
+
+#endif
@@ -33,6 +33,7 @@
 // forward declarations
 class Node;
 class MeshRefinement;
+class ObjectPool;
 
 
 /**
@@ -82,6 +83,21 @@ public:
    */
   Node& operator= (const Point& p);
 
+  /**
+   * nodes are allocated from an arena, see ObjectPool
+   */
+  static void * operator new (size_t size);
+
+  /**
+   * return the memory to the arena
+   */
+  static void operator delete (void * p, size_t size);
+
+  /**
+   * @return the arena of nodes
+   */
+  static ObjectPool & pool();
+
   /**
    * Builds a \p Node and returns an \p AutoPtr<Node> to the
    * newly-created object.  The \p id is copied from \p n.id()
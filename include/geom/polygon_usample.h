@@ -69,6 +69,18 @@ public:
    */
   Point location(const Idx & idx) const;
 
+  /**
+   * @return the number of continuous inside segments in row ix
+   */
+  unsigned int n_runs(unsigned int ix) const
+  { return _run_offset[ix+1] - _run_offset[ix]; }
+
+  /**
+   * @return the k-th inside segment [first, second] of row ix
+   */
+  const Idx & run(unsigned int ix, unsigned int k) const
+  { return _runs[_run_offset[ix] + k]; }
+
 private:
 
 
@@ -98,6 +110,16 @@ private:
 
   std::vector<bool> _inside;
 
+  /**
+   * inside segments of each row, row ix owns _runs[_run_offset[ix], _run_offset[ix+1])
+   */
+  std::vector<unsigned int> _run_offset;
+
+  /**
+   * inside segments
+   */
+  std::vector<Idx> _runs;
+
 };
 
 
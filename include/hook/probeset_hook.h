@@ -0,0 +1,158 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __probeset_hook_h__
+#define __probeset_hook_h__
+
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "hook.h"
+#include "point.h"
+#include "enum_solution.h"
+
+class Elem;
+class FVM_Node;
+
+/**
+ * sample solution variables at a set of points and cut lines.
+ * each probe is located once by the mesh point locator, and the variables are
+ * interpolated by the shape functions of the element containing the probe.
+ * all the probes of a step are written as one record into a binary file,
+ * the layout of the record is described by a text header file.
+ */
+class ProbeSetHook : public Hook
+{
+
+public:
+  ProbeSetHook(SolverBase & solver, const std::string & name, void * file);
+
+  virtual ~ProbeSetHook();
+
+  /**
+   *   This is executed before the initialization of the solver
+   */
+  virtual void on_init();
+
+  /**
+   *   This is executed previously to each solution step.
+   */
+  virtual void pre_solve();
+
+  /**
+   *  This is executed after each solution step.
+   */
+  virtual void post_solve();
+
+  /**
+   *  This is executed after each (nonlinear) iteration
+   */
+  virtual void post_iteration();
+
+  /**
+   * This is executed after the finalization of the solver
+   */
+  virtual void on_close();
+
+private:
+
+  /**
+   * a located probe, with interpolation weight of element nodes
+   */
+  struct Probe
+  {
+    Point                      p;
+    const Elem *               elem;
+    std::vector<unsigned int>  nodes;   // index into _sample_nodes
+    std::vector<double>        weights;
+  };
+
+  /**
+   * parse "x,y,z" in um
+   */
+  static bool _parse_point(const std::string & s, Point & p);
+
+  /**
+   * parse "x1,y1,z1,x2,y2,z2,n" in um, append n uniform points to _points
+   */
+  bool _parse_line(const std::string & s);
+
+  /**
+   * @return the scan value of current step, voltage, current or time
+   */
+  double _scan_value() const;
+
+  /**
+   * write the text header describing the records
+   */
+  void _write_header() const;
+
+  /**
+   * probe locations, in the order given by user
+   */
+  std::vector<Point>              _points;
+
+  /**
+   * variables to be sampled
+   */
+  std::vector<SolutionVariable>   _variables;
+
+  /**
+   * name of the sampled variables
+   */
+  std::vector<std::string>        _variable_names;
+
+  /**
+   * the located probes
+   */
+  std::vector<Probe>              _probes;
+
+  /**
+   * the (region, node id) pairs required by probes, all the variables at these
+   * nodes are collected to processor 0 at each step
+   */
+  std::vector< std::pair<unsigned int, unsigned int> > _sample_nodes;
+
+  /**
+   * the FVM nodes on this processor and their index into _sample_nodes
+   */
+  std::vector< std::pair<unsigned int, const FVM_Node *> > _local_nodes;
+
+  /**
+   * the output file name
+   */
+  std::string     _probe_file;
+
+  /**
+   * file stream
+   */
+  std::ofstream   _out;
+
+  /**
+   * step counter, used as scan value for other solve types
+   */
+  unsigned int    _count;
+};
+
+#endif
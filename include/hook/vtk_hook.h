@@ -29,6 +29,8 @@
 #include <vector>
 #include <string>
 
+class AsyncWriter;
+
 /**
  * write vtk file
  */
@@ -67,6 +69,17 @@ public:
 
 private:
 
+  /**
+   * export current solution to vtk file
+   */
+  void _export_vtk(const std::string & filename);
+
+  /**
+   * continue the vtk series of previous solver pass (after mesh adaptation),
+   * the time sequence, count and last values are restored from prefix.pvd
+   */
+  void _resume();
+
   /**
    * the output file name
    */
@@ -112,6 +125,11 @@ private:
    * if we are in ddmac mode
    */
   bool            _ddm_ac;
+
+  /**
+   * write vtk files in background, NULL for synchronous write
+   */
+  AsyncWriter *   _writer;
 };
 
 #endif
@@ -0,0 +1,109 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __xdmf_hook_h__
+#define __xdmf_hook_h__
+
+
+#include "hook.h"
+#include <string>
+
+class XDMFIO;
+
+/**
+ * write the solutions of DC sweep/transient as a time series in XDMF format.
+ * unlike vtk hook, the mesh is written only once and each step only appends its fields.
+ */
+class XDMFHook : public Hook
+{
+
+public:
+  XDMFHook(SolverBase & solver, const std::string & name, void *);
+
+  virtual ~XDMFHook();
+
+  /**
+   *   This is executed before the initialization of the solver
+   */
+  virtual void on_init();
+
+  /**
+   *   This is executed previously to each solution step.
+   */
+  virtual void pre_solve();
+
+  /**
+   *  This is executed after each solution step.
+   */
+  virtual void post_solve();
+
+  /**
+   *  This is executed after each (nonlinear) iteration
+   */
+  virtual void post_iteration();
+
+  /**
+   * This is executed after the finalization of the solver
+   */
+  virtual void on_close();
+
+private:
+
+  /**
+   * @return the scan value of current step, voltage, current or time
+   */
+  double _scan_value() const;
+
+  /**
+   * the output file prefix
+   */
+  std::string     _prefix;
+
+  /**
+   * store fields in float32
+   */
+  bool            _single;
+
+  /**
+   * the series writer
+   */
+  XDMFIO *        _xdmf;
+
+  /**
+   * last value
+   */
+  double _last;
+
+  /**
+   * step, only write solution when scan value changes more than step
+   */
+  double _t_step;
+  double _v_step;
+  double _i_step;
+
+  /**
+   * step counter, used as time value for other solve types
+   */
+  unsigned int _count;
+};
+
+#endif
@@ -42,8 +42,30 @@ public:
    */
   double get_interpolated_value(const Point & point, int group) const;
 
+  /**
+   * get interpolated values with GROUP_ID group in all the location points,
+   * the points are approximated in parallel
+   */
+  void get_interpolated_values(const std::vector<Point> & points, int group, std::vector<double> & values) const;
+
 private:
 
+  /**
+   * transform approximated value back to the field, and limit it by the field range
+   */
+  double _field_value(int group, double z) const;
+
+  /**
+   * body of Threads::parallel_for, approximate a range of points
+   */
+  struct ApproximateBody
+  {
+    CSA::csa * field;
+    std::vector<CSA::point> * points;
+    void operator() (unsigned int begin, unsigned int end, unsigned int)
+    { CSA::csa_approximatepoints(field, end-begin, &(*points)[begin]); }
+  };
+
   std::map<int, CSA::csa *>  field_map;  //
 
   std::map<int, std::vector<CSA::point> > csa_points;
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "point.h"
 
@@ -51,6 +52,13 @@ public:
    */
   virtual void add_scatter_data(const Point & point, int group, double value)=0;
 
+  /**
+   * add the data of mesh node with GROUP_ID group.
+   * interpolator knows the mesh can use node id, others take it as scatter data
+   */
+  virtual void add_node_data(unsigned int /* node_id */, const Point & point, int group, double value)
+  { this->add_scatter_data(point, group, value); }
+
   /**
    * build internal data structure
    */
@@ -67,6 +75,17 @@ public:
    */
   virtual double get_interpolated_value(const Point & point, int group)const=0;
 
+  /**
+   * get interpolated values with GROUP_ID group in all the location points.
+   * the default one calls get_interpolated_value point by point
+   */
+  virtual void get_interpolated_values(const std::vector<Point> & points, int group, std::vector<double> & values) const
+  {
+    values.resize(points.size());
+    for(unsigned int n=0; n<points.size(); ++n)
+      values[n] = get_interpolated_value(points[n], group);
+  }
+
   /**
    * InterpolationType, should support linear (for potential, etc) and asinh (doping concentration and carrier density)
    */
@@ -0,0 +1,160 @@
+#ifndef __interpolation_mesh_h__
+#define __interpolation_mesh_h__
+
+#include <vector>
+
+#include "auto_ptr.h"
+#include "interpolation_base.h"
+
+class MeshBase;
+class Elem;
+class PointLocatorBase;
+
+
+/**
+ * interpolate the node data of a mesh by the shape function of the element
+ * which contains the location point.
+ * the mesh is copied, so the interpolator can transfer data to the mesh after
+ * refinement or regeneration. points out of the mesh take the value of nearest node.
+ */
+class InterpolationMesh : public InterpolationBase
+{
+public:
+
+  /**
+   * copy the mesh and build the point locator
+   */
+  InterpolationMesh(const MeshBase & mesh);
+
+  ~InterpolationMesh();
+
+  /**
+   * clear internal interpolation data
+   */
+  void clear();
+
+  /**
+   * the value is set to the nearest node of the element contains point
+   */
+  void add_scatter_data(const Point & point, int group, double value);
+
+  /**
+   * add the data of mesh node with GROUP_ID group
+   */
+  void add_node_data(unsigned int node_id, const Point & point, int group, double value);
+
+  /**
+   * build internal data structure
+   */
+  void setup(int group);
+
+  /**
+   * broadcast data to all the processor
+   */
+  virtual void broadcast(unsigned int root=0);
+
+  /**
+   * get interpolated value with GROUP_ID group in location point
+   */
+  double get_interpolated_value(const Point & point, int group) const;
+
+  /**
+   * get interpolated values with GROUP_ID group in all the location points,
+   * the points are located in parallel
+   */
+  void get_interpolated_values(const std::vector<Point> & points, int group, std::vector<double> & values) const;
+
+  /**
+   * max number of nodes of an element
+   */
+  static const unsigned int max_elem_nodes = 27;
+
+  /**
+   * interpolation weights of element nodes at point p, which sum to 1.
+   * use the first order lagrange shape function when available, otherwise inverse distance weight.
+   * weights should have at least elem->n_nodes() entries
+   */
+  static void shape_weights(const Elem * elem, const Point & p, double * weights);
+
+private:
+
+  /**
+   * the copy of donor mesh
+   */
+  AutoPtr<MeshBase> _mesh;
+
+  /**
+   * point locator of the donor mesh, it owns the search tree
+   */
+  AutoPtr<PointLocatorBase> _locator;
+
+  /**
+   * the scaled node value of each group, indexed by node id
+   */
+  std::map<int, std::vector<double> > _value;
+
+  /**
+   * the flag of node which has value, indexed by node id
+   */
+  std::map<int, std::vector<int> > _valid;
+
+  /**
+   * uniform bins of the nodes which have value, for nearest node search.
+   * the bin size is chosen to hold about one node
+   */
+  struct NodeBins
+  {
+    Point lo;
+    double h;
+    unsigned int n[3];
+
+    /**
+     * nodes of bin b are nodes[offset[b]] ... nodes[offset[b+1]-1]
+     */
+    std::vector<unsigned int> offset;
+    std::vector<unsigned int> nodes;
+
+    void build(const MeshBase & mesh, const std::vector<int> & valid);
+
+    /**
+     * @return the nearest node to p, invalid_uint if there is no node
+     */
+    unsigned int nearest(const MeshBase & mesh, const Point & p) const;
+
+    unsigned int bin(unsigned int i, unsigned int j, unsigned int k) const
+    { return (k*n[1] + j)*n[0] + i; }
+  };
+
+  /**
+   * the node bins of each group
+   */
+  std::map<int, NodeBins> _node_bins;
+
+  /**
+   * interpolated value at p, elem is the element contains p or NULL
+   */
+  double _value_at(const Elem * elem, const Point & p, int group) const;
+
+  /**
+   * the value of nearest node which has value
+   */
+  double _nearest_node_value(const Point & p, int group) const;
+
+  /**
+   * body of Threads::parallel_for, each thread has its own point locator
+   */
+  struct InterpolateBody
+  {
+    const InterpolationMesh * interpolator;
+    const std::vector<Point> * points;
+    std::vector<double> * values;
+    std::vector<PointLocatorBase *> * locators;
+    int group;
+    void operator() (unsigned int begin, unsigned int end, unsigned int tid);
+  };
+
+  friend struct InterpolateBody;
+};
+
+
+#endif
@@ -2,6 +2,7 @@
 #define __expr_evalute_h__
 
 #include "expr_eval.h"
+#include "expr_program.h"
 
 
 /**
@@ -71,6 +72,12 @@ public:
   double operator () (double x, double y, double z, double t)
   { return eval(x,y,z,t); }
 
+  /**
+   * @return true when the expression is evaluated by the compiled program
+   */
+  bool compiled() const
+  { return _program.compiled(); }
+
 private:
 
   /**
@@ -88,6 +95,16 @@ private:
    */
   ExprEval::Expression e;
 
+  /**
+   * address of the independent variables in vlist
+   */
+  double *_x, *_y, *_z, *_t;
+
+  /**
+   * the expression compiled to register code
+   */
+  ExprProgram _program;
+
 };
 
 #endif
@@ -0,0 +1,168 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __expr_program_h__
+#define __expr_program_h__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "expr_eval.h"
+
+
+/**
+ * flat register bytecode of a parsed ExprEval::Expression.
+ * the expression tree is lowered once, operators with constant operands
+ * (numbers, units and physical constants) are folded at compile time,
+ * and the remaining instructions are executed on a flat register file.
+ * expressions with assignment, multi-expression, or functions which are
+ * not pure (rand) or take reference/data arguments can not be compiled,
+ * the caller should use the expression tree instead.
+ */
+class ExprProgram : public ExprEval::Lowering
+{
+public:
+
+  ExprProgram();
+
+  /**
+   * bind variable address of the value list as the input of given index
+   */
+  void bind_input(const double *var, unsigned int index);
+
+  /**
+   * bind variable address of the value list as constant, the value is read at compile time
+   */
+  void bind_constant(const double *var);
+
+  /**
+   * lower the expression to bytecode
+   * @return true on success
+   */
+  bool compile(const ExprEval::Expression &e);
+
+  /**
+   * @return true if the expression is compiled
+   */
+  bool compiled() const
+  { return _compiled; }
+
+  /**
+   * @return the number of instructions after constant folding
+   */
+  unsigned int n_instructions() const
+  { return _code.size(); }
+
+  /**
+   * evaluate at one point, the register file of this program is used,
+   * so one program should not be evaluated by several threads at the same time
+   * @return false if division by zero or domain error happened, the caller should
+   * evaluate the expression tree to get the exact behavior
+   */
+  bool eval(const double *input, double &result);
+
+  /**
+   * implement ExprEval::Lowering
+   */
+  virtual int Value(double val);
+
+  virtual int Variable(const double *var);
+
+  virtual int Operator(const std::string &name, const std::vector<int> &args);
+
+private:
+
+  enum OpCode
+  {
+    OP_LOAD,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_NEG, OP_POW,
+    OP_ABS, OP_MOD, OP_IPART, OP_FPART, OP_MIN, OP_MAX,
+    OP_SQRT, OP_SIN, OP_COS, OP_TAN, OP_SINH, OP_COSH, OP_TANH,
+    OP_ASIN, OP_ACOS, OP_ATAN, OP_ATAN2, OP_LOG10, OP_LN, OP_EXP, OP_LOGN,
+    OP_ERF, OP_ERFC, OP_CEIL, OP_FLOOR, OP_DEG, OP_RAD,
+    OP_IF, OP_SELECT, OP_EQUAL, OP_ABOVE, OP_BELOW, OP_CLIP, OP_CLAMP, OP_RESCALE,
+    OP_AND, OP_OR, OP_NOT
+  };
+
+  /**
+   * one instruction, dst = op(a, b, c, d, e)
+   */
+  struct Instruction
+  {
+    OpCode         op;
+    unsigned int   dst;
+    unsigned int   arg[5];
+    const double * ptr;   // variable address for OP_LOAD
+  };
+
+  /**
+   * emit an instruction, fold it if all the operands are constant
+   */
+  int _emit(OpCode op, const std::vector<int> &args);
+
+  /**
+   * execute one instruction on the register file, bad is set on division by zero or domain error
+   */
+  static void _execute(const Instruction &ins, double *reg, bool &bad);
+
+  bool _compiled;
+
+  std::vector<Instruction> _code;
+
+  /**
+   * number of registers, the first 4 are inputs
+   */
+  unsigned int _n_registers;
+
+  /**
+   * register holds the value of expression
+   */
+  unsigned int _result;
+
+  /**
+   * value of constant registers
+   */
+  std::map<unsigned int, double> _constant_value;
+
+  /**
+   * constant register of a value
+   */
+  std::map<double, unsigned int> _constant_register;
+
+  /**
+   * input index of bind variables
+   */
+  std::map<const double *, unsigned int> _inputs;
+
+  /**
+   * address of constant variables
+   */
+  std::map<const double *, double> _constant_vars;
+
+  /**
+   * register file
+   */
+  std::vector<double> _registers;
+};
+
+#endif
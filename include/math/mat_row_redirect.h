@@ -0,0 +1,157 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __mat_row_redirect_h__
+#define __mat_row_redirect_h__
+
+#include <vector>
+
+#include "petscmat.h"
+
+/**
+ * row redirect table of jacobian matrix.
+ * boundary conditions move the rows of interface nodes to their master node (src row -> dst row)
+ * and clear the rows they will fill themselves. instead of assemble the matrix, reading the
+ * source rows back and zero the cleared rows, the table is built once from the rows given by
+ * boundary conditions, and the region assembly adds each value directly to its destination rows.
+ * the values added to cleared rows are not put into the matrix, but captured, so boundary
+ * conditions can still read them, i.e. for the electrode current of ohmic contact.
+ * the capture slots are the nonzero columns of cleared rows when the table is built.
+ *
+ * the solver hands the table to the region assembly routines and boundary conditions,
+ * which pass it to PetscUtils::MatAddValues / MatGetValues.
+ * all the redirected rows should on local processor.
+ */
+class MatRowRedirect
+{
+public:
+
+  MatRowRedirect() : _mat(0), _row_begin(0), _row_end(0), _missed(false) {}
+
+  ~MatRowRedirect()
+  { this->clear(); }
+
+  /**
+   * build the table from the row lists of boundary conditions.
+   * the value of src_rows[i] will be added to dst_rows[i], and the rows in clear_rows are zeroed.
+   * mat should be assembled and the cleared rows not yet zeroed, their nonzero columns are the capture slots.
+   */
+  void build(Mat mat, const std::vector<PetscInt> &src_rows, const std::vector<PetscInt> &dst_rows, const std::vector<PetscInt> &clear_rows);
+
+  /**
+   * free the table
+   */
+  void clear();
+
+  /**
+   * @return true when the table is built
+   */
+  bool valid() const
+  { return _mat != 0; }
+
+  /**
+   * @return true when the row lists are the same as the ones the table built from,
+   * and all the values added to cleared rows since begin_assembly() are captured
+   */
+  bool match(const std::vector<PetscInt> &src_rows, const std::vector<PetscInt> &dst_rows, const std::vector<PetscInt> &clear_rows) const
+  { return !_missed && src_rows == _src_rows && dst_rows == _dst_rows && clear_rows == _clear_rows; }
+
+  /**
+   * begin a new assembly, drop the captured values
+   */
+  void begin_assembly();
+
+  /**
+   * add values to matrix with ADD_VALUES, each row is redirected to its destination rows
+   */
+  PetscErrorCode add_values(PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], const PetscScalar v[]);
+
+  /**
+   * get the values captured for cleared rows. only cleared rows can be read
+   */
+  PetscErrorCode get_values(PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], PetscScalar v[]) const;
+
+private:
+
+  /**
+   * the matrix the table built for
+   */
+  Mat _mat;
+
+  /**
+   * local row range of the matrix
+   */
+  PetscInt _row_begin, _row_end;
+
+  /**
+   * the row lists the table built from
+   */
+  std::vector<PetscInt> _src_rows, _dst_rows, _clear_rows;
+
+  /**
+   * slot of each local row, -1 for the row which is not redirected
+   */
+  std::vector<int> _row_slot;
+
+  /**
+   * destination rows of each slot, in CSR format
+   */
+  std::vector<unsigned int> _target_begin;
+  std::vector<PetscInt>     _targets;
+
+  /**
+   * the slot is a cleared row
+   */
+  std::vector<bool> _cleared;
+
+  /**
+   * capture columns and values of each slot in CSR format, columns are sorted. empty for rows not cleared
+   */
+  std::vector<unsigned int> _capture_begin;
+  std::vector<PetscInt>     _capture_cols;
+  std::vector<PetscScalar>  _capture_vals;
+
+  /**
+   * a value is added to a column of cleared row which has no capture slot
+   */
+  bool _missed;
+
+  /**
+   * @return position of col in the capture slots of slot s, -1 if not found
+   */
+  int capture_position(int s, PetscInt col) const;
+
+  /**
+   * @return slot of the row, -1 if row is not redirected
+   */
+  int slot(PetscInt row) const
+  {
+    if( row < _row_begin || row >= _row_end ) return -1;
+    return _row_slot[row - _row_begin];
+  }
+
+  // no copy
+  MatRowRedirect(const MatRowRedirect &);
+  MatRowRedirect & operator=(const MatRowRedirect &);
+};
+
+#endif // #define __mat_row_redirect_h__
@@ -32,6 +32,8 @@
 #include "dense_vector.h"
 #include "dense_matrix.h"
 
+class MatRowRedirect;
+
 namespace PetscUtils
 {
 
@@ -179,6 +181,32 @@ namespace PetscUtils
    */
   //extern PetscErrorCode  MatAddClearRow(Mat mat, std::vector<PetscInt> & src_rows, std::vector<PetscInt> & dst_rows, std::vector<PetscInt> & clear_rows);
 
+  /**
+   * @brief add values to matrix with ADD_VALUES, redirect rows if a row redirect table is given
+   *
+   * @param  redirect   the row redirect table used to assemble mat, can be NULL
+   * @param  mat        Petsc Matrix
+   *
+   * @note   other parameters are the same as MatSetValues
+   *
+   */
+  extern PetscErrorCode  MatAddValues(MatRowRedirect * redirect, Mat mat, PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], const PetscScalar v[]);
+
+  /**
+   * @brief add a value to matrix with ADD_VALUES, redirect row if a row redirect table is given
+   */
+  extern PetscErrorCode  MatAddValue(MatRowRedirect * redirect, Mat mat, PetscInt row, PetscInt col, PetscScalar v);
+
+  /**
+   * @brief get values of matrix. if a row redirect table is given, read the values captured for cleared rows.
+   *
+   * @param  redirect   the row redirect table used to assemble mat, can be NULL
+   *
+   * @note   other parameters are the same as MatGetValues, only get value from local block
+   *
+   */
+  extern PetscErrorCode  MatGetValues(const MatRowRedirect * redirect, Mat mat, PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], PetscScalar v[]);
+
   /**
    * @brief add real DenseVector to PetscVec by dof_indices
    *
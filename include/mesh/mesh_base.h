@@ -385,6 +385,12 @@ public:
    */
   virtual void reorder_elems () {}
 
+  /**
+   * renumber elems and nodes by given order, i.e. the order computed by reorder_elems() before.
+   * elem_order[id] (node_order[id]) is the new id, the arrays hold n_elem() (n_nodes()) values
+   */
+  virtual void reorder_elems (const unsigned int *, const unsigned int *) {}
+
 
   /**
    * reorder the node index by Reverse Cuthill-McKee Algorithm
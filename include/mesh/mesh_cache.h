@@ -0,0 +1,268 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+
+
+#ifndef __mesh_cache_h__
+#define __mesh_cache_h__
+
+#include <string>
+#include <vector>
+
+#include "genius_common.h"
+
+class MeshBase;
+class Elem;
+class Node;
+
+
+/**
+ * a versioned binary file of flat sections, protected by a checksum.
+ * the file is memory mapped on open when mmap is available, and the
+ * sections are read in place until the file is closed.
+ */
+class MeshCacheFile
+{
+public:
+
+  MeshCacheFile() : _image(0), _image_size(0), _mapped(false) {}
+
+  ~MeshCacheFile() { close(); }
+
+  /**
+   * map the file and validate its version, key and checksum
+   * @return false if the file does not exist or is not valid
+   */
+  bool open(const std::string & file_name, unsigned long long key);
+
+  /**
+   * release the mapped file
+   */
+  void close();
+
+  /**
+   * @return the number of sections of the opened file
+   */
+  unsigned int n_sections() const
+  { return _sections.size(); }
+
+  /**
+   * @return section \p i of the opened file in place, \p n is set to the number of values.
+   * the data is valid until close()
+   */
+  template <typename T>
+  const T * section(unsigned int i, unsigned int & n) const
+  {
+    n = _section_size[i]/sizeof(T);
+    return reinterpret_cast<const T *>(_sections[i]);
+  }
+
+  /**
+   * append a section to the file to be written
+   */
+  template <typename T>
+  void add_section(const std::vector<T> & data)
+  { _add_section(data.empty() ? 0 : &data[0], data.size()*sizeof(T)); }
+
+  /**
+   * write the added sections, a partial file never has a valid name
+   * @return true on success
+   */
+  bool write(const std::string & file_name, unsigned long long key) const;
+
+  /**
+   * 64bit FNV-1a hash of \p n bytes, continued from \p h
+   */
+  static unsigned long long hash(const void * p, size_t n, unsigned long long h=14695981039346656037ULL);
+
+  /**
+   * file format version
+   */
+  static const unsigned int version = 2;
+
+private:
+
+  /**
+   * file content, mapped or read into _buffer
+   */
+  const char * _image;
+  size_t _image_size;
+  bool _mapped;
+  std::vector<char> _buffer;
+
+  /**
+   * sections of the opened file
+   */
+  std::vector<const char *> _sections;
+  std::vector<size_t> _section_size;
+
+  /**
+   * sections to be written
+   */
+  std::vector< std::vector<char> > _new_sections;
+
+  /**
+   * file header
+   */
+  struct Header
+  {
+    char magic[8];
+    unsigned int version;
+    unsigned int n_sections;
+    unsigned long long key;
+  };
+
+  bool _parse(unsigned long long key);
+
+  void _add_section(const void * p, size_t n);
+
+  MeshCacheFile(const MeshCacheFile &);
+  MeshCacheFile & operator = (const MeshCacheFile &);
+};
+
+
+
+/**
+ * on-disk cache of the prepared mesh. the entry begins with the mesh topology,
+ * i.e. the elem/node order computed by reorder_elems() and the neighbor table built
+ * by find_neighbors(), followed by the sections of the prepared simulation structure
+ * added by the caller, which are read in place from the mapped entry by section().
+ * the cache is content addressed: the key is a hash of the first order mesh,
+ * node locations and element connectivity, and of the build options.
+ * only level 0 serial mesh is supported, the cache is disabled otherwise.
+ *
+ * the mesh built from an input, i.e. by the mesh generator, can be cached as well
+ * by save_mesh(), so the input is not processed again on the next run.
+ */
+class MeshCache
+{
+public:
+
+  /**
+   * hash the mesh, which should be first order and not yet prepared, and the
+   * build \p options the prepared structure depends on. the cache is disabled when dir is empty
+   */
+  MeshCache(MeshBase & mesh, const std::string & dir, unsigned int options=0);
+
+  /**
+   * @return true when the cache can be used
+   */
+  bool enabled() const { return !_dir.empty(); }
+
+  /**
+   * @return the cache key
+   */
+  unsigned long long key() const { return _key; }
+
+  /**
+   * sections of the mesh topology: node order, elem order and neighbors
+   */
+  static const unsigned int n_topology_sections = 3;
+
+  /**
+   * renumber the mesh and set elem neighbors from the cache. collective,
+   * the mesh is changed only when all the processors find a valid entry.
+   * the entry stays mapped for section() until the cache is destroyed.
+   * @return true on cache hit
+   */
+  bool load();
+
+  /**
+   * @return the number of sections of the loaded entry
+   */
+  unsigned int n_sections() const
+  { return _file.n_sections(); }
+
+  /**
+   * @return section \p i of the loaded entry in place, see MeshCacheFile::section()
+   */
+  template <typename T>
+  const T * section(unsigned int i, unsigned int & n) const
+  { return _file.section<T>(i, n); }
+
+  /**
+   * record the elem/node order and neighbor table for the new entry, should be
+   * called after find_neighbors() and reorder_elems(), before the elems are replaced
+   * by convert_to_fvm_mesh()
+   */
+  void add_topology();
+
+  /**
+   * append a section of the prepared structure to the new entry
+   */
+  template <typename T>
+  void add_section(const std::vector<T> & data)
+  { _file.add_section(data); }
+
+  /**
+   * write the new entry
+   */
+  void save();
+
+  /**
+   * rebuild the mesh saved by save_mesh() with the same \p input_key,
+   * which is a hash of the input computed by the caller. the mesh should be empty.
+   * @return true on cache hit
+   */
+  static bool load_mesh(MeshBase & mesh, const std::string & dir, unsigned long long input_key);
+
+  /**
+   * save the mesh built from the input: nodes, elems, subdomains and boundary information
+   */
+  static void save_mesh(MeshBase & mesh, const std::string & dir, unsigned long long input_key);
+
+private:
+
+  MeshBase & _mesh;
+
+  std::string _dir;
+
+  unsigned long long _key;
+
+  /**
+   * elems and nodes indexed by their id at construction
+   */
+  std::vector<Elem *> _elems;
+  std::vector<Node *> _nodes;
+
+  /**
+   * total sides of all the elems
+   */
+  unsigned int _n_sides;
+
+  /**
+   * the loaded entry, or the new entry to be saved
+   */
+  MeshCacheFile _file;
+
+  template <typename T>
+  void _add(const T & v) { _key = MeshCacheFile::hash(&v, sizeof(T), _key); }
+
+  /**
+   * validate the topology sections of the loaded entry
+   */
+  bool _check_topology() const;
+
+  static std::string _file_name(const std::string & dir, unsigned long long key, const char * suffix);
+};
+
+#endif
@@ -199,6 +199,11 @@ class SerialMesh : public UnstructuredMesh
    */
   virtual void reorder_elems();
 
+  /**
+   * renumber elems and nodes by given order, elem_order[id] (node_order[id]) is the new id
+   */
+  virtual void reorder_elems(const unsigned int * elem_order, const unsigned int * node_order);
+
   /**
    * functions for reordering nodes
    */
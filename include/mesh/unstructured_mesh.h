@@ -71,15 +71,20 @@ class UnstructuredMesh : public MeshBase
 
   /**
    * Converts all the element in mesh to FVM element.
+   * when \p incremental is true, elements which are already FVM element
+   * keep their geometry unless they are flagged as JUST_REFINED/JUST_COARSENED.
+   * when \p build_geometry is false, the geometry of FVM elements which support
+   * Elem::unpack_fvm_geometry() is left to the caller, i.e. it is set from the mesh cache.
    * return true if success.
    */
-  virtual bool convert_to_fvm_mesh (std::string &error);
+  virtual bool convert_to_fvm_mesh (std::string &error, bool incremental=false, bool build_geometry=true);
 
   /**
    * Converts all the element in (2d) mesh to cylindrical FVM element.
+   * see convert_to_fvm_mesh() for \p incremental and \p build_geometry
    * return true if success.
    */
-  virtual bool convert_to_cylindrical_fvm_mesh (std::string &error);
+  virtual bool convert_to_cylindrical_fvm_mesh (std::string &error, bool incremental=false, bool build_geometry=true);
 
 
   /**
@@ -129,6 +134,15 @@ class UnstructuredMesh : public MeshBase
    */
   virtual void find_neighbors ();
 
+#ifdef ENABLE_AMR
+  /**
+   * Only update neighbor information around the elements flagged as
+   * JUST_REFINED/JUST_COARSENED by the last refinement step.
+   * Neighbor information of other elements should be valid.
+   */
+  void find_neighbors_incremental ();
+#endif
+
 #ifdef ENABLE_AMR
   /**
    * Delete subactive (i.e. children of coarsened) elements.
@@ -144,6 +158,12 @@ private:
 
   void _find_neighbors_by_ukey();
 
+  /**
+   * find neighbors by sorting the side vertex keys of all the elements,
+   * the keys are built in parallel threads and sorted by radix sort
+   */
+  void _find_neighbors_by_sort();
+
   std::vector< std::vector<unsigned int> > _subdomain_cluster;
 
 };
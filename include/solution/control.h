@@ -185,6 +185,13 @@ public:
    */
   int do_refine_hierarchical ( const Parser::Card & c );
 
+  /**
+   * adapt the mesh between two passes of a DC sweep/transient,
+   * controlled by adapt.* parameters of "SOLVE" card.
+   * the solution and electrode state are transferred to the new mesh
+   */
+  int do_refine_adaptive ( const Parser::Card & c );
+
   /**
    * process and do "REFINE.UNIFORM" card
    */
@@ -226,6 +233,11 @@ private:
    */
   int  import_mesh ();
 
+  /**
+   * create the solver given by SolverSpecify with its hooks and solve
+   */
+  int  run_solver ();
+
   /**
    * also, a solver which provides doping profile is required in most case.
    * it can be a serious process simulator,
@@ -25,6 +25,7 @@
 #define __external_circuit_h__
 
 #include <string>
+#include <vector>
 #include <complex>
 
 #include "genius_common.h"
@@ -292,6 +293,34 @@ public:
     _current_old = _current;
   }
 
+  /**
+   * append the solution and transient history of the circuit to state
+   */
+  virtual void save_state(std::vector<Real> & state) const
+  {
+    state.push_back(_Vapp);
+    state.push_back(_Iapp);
+    state.push_back(_potential);
+    state.push_back(_potential_old);
+    state.push_back(_current);
+    state.push_back(_current_old);
+  }
+
+  /**
+   * restore the circuit from state written by save_state
+   * @return the number of values used
+   */
+  virtual unsigned int load_state(const std::vector<Real> & state)
+  {
+    _Vapp          = state[0];
+    _Iapp          = state[1];
+    _potential     = state[2];
+    _potential_old = state[3];
+    _current       = state[4];
+    _current_old   = state[5];
+    return 6;
+  }
+
 
 protected:
   /**
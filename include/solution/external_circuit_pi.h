@@ -193,6 +193,27 @@ public:
    */
   virtual void tran_op_init();
 
+  /**
+   * append the solution and transient history of the circuit to state
+   */
+  virtual void save_state(std::vector<Real> & state) const
+  {
+    ExternalCircuit::save_state(state);
+    state.push_back(_V1);
+    state.push_back(_V1_last);
+  }
+
+  /**
+   * restore the circuit from state written by save_state
+   */
+  virtual unsigned int load_state(const std::vector<Real> & state)
+  {
+    unsigned int n = ExternalCircuit::load_state(state);
+    _V1      = state[n++];
+    _V1_last = state[n++];
+    return n;
+  }
+
 private:
 
   Real _r_app;
@@ -191,6 +191,27 @@ public:
     _cap_current = _cap_current_old = 0.0;
   }
 
+  /**
+   * append the solution and transient history of the circuit to state
+   */
+  virtual void save_state(std::vector<Real> & state) const
+  {
+    ExternalCircuit::save_state(state);
+    state.push_back(_cap_current);
+    state.push_back(_cap_current_old);
+  }
+
+  /**
+   * restore the circuit from state written by save_state
+   */
+  virtual unsigned int load_state(const std::vector<Real> & state)
+  {
+    unsigned int n = ExternalCircuit::load_state(state);
+    _cap_current     = state[n++];
+    _cap_current_old = state[n++];
+    return n;
+  }
+
 private:
 
   Real _res;
@@ -164,6 +164,27 @@ public:
    */
   virtual void tran_op_init();
 
+  /**
+   * append the solution and transient history of the circuit to state
+   */
+  virtual void save_state(std::vector<Real> & state) const
+  {
+    ExternalCircuit::save_state(state);
+    state.insert(state.end(), _v.begin(), _v.end());
+    state.insert(state.end(), _v_last.begin(), _v_last.end());
+  }
+
+  /**
+   * restore the circuit from state written by save_state
+   */
+  virtual unsigned int load_state(const std::vector<Real> & state)
+  {
+    unsigned int n = ExternalCircuit::load_state(state);
+    for(unsigned int i=0; i<_v.size(); ++i)      _v[i]      = state[n++];
+    for(unsigned int i=0; i<_v_last.size(); ++i) _v_last[i] = state[n++];
+    return n;
+  }
+
 private:
 
   Real _r_app;
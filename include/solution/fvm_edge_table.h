@@ -0,0 +1,166 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __fvm_edge_table_h__
+#define __fvm_edge_table_h__
+
+#include <vector>
+#include <utility>
+
+#include "fvm_node_info.h"
+
+class FVM_NodeData;
+
+/**
+ * flat edge table of a simulation region, consumed by the FVM edge loops.
+ * the edge data are stored as separate arrays (structure of arrays), the
+ * length and control volume surface area of each edge are computed once,
+ * so the kernels need neither sqrt nor searching the neighbors of FVM_Node.
+ * the dof offsets are filled for each solver index by build_offsets(),
+ * which should be called after the dof map of solver is built.
+ */
+class FVM_EdgeTable
+{
+public:
+
+  FVM_EdgeTable() {}
+
+  /**
+   * build the table from region edges, the FVM_Node should be prepared
+   */
+  void build(const std::vector< std::pair<FVM_Node *, FVM_Node *> > & edges);
+
+  /**
+   * fill the local/global offsets of current solver index
+   */
+  void build_offsets();
+
+  /**
+   * free all the data
+   */
+  void clear();
+
+  /**
+   * @return number of edges
+   */
+  unsigned int size() const { return _length.size(); }
+
+  /**
+   * @return the first FVM_Node of edge e
+   */
+  const FVM_Node * node1(unsigned int e) const { return _node[2*e]; }
+
+  /**
+   * @return the second FVM_Node of edge e
+   */
+  const FVM_Node * node2(unsigned int e) const { return _node[2*e+1]; }
+
+  /**
+   * @return the node data of the first FVM_Node of edge e
+   */
+  const FVM_NodeData * data1(unsigned int e) const { return _node_data[2*e]; }
+
+  /**
+   * @return the node data of the second FVM_Node of edge e
+   */
+  const FVM_NodeData * data2(unsigned int e) const { return _node_data[2*e+1]; }
+
+  /**
+   * @return the length of edge e
+   */
+  Real length(unsigned int e) const { return _length[e]; }
+
+  /**
+   * @return the control volume surface area between the two nodes of edge e
+   */
+  Real cv_surface_area(unsigned int e) const { return _cv_area[e]; }
+
+  /**
+   * @return true if the first FVM_Node of edge e is on processor
+   */
+  bool on_processor1(unsigned int e) const { return (_on_processor[e] & 1) != 0; }
+
+  /**
+   * @return true if the second FVM_Node of edge e is on processor
+   */
+  bool on_processor2(unsigned int e) const { return (_on_processor[e] & 2) != 0; }
+
+  /**
+   * @return the local offset of the first FVM_Node of edge e
+   */
+  unsigned int local_offset1(unsigned int e) const  { return _local_offset[FVM_Node::solver_index()][2*e]; }
+
+  /**
+   * @return the local offset of the second FVM_Node of edge e
+   */
+  unsigned int local_offset2(unsigned int e) const  { return _local_offset[FVM_Node::solver_index()][2*e+1]; }
+
+  /**
+   * @return the global offset of the first FVM_Node of edge e
+   */
+  unsigned int global_offset1(unsigned int e) const { return _global_offset[FVM_Node::solver_index()][2*e]; }
+
+  /**
+   * @return the global offset of the second FVM_Node of edge e
+   */
+  unsigned int global_offset2(unsigned int e) const { return _global_offset[FVM_Node::solver_index()][2*e+1]; }
+
+  /**
+   * @return the memory usage of the table
+   */
+  size_t memory_size() const;
+
+private:
+
+  /**
+   * the two FVM_Node of each edge
+   */
+  std::vector<FVM_Node *> _node;
+
+  /**
+   * the node data of the two FVM_Node of each edge
+   */
+  std::vector<const FVM_NodeData *> _node_data;
+
+  /**
+   * edge length
+   */
+  std::vector<Real> _length;
+
+  /**
+   * control volume surface area of each edge
+   */
+  std::vector<Real> _cv_area;
+
+  /**
+   * bit 0/1 is set when the first/second FVM_Node is on processor
+   */
+  std::vector<unsigned char> _on_processor;
+
+  /**
+   * dof offsets of the two FVM_Node of each edge, one array for each solver index
+   */
+  std::vector<unsigned int> _local_offset[4];
+  std::vector<unsigned int> _global_offset[4];
+};
+
+#endif
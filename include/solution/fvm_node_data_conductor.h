@@ -251,8 +251,8 @@ class FVM_Conductor_NodeData : public FVM_NodeData
     {
       switch ( variable )
       {
-        case POTENTIAL   :  psi() = value;                             /* potential */
-        case TEMPERATURE :  T() = value;                               /* lattice temperature */
+        case POTENTIAL   :  psi() = value; break;                      /* potential */
+        case TEMPERATURE :  T() = value; break;                        /* lattice temperature */
         default          :  return;
       }
     }
@@ -255,9 +255,9 @@ class FVM_Resistance_NodeData : public FVM_NodeData
     {
       switch ( variable )
       {
-        case POTENTIAL   :  psi() = value;                             /* potential */
-        case ELECTRON    :  n() = value;                               /* electron concentration */
-        case TEMPERATURE :  T() = value;                               /* lattice temperature */
+        case POTENTIAL   :  psi() = value; break;                      /* potential */
+        case ELECTRON    :  n() = value; break;                        /* electron concentration */
+        case TEMPERATURE :  T() = value; break;                        /* lattice temperature */
         default          :  return;
       }
     }
@@ -33,6 +33,7 @@
 #include "fvm_node_data.h"
 
 class Elem;
+class ObjectPool;
 
 /**
  * for FVM usage, we need to construct control volume (CV)
@@ -84,6 +85,21 @@ public:
    */
   ~FVM_Node();
 
+  /**
+   * FVM nodes are allocated from an arena, see ObjectPool
+   */
+  static void * operator new (size_t size);
+
+  /**
+   * return the memory to the arena
+   */
+  static void operator delete (void * p, size_t size);
+
+  /**
+   * @return the arena of FVM nodes
+   */
+  static ObjectPool & pool();
+
 
   /**
    * @return the centre node pointer
@@ -137,6 +153,12 @@ public:
    */
   void set_fvm_node_neighbor(FVM_Node *, Real, Real);
 
+  /**
+   * append fvm node neighbor which is not in the list, i.e. restored from mesh cache
+   */
+  void append_fvm_node_neighbor(FVM_Node *nb, Real s, Real abs)
+  { _fvm_node_neighbor.push_back( std::make_pair(nb, std::make_pair(s, abs)) ); }
+
   /**
    * set ghost node, which has the same root_node but in different region
    */
@@ -183,13 +205,13 @@ public:
   void truncate_cv_surface_area();
 
 
-  typedef std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator fvm_ghost_node_iterator;
+  typedef std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::const_iterator fvm_ghost_node_iterator;
 
   /**
    * @return the number of ghost node, which in different region.
    * the NULL node (indicate outside boundary) is also considered here.
    */
-  unsigned int n_ghost_node() const  {  return _ghost_nodes->size();  }
+  unsigned int n_ghost_node() const  {  return _ghost_nodes.size();  }
 
   /**
    * @return the number of ghost node, which in different region. No NULL nodes!
@@ -199,13 +221,13 @@ public:
   /**
    * @return the begin position of _ghost_nodes
    */
-  fvm_ghost_node_iterator  ghost_node_begin() const    { return _ghost_nodes->begin(); }
+  fvm_ghost_node_iterator  ghost_node_begin() const    { return _ghost_nodes.begin(); }
 
 
   /**
    * @return the end position of _ghost_nodes
    */
-  fvm_ghost_node_iterator  ghost_node_end() const      { return _ghost_nodes->end(); }
+  fvm_ghost_node_iterator  ghost_node_end() const      { return _ghost_nodes.end(); }
 
   /**
    * @return ith ghost FVM_Node
@@ -356,6 +378,12 @@ public:
    */
   void PDE_node_pattern(std::vector<std::pair<unsigned int, unsigned int> > &, bool elem_based=false) const;
 
+  /**
+   * get the PDE involved nodes themselves, the same node set counted by PDE_node_pattern().
+   * each node appears once, appended at the end of v_nodes
+   */
+  void PDE_nodes(std::vector<const FVM_Node *> & v_nodes, bool elem_based=false) const;
+
   /**
    * get PDE involved node structure. including itself and neighbor nodes, and also the ghost node and neighbors of the ghost node
    * return as <region, node_num>. when elem_based is true, all the nodes belong to neighbor elements will be returned.
@@ -526,8 +554,21 @@ private:
    * the FVM Node with same root node, but in different region
    * record the region index of ghost node as well as the area of interface
    * the NULL ghost node means this node on the boundary
+   * stored as flat array sorted by FVM_Node pointer, it has only a few entries
+   */
+  std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > > _ghost_nodes;
+
+  /**
+   * less test of ghost node entries by FVM_Node pointer
    */
-  std::map< FVM_Node *, std::pair<unsigned int, Real> > * _ghost_nodes ;
+  class GhostLess
+  {
+    public:
+      bool operator () (const std::pair<FVM_Node *, std::pair<unsigned int, Real> > &a, const std::pair<FVM_Node *, std::pair<unsigned int, Real> > &b) const
+      {
+        return a.first < b.first;
+      }
+  };
 
   /**
    * when the CV lies on region boundary, this is the vector norm to region boundary
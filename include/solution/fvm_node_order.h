@@ -0,0 +1,59 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __fvm_node_order_h__
+#define __fvm_node_order_h__
+
+#include <string>
+#include <vector>
+
+class FVM_Node;
+
+/**
+ * the iteration order of region nodes and edges. since the serial dof map
+ * numbers the nodes in region iteration order, it is also the order of dofs.
+ */
+enum FVM_NodeOrder
+{
+  /// node id order, as given by mesh generator
+  MeshNodeOrder=0,
+  /// reverse Cuthill-McKee over the FVM node graph
+  RCMNodeOrder,
+  /// Hilbert curve over node coordinates
+  HilbertNodeOrder,
+  /// Morton (Z) curve over node coordinates
+  MortonNodeOrder
+};
+
+/**
+ * convert string to FVM_NodeOrder, unknown string gives MeshNodeOrder
+ */
+FVM_NodeOrder fvm_node_order(const std::string & order);
+
+/**
+ * compute the rank of each node under given order.
+ * rank[i] is the position of nodes[i] in the new order.
+ * the neighbors of FVM_Node which are not in nodes are ignored by RCM.
+ */
+void fvm_node_order_rank(FVM_NodeOrder order, const std::vector<const FVM_Node *> & nodes, std::vector<unsigned int> & rank);
+
+#endif // #define __fvm_node_order_h__
@@ -0,0 +1,158 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __region_node_map_h__
+#define __region_node_map_h__
+
+#include <vector>
+#include <algorithm>
+
+class FVM_Node;
+
+/**
+ * the map from node id to region FVM_Node, stored as a flat vector of \<node_id, FVM_Node *\>
+ * sorted by node id. new entries are appended and the vector is sorted once at the next lookup,
+ * so building the region costs one sort instead of a tree insertion per node.
+ * the interface follows the subset of std::map used by SimulationRegion.
+ * lookup may sort the vector, it is not safe to call from concurrent threads during region build.
+ */
+class RegionNodeMap
+{
+public:
+
+  typedef std::pair<unsigned int, FVM_Node *>          value_type;
+  typedef std::vector<value_type>::iterator           iterator;
+  typedef std::vector<value_type>::const_iterator     const_iterator;
+
+  RegionNodeMap(): _sorted(true) {}
+
+  /**
+   * @return reference to FVM_Node pointer of node id for assignment, a NULL entry is created if not exist.
+   * the reference is only valid until next call of the map
+   */
+  FVM_Node * & operator[] (unsigned int id)
+  {
+    if( _sorted )
+    {
+      iterator it = _lower_bound(id);
+      if( it != _nodes.end() && (*it).first == id ) return (*it).second;
+      // keep sorted state when ids come in increasing order
+      _sorted = ( it == _nodes.end() );
+    }
+    _nodes.push_back( value_type(id, static_cast<FVM_Node *>(0)) );
+    return _nodes.back().second;
+  }
+
+  iterator find(unsigned int id)
+  {
+    _sort();
+    iterator it = _lower_bound(id);
+    if( it != _nodes.end() && (*it).first == id ) return it;
+    return _nodes.end();
+  }
+
+  const_iterator find(unsigned int id) const
+  {
+    _sort();
+    const_iterator it = std::lower_bound(_nodes.begin(), _nodes.end(), value_type(id, static_cast<FVM_Node *>(0)), IdLess());
+    if( it != _nodes.end() && (*it).first == id ) return it;
+    return _nodes.end();
+  }
+
+  iterator begin()             { _sort(); return _nodes.begin(); }
+  iterator end()               { _sort(); return _nodes.end(); }
+  const_iterator begin() const { _sort(); return _nodes.begin(); }
+  const_iterator end() const   { _sort(); return _nodes.end(); }
+
+  /**
+   * erase the entry of node id
+   */
+  void erase(unsigned int id)
+  {
+    iterator it = find(id);
+    if( it != _nodes.end() ) _nodes.erase(it);
+  }
+
+  /**
+   * erase all the entries whose FVM_Node pointer is NULL, linear time
+   */
+  void erase_null()
+  {
+    _sort();
+    iterator it = std::remove_if(_nodes.begin(), _nodes.end(), IsNull());
+    _nodes.erase(it, _nodes.end());
+  }
+
+  void clear()
+  { _nodes.clear(); _sorted = true; }
+
+  size_t size() const
+  { _sort(); return _nodes.size(); }
+
+  bool empty() const
+  { return _nodes.empty(); }
+
+  size_t memory_size() const
+  { return sizeof(*this) + _nodes.capacity()*sizeof(value_type); }
+
+private:
+
+  struct IdLess
+  {
+    bool operator() (const value_type & a, const value_type & b) const
+    { return a.first < b.first; }
+  };
+
+  struct IsNull
+  {
+    bool operator() (const value_type & a) const
+    { return a.second == 0; }
+  };
+
+  iterator _lower_bound(unsigned int id)
+  { return std::lower_bound(_nodes.begin(), _nodes.end(), value_type(id, static_cast<FVM_Node *>(0)), IdLess()); }
+
+  /**
+   * sort by id, for duplicated id the last inserted one is kept, as std::map::operator[] does
+   */
+  void _sort() const
+  {
+    if( _sorted ) return;
+    std::stable_sort(_nodes.begin(), _nodes.end(), IdLess());
+    std::vector<value_type>::iterator out = _nodes.begin();
+    for(std::vector<value_type>::iterator it = _nodes.begin(); it != _nodes.end(); ++it)
+    {
+      if( out != _nodes.begin() && (*(out-1)).first == (*it).first )
+        *(out-1) = *it;
+      else
+        *out++ = *it;
+    }
+    _nodes.erase(out, _nodes.end());
+    _sorted = true;
+  }
+
+  mutable std::vector<value_type> _nodes;
+
+  mutable bool _sorted;
+};
+
+#endif // #define __region_node_map_h__
@@ -31,6 +31,9 @@
 #include "fvm_node_info.h"
 #include "fvm_node_data.h"
 #include "fvm_cell_data.h"
+#include "fvm_edge_table.h"
+#include "fvm_node_order.h"
+#include "region_node_map.h"
 #include "petscvec.h"
 #include "petscmat.h"
 #include "advanced_model.h"
@@ -56,6 +59,7 @@ namespace Parser {
 class SolverBase;
 class MeshBase;
 class BoundaryCondition;
+class MatRowRedirect;
 namespace Material {
   class MaterialBase;
 }
@@ -461,6 +465,18 @@ public:
     return _region_edges.end();
   }
 
+  /**
+   * @return the flat edge table for FVM edge loops, in the same order as _region_edges
+   */
+  const FVM_EdgeTable & edge_table() const
+  { return _edge_table; }
+
+  /**
+   * fill the dof offsets of edge table for current solver, call it after dof map is built
+   */
+  void build_edge_table_offsets()
+  { _edge_table.build_offsets(); }
+
   /**
    * @return the corresponding location of an element's edge in _region_edges
    * by given an element pointer, and the local index of the edge
@@ -468,6 +484,24 @@ public:
   unsigned int elem_edge_index(const Elem* elem, unsigned int e) const
   { return _region_elem_edge_in_edges_index.find(elem)->second[e]; }
 
+  /**
+   * set the iteration order of region nodes and edges, call it before prepare_for_use
+   */
+  void set_node_order(FVM_NodeOrder order)
+  { _node_order = order; }
+
+  /**
+   * @return the iteration order of region nodes and edges
+   */
+  FVM_NodeOrder node_order() const
+  { return _node_order; }
+
+  /**
+   * set the row redirect table used by jacobian assembly, NULL to add values to the matrix directly
+   */
+  void set_row_redirect(MatRowRedirect * redirect)
+  { _row_redirect = redirect; }
+
   /**
    * (re)build _region_local_node and _region_processor_node for fast iteration
    */
@@ -478,6 +512,14 @@ public:
    */
   virtual void prepare_for_use();
 
+  /**
+   * pre process as prepare_for_use, but the surface area fix and region edges are
+   * restored from the mesh cache instead of being built.
+   * \p fvm_nodes are indexed by the values of \p edges, which holds the node pair of
+   * \p n_edges region edges. \p cell_edges holds the index of each edge of region cells, cell by cell
+   */
+  void restore_for_use(const std::vector<FVM_Node *> & fvm_nodes, const unsigned int * edges, unsigned int n_edges, const unsigned int * cell_edges);
+
   /**
    * for some pre process, which should be executed in parallel
    * call it after prepare_for_use
@@ -810,10 +852,30 @@ protected:
    */
   unsigned int _n_region_node;
 
+  /**
+   * the iteration order of region nodes and edges
+   */
+  FVM_NodeOrder _node_order;
+
+  /**
+   * the row redirect table of jacobian matrix, set by the solver during assembly
+   */
+  MatRowRedirect * _row_redirect;
+
+  /**
+   * all the region nodes, sorted by _node_order
+   */
+  void ordered_region_nodes(std::vector<FVM_Node *> & nodes) const;
+
+  /**
+   * remove the extra on local cells which don't have on processor node
+   */
+  void remove_extra_local_cells();
+
   /**
    *  the node belongs to this region. stored as \< node_id, FVM_Node *\>
    */
-  std::map< unsigned int, FVM_Node * > _region_node;
+  RegionNodeMap _region_node;
 
 
   /**
@@ -847,6 +909,11 @@ protected:
    */
   std::vector< std::pair<FVM_Node *, FVM_Node *> > _region_edges;
 
+  /**
+   * the flat edge table built from _region_edges
+   */
+  FVM_EdgeTable _edge_table;
+
   /**
    * the corresponding location of an element's edge in _region_edges
    * by given an element pointer, and the local index of the edge
@@ -31,6 +31,7 @@
 #include "error_vector.h"
 #include "physical_unit.h"
 #include "interpolation_base.h"
+#include "fvm_node_order.h"
 
 namespace Parser {
 class InputParser;
@@ -91,10 +92,19 @@ public:
   void set_resistive_metal_mode(bool flag)
   { _resistive_metal_mode = flag; }
 
+  /**
+   * @return directory of the mesh cache, empty for no cache
+   */
+  const std::string & mesh_cache_dir() const
+  { return _mesh_cache_dir; }
+
   /**
    * @brief build the simulation system from mesh and mesh boundary
+   * @param incremental  the mesh was built before and only changed by hierarchical refinement,
+   *                     mesh topology and FVM geometry of untouched elements are reused,
+   *                     elements are not reordered and regions, nodes and dofs are still rebuilt
    */
-  void build_simulation_system();
+  void build_simulation_system(bool incremental=false);
 
   /**
    * @brief  data initialization for each region
@@ -338,13 +348,15 @@ public:
    * type can be -- linear interpolation
    *             -- signed log interpolation
    *             -- asinh interpolation
+   * data is saved in group of variable name unless group is given
    */
-  void fill_interpolator(InterpolationBase *, const std::string &, InterpolationBase::InterpolationType /* type */) const;
+  void fill_interpolator(InterpolationBase *, const std::string &, InterpolationBase::InterpolationType /* type */,
+                         const std::string & group = std::string()) const;
 
   /**
    * get data from interpolator after mesh refinement
    */
-  void do_interpolation(const InterpolationBase *, const std::string &);
+  void do_interpolation(const InterpolationBase *, const std::string &, const std::string & group = std::string());
 
   /**
    * set unique solver name to _solver_active_history
@@ -364,6 +376,13 @@ public:
    */
   virtual size_t memory_size() const;
 
+  /**
+   * print the memory used by mesh, regions and object arenas, as well as
+   * the resident memory of each processor.
+   * it is called after the data structure is built if GLOBAL memory.report is set
+   */
+  void memory_report() const;
+
 private:
 
   /**
@@ -402,11 +421,26 @@ private:
    */
   bool _block_partition;
 
+  /**
+   * the iteration order of region nodes, edges and dofs
+   */
+  FVM_NodeOrder _node_order;
+
+  /**
+   * directory of the prepared mesh cache, empty for no cache
+   */
+  std::string _mesh_cache_dir;
+
+  /**
+   * report the memory usage after the data structure is built
+   */
+  bool _memory_report;
+
   /**
    * data structure for fvm solver
    * only build nodes which belongs to local processor
    */
-  void build_region_fvm_mesh();
+  void build_region_fvm_mesh(bool incremental=false);
 
   /**
    * all the boundary conditions
@@ -37,6 +37,7 @@
 
 // Forward declarations
 class MeshBase;
+class AsyncWriter;
 
 
 #ifdef HAVE_VTK
@@ -81,8 +82,20 @@ public:
    */
   virtual void write (const std::string& );
 
+  /**
+   * when set, write() only takes a snapshot of the solution into a vtk grid,
+   * the binary .vtu file is written later by the I/O thread of writer
+   */
+  void set_async_writer(AsyncWriter * writer)
+  { _async_writer = writer; }
+
 private:
 
+  /**
+   * background writer for .vtu file, NULL for synchronous write
+   */
+  AsyncWriter * _async_writer;
+
   // boundary info
   std::vector<unsigned int>       _el;
   std::vector<unsigned short int> _sl;
@@ -163,6 +176,8 @@ private:
   vtkUnstructuredGrid* _vtk_grid;
 
   class XMLUnstructuredGridWriter;
+
+  class VTKWriteJob;
 #endif
 
   /**
@@ -239,7 +254,7 @@ private:
 inline
 VTKIO::VTKIO (SimulationSystem& system) :
     FieldInput<SimulationSystem> (system),
-    FieldOutput<SimulationSystem> (system)
+    FieldOutput<SimulationSystem> (system), _async_writer(NULL)
 {
 #ifdef HAVE_VTK
   _vtk_grid = NULL;
@@ -250,7 +265,7 @@ VTKIO::VTKIO (SimulationSystem& system) :
 
 inline
 VTKIO::VTKIO (const SimulationSystem& system) :
-    FieldOutput<SimulationSystem>(system)
+    FieldOutput<SimulationSystem>(system), _async_writer(NULL)
 {
 #ifdef HAVE_VTK
   _vtk_grid = NULL;
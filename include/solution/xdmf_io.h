@@ -0,0 +1,180 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __xdmf_io_h__
+#define __xdmf_io_h__
+
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "enum_solution.h"
+
+class SimulationSystem;
+
+
+/**
+ * write a time series of solutions in XDMF format.
+ * the mesh geometry, topology and static data (region, doping) are written only once
+ * to prefix.mesh.bin, the solution fields of each step are appended to prefix.fields.bin.
+ * both are raw binary in native byte order, so they can be mmap-ed by post processor.
+ * the light weight index prefix.xmf, which can be loaded by paraview/visit directly,
+ * is updated after each step, so it is always valid even if the simulation is killed.
+ * the series can be continued on a new mesh, i.e. after mesh adaptation: the new mesh
+ * is appended to prefix.mesh.bin and the following steps refer to it.
+ */
+class XDMFIO
+{
+public:
+
+  /**
+   * constructor
+   * @param system    the simulation system
+   * @param prefix    prefix of output files
+   * @param single    store fields in float32 instead of float64
+   */
+  XDMFIO(const SimulationSystem & system, const std::string & prefix, bool single=true);
+
+  ~XDMFIO();
+
+  /**
+   * write mesh and static data, should be called once by all the processors
+   * @param append  continue the files written before instead of creating them
+   */
+  void write_mesh(bool append=false);
+
+  /**
+   * append solution fields of current step, should be called by all the processors
+   * @param time   the time (or bias) value of this step
+   */
+  void write_step(double time);
+
+  /**
+   * @return the number of steps written
+   */
+  unsigned int n_steps() const
+  { return _step_base + _steps.size(); }
+
+private:
+
+  /**
+   * reference to a binary data block
+   */
+  struct DataBlock
+  {
+    std::string   name;
+    std::string   file;
+    unsigned long offset;
+    unsigned int  precision;
+  };
+
+  /**
+   * gather a node based variable to processor 0, ordered by node id.
+   * invalid variable (i.e. electron density in insulator) is exported as 0
+   */
+  void _gather_node_variable(SolutionVariable variable, std::vector<double> & values) const;
+
+  /**
+   * write values to binary file, return the data block
+   */
+  DataBlock _write_block(std::ofstream & out, unsigned long & offset, const std::string & file, const std::string & name,
+                         const std::vector<double> & values, unsigned int precision);
+
+  /**
+   * begin the index file prefix.xmf
+   */
+  void _write_index_header();
+
+  /**
+   * reopen the index file prefix.xmf for appending steps
+   * @return false if the file is not a valid index
+   */
+  bool _resume_index();
+
+  /**
+   * close the xml tags of index file
+   */
+  void _write_index_footer();
+
+  /**
+   * add step s to index file, the index is kept valid after each step
+   */
+  void _append_index_step(unsigned int s);
+
+  /**
+   * write a data item of XDMF file
+   */
+  void _write_data_item(std::ofstream & out, const DataBlock & block, const std::string & dims, const std::string & type) const;
+
+  const SimulationSystem & _system;
+
+  std::string   _prefix;
+
+  /**
+   * precision of field data, 4 or 8
+   */
+  unsigned int  _precision;
+
+  /**
+   * node based variables exported at each step
+   */
+  std::vector<SolutionVariable> _variables;
+
+  /**
+   * name of the exported variables
+   */
+  std::vector<std::string>      _variable_names;
+
+  unsigned int  _n_nodes;
+  unsigned int  _n_cells;
+  unsigned int  _topology_size;
+
+  DataBlock     _geometry;
+  DataBlock     _topology;
+
+  /**
+   * static data, written with mesh
+   */
+  std::vector<DataBlock>  _node_static;
+  std::vector<DataBlock>  _cell_static;
+
+  /**
+   * time and field data of each step
+   */
+  std::vector< std::pair<double, std::vector<DataBlock> > > _steps;
+
+  /**
+   * number of steps in the index file written before
+   */
+  unsigned int _step_base;
+
+  std::ofstream _field_out;
+  unsigned long _field_offset;
+
+  /**
+   * the index file, and position of its footer
+   */
+  std::ofstream  _index_out;
+  std::streampos _footer_pos;
+};
+
+#endif
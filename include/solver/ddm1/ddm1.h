@@ -26,6 +26,7 @@
 
 #include "ddm_solver.h"
 #include "solver_specify.h"
+#include "mat_row_redirect.h"
 
 
 /**
@@ -249,6 +250,23 @@ private:
    * check for positive carrier density
    */
   void check_positive_density(Vec x, Vec y, Vec w, PetscBool *changed_y, PetscBool *changed_w);
+
+  /**
+   * evaluate the jacobian of regions, the boundary conditions are processed later
+   */
+  void _region_jacobian(PetscScalar * lxx, InsertMode & add_value_flag);
+
+  /**
+   * hand the row redirect table to regions and boundary conditions, NULL for direct assembly
+   */
+  void _set_row_redirect(MatRowRedirect * redirect);
+
+  /**
+   * row redirect table of boundary conditions, built at the first jacobian assembly.
+   * with it, region assembly adds boundary rows to their destination directly,
+   * and the jacobian matrix is assembled only once.
+   */
+  MatRowRedirect _row_redirect;
 };
 
 
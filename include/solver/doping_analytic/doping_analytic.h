@@ -121,14 +121,34 @@ private:
  double _do_doping_interp(int i, const Node *node, const std::string &msg=std::string());
 
  /**
-  * @return the acceptor concentration of node
+  * evaluate the analytic doping functions on node batches,
+  * the body of Threads::parallel_for_dynamic
   */
- double doping_Na(const Node * node);
-
- /**
-  * @return the donor concentration of node
-  */
- double doping_Nd(const Node * node);
+ class DopingBatch
+ {
+ public:
+   DopingBatch(const std::vector<DopingFunction *> &funs, const std::vector<DopingFunction *> &custom_funs,
+               const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &z);
+
+   void operator()(unsigned int begin, unsigned int end, unsigned int tid);
+
+   /**
+    * the acceptor and donor concentration of each node
+    */
+   std::vector<double> Na, Nd;
+
+   /**
+    * the value of each custom profile at each node
+    */
+   std::vector< std::vector<double> > custom;
+
+ private:
+   const std::vector<DopingFunction *> & _funs;
+   const std::vector<DopingFunction *> & _custom_funs;
+   const std::vector<double> & _x;
+   const std::vector<double> & _y;
+   const std::vector<double> & _z;
+ };
 
  /**
   * the pointer vector to DopingFunction
@@ -69,7 +69,17 @@ public:
   /**
    * virtual compute function
    */
-  virtual double profile(double x, double y, double z)=0;
+  virtual double profile(double x, double y, double z) const=0;
+
+  /**
+   * compute the doping concentration of n points at once.
+   * it may be called concurrently by several threads
+   */
+  virtual void profiles(unsigned int n, const double *x, const double *y, const double *z, double *result) const
+  {
+    for(unsigned int i=0; i<n; ++i)
+      result[i] = profile(x[i], y[i], z[i]);
+  }
 
 protected:
   /**
@@ -103,7 +113,7 @@ public:
   /**
    * compute doping concentration by point location
    */
-  double profile(double x,double y,double z);
+  double profile(double x,double y,double z) const;
 
 private:
   /**
@@ -169,7 +179,7 @@ public:
   /**
    * compute doping concentration by point location
    */
-  double profile(double x, double y, double z);
+  double profile(double x, double y, double z) const;
 
 private:
   /**
@@ -260,7 +270,12 @@ public:
   /**
    * compute doping concentration by point location
    */
-  double profile(double x, double y, double z);
+  double profile(double x, double y, double z) const;
+
+  /**
+   * compute doping concentration of n points, share the work buffer
+   */
+  void profiles(unsigned int n, const double *x, const double *y, const double *z, double *result) const;
 
 private:
 
@@ -302,14 +317,34 @@ private:
 
   PolygonUSample _mask_mesh;
 
+  /**
+   * point and normal of the mask plane
+   */
+  Point _plane_point, _plane_norm;
 
-  std::vector<double> prof_func_r(const std::vector<double> &rs) const;
+  /**
+   * location of mask mesh cell (0,0) and the steps to the next cell in each index
+   */
+  Point _loc0, _step_i, _step_j;
 
+  /**
+   * the normalization factor of lateral distribution
+   */
+  double _lnorm;
 
-  std::vector<double> prof_func_l(const std::vector<double> &dists) const;
+  /**
+   * when the doping line is normal to the mask plane and the mask mesh is orthogonal,
+   * the range function is the same for all the doping lines and the lateral gauss
+   * function is the product of the one in each index direction
+   */
+  bool _separable;
 
+  /**
+   * the doping concentration at p, buffer is the work space of lateral sum
+   */
+  double _profile(const Point &p, std::vector<double> &buffer) const;
 
-  double prof_func_lnorm() const;
+  double prof_func_r(double r) const;
 
 
 };
@@ -337,7 +372,7 @@ public:
   /**
    * compute doping concentration by point location
    */
-  double profile(double x, double y, double z);
+  double profile(double x, double y, double z) const;
 
 private:
 
@@ -401,6 +436,17 @@ private:
    */
   double _resolution_factor;
 
+  /**
+   * the axis normal to the mask plane
+   */
+  unsigned int _normal_axis;
+
+  /**
+   * true when the doping line is normal to the mask plane,
+   * then the lateral integral is separated into 1D sums
+   */
+  bool _separable;
+
   void _init(double xmin, double xmax, double ymin, double ymax, double zmin, double zmax, double theta, double phi);
 
   double _profile_r(double r) const;
@@ -31,6 +31,8 @@
 #include "petscksp.h"
 
 
+class OpticalCache;
+
 /**
  * derived from fem linear solver contex.
  */
@@ -135,43 +137,97 @@ private:
   double _incidence_angle;
 
   /**
-   * solve TE scatter problem
+   * the polarization mode of scatter problem
+   */
+  enum SCATTER_MODE {TE_Mode, TM_Mode, Unknown_Mode};
+
+  /**
+   * solve TM scatter problem for unit incident wave with zero initial phase.
+   * the rhs is linear in the incident amplitude, the solution of any power
+   * and phase at this wave length is a complex scaling of it.
    * @param lamda  wave length
-   * @param power  wave power
-   * @param phase0 wave phase
    */
-  void solve_TM_scatter_problem(double lamda, double power, double phase0);
+  void solve_TM_scatter_problem(double lamda);
 
   /**
-   * solve TM scatter problem
+   * solve TE scatter problem for unit incident wave with zero initial phase.
    * @param lamda  wave length
-   * @param power  wave power
-   * @param phase0 wave phase
    */
-  void solve_TE_scatter_problem(double lamda, double power, double phase0);
+  void solve_TE_scatter_problem(double lamda);
+
+  /**
+   * solve the assembled system, try the reduced basis first when enabled
+   */
+  void solve_scatter_problem(SCATTER_MODE mode, std::vector<Vec> & basis);
+
+  /**
+   * build the matrix A, precondition matrix PC and RHS for TE scatter problem of unit incident wave
+   */
+  void build_TE_matrix_rhs(double lamda);
+
+  /**
+   * build the matrix A, precondition matrix PC and RHS for TM scatter problem of unit incident wave
+   */
+  void build_TM_matrix_rhs(double lamda);
+
+  /**
+   * minimal residual solution of current system in the span of basis, saved in x
+   * @return true if the relative residual is below _rb_tol
+   */
+  bool reduced_basis_solve(const std::vector<Vec> & basis);
+
+  /**
+   * add the solution x (and j*x) to basis after orthonormalization
+   */
+  void extend_reduced_basis(std::vector<Vec> & basis);
+
+  /**
+   * use reduced basis built from full solutions at previous wave lengths
+   */
+  bool _rb_sweep;
 
   /**
-   * build the matrix A, precondition matrix PC and RHS for TE scatter problem
+   * relative residual to accept the reduced basis solution
    */
-  void build_TE_matrix_rhs(double lamda, double power, double phase0);
+  double _rb_tol;
 
   /**
-   * build the matrix A, precondition matrix PC and RHS for TM scatter problem
+   * max full solutions kept in each basis
    */
-  void build_TM_matrix_rhs(double lamda, double power, double phase0);
+  unsigned int _rb_size;
 
   /**
-   * save nodal solution to fvm node data structure
+   * orthonormal basis of TE/TM scatter solutions at previous wave lengths
+   */
+  std::vector<Vec> _TE_basis, _TM_basis;
+
+  /**
+   * keep the preconditioner of the previous full solve with the same mode
+   */
+  bool _pc_reuse;
+
+  /**
+   * the mode current preconditioner was built for
+   */
+  SCATTER_MODE _pc_mode;
+
+  /**
+   * save nodal solution to fvm node data structure, x is the solution of unit incident wave
    * when append is true, the new solution will be added to previous solution
    */
   void save_TE_solution(double lamda, double power, double phase0, double eta, bool eta_auto, bool append=true);
 
   /**
-   * save nodal solution to fvm node data structure
+   * save nodal solution to fvm node data structure, x is the solution of unit incident wave
    * when append is true, the new solution will be added to previous solution
    */
   void save_TM_solution(double lamda, double power, double phase0, double eta, bool eta_auto, bool append=true);
 
+  /**
+   * add everything the optical fields depend on to the key of cache
+   */
+  void hash_optical_inputs(OpticalCache & cache);
+
   /**
    * the edge chain of Absorbing Boundary
    */
@@ -293,6 +293,22 @@ protected:
    */
   VecScatter     scatter;
 
+  /**
+   * true when the local vector is the same as global vector, i.e. serial dof map,
+   * where local index set is identity. the kernels read global vector array directly.
+   */
+  bool           local_is_global;
+
+  /**
+   * get the array of v indexed by local offset. scatter v to lv only when local_is_global is false
+   */
+  PetscScalar *  get_local_array(Vec v, Vec lv);
+
+  /**
+   * restore the array got by get_local_array()
+   */
+  void           restore_local_array(Vec v, Vec lv, PetscScalar ** array);
+
   /**
    * petsc nonlinear solver contex
    */
@@ -131,6 +131,19 @@ public:
   virtual void set_extra_matrix_nonzero_pattern()
   { return; }
 
+  /**
+   * build the exact column structure of the serial matrix into csr_row_offset/csr_columns
+   * and reset n_nz to the exact row length. called at the end of set_serial_dof_map()
+   */
+  void set_serial_matrix_nonzero_columns();
+
+  /**
+   * add the columns of extra dofs, and of the boundary rows they couple to, as <row, columns>
+   * the structure should be a superset of set_extra_matrix_nonzero_pattern()
+   */
+  virtual void set_extra_matrix_nonzero_columns(std::map<PetscInt, std::vector<PetscInt> > & )
+  { return; }
+
 protected:
 
   /**
@@ -185,6 +198,17 @@ protected:
    */
   std::vector<PetscInt> n_oz;
 
+  /**
+   * row offset of the exact CSR nonzero structure of serial matrix,
+   * empty when the structure is not available
+   */
+  std::vector<PetscInt> csr_row_offset;
+
+  /**
+   * column index of the exact CSR nonzero structure of serial matrix
+   */
+  std::vector<PetscInt> csr_columns;
+
 };
 
 #endif //define __fvm_pde_solver_h__
@@ -87,6 +87,11 @@ public:
    */
   virtual void set_extra_matrix_nonzero_pattern();
 
+  /**
+   * set the matrix columns for spice circuit
+   */
+  virtual void set_extra_matrix_nonzero_columns(std::map<PetscInt, std::vector<PetscInt> > & extra_columns);
+
   /**
    * @return the extra dofs of spice circuit
    */
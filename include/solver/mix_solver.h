@@ -88,6 +88,11 @@ public:
    */
   virtual void set_extra_matrix_nonzero_pattern();
 
+  /**
+   * set the matrix columns for spice circuit
+   */
+  virtual void set_extra_matrix_nonzero_columns(std::map<PetscInt, std::vector<PetscInt> > & extra_columns);
+
 
   /**
    * call ckt_load to build spice rhs/matrix, then
@@ -32,17 +32,42 @@ class Elem;
 class ARCoatings;
 
 /**
- * class to define a light
+ * class to define a light. it is a plain value, the ray tracer keeps the rays
+ * in reused buffers and overwrites them with reset()
  */
 class LightThread
 {
 public:
 
+  LightThread()
+      :_wavelength(0.0), _init_power(0.0), _power(0.0)
+  {
+    hit_elem = NULL;
+    path_id = 0;
+  }
+
   LightThread(const Point & p, const Point & dir, const Point & E_dir, double wavelength, double init_power, double power)
       :_p(p), _dir(dir.unit()), _E_dir(E_dir), _wavelength(wavelength),
       _init_power(init_power), _power(power)
   {
     hit_elem = NULL;
+    path_id = 0;
+  }
+
+  /**
+   * set the light to a new state as the constructor does, the storage of hit points is kept
+   */
+  void reset(const Point & p, const Point & dir, const Point & E_dir, double wavelength, double init_power, double power)
+  {
+    _p = p;
+    _dir = dir.unit();
+    _E_dir = E_dir;
+    _wavelength = wavelength;
+    _init_power = init_power;
+    _power = power;
+    hit_elem = NULL;
+    result.hit_points.clear();
+    path_id = 0;
   }
 
   /**
@@ -51,9 +76,9 @@ public:
    * @param  a_band band to band absorption
    * @param  a_tail band tail absorption
    * @param  a_fc free carrier absorption
-   * @return power loss due to band/tail/fc
+   * @param  power_loss filled with power loss due to band/tail/fc
    */
-  std::vector<double> advance_to(const Point & p_end, double a_band, double a_tail, double a_fc);
+  void advance_to(const Point & p_end, double a_band, double a_tail, double a_fc, double power_loss[3]);
 
   /**
    * when light energy less than some factor (default 1e-3) of origin energy, it is dead
@@ -114,9 +139,9 @@ public:
   { return _power; }
 
   /**
-   * set the light as reflection by mirror
+   * set reflect_light as the reflection of this light by mirror
    */
-  LightThread * reflection(const Point & in_p, const Point & norm) const;
+  void reflection(const Point & in_p, const Point & norm, LightThread & reflect_light) const;
 
   /**
    * generate reflection and transmission light at interface
@@ -124,11 +149,15 @@ public:
    * @param norm the norm of interface, form material 2 to material 1
    * @param n1   refraction index of material 1
    * @param n2   refraction index of material 2
+   * @param reflect_light filled with the reflection light
+   * @param refract_light filled with the transmission light
    * @param arc  anti-reflection coating
    * @param inv  the layer order of anti-reflection coating seen by the light
+   * @return whether reflect_light and refract_light are generated
    */
-  std::pair<LightThread *, LightThread *> interface_light_gen_linear_polarized
-      (const Point & in_p, const Point & norm, double n1, double n2, const ARCoatings *arc=0, bool inv=false) const;
+  std::pair<bool, bool> interface_light_gen_linear_polarized
+      (const Point & in_p, const Point & norm, double n1, double n2,
+       LightThread & reflect_light, LightThread & refract_light, const ARCoatings *arc=0, bool inv=false) const;
 
   /**
    * pointer to the elem this light hit
@@ -140,6 +169,11 @@ public:
    */
   IntersectionResult result;
 
+  /**
+   * index of this light in the recorded ray path, see RayTraceSolver::RayPath
+   */
+  unsigned int path_id;
+
   /**
    * factor to determine it is dead
    */
@@ -165,12 +199,12 @@ private:
   /**
    * wave length of the light
    */
-  const double _wavelength;
+  double _wavelength;
 
   /**
    * initial power of this thread
    */
-  const double _init_power;
+  double _init_power;
 
   /**
    * current power of this thread
@@ -178,12 +212,14 @@ private:
   double _power;
 
   /// light refraction on simple interface
-  std::pair<LightThread *, LightThread *> _interface_light_gen_linear_polarized_simple
-      (const Point & in_p, const Point & norm, double n1, double n2 ) const;
+  std::pair<bool, bool> _interface_light_gen_linear_polarized_simple
+      (const Point & in_p, const Point & norm, double n1, double n2,
+       LightThread & reflect_light, LightThread & refract_light) const;
 
   /// light refraction on stacked interface
-  std::pair<LightThread *, LightThread *> _interface_light_gen_linear_polarized_stack
-      (const Point & in_p, const Point & norm, double n1, double n2, const ARCoatings *arc, bool inv ) const;
+  std::pair<bool, bool> _interface_light_gen_linear_polarized_stack
+      (const Point & in_p, const Point & norm, double n1, double n2,
+       LightThread & reflect_light, LightThread & refract_light, const ARCoatings *arc, bool inv ) const;
 
 
 };
@@ -50,7 +50,7 @@ public:
   /**
    * @return the first elem the light thread hit
    */
-  const Elem * hit(const LightThread *) const;
+  const Elem * hit(const LightThread &) const;
 
   /**
    * @return the first elem the ray(p,d) hit
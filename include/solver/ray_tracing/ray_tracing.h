@@ -27,18 +27,20 @@
 #include <vector>
 #include <map>
 #include <utility>
+#include <algorithm>
 
 //local include
 #include "elem.h"
 #include "edge_edge2.h"
 #include "parser.h"
 #include "solver_base.h"
+#include "ray_tracing/light_thread.h"
 
 
 class ObjectTree;
-class LightThread;
 class LightLenses;
 class ARCoatings;
+class OpticalCache;
 
 /**
  * Ray tracing program  to calculate photogeneration carriers, which is
@@ -136,62 +138,135 @@ private:
   double get_free_carrier_absorption(const Elem*, double) const;
 
   /**
-   * record all the elements which contains this Node as its vertex
+   * lists stored in one flat array, the list of key k is items[offset[k], offset[k+1])
    */
-  std::vector<std::vector<const Elem*> > _elems_shared_this_node;
+  template <typename T>
+  struct FlatTable
+  {
+    std::vector<unsigned int> offset;
+    std::vector<T> items;
+
+    unsigned int size(unsigned int k) const
+    { return offset[k+1] - offset[k]; }
+
+    const T * begin(unsigned int k) const
+    { return items.empty() ? 0 : &items[0] + offset[k]; }
+
+    void clear()
+    { offset.clear(); items.clear(); }
+  };
+
+  /**
+   * an elem and one of its side
+   */
+  typedef std::pair<const Elem*, unsigned int> ElemSide;
+
+  /**
+   * record all the elements which contains this Node as its vertex, indexed by node id
+   */
+  FlatTable<const Elem*> _elems_shared_this_node;
 
   /**
-   * build _elems_shared_this_node map
+   * build _elems_shared_this_node table
    */
   void build_elems_node_map();
 
   /**
-   * the '<' operator used in std::map _elems_shared_this_edge
+   * an edge is identified by its two global node ids, the smaller one first
+   */
+  typedef std::pair<unsigned int, unsigned int> EdgeKey;
+
+  /**
+   * @return the EdgeKey of edge e of elem, no edge element is built
    */
-  struct lt_edge
+  static EdgeKey edge_key(const Elem * elem, unsigned int e);
+
+  /**
+   * @return the index of edge in sorted edges, invalid_uint if not found
+   */
+  static unsigned int edge_index(const std::vector<EdgeKey> & edges, const EdgeKey & edge)
   {
-    bool operator()(const Elem * e1, const Elem * e2) const
-    {
-      unsigned int e1_p1 = e1->node(0);
-      unsigned int e1_p2 = e1->node(1);
-      if(e1_p1>e1_p2) std::swap(e1_p1, e1_p2);
+    std::vector<EdgeKey>::const_iterator it = std::lower_bound(edges.begin(), edges.end(), edge);
+    if(it == edges.end() || *it != edge) return invalid_uint;
+    return static_cast<unsigned int>(it - edges.begin());
+  }
 
-      unsigned int e2_p1 = e2->node(0);
-      unsigned int e2_p2 = e2->node(1);
-      if(e2_p1>e2_p2) std::swap(e2_p1, e2_p2);
+  /**
+   * all the edges of mesh, sorted
+   */
+  std::vector<EdgeKey> _edges;
 
-      if(e1_p2!=e2_p2) return e1_p2<e2_p2;
-      return e1_p1<e2_p1;
-    }
+  /**
+   * record all the elements which contains this edge, indexed by the position of edge in _edges
+   */
+  FlatTable<const Elem *> _elems_shared_this_edge;
+
+  /**
+   * build _edges and _elems_shared_this_edge table
+   */
+  void build_elems_edge_map();
+
+  /**
+   * record all the boundary/interface node to boundary/interface elem-side pair, indexed by node id
+   */
+  FlatTable<ElemSide> _boundary_node_to_elem_side_map;
+
+  /**
+   * all the boundary/interface edges, sorted
+   */
+  std::vector<EdgeKey> _boundary_edges;
+
+  /**
+   * record all the boundary/interface edge to boundary/interface elem-side pair,
+   * indexed by the position of edge in _boundary_edges
+   */
+  FlatTable<ElemSide> _boundary_edge_to_elem_side_map;
+
+  /**
+   * precomputed surface information of an elem-side
+   */
+  struct FaceInfo
+  {
+    FaceInfo() : bc(0), arc(0), reflect(false) {}
+    /// boundary condition of this side, NULL for inner side
+    const BoundaryCondition * bc;
+    /// anti-reflection coatings of this side, NULL for none
+    const ARCoatings * arc;
+    /// full reflection surface
+    bool reflect;
   };
 
   /**
-   * record all the elements which contains this edge
+   * face information of all the elem-sides, side s of elem is stored at _face_offset[elem->id()]+s
    */
-  std::map<const Elem *, std::vector<const Elem *>,  lt_edge> _elems_shared_this_edge;
+  std::vector<FaceInfo> _face_info;
 
   /**
-   * build _elems_shared_this_edge map
+   * offset of the first side of each elem in _face_info
    */
-  void build_elems_edge_map();
+  std::vector<unsigned int> _face_offset;
 
   /**
-   * record all the boundary/interface node to boundary/interface elem-side pair
+   * the neighbor elem across each elem-side and its side shared with the elem,
+   * stored as _face_info. NULL neighbor for the side on mesh boundary
    */
-  std::map<const Node *, std::vector<std::pair<const Elem*, unsigned int> > >        _boundary_node_to_elem_side_map;
+  std::vector<ElemSide> _face_neighbor;
 
   /**
-   * record all the boundary/interface edge to boundary/interface elem-side pair
+   * @return the neighbor elem-side across elem-side
    */
-  std::map<const Elem *, std::vector<std::pair<const Elem*, unsigned int> >, lt_edge> _boundary_edge_to_elem_side_map;
+  const ElemSide & face_neighbor(const Elem *elem, unsigned int side) const
+  { return _face_neighbor[_face_offset[elem->id()] + side]; }
 
   /**
-   * map elem-side to boundary condition
+   * @return the face information of elem-side
    */
-  std::map< std::pair<const Elem *, unsigned int>, const BoundaryCondition * >  _elem_to_surface_map;
+  const FaceInfo & face_info(const Elem *elem, unsigned int side) const
+  { return _face_info[_face_offset[elem->id()] + side]; }
 
   /**
-   * build boundary/interface node/edge map and _full_reflect_surface map
+   * build boundary/interface node/edge table, the face information and face neighbor table,
+   * should be called after build_anti_reflection_coating_surface_map
    */
   void build_boundary_elems_map();
 
@@ -222,9 +297,9 @@ private:
   const ARCoatings * is_anti_reflection_coating_surface(const Elem *, unsigned int) const;
 
   /**
-   * find the first elem ray hit among elements in vector
+   * find the first elem ray hit among n elements
    */
-  const Elem * ray_hit(const Point &p, const Point &dir, const std::vector<const Elem *> &, IntersectionResult&) const;
+  const Elem * ray_hit(const Point &p, const Point &dir, const Elem * const * elems, unsigned int n, IntersectionResult&) const;
 
   /**
    * find the first elem ray hit among elements in vector
@@ -275,12 +350,22 @@ private:
     double ray_area() const
     { return min_dist*min_dist; }
 
+    /**
+     * two orthogonal directions in ray start plane, d2 is zero for 2D
+     */
+    Point d1, d2;
+
     /**
      * the start point of each ray, each takes three double value as (X,Y,Z)
      * only record the rays own by local processor
      */
     std::vector<Point> ray_start_points;
 
+    /**
+     * the grid index (i, j) of each ray in start plane, ray (i, j) starts at center + i*min_dist*d1 + j*min_dist*d2
+     */
+    std::vector< std::pair<int, int> > ray_start_index;
+
     unsigned int n_on_processor_rays() const
     { return static_cast<unsigned int>(ray_start_points.size()); }
 
@@ -328,9 +413,200 @@ private:
   void define_lenses();
 
   /**
-   * do ray tracing of a single ray
+   * number of threads used to trace the rays of each wave length
+   */
+  unsigned int _n_threads;
+
+  /**
+   * launch the rays adaptively: start from a coarse ray grid, and subdivide the rays
+   * which cross small elements or differ from their neighbors in path or energy deposit
+   */
+  bool _adaptive_rays;
+
+  /**
+   * max subdivision level of adaptive rays
+   */
+  unsigned int _adapt_level;
+
+  /**
+   * relative difference of energy deposit between neighbor rays to trigger subdivision
+   */
+  double _adapt_tol;
+
+  /**
+   * rays per minimal element size, the required ray density
+   */
+  double _ray_density;
+
+  /**
+   * the energy deposit and path information of a single ray, used by adaptive ray launching
+   */
+  struct RayFootprint
+  {
+    RayFootprint() : path_key(0), last_region(invalid_uint), hmin(1e30), energy(0.0) {}
+
+    /**
+     * elem id with band and total absorption energy deposited in it
+     */
+    std::vector< std::pair<unsigned int, std::pair<double, double> > > deposit;
+
+    /**
+     * hash of the region sequence the ray (and its secondary rays) passed
+     */
+    unsigned int path_key;
+
+    /**
+     * the last region, to detect region change
+     */
+    unsigned int last_region;
+
+    /**
+     * minimal size of elements which absorbed energy
+     */
+    double hmin;
+
+    /**
+     * total energy deposit
+     */
+    double energy;
+  };
+
+  /**
+   * reuse the ray paths among wave lengths which have the same refractive index
+   */
+  bool _cache_ray_paths;
+
+  /**
+   * the recorded path of a ray and all its secondary rays.
+   * the geometry of ray path only depends on the real part of refractive index, so the path
+   * traced at one wave length can be replayed for another wave length with the same refractive
+   * index, only the absorption along each segment is recomputed.
+   */
+  struct RayPath
+  {
+    RayPath() : n_rays(1) {}
+
+    enum EventType
+    {
+      SPAWN,     // new ray 'target' with power 'value' times the power of 'ray'
+      SCALE,     // power of 'ray' is multiplied by 'value'
+      ADVANCE,   // 'ray' travels 'value' length in elem 'target'
+      DEPOSIT    // elem 'target' gets 'value' fraction of the energy lost in last ADVANCE
+    };
+
+    struct Event
+    {
+      EventType    type;
+      unsigned int ray;
+      unsigned int target;
+      double       value;
+    };
+
+    void add(EventType type, unsigned int ray, unsigned int target, double value)
+    {
+      Event e;
+      e.type = type; e.ray = ray; e.target = target; e.value = value;
+      events.push_back(e);
+    }
+
+    /**
+     * the events in the order they happened
+     */
+    std::vector<Event> events;
+
+    /**
+     * number of rays, include the origin ray (index 0) and all the secondary rays
+     */
+    unsigned int n_rays;
+  };
+
+  /**
+   * record the creation of secondary ray child from parent
+   */
+  void record_spawn(RayPath * path, const LightThread & parent, LightThread & child) const;
+
+  /**
+   * add everything the optical fields depend on to the key of cache
+   */
+  void hash_optical_inputs(OpticalCache & cache);
+
+  /**
+   * split the optical sources into groups, the sources in one group share the same ray path.
+   * the first source of each group is traced, and the others replay its ray paths.
+   */
+  void group_optical_sources(std::vector< std::vector<unsigned int> > & groups);
+
+  /**
+   * replay the ray path with current refractive index and wave length, the energy deposit is added to the arrays
+   */
+  void replay_ray_path(const RayPath & path, double power, double lamda,
+                       std::vector<double> & band_absorption_energy_in_elem,
+                       std::vector<double> & total_absorption_energy_in_elem) const;
+
+  /**
+   * trace all the rays of one wave length with adaptive ray launching
+   */
+  void adaptive_ray_tracing(double lamda, double intensity);
+
+  /**
+   * add weight times energy deposit to elem in the arrays, or to the footprint of the ray if it is not NULL.
+   * the deposit is also recorded to ray path if it is not NULL
+   */
+  void deposit_energy(const Elem * elem, double weight, double band, double total,
+                      std::vector<double> & band_absorption_energy_in_elem,
+                      std::vector<double> & total_absorption_energy_in_elem,
+                      RayFootprint * footprint, RayPath * path) const;
+
+  /**
+   * trace a batch of rays in one thread, see ray_tracing.cc
+   */
+  class RayBatchTracer;
+
+  /**
+   * working storage of ray_tracing, each thread owns one and reuses it for all the rays it traces.
+   * the rays are kept by value, and the slots are overwritten instead of reallocated
+   */
+  struct RayBuffer
+  {
+    RayBuffer() : n_rays(0) {}
+
+    /**
+     * stack of the rays wait for tracing, the first n_rays slots are in use
+     */
+    std::vector<LightThread> rays;
+    unsigned int n_rays;
+
+    /**
+     * the ray being traced, and the secondary rays it generates at interface
+     */
+    LightThread current, reflect, refract;
+
+    /**
+     * the candidate elems around an interior edge
+     */
+    std::vector<const Elem *> edge_candidates;
+
+    void push(const LightThread & ray)
+    {
+      if(n_rays == rays.size()) rays.push_back(ray);
+      else rays[n_rays] = ray;
+      ++n_rays;
+    }
+
+    void pop()
+    { current = rays[--n_rays]; }
+  };
+
+  /**
+   * do ray tracing of a single ray, the energy deposit is added to the given arrays,
+   * or recorded in footprint when it is given. the ray path is recorded when path is given.
+   * it only reads the shared data of the solver, so rays can be traced concurrently
+   * as long as each thread has its own buffer and deposit arrays.
    */
-  void ray_tracing(LightThread *);
+  void ray_tracing(const LightThread & ray, RayBuffer & buffer,
+                   std::vector<double> & band_absorption_energy_in_elem,
+                   std::vector<double> & total_absorption_energy_in_elem,
+                   RayFootprint * footprint=0, RayPath * path=0) const;
 
   /**
    * save the energy deposit. for parallel simulation, we must gather this vector
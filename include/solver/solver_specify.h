@@ -454,6 +454,24 @@ namespace SolverSpecify
    */
   extern int       DC_Cycles;
 
+  /**
+   * number of accepted DC/transient steps between two mesh adaptations,
+   * 0 means no adaptation during the solve
+   */
+  extern int       AdaptInterval;
+
+  /**
+   * set by the solver when it stops to let the mesh be adapted,
+   * the sweep will be continued on the new mesh
+   */
+  extern bool      AdaptRequest;
+
+  /**
+   * true for the solver passes after a mesh adaptation, the output hooks
+   * continue the files written by previous pass instead of creating them
+   */
+  extern bool      AdaptResume;
+
 
   /**
    * use node set, only for mixA solver
@@ -60,10 +60,16 @@ public:
    */
   Sphere bounding_sphere() const;
 
+  /**
+   * @return the parameters of active lenses in order, for identify the lens setup
+   */
+  std::vector<double> active_lens_parameters() const;
+
   /**
    * apply lens to light thread
+   * @return false if the light is lost in lenses
    */
-  LightThread * operator << (LightThread *) const;
+  bool operator << (LightThread &) const;
 
 private:
 
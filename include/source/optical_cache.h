@@ -0,0 +1,123 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __optical_cache_h__
+#define __optical_cache_h__
+
+#include <string>
+#include <vector>
+
+#include "genius_common.h"
+
+namespace Parser{
+  class Card;
+}
+class SimulationSystem;
+
+/**
+ * on-disk cache of the optical fields deposited by RAYTRACE/EMFEM2D solver.
+ * the cache is content addressed: the key is a hash of the mesh, the regions,
+ * the light source card and everything the solver adds by add(), i.e. the
+ * optical parameters of each region at each wave length.
+ * the change of OptG, OptQ, OptE, OptE_complex and OptH_complex made by the
+ * solver is saved for each local node, each processor writes its own file.
+ * any change of input gives a new key, so the stale entry is never used.
+ */
+class OpticalCache
+{
+public:
+
+  /**
+   * hash the mesh, regions and the card. the cache directory is given by
+   * parameter optical.cache of the card, the cache is disabled without it.
+   */
+  OpticalCache(SimulationSystem & system, const Parser::Card & c);
+
+  /**
+   * @return true when the cache directory is given
+   */
+  bool enabled() const { return !_dir.empty(); }
+
+  /**
+   * add solver dependent data to the key
+   */
+  void add(const std::string & s);
+  void add(double v);
+  void add(int v);
+  void add(unsigned int v);
+  void add(const Complex & v);
+
+  /**
+   * @return the cache key
+   */
+  unsigned long long key() const { return _key; }
+
+  /**
+   * load the optical fields from the cache. collective, the fields are updated
+   * only when all the processors find a complete entry.
+   * @return true on cache hit
+   */
+  bool load();
+
+  /**
+   * record the optical fields before solve
+   */
+  void snapshot();
+
+  /**
+   * save the change of the optical fields since snapshot()
+   */
+  void save();
+
+private:
+
+  SimulationSystem & _system;
+
+  std::string _dir;
+
+  unsigned long long _key;
+
+  /**
+   * number of values recorded for each node
+   */
+  static const unsigned int _n_values = 7;
+
+  /**
+   * region and root node id of each local node, with its optical fields
+   */
+  struct Record
+  {
+    unsigned int region;
+    unsigned int node;
+    double value[_n_values];
+  };
+
+  std::vector<Record> _snapshot;
+
+  void _add_bytes(const void * p, size_t n);
+
+  void _read_records(std::vector<Record> & records) const;
+
+  std::string _file_name() const;
+};
+
+#endif
@@ -219,6 +219,12 @@ private:
   std::vector<track_t> _tracks;
 
   void _read_particle_profile_track(const std::string &, Real );
+
+  /**
+   * batched deposition of all the tracks to spatially binned FVM nodes,
+   * defined in particle_source.cc
+   */
+  class TrackBatch;
 };
 
 
@@ -0,0 +1,123 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __async_writer_h__
+#define __async_writer_h__
+
+#include <deque>
+
+#include "threads.h"
+
+/**
+ * write files in a background thread.
+ * the caller takes a snapshot of the data it wants to write into a Job,
+ * and submit it to the writer. the job is then executed by a dedicated I/O thread,
+ * so the solver does not wait on disk. at most max_queue jobs are pending,
+ * submit() blocks when the queue is full, which bounds the memory held by snapshots.
+ * if the I/O thread can not be started (or without pthread support), jobs are executed in submit().
+ */
+class AsyncWriter
+{
+public:
+
+  /**
+   * a snapshot of data to be written
+   */
+  class Job
+  {
+  public:
+    virtual ~Job() {}
+
+    /**
+     * do the write, called by the I/O thread
+     */
+    virtual void write()=0;
+  };
+
+  /**
+   * constructor, start the I/O thread, fall back to synchronous write if it fails
+   */
+  AsyncWriter(unsigned int max_queue=2);
+
+  /**
+   * destructor, wait all the pending jobs to finish and stop the I/O thread
+   */
+  ~AsyncWriter();
+
+  /**
+   * submit a job, AsyncWriter takes the ownership of it
+   */
+  void submit(Job * job);
+
+  /**
+   * wait all the pending jobs to finish
+   */
+  void flush();
+
+private:
+
+  class IOThread;
+
+  /**
+   * the loop of I/O thread
+   */
+  void _process();
+
+  /**
+   * pending jobs
+   */
+  std::deque<Job *> _queue;
+
+  /**
+   * max pending jobs
+   */
+  unsigned int _max_queue;
+
+  /**
+   * true when a job is being written
+   */
+  bool _busy;
+
+  /**
+   * true when the I/O thread should exit
+   */
+  bool _stop;
+
+  Threads::Mutex _mutex;
+
+  /**
+   * signaled when a job is submitted or the writer stops
+   */
+  Threads::ConditionVariable _job_ready;
+
+  /**
+   * signaled when a job is finished
+   */
+  Threads::ConditionVariable _job_done;
+
+  /**
+   * the I/O thread, NULL for synchronous write
+   */
+  IOThread * _thread;
+};
+
+#endif
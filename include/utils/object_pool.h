@@ -0,0 +1,108 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#ifndef __object_pool_h__
+#define __object_pool_h__
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "threads.h"
+
+/**
+ * arena for objects of one class hierarchy, used by class specific
+ * operator new/delete. objects are carved from large contiguous chunks,
+ * one block pool for each object size, so objects created in sequence lie
+ * next to each other in memory. freed blocks are kept in a free list for
+ * reuse, the chunks are never returned to system.
+ * the pool is thread safe.
+ */
+class ObjectPool
+{
+public:
+
+  /**
+   * the name is used in memory report
+   */
+  ObjectPool(const std::string & name, size_t objects_per_chunk=4096);
+
+  ~ObjectPool();
+
+  /**
+   * allocate a block of size bytes
+   */
+  void * allocate(size_t size);
+
+  /**
+   * return a block of size bytes to the pool
+   */
+  void deallocate(void * p, size_t size);
+
+  /**
+   * @return the name of the pool
+   */
+  const std::string & name() const { return _name; }
+
+  /**
+   * @return the number of objects in use
+   */
+  size_t n_objects() const;
+
+  /**
+   * @return the memory reserved by the pool
+   */
+  size_t memory_size() const;
+
+private:
+
+  /**
+   * pool of blocks with the same size
+   */
+  struct BlockPool
+  {
+    size_t block_size;
+    std::vector<char *> chunks;
+    /// head of free list, each free block stores the pointer to next one
+    void * free_list;
+    /// the unused part of last chunk
+    char * next;
+    char * end;
+    size_t n_used;
+  };
+
+  std::string _name;
+
+  size_t _objects_per_chunk;
+
+  /**
+   * block pools indexed by size in unit of pointer size
+   */
+  std::vector<BlockPool *> _block_pools;
+
+  mutable Threads::Mutex _mutex;
+
+  ObjectPool(const ObjectPool &);
+  ObjectPool & operator= (const ObjectPool &);
+};
+
+#endif
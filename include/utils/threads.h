@@ -0,0 +1,354 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+#ifndef __genius_threads_h__
+#define __genius_threads_h__
+
+#include "genius_common.h"
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+
+#include <vector>
+
+/**
+ * light weight thread support for shared memory parallel work inside one processor.
+ * when genius is built without pthread, everything degrades to serial execution:
+ * Thread::start() fails, parallel_for runs all the chunks in the calling thread and locks do nothing.
+ */
+namespace Threads
+{
+
+  /**
+   * @return the number of threads each processor may use.
+   * it can be set by environment variable GENIUS_NUM_THREADS or GLOBAL threads parameter,
+   * otherwise one thread per processor is used
+   */
+  unsigned int n_threads();
+
+  /**
+   * set the number of threads each processor may use
+   */
+  void set_n_threads(unsigned int n);
+
+
+  /**
+   * simple mutex
+   */
+  class Mutex
+  {
+  public:
+    Mutex();
+
+    ~Mutex();
+
+    void lock();
+
+    void unlock();
+
+  private:
+
+    Mutex(const Mutex &);
+    Mutex & operator= (const Mutex &);
+
+#ifdef HAVE_PTHREAD
+    pthread_mutex_t _mutex;
+#endif
+
+    friend class ConditionVariable;
+  };
+
+
+  /**
+   * lock the mutex in constructor and unlock it in destructor
+   */
+  class ScopedLock
+  {
+  public:
+    ScopedLock(Mutex & m): _mutex(m)
+    { _mutex.lock(); }
+
+    ~ScopedLock()
+    { _mutex.unlock(); }
+
+  private:
+    Mutex & _mutex;
+  };
+
+
+  /**
+   * condition variable works with Mutex
+   */
+  class ConditionVariable
+  {
+  public:
+    ConditionVariable();
+
+    ~ConditionVariable();
+
+    /**
+     * atomically unlock the mutex and wait, the mutex is locked again on return
+     */
+    void wait(Mutex & m);
+
+    /**
+     * wake up one waiting thread
+     */
+    void signal();
+
+    /**
+     * wake up all the waiting threads
+     */
+    void broadcast();
+
+  private:
+
+    ConditionVariable(const ConditionVariable &);
+    ConditionVariable & operator= (const ConditionVariable &);
+
+#ifdef HAVE_PTHREAD
+    pthread_cond_t _cond;
+#endif
+  };
+
+
+  /**
+   * base class of a thread, derived class should implement run()
+   */
+  class Thread
+  {
+  public:
+    Thread();
+
+    /**
+     * the thread should be joined before destroy
+     */
+    virtual ~Thread();
+
+    /**
+     * start the thread.
+     * @return false if the thread can not be created (or without pthread support),
+     * run() is not executed then, the caller should do the job itself.
+     */
+    bool start();
+
+    /**
+     * wait the thread to finish
+     */
+    void join();
+
+  protected:
+
+    /**
+     * the job of this thread
+     */
+    virtual void run()=0;
+
+  private:
+
+    Thread(const Thread &);
+    Thread & operator= (const Thread &);
+
+    bool _started;
+
+#ifdef HAVE_PTHREAD
+    pthread_t _thread;
+
+    static void * _entry(void *);
+#endif
+  };
+
+
+
+  /**
+   * aux class for parallel_for, run body on [begin, end)
+   */
+  template <typename Body>
+  class RangeThread : public Thread
+  {
+  public:
+    RangeThread(Body & body, unsigned int begin, unsigned int end, unsigned int tid)
+      : _body(body), _begin(begin), _end(end), _tid(tid) {}
+
+    void execute()
+    { _body(_begin, _end, _tid); }
+
+  protected:
+    virtual void run()
+    { this->execute(); }
+
+  private:
+    Body & _body;
+    unsigned int _begin;
+    unsigned int _end;
+    unsigned int _tid;
+  };
+
+
+  /**
+   * split [begin, end) into at most n_threads contiguous chunks and call
+   * body(chunk_begin, chunk_end, thread_id) for each chunk concurrently.
+   * the first chunk is executed by the calling thread.
+   * body must not modify data shared with other chunks without locking.
+   */
+  template <typename Body>
+  void parallel_for(unsigned int begin, unsigned int end, Body & body, unsigned int n_threads = Threads::n_threads())
+  {
+    if( end <= begin ) return;
+
+    unsigned int n = end - begin;
+    if( n_threads > n ) n_threads = n;
+    if( n_threads <= 1 )
+    {
+      body(begin, end, 0);
+      return;
+    }
+
+    unsigned int chunk = n/n_threads;
+    unsigned int remain = n%n_threads;
+
+    std::vector< RangeThread<Body> * > threads;
+    unsigned int b = begin;
+    for( unsigned int t=0; t<n_threads; ++t )
+    {
+      unsigned int e = b + chunk + (t < remain ? 1 : 0);
+      threads.push_back( new RangeThread<Body>(body, b, e, t) );
+      b = e;
+    }
+
+    std::vector<bool> started(threads.size(), true);
+    for( unsigned int t=1; t<threads.size(); ++t )
+      started[t] = threads[t]->start();
+
+    threads[0]->execute();
+
+    // the chunks whose thread can not be created
+    for( unsigned int t=1; t<threads.size(); ++t )
+      if( !started[t] ) threads[t]->execute();
+
+    for( unsigned int t=1; t<threads.size(); ++t )
+      threads[t]->join();
+
+    for( unsigned int t=0; t<threads.size(); ++t )
+      delete threads[t];
+  }
+
+
+  /**
+   * shared cursor of parallel_for_dynamic, threads take [cursor, cursor+grain) one by one
+   */
+  class DynamicRange
+  {
+  public:
+    DynamicRange(unsigned int begin, unsigned int end, unsigned int grain)
+      : _cursor(begin), _end(end), _grain(grain ? grain : 1) {}
+
+    /**
+     * take the next chunk, @return false when the range is exhausted
+     */
+    bool next(unsigned int & b, unsigned int & e)
+    {
+      ScopedLock lock(_mutex);
+      if( _cursor >= _end ) return false;
+      b = _cursor;
+      e = (_end - _cursor > _grain) ? _cursor + _grain : _end;
+      _cursor = e;
+      return true;
+    }
+
+  private:
+    Mutex        _mutex;
+    unsigned int _cursor;
+    unsigned int _end;
+    unsigned int _grain;
+  };
+
+
+  /**
+   * aux class for parallel_for_dynamic, run body on chunks taken from shared range
+   */
+  template <typename Body>
+  class DynamicRangeThread : public Thread
+  {
+  public:
+    DynamicRangeThread(Body & body, DynamicRange & range, unsigned int tid)
+      : _body(body), _range(range), _tid(tid) {}
+
+    void execute()
+    {
+      unsigned int b, e;
+      while( _range.next(b, e) )
+        _body(b, e, _tid);
+    }
+
+  protected:
+    virtual void run()
+    { this->execute(); }
+
+  private:
+    Body & _body;
+    DynamicRange & _range;
+    unsigned int _tid;
+  };
+
+
+  /**
+   * like parallel_for, but the threads take chunks of grain items from [begin, end) on demand,
+   * so the load is balanced when the cost of items varies a lot.
+   * body(chunk_begin, chunk_end, thread_id) may be called many times by one thread.
+   */
+  template <typename Body>
+  void parallel_for_dynamic(unsigned int begin, unsigned int end, unsigned int grain, Body & body, unsigned int n_threads = Threads::n_threads())
+  {
+    if( end <= begin ) return;
+
+    if( grain == 0 ) grain = 1;
+    unsigned int n_chunk = (end - begin + grain - 1)/grain;
+    if( n_threads > n_chunk ) n_threads = n_chunk;
+    if( n_threads <= 1 )
+    {
+      body(begin, end, 0);
+      return;
+    }
+
+    DynamicRange range(begin, end, grain);
+
+    std::vector< DynamicRangeThread<Body> * > threads;
+    for( unsigned int t=0; t<n_threads; ++t )
+      threads.push_back( new DynamicRangeThread<Body>(body, range, t) );
+
+    // the range is drained by the started threads, a thread which can not be created is simply skipped
+    for( unsigned int t=1; t<threads.size(); ++t )
+      threads[t]->start();
+
+    threads[0]->execute();
+
+    for( unsigned int t=1; t<threads.size(); ++t )
+      threads[t]->join();
+
+    for( unsigned int t=0; t<threads.size(); ++t )
+      delete threads[t];
+  }
+
+}
+
+#endif
@@ -335,7 +335,7 @@ bool consistent_bc_by_subdomain(const std::string &mat1, const std::string &mat2
 BoundaryCondition::BoundaryCondition(SimulationSystem  & system, const std::string & label)
   : _system(system), _boundary_name(label), _boundary_id(BoundaryInfo::invalid_id), _bc_regions(NULL, NULL), _link_to_spice(false),
     _ext_circuit(NULL), _z_width(system.z_width()),
-    _T_Ext(system.T_external()), _inter_connect_hub(0)
+    _T_Ext(system.T_external()), _inter_connect_hub(0), _row_redirect(0)
 {
   for(int i=0; i<4; ++i)
   {
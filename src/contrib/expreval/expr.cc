@@ -150,4 +150,13 @@ double Expression::Evaluate()
         throw(EmptyExpressionException());
         }    
     }
+
+// Lower an expression
+int Expression::Lower(Lowering &lowering) const
+    {
+    if(m_expr)
+        return m_expr->Lower(lowering);
+
+    return -1;
+    }
             
@@ -18,6 +18,7 @@ namespace ExprEval
     class FunctionList;
     class DataList;
     class Node;
+    class Lowering;
     
     // Expression class
     //--------------------------------------------------------------------------
@@ -52,6 +53,9 @@ namespace ExprEval
             
             // Evaluate expression
             double Evaluate();
+
+            // Lower the parsed expression, returns -1 if it can not be lowered
+            int Lower(Lowering &lowering) const;
             
         protected:
             ValueList *m_vlist;
@@ -943,7 +943,7 @@ namespace
                                 a9 = -0.82215223,  a10 = 0.17087277;
 
                   double result = 1; // The return value
-                  double x = m_nodes[1]->Evaluate();
+                  double x = m_nodes[0]->Evaluate();
                   double z = fabs(x);
 
                   if (z <= 0) return result; // erfc(0)=1
@@ -997,7 +997,7 @@ namespace
                                 a9 = -0.82215223,  a10 = 0.17087277;
 
                   double result = 1; // The return value
-                  double x = m_nodes[1]->Evaluate();
+                  double x = m_nodes[0]->Evaluate();
                   double z = fabs(x);
 
                   if (z <= 0) return result; // erfc(0)=1
@@ -43,6 +43,12 @@ double Node::Evaluate()
     return DoEvaluate();
     }
 
+// Lower
+int Node::Lower(Lowering &/*lowering*/) const
+    {
+    return -1;
+    }
+
 // Function node
 //------------------------------------------------------------------------------
 
@@ -70,6 +76,25 @@ string FunctionNode::GetName() const
     return m_factory->GetName();
     }
 
+// Lower
+int FunctionNode::Lower(Lowering &lowering) const
+    {
+    if(!m_refs.empty() || !m_data.empty())
+        return -1;
+
+    vector<int> args(m_nodes.size());
+    vector<Node*>::size_type pos;
+
+    for(pos = 0; pos < m_nodes.size(); pos++)
+        {
+        args[pos] = m_nodes[pos]->Lower(lowering);
+        if(args[pos] < 0)
+            return -1;
+        }
+
+    return lowering.Operator(GetName(), args);
+    }
+
 // Set argument count
 void FunctionNode::SetArgumentCount(long argMin, long argMax, long refMin, long refMax,
         long dataMin, long dataMax)
@@ -563,6 +588,18 @@ double AddNode::DoEvaluate()
     return m_lhs->Evaluate() + m_rhs->Evaluate();
     }
 
+// Lower
+int AddNode::Lower(Lowering &lowering) const
+    {
+    vector<int> args(2);
+    args[0] = m_lhs->Lower(lowering);
+    args[1] = m_rhs->Lower(lowering);
+    if(args[0] < 0 || args[1] < 0)
+        return -1;
+
+    return lowering.Operator("+", args);
+    }
+
 // Parse
 void AddNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -607,6 +644,18 @@ double SubtractNode::DoEvaluate()
     return m_lhs->Evaluate() - m_rhs->Evaluate();
     }
 
+// Lower
+int SubtractNode::Lower(Lowering &lowering) const
+    {
+    vector<int> args(2);
+    args[0] = m_lhs->Lower(lowering);
+    args[1] = m_rhs->Lower(lowering);
+    if(args[0] < 0 || args[1] < 0)
+        return -1;
+
+    return lowering.Operator("-", args);
+    }
+
 // Parse
 void SubtractNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -651,6 +700,18 @@ double MultiplyNode::DoEvaluate()
     return m_lhs->Evaluate() * m_rhs->Evaluate();
     }
 
+// Lower
+int MultiplyNode::Lower(Lowering &lowering) const
+    {
+    vector<int> args(2);
+    args[0] = m_lhs->Lower(lowering);
+    args[1] = m_rhs->Lower(lowering);
+    if(args[0] < 0 || args[1] < 0)
+        return -1;
+
+    return lowering.Operator("*", args);
+    }
+
 // Parse
 void MultiplyNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -704,6 +765,18 @@ double DivideNode::DoEvaluate()
         }
     }
 
+// Lower
+int DivideNode::Lower(Lowering &lowering) const
+    {
+    vector<int> args(2);
+    args[0] = m_lhs->Lower(lowering);
+    args[1] = m_rhs->Lower(lowering);
+    if(args[0] < 0 || args[1] < 0)
+        return -1;
+
+    return lowering.Operator("/", args);
+    }
+
 // Parse
 void DivideNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -747,6 +820,17 @@ double NegateNode::DoEvaluate()
     return -(m_rhs->Evaluate());
     }
 
+// Lower
+int NegateNode::Lower(Lowering &lowering) const
+    {
+    vector<int> args(1);
+    args[0] = m_rhs->Lower(lowering);
+    if(args[0] < 0)
+        return -1;
+
+    return lowering.Operator("neg", args);
+    }
+
 // Parse
 void NegateNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -796,6 +880,18 @@ double ExponentNode::DoEvaluate()
     return result;
     }
 
+// Lower
+int ExponentNode::Lower(Lowering &lowering) const
+    {
+    vector<int> args(2);
+    args[0] = m_lhs->Lower(lowering);
+    args[1] = m_rhs->Lower(lowering);
+    if(args[0] < 0 || args[1] < 0)
+        return -1;
+
+    return lowering.Operator("^", args);
+    }
+
 // Parse
 void ExponentNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -837,6 +933,12 @@ double VariableNode::DoEvaluate()
     return *m_var;
     }
 
+// Lower
+int VariableNode::Lower(Lowering &lowering) const
+    {
+    return lowering.Variable(m_var);
+    }
+
 // Parse
 void VariableNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -907,6 +1009,12 @@ double ValueNode::DoEvaluate()
     return m_val;
     }
 
+// Lower
+int ValueNode::Lower(Lowering &lowering) const
+    {
+    return lowering.Value(m_val);
+    }
+
 // Parse
 void ValueNode::Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
         Parser::size_type v1)
@@ -20,6 +20,20 @@ namespace ExprEval
     class FunctionFactory;
     class DataEntry;
 
+    // Lowering interface
+    //--------------------------------------------------------------------------
+    // Used by external compilers to translate the parsed tree into another
+    // form.  Each method returns a handle of the value, or -1 on failure.
+    class Lowering
+        {
+        public:
+            virtual ~Lowering() {}
+
+            virtual int Value(double val) = 0;
+            virtual int Variable(const double *var) = 0;
+            virtual int Operator(const ::std::string &name, const ::std::vector<int> &args) = 0;
+        };
+
     // Node class
     //--------------------------------------------------------------------------
     class Node
@@ -34,6 +48,9 @@ namespace ExprEval
 
             double Evaluate(); // Calls Expression::TestAbort, then DoEvaluate
 
+            // Lower the node, returns -1 if the node can not be lowered
+            virtual int Lower(Lowering &lowering) const;
+
         protected:
             Expression *m_expr;
         };
@@ -50,6 +67,10 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            // Lower by function name, functions with reference or data
+            // arguments can not be lowered
+            int Lower(Lowering &lowering) const;
+
 
         private:
             // Function factory
@@ -124,6 +145,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             Node *m_lhs;
             Node *m_rhs;
@@ -141,6 +164,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             Node *m_lhs;
             Node *m_rhs;
@@ -158,6 +183,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             Node *m_lhs;
             Node *m_rhs;
@@ -175,6 +202,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             Node *m_lhs;
             Node *m_rhs;
@@ -192,6 +221,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             Node *m_rhs;
         };
@@ -208,6 +239,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             Node *m_lhs;
             Node *m_rhs;
@@ -225,6 +258,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             double *m_var;
         };
@@ -241,6 +276,8 @@ namespace ExprEval
             void Parse(Parser &parser, Parser::size_type start, Parser::size_type end,
                     Parser::size_type v1 = 0);
 
+            int Lower(Lowering &lowering) const;
+
         private:
             double m_val;
         };
@@ -165,9 +165,21 @@ void Edge2::connectivity(const unsigned int sc,
 
 
 void Edge2::ray_hit(const Point &point , const Point &d , IntersectionResult &result, unsigned int) const
+{
+  Hit_Point hit_points[2];
+  unsigned int n_hit_points = ray_hit_segment(this->point(0), this->point(1), point, d, result.state, hit_points);
+  result.hit_points.assign(hit_points, hit_points+n_hit_points);
+}
+
+
+
+unsigned int Edge2::ray_hit_segment(const Point &a, const Point &b, const Point &point, const Point &d,
+                                    IntersectionState & state, Hit_Point hit_points[2])
 {
   // if point is far away, numerical error may cause some problem. move point something close.
-  Sphere sphere(this->bounding_sphere());
+  // the same as bounding_sphere() of the edge
+  Point center = 0.5*(a+b);
+  Sphere sphere(center, (1+1e-6)*std::max((center-a).size(), (center-b).size()));
 
   // p = point + d*t1
   Point p = point;
@@ -176,15 +188,15 @@ void Edge2::ray_hit(const Point &point , const Point &d , IntersectionResult &re
   {
     if(!sphere.intersect_point(point, d, t1, t2))
     {
-      result.state = Missed;
-      return;
+      state = Missed;
+      return 0;
     }
     p = point + t1*d;
   }
 
 
-  Point p0 = this->point(0);
-  Point d0 = (this->point(1)-this->point(0)).unit();
+  Point p0 = a;
+  Point d0 = (b-a).unit();
 
   double h = (d.cross(d0)).size();
 
@@ -196,29 +208,27 @@ void Edge2::ray_hit(const Point &point , const Point &d , IntersectionResult &re
     // two lines are overlap
     if(dist<1e-10)
     {
-      result.state = Overlap_Edge;
-
-      result.hit_points.resize(2);
+      state = Overlap_Edge;
 
-      result.hit_points[0].p = this->point(0);
-      result.hit_points[0].t = d.dot((this->point(0) - p)) + t1;
-      result.hit_points[0].point_location = on_vertex;
-      result.hit_points[0].mark = 0;
+      hit_points[0].p = a;
+      hit_points[0].t = d.dot((a - p)) + t1;
+      hit_points[0].point_location = on_vertex;
+      hit_points[0].mark = 0;
 
-      result.hit_points[1].p = this->point(1);
-      result.hit_points[1].t = d.dot((this->point(1) - p)) + t1;
-      result.hit_points[1].point_location = on_vertex;
-      result.hit_points[1].mark = 1;
+      hit_points[1].p = b;
+      hit_points[1].t = d.dot((b - p)) + t1;
+      hit_points[1].point_location = on_vertex;
+      hit_points[1].mark = 1;
 
-      if(result.hit_points[0].t > result.hit_points[1].t)
-        std::swap(result.hit_points[0], result.hit_points[1]);
+      if(hit_points[0].t > hit_points[1].t)
+        std::swap(hit_points[0], hit_points[1]);
 
-      return;
+      return 2;
     }
     else // no intersection
     {
-      result.state = Missed;
-      return;
+      state = Missed;
+      return 0;
     }
   }
 
@@ -229,39 +239,37 @@ void Edge2::ray_hit(const Point &point , const Point &d , IntersectionResult &re
   double t  = T.det() /(h*h);
 
   Point near_point = p+t*d;
-  double length = (this->point(1)-this->point(0)).size();
+  double length = (b-a).size();
 
   // has one intersection
   if( ((p0+t0*d0) - (near_point)).size()<1e-10 && t0>-1e-10 && t0<length+1e-10 )
   {
-    result.state = Intersect_Body;
-
-    result.hit_points.resize(1);
+    state = Intersect_Body;
 
-    result.hit_points[0].p = near_point;
-    result.hit_points[0].t = t + t1;
+    hit_points[0].p = near_point;
+    hit_points[0].t = t + t1;
     if( std::abs(t0) <1e-10)
     {
-      result.hit_points[0].point_location = on_vertex;
-      result.hit_points[0].p = this->point(0);
-      result.hit_points[0].mark = 0;
+      hit_points[0].point_location = on_vertex;
+      hit_points[0].p = a;
+      hit_points[0].mark = 0;
     }
     else if( std::abs(t0-length)<1e-10)
     {
-      result.hit_points[0].point_location = on_vertex;
-      result.hit_points[0].p = this->point(1);
-      result.hit_points[0].mark = 1;
+      hit_points[0].point_location = on_vertex;
+      hit_points[0].p = b;
+      hit_points[0].mark = 1;
     }
     else
     {
-      result.hit_points[0].point_location = on_edge;
-      result.hit_points[0].mark = 0;
+      hit_points[0].point_location = on_edge;
+      hit_points[0].mark = 0;
     }
-    return;
+    return 1;
   }
 
-  result.state = Missed;
-  return;
+  state = Missed;
+  return 0;
 
 }
 
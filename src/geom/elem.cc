@@ -46,6 +46,7 @@
 #endif
 
 #include "elem_clone.h"
+#include "object_pool.h"
 
 
 // Initialize static member variables
@@ -54,6 +55,26 @@ const unsigned int Elem::_bp2 = 48661;
 
 // ------------------------------------------------------------
 // Elem class member funcions
+ObjectPool & Elem::pool()
+{
+  // never freed, objects may be deleted during static destruction
+  static ObjectPool * arena = new ObjectPool("Elem");
+  return *arena;
+}
+
+
+void * Elem::operator new (size_t size)
+{
+  return pool().allocate(size);
+}
+
+
+void Elem::operator delete (void * p, size_t size)
+{
+  pool().deallocate(p, size);
+}
+
+
 AutoPtr<Elem> Elem::build(const ElemType type,
                           Elem* p)
 {
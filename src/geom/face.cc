@@ -0,0 +1,108 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+
+// Local includes
+#include "face.h"
+#include "edge_edge2.h"
+
+
+
+// ------------------------------------------------------------
+// Face class member functions
+void Face::coplanar_ray_hit(const Point & point, const Point & d, IntersectionResult & result, unsigned int dim) const
+{
+  // at most 4 sides for 2D elements we support
+  genius_assert(this->n_sides() <= 4);
+
+  IntersectionState state[4];
+  Hit_Point         hit_points[4][2];
+  std::pair<unsigned int, unsigned int> side_nodes[4];
+
+  bool missed = true;
+  for ( unsigned int s=0; s<this->n_sides(); ++s )
+  {
+    this->nodes_on_edge(s, side_nodes[s]);
+    Edge2::ray_hit_segment(this->point(side_nodes[s].first), this->point(side_nodes[s].second), point, d, state[s], hit_points[s]);
+    if(state[s] != Missed) missed = false;
+  }
+
+  // miss?
+  if ( missed )
+  {
+    result.state = Missed;
+    return;
+  }
+
+  // has any overlap edge?
+  for ( unsigned int s=0; s<this->n_sides(); ++s )
+    if ( state[s]==Overlap_Edge )
+    {
+      // collect result
+      result.state = Overlap_Edge;
+      result.mark = s;
+      result.hit_points.assign(hit_points[s], hit_points[s]+2);
+      result.hit_points[0].mark = result.hit_points[0].mark ? side_nodes[s].second : side_nodes[s].first;
+      result.hit_points[1].mark = result.hit_points[1].mark ? side_nodes[s].second : side_nodes[s].first;
+      return;
+    }
+
+  // ok, must be intersect, find the first and last intersection point.
+  // for hit points with the same t, the one on the lower side is used.
+  const Hit_Point * first = 0;
+  const Hit_Point * last  = 0;
+  for ( unsigned int s=0; s<this->n_sides(); ++s )
+  {
+    if ( state[s]==Intersect_Body )
+    {
+      if ( dim==2 )
+        result.state=Intersect_Body;
+      else
+        result.state=On_Face;
+
+      Hit_Point & hit_point = hit_points[s][0];
+      if ( hit_point.point_location == on_edge )
+      {
+        //for 2D mesh, on edge equals to on side
+        if ( dim==2 ) hit_point.point_location = on_side;
+        hit_point.mark = s;
+      }
+      else if ( hit_point.point_location == on_vertex )
+      {
+        hit_point.mark = hit_point.mark ? side_nodes[s].second : side_nodes[s].first;
+      }
+
+      if ( !first || hit_point.t < first->t ) first = &hit_point;
+      if ( !last  || hit_point.t > last->t  ) last  = &hit_point;
+    }
+  }
+
+  if ( first )
+    result.hit_points.push_back ( *first );
+
+  if ( last && last->t != first->t )
+  {
+    if ( !result.is_point_overlap_exist ( *last ) )
+      result.hit_points.push_back ( *last );
+  }
+}
+
@@ -20,6 +20,8 @@
 /********************************************************************************/
 
 
+#include <algorithm>
+
 #include "face_cy_quad4_fvm.h"
 #include "edge_edge2_fvm.h"
 #include <TNT/jama_lu.h>
@@ -180,8 +182,45 @@ void Quad4_CY_FVM::prepare_for_fvm()
 
 
 
+unsigned int Quad4_CY_FVM::n_fvm_geometry() const
+{ return 3*4 + 1 + 2*4 + 2*4; }
+
+
+void Quad4_CY_FVM::pack_fvm_geometry(Real * data) const
+{
+  data = std::copy(d, d+4, data);
+  data = std::copy(l, l+4, data);
+  data = std::copy(v, v+4, data);
+  *data++ = vol;
+  data = std::copy(&least_squares_gradient_matrix[0][0], &least_squares_gradient_matrix[0][0]+2*4, data);
+  for(int i=0; i<2; ++i)
+    for(int j=0; j<4; ++j)
+      *data++ = least_squares_vector_reconstruct_matrix[i][j];
+}
+
+
+void Quad4_CY_FVM::unpack_fvm_geometry(const Real * data)
+{
+  std::copy(data, data+4, d);   data += 4;
+  std::copy(data, data+4, l);   data += 4;
+  std::copy(data, data+4, v);   data += 4;
+  vol = *data++;
+  std::copy(data, data+2*4, &least_squares_gradient_matrix[0][0]);  data += 2*4;
+  least_squares_vector_reconstruct_matrix = TNT::Array2D<Real>(2, 4);
+  for(int i=0; i<2; ++i)
+    for(int j=0; j<4; ++j)
+      least_squares_vector_reconstruct_matrix[i][j] = *data++;
+}
+
+
+
 void Quad4_CY_FVM::prepare_for_least_squares()
 {
+  // FIXME we assume the quad on xy plane here. not a general case
+  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
+  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
+  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
+
   TNT::Array2D<Real> A (n_nodes(), 3, 0.0);
   TNT::Array2D<Real> AT(3, n_nodes(), 0.0);
 
@@ -202,7 +241,11 @@ void Quad4_CY_FVM::prepare_for_least_squares()
 
   TNT::Array2D<Real> inv_ATA = solver.inv();
 
-  least_squares_gradient_matrix = TNT::matmult(inv_ATA, AT);
+  TNT::Array2D<Real>  M = TNT::matmult(inv_ATA, AT);
+
+  for(int m=0; m<2; m++)
+    for(int n=0; n<4; n++ )
+      least_squares_gradient_matrix[m][n] = M[m+1][n];
 
 }
 
@@ -210,61 +253,22 @@ void Quad4_CY_FVM::prepare_for_least_squares()
 
 VectorValue<PetscScalar> Quad4_CY_FVM::gradient( const std::vector<PetscScalar> & var) const
 {
-  // FIXME we assume the quad on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
   genius_assert( var.size()==n_nodes() );
-
-  PetscScalar dx=0, dy=0, dz=0;
-  for( unsigned int i=0; i<n_nodes(); i++ )
-  {
-    dx += least_squares_gradient_matrix[1][i] * var[i];
-    dy += least_squares_gradient_matrix[2][i] * var[i];
-  }
-
-  return VectorValue<PetscScalar>(dx, dy, dz);
-
+  return gradient_kernel(&var[0]);
 }
 
 
 VectorValue<Complex> Quad4_CY_FVM::gradient( const std::vector<Complex> & var) const
 {
-  // FIXME we assume the quad on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
   genius_assert( var.size()==n_nodes() );
-
-  Complex dx=0, dy=0, dz=0;
-  for( unsigned int i=0; i<n_nodes(); i++ )
-  {
-    dx += least_squares_gradient_matrix[1][i] * var[i];
-    dy += least_squares_gradient_matrix[2][i] * var[i];
-  }
-
-  return VectorValue<Complex>(dx, dy, dz);
-
+  return gradient_kernel(&var[0]);
 }
 
 
 VectorValue<AutoDScalar> Quad4_CY_FVM::gradient( const std::vector<AutoDScalar> & var) const
 {
-  // FIXME we assume the quad on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
   genius_assert( var.size()==n_nodes() );
-
-  AutoDScalar dx=0, dy=0, dz=0;
-
-  for( unsigned int i=0; i<n_nodes(); i++ )
-  {
-    dx += least_squares_gradient_matrix[1][i] * var[i];
-    dy += least_squares_gradient_matrix[2][i] * var[i];
-  }
-
-  return VectorValue<AutoDScalar>(dx, dy, dz);
+  return gradient_kernel(&var[0]);
 }
 
 
@@ -20,6 +20,8 @@
 /********************************************************************************/
 
 
+#include <algorithm>
+
 #include "face_cy_tri3_fvm.h"
 #include "edge_edge2_fvm.h"
 #include <TNT/jama_lu.h>
@@ -223,30 +225,49 @@ void Tri3_CY_FVM::prepare_for_fvm()
   genius_assert( (vol > 1e-10 ? (std::abs(V-vol) < 1e-3*vol) : (std::abs(V-vol) < std::max(1e-13, 1e-2*vol))) );
 #endif
 
+  prepare_for_gradient();
+
   prepare_for_vector_reconstruct();
 }
 
 
-VectorValue<PetscScalar> Tri3_CY_FVM::gradient( const std::vector<PetscScalar> & var) const
+
+unsigned int Tri3_CY_FVM::n_fvm_geometry() const
+{ return 5*3 + 1 + 2*3 + 2*3; }
+
+
+void Tri3_CY_FVM::pack_fvm_geometry(Real * data) const
 {
-  // FIXME we assume the triangle on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
+  data = std::copy(d,  d+3,  data);
+  data = std::copy(dt, dt+3, data);
+  data = std::copy(l,  l+3,  data);
+  data = std::copy(v,  v+3,  data);
+  data = std::copy(vt, vt+3, data);
+  *data++ = vol;
+  data = std::copy(&gradient_matrix[0][0], &gradient_matrix[0][0]+2*3, data);
+  for(int i=0; i<2; ++i)
+    for(int j=0; j<3; ++j)
+      *data++ = least_squares_vector_reconstruct_matrix[i][j];
+}
 
-  Real xa = (this->point(0))(0);
-  Real xb = (this->point(1))(0);
-  Real xc = (this->point(2))(0);
-  Real ya = (this->point(0))(1);
-  Real yb = (this->point(1))(1);
-  Real yc = (this->point(2))(1);
 
-  PetscScalar dx = ((yb-yc)*var[0] + (yc-ya)*var[1] +(ya-yb)*var[2])/(2*vol);
-  PetscScalar dy = ((xc-xb)*var[0] + (xa-xc)*var[1] +(xb-xa)*var[2])/(2*vol);
-  return VectorValue<PetscScalar>(dx, dy, 0.0);
+void Tri3_CY_FVM::unpack_fvm_geometry(const Real * data)
+{
+  std::copy(data, data+3, d);    data += 3;
+  std::copy(data, data+3, dt);   data += 3;
+  std::copy(data, data+3, l);    data += 3;
+  std::copy(data, data+3, v);    data += 3;
+  std::copy(data, data+3, vt);   data += 3;
+  vol = *data++;
+  std::copy(data, data+2*3, &gradient_matrix[0][0]);  data += 2*3;
+  least_squares_vector_reconstruct_matrix = TNT::Array2D<Real>(2, 3);
+  for(int i=0; i<2; ++i)
+    for(int j=0; j<3; ++j)
+      least_squares_vector_reconstruct_matrix[i][j] = *data++;
 }
 
 
-VectorValue<Complex> Tri3_CY_FVM::gradient( const std::vector<Complex> & var) const
+void Tri3_CY_FVM::prepare_for_gradient()
 {
   // FIXME we assume the triangle on xy plane here. not a general case
   genius_assert( (this->point(0))(2) == (this->point(1))(2) );
@@ -259,28 +280,33 @@ VectorValue<Complex> Tri3_CY_FVM::gradient( const std::vector<Complex> & var) co
   Real yb = (this->point(1))(1);
   Real yc = (this->point(2))(1);
 
-  Complex dx = ((yb-yc)*var[0] + (yc-ya)*var[1] +(ya-yb)*var[2])/(2*vol);
-  Complex dy = ((xc-xb)*var[0] + (xa-xc)*var[1] +(xb-xa)*var[2])/(2*vol);
-  return VectorValue<Complex>(dx, dy, 0.0);
+  gradient_matrix[0][0] = (yb-yc)/(2*vol);
+  gradient_matrix[0][1] = (yc-ya)/(2*vol);
+  gradient_matrix[0][2] = (ya-yb)/(2*vol);
+  gradient_matrix[1][0] = (xc-xb)/(2*vol);
+  gradient_matrix[1][1] = (xa-xc)/(2*vol);
+  gradient_matrix[1][2] = (xb-xa)/(2*vol);
 }
 
 
-VectorValue<AutoDScalar> Tri3_CY_FVM::gradient( const std::vector<AutoDScalar> & var) const
+VectorValue<PetscScalar> Tri3_CY_FVM::gradient( const std::vector<PetscScalar> & var) const
 {
-  // FIXME we assume the triangle on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
+  genius_assert( var.size()==n_nodes() );
+  return gradient_kernel(&var[0]);
+}
 
-  Real xa = (this->point(0))(0);
-  Real xb = (this->point(1))(0);
-  Real xc = (this->point(2))(0);
-  Real ya = (this->point(0))(1);
-  Real yb = (this->point(1))(1);
-  Real yc = (this->point(2))(1);
 
-  AutoDScalar dx = ((yb-yc)*var[0] + (yc-ya)*var[1] +(ya-yb)*var[2])/(2*vol);
-  AutoDScalar dy = ((xc-xb)*var[0] + (xa-xc)*var[1] +(xb-xa)*var[2])/(2*vol);
-  return VectorValue<AutoDScalar>(dx, dy, 0.0);
+VectorValue<Complex> Tri3_CY_FVM::gradient( const std::vector<Complex> & var) const
+{
+  genius_assert( var.size()==n_nodes() );
+  return gradient_kernel(&var[0]);
+}
+
+
+VectorValue<AutoDScalar> Tri3_CY_FVM::gradient( const std::vector<AutoDScalar> & var) const
+{
+  genius_assert( var.size()==n_nodes() );
+  return gradient_kernel(&var[0]);
 }
 
 
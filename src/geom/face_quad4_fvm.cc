@@ -22,6 +22,8 @@
 //  $Id: face_quad4_fvm.cc,v 1.6 2008/07/10 09:39:38 gdiso Exp $
 
 
+#include <algorithm>
+
 #include "face_quad4_fvm.h"
 #include "edge_edge2_fvm.h"
 
@@ -240,8 +242,40 @@ void Quad4_FVM::prepare_for_fvm()
 
 
 
+unsigned int Quad4_FVM::n_fvm_geometry() const
+{ return 3*4 + 1 + 2*4 + 2*4; }
+
+
+void Quad4_FVM::pack_fvm_geometry(Real * data) const
+{
+  data = std::copy(d, d+4, data);
+  data = std::copy(l, l+4, data);
+  data = std::copy(v, v+4, data);
+  *data++ = vol;
+  data = std::copy(&least_squares_gradient_matrix[0][0], &least_squares_gradient_matrix[0][0]+2*4, data);
+  std::copy(&least_squares_vector_reconstruct_matrix[0][0], &least_squares_vector_reconstruct_matrix[0][0]+2*4, data);
+}
+
+
+void Quad4_FVM::unpack_fvm_geometry(const Real * data)
+{
+  std::copy(data, data+4, d);   data += 4;
+  std::copy(data, data+4, l);   data += 4;
+  std::copy(data, data+4, v);   data += 4;
+  vol = *data++;
+  std::copy(data, data+2*4, &least_squares_gradient_matrix[0][0]);  data += 2*4;
+  std::copy(data, data+2*4, &least_squares_vector_reconstruct_matrix[0][0]);
+}
+
+
+
 void Quad4_FVM::prepare_for_least_squares()
 {
+  // FIXME we assume the quad on xy plane here. not a general case
+  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
+  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
+  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
+
   //FIXME NOT work for 3D quad
   TNT::Array2D<Real> A (n_nodes(), 3, 0.0);
   TNT::Array2D<Real> AT(3, n_nodes(), 0.0);
@@ -282,61 +316,22 @@ void Quad4_FVM::prepare_for_least_squares()
 
 VectorValue<PetscScalar> Quad4_FVM::gradient( const std::vector<PetscScalar> & var) const
 {
-  // FIXME we assume the quad on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
   genius_assert( var.size()==n_nodes() );
-
-  PetscScalar dx=0, dy=0, dz=0;
-  for( unsigned int i=0; i<n_nodes(); i++ )
-  {
-    dx += least_squares_gradient_matrix[0][i] * var[i];
-    dy += least_squares_gradient_matrix[1][i] * var[i];
-  }
-
-  return VectorValue<PetscScalar>(dx, dy, dz);
-
+  return gradient_kernel(&var[0]);
 }
 
 
 VectorValue<Complex> Quad4_FVM::gradient( const std::vector<Complex> & var) const
 {
-  // FIXME we assume the quad on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
   genius_assert( var.size()==n_nodes() );
-
-  Complex dx=0, dy=0, dz=0;
-  for( unsigned int i=0; i<n_nodes(); i++ )
-  {
-    dx += least_squares_gradient_matrix[0][i] * var[i];
-    dy += least_squares_gradient_matrix[1][i] * var[i];
-  }
-
-  return VectorValue<Complex>(dx, dy, dz);
-
+  return gradient_kernel(&var[0]);
 }
 
 
 VectorValue<AutoDScalar> Quad4_FVM::gradient( const std::vector<AutoDScalar> & var) const
 {
-  // FIXME we assume the quad on xy plane here. not a general case
-  genius_assert( (this->point(0))(2) == (this->point(1))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(2))(2) );
-  genius_assert( (this->point(0))(2) == (this->point(3))(2) );
   genius_assert( var.size()==n_nodes() );
-
-  AutoDScalar dx=0, dy=0, dz=0;
-
-  for( unsigned int i=0; i<n_nodes(); i++ )
-  {
-    dx += least_squares_gradient_matrix[0][i] * var[i];
-    dy += least_squares_gradient_matrix[1][i] * var[i];
-  }
-
-  return VectorValue<AutoDScalar>(dx, dy, dz);
+  return gradient_kernel(&var[0]);
 }
 
 
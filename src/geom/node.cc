@@ -0,0 +1,27 @@
+// C++ includes
+
+// Local includes
+#include "node.h"
+#include "object_pool.h"
+
+
+// ------------------------------------------------------------
+// Node class member functions
+ObjectPool & Node::pool()
+{
+  // never freed, objects may be deleted during static destruction
+  static ObjectPool * arena = new ObjectPool("Node");
+  return *arena;
+}
+
+
+void * Node::operator new (size_t size)
+{
+  return pool().allocate(size);
+}
+
+
+void Node::operator delete (void * p, size_t size)
+{
+  pool().deallocate(p, size);
+}
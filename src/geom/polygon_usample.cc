@@ -79,6 +79,21 @@ PolygonUSample::PolygonUSample(const std::vector<Point> & pts, const Real mesh_s
       Point loc = _bl_point + Point( ix*_mesh_size, iy*_mesh_size  );
       _inside[ix*(_max_index_y+1)+iy] = _has_projected_point(loc);
     }
+
+  // run length index of the inside flags
+  _run_offset.push_back(0);
+  for(unsigned int ix=0; ix<=_max_index_x; ++ix)
+  {
+    for(unsigned int iy=0; iy<=_max_index_y; ++iy)
+    {
+      if( !_inside[ix*(_max_index_y+1)+iy] ) continue;
+      if( _runs.size() > _run_offset.back() && _runs.back().second+1 == iy )
+        _runs.back().second = iy;
+      else
+        _runs.push_back( std::make_pair(iy, iy) );
+    }
+    _run_offset.push_back(_runs.size());
+  }
 }
 
 
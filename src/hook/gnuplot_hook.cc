@@ -66,7 +66,7 @@ GnuplotHook::GnuplotHook(SolverBase & solver, const std::string & name, void * f
     bool file_exist = ( access( _gnuplot_file.c_str(),  R_OK ) == 0 );
 #endif
 
-    if(file_exist && SolverSpecify::out_append)
+    if(file_exist && (SolverSpecify::out_append || SolverSpecify::AdaptResume))
       _out.open(_gnuplot_file.c_str(), std::ios::app);
     else
     {
@@ -54,8 +54,9 @@ ProbeHook::ProbeHook(SolverBase & solver, const std::string & name, void * param
   }
 
 
+  // continue the file of previous pass after mesh adaptation
   if ( !Genius::processor_id() )
-    _out.open(_probe_file.c_str());
+    _out.open(_probe_file.c_str(), SolverSpecify::AdaptResume ? std::ios::app : std::ios::trunc);
 
 }
 
@@ -142,7 +143,7 @@ void ProbeHook::on_init()
   for(int i=0; i<n_var; i++)
     Parallel::broadcast(var_name[i], _min_loc);
 
-  if ( !Genius::processor_id() )
+  if ( !Genius::processor_id() && !SolverSpecify::AdaptResume )
   {
     time_t          _time;
     time(&_time);
@@ -0,0 +1,393 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+#include <string>
+#include <sstream>
+#include <ctime>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <map>
+
+#include "solver_base.h"
+#include "probeset_hook.h"
+#include "mesh_base.h"
+#include "elem.h"
+#include "point_locator_tree.h"
+#include "interpolation_mesh.h"
+#include "simulation_system.h"
+#include "simulation_region.h"
+#include "boundary_condition_collector.h"
+#include "spice_ckt.h"
+#include "parallel.h"
+
+using PhysicalUnit::um;
+
+
+/*----------------------------------------------------------------------
+ * constructor, open the file for writing
+ */
+ProbeSetHook::ProbeSetHook(SolverBase & solver, const std::string & name, void * param)
+    : Hook(solver, name), _probe_file(SolverSpecify::out_prefix + ".probeset"), _count(0)
+{
+  const std::vector<Parser::Parameter> & parm_list = *((std::vector<Parser::Parameter> *)param);
+  for(std::vector<Parser::Parameter>::const_iterator parm_it = parm_list.begin();
+      parm_it != parm_list.end(); parm_it++)
+  {
+    if(parm_it->name() == "point" && parm_it->type() == Parser::STRING)
+    {
+      Point p;
+      if(_parse_point(parm_it->get_string(), p))
+        _points.push_back(p);
+      else
+      {
+        MESSAGE<<"WARNING: probeset hook can't parse point \""<< parm_it->get_string() <<"\", ignored."<<std::endl; RECORD();
+      }
+    }
+    if(parm_it->name() == "line" && parm_it->type() == Parser::STRING)
+    {
+      if(!_parse_line(parm_it->get_string()))
+      {
+        MESSAGE<<"WARNING: probeset hook can't parse line \""<< parm_it->get_string() <<"\", ignored."<<std::endl; RECORD();
+      }
+    }
+    if(parm_it->name() == "variable" && parm_it->type() == Parser::STRING)
+    {
+      SolutionVariable v = solution_string_to_enum(FormatVariableString(parm_it->get_string()));
+      if(v != INVALID_Variable)
+      {
+        _variables.push_back(v);
+        _variable_names.push_back(parm_it->get_string());
+      }
+      else
+      {
+        MESSAGE<<"WARNING: probeset hook doesn't know variable "<< parm_it->get_string() <<", ignored."<<std::endl; RECORD();
+      }
+    }
+    if(parm_it->name() == "file" && parm_it->type() == Parser::STRING)
+      _probe_file = parm_it->get_string();
+  }
+
+  if(_variables.empty())
+  {
+    _variables.push_back(POTENTIAL);
+    _variables.push_back(ELECTRON);
+    _variables.push_back(HOLE);
+    _variable_names.push_back("potential");
+    _variable_names.push_back("electron");
+    _variable_names.push_back("hole");
+  }
+
+  // continue the records of previous pass after mesh adaptation, the probes are the same
+  if ( !Genius::processor_id() )
+    _out.open(_probe_file.c_str(), std::ofstream::binary | (SolverSpecify::AdaptResume ? std::ofstream::app : std::ofstream::trunc));
+}
+
+
+/*----------------------------------------------------------------------
+ * destructor, close file
+ */
+ProbeSetHook::~ProbeSetHook()
+{
+  if ( !Genius::processor_id() )
+    _out.close();
+}
+
+
+/*----------------------------------------------------------------------
+ * parse "x,y,z", the missing coordinates are 0
+ */
+bool ProbeSetHook::_parse_point(const std::string & s, Point & p)
+{
+  std::string str(s);
+  std::replace(str.begin(), str.end(), ',', ' ');
+  std::stringstream ss(str);
+
+  double x[3] = {0.0, 0.0, 0.0};
+  unsigned int n=0;
+  for(; n<3 && (ss >> x[n]); ++n);
+  if(n==0) return false;
+
+  p = Point(x[0]*um, x[1]*um, x[2]*um);
+  return true;
+}
+
+
+/*----------------------------------------------------------------------
+ * parse "x1,y1,z1,x2,y2,z2,n"
+ */
+bool ProbeSetHook::_parse_line(const std::string & s)
+{
+  std::string str(s);
+  std::replace(str.begin(), str.end(), ',', ' ');
+  std::stringstream ss(str);
+
+  double x[6];
+  int n;
+  for(unsigned int i=0; i<6; ++i)
+    if(!(ss >> x[i])) return false;
+  if(!(ss >> n) || n < 2) return false;
+
+  Point begin(x[0]*um, x[1]*um, x[2]*um);
+  Point end(x[3]*um, x[4]*um, x[5]*um);
+  for(int i=0; i<n; ++i)
+    _points.push_back(begin + (end-begin)*(double(i)/(n-1)));
+
+  return true;
+}
+
+
+/*----------------------------------------------------------------------
+ *   This is executed before the initialization of the solver
+ */
+void ProbeSetHook::on_init()
+{
+  const SimulationSystem & system = _solver.get_system();
+  const MeshBase & mesh = system.mesh();
+
+  // share the search tree of mesh point locator, but return NULL for points out of mesh
+  PointLocatorTree point_locator(mesh, &mesh.point_locator());
+  point_locator.enable_out_of_mesh_mode();
+
+  // the mesh is replicated on all the processors, each processor locates the probes itself
+  std::map< std::pair<unsigned int, unsigned int>, unsigned int > sample_node_map;
+
+  _probes.clear();
+  _sample_nodes.clear();
+  _local_nodes.clear();
+
+  unsigned int n_missing = 0;
+  for(unsigned int n=0; n<_points.size(); ++n)
+  {
+    Probe probe;
+    probe.p = _points[n];
+    probe.elem = point_locator(probe.p);
+
+    if(probe.elem)
+    {
+      probe.weights.resize(probe.elem->n_nodes());
+      InterpolationMesh::shape_weights(probe.elem, probe.p, &probe.weights[0]);
+
+      const unsigned int sub_id = probe.elem->subdomain_id();
+      for(unsigned int i=0; i<probe.elem->n_nodes(); ++i)
+      {
+        std::pair<unsigned int, unsigned int> key(sub_id, probe.elem->node(i));
+        std::map< std::pair<unsigned int, unsigned int>, unsigned int >::iterator it = sample_node_map.find(key);
+        if(it == sample_node_map.end())
+        {
+          it = sample_node_map.insert(std::make_pair(key, _sample_nodes.size())).first;
+          _sample_nodes.push_back(key);
+        }
+        probe.nodes.push_back(it->second);
+      }
+    }
+    else
+      n_missing++;
+
+    _probes.push_back(probe);
+  }
+
+  if(n_missing)
+  {
+    MESSAGE<<"WARNING: "<< n_missing <<" probe(s) out of mesh, NaN will be written for them."<<std::endl; RECORD();
+  }
+
+  // the values are sampled by the region of the element, so the probe in a heterojunction
+  // element always see the solution of its own region
+  for(unsigned int n=0; n<_sample_nodes.size(); ++n)
+  {
+    const SimulationRegion * region = system.region(_sample_nodes[n].first);
+    const FVM_Node * fvm_node = region->region_fvm_node(_sample_nodes[n].second);
+    if(fvm_node && fvm_node->on_processor())
+      _local_nodes.push_back(std::make_pair(n, fvm_node));
+  }
+
+  _count = 0;
+
+  if ( !Genius::processor_id() )
+    _write_header();
+}
+
+
+/*----------------------------------------------------------------------
+ * describe the binary records
+ */
+void ProbeSetHook::_write_header() const
+{
+  std::string header_file = _probe_file + ".hdr";
+  std::ofstream out(header_file.c_str());
+
+  time_t          _time;
+  time(&_time);
+
+  out << "# Title: Probe Set File Created by Genius TCAD Simulation" << std::endl;
+  out << "# Date: " << ctime(&_time);
+  out << "# Data: " << _probe_file << std::endl;
+  out << "# Each record is one float64 scan value followed by n_variable x n_probe float32 values in native byte order." << std::endl;
+  out << "# The values of one variable are contiguous, in the order of probes." << std::endl;
+
+  out << "scan ";
+  if( SolverSpecify::Type==SolverSpecify::TRANSIENT )
+    out << "time [s]" << std::endl;
+  else if( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_VScan.size() )
+    out << SolverSpecify::Electrode_VScan[0] << " [V]" << std::endl;
+  else if( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_IScan.size() )
+    out << SolverSpecify::Electrode_IScan[0] << " [A]" << std::endl;
+  else
+    out << "step" << std::endl;
+
+  out << "record_bytes " << sizeof(double) + sizeof(float)*_variables.size()*_probes.size() << std::endl;
+
+  out << "variables " << _variables.size() << std::endl;
+  for(unsigned int v=0; v<_variables.size(); ++v)
+    out << _variable_names[v] << " [" << variable_unit_string(_variables[v]) << "]" << std::endl;
+
+  out << "probes " << _probes.size() << std::endl;
+  out << "# x(um) y(um) z(um) region" << std::endl;
+  for(unsigned int n=0; n<_probes.size(); ++n)
+  {
+    const Probe & probe = _probes[n];
+    out << probe.p(0)/um << ' ' << probe.p(1)/um << ' ' << probe.p(2)/um << ' ';
+    if(probe.elem)
+      out << _solver.get_system().region(probe.elem->subdomain_id())->label() << std::endl;
+    else
+      out << "-" << std::endl;
+  }
+}
+
+
+/*----------------------------------------------------------------------
+ * @return the scan value of current step
+ */
+double ProbeSetHook::_scan_value() const
+{
+  if ( SolverSpecify::Type==SolverSpecify::TRANSIENT )
+    return SolverSpecify::clock/PhysicalUnit::s;
+
+  if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_VScan.size() )
+  {
+    if ( get_solver().solver_type() == SolverSpecify::DDML1MIXA ||
+         get_solver().solver_type() == SolverSpecify::DDML2MIXA ||
+         get_solver().solver_type() == SolverSpecify::EBML3MIXA )
+      return _solver.get_system().get_circuit()->get_voltage_from_sync ( SolverSpecify::Electrode_VScan[0] )/PhysicalUnit::V;
+
+    const BoundaryCondition * bc = _solver.get_system().get_bcs()->get_bc ( SolverSpecify::Electrode_VScan[0] );
+    return bc->ext_circuit()->Vapp()/PhysicalUnit::V;
+  }
+
+  if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_IScan.size() )
+  {
+    if ( get_solver().solver_type() == SolverSpecify::DDML1MIXA ||
+         get_solver().solver_type() == SolverSpecify::DDML2MIXA ||
+         get_solver().solver_type() == SolverSpecify::EBML3MIXA )
+      return _solver.get_system().get_circuit()->get_current_from_sync ( SolverSpecify::Electrode_IScan[0] )/PhysicalUnit::A;
+
+    const BoundaryCondition * bc = _solver.get_system().get_bcs()->get_bc ( SolverSpecify::Electrode_IScan[0] );
+    return bc->ext_circuit()->Iapp()/PhysicalUnit::A;
+  }
+
+  return _count;
+}
+
+
+/*----------------------------------------------------------------------
+ *   This is executed previously to each solution step.
+ */
+void ProbeSetHook::pre_solve()
+{}
+
+
+
+/*----------------------------------------------------------------------
+ *  This is executed after each solution step.
+ */
+void ProbeSetHook::post_solve()
+{
+  const unsigned int n_var = _variables.size();
+
+  // node values, node major. each sample node is owned by exactly one processor
+  std::vector<double> values(_sample_nodes.size()*n_var, 0.0);
+  for(unsigned int n=0; n<_local_nodes.size(); ++n)
+  {
+    const FVM_NodeData * node_data = _local_nodes[n].second->node_data();
+    for(unsigned int v=0; v<n_var; ++v)
+      if(node_data->is_variable_valid(_variables[v]))
+        values[_local_nodes[n].first*n_var + v] = node_data->get_variable_real(_variables[v])/variable_unit(_variables[v]);
+  }
+  Parallel::sum(values);
+
+  double scan = _scan_value();
+  _count++;
+
+  if ( Genius::processor_id() ) return;
+
+  // variable major record
+  std::vector<float> record(n_var*_probes.size(), std::numeric_limits<float>::quiet_NaN());
+  for(unsigned int n=0; n<_probes.size(); ++n)
+  {
+    const Probe & probe = _probes[n];
+    if(!probe.elem) continue;
+
+    for(unsigned int v=0; v<n_var; ++v)
+    {
+      double value = 0.0;
+      for(unsigned int i=0; i<probe.nodes.size(); ++i)
+        value += probe.weights[i]*values[probe.nodes[i]*n_var + v];
+      record[v*_probes.size() + n] = static_cast<float>(value);
+    }
+  }
+
+  _out.write(reinterpret_cast<const char *>(&scan), sizeof(double));
+  if(!record.empty())
+    _out.write(reinterpret_cast<const char *>(&record[0]), record.size()*sizeof(float));
+  _out.flush();
+}
+
+
+
+/*----------------------------------------------------------------------
+ *  This is executed after each (nonlinear) iteration
+ */
+void ProbeSetHook::post_iteration()
+{}
+
+
+
+/*----------------------------------------------------------------------
+ * This is executed after the finalization of the solver
+ */
+void ProbeSetHook::on_close()
+{}
+
+
+#ifdef DLLHOOK
+
+// dll interface
+extern "C"
+{
+  Hook* get_hook (SolverBase & solver, const std::string & name, void * fun_data)
+  {
+    return new ProbeSetHook(solver, name, fun_data );
+  }
+
+}
+
+#endif
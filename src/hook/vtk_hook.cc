@@ -19,12 +19,17 @@
 /*                                                                              */
 /********************************************************************************/
 
+#include <algorithm>
 #include <cstdlib>
 #include <iomanip>
+#include <fstream>
 
 #include "solver_base.h"
 #include "vtk_hook.h"
+#include "vtk_io.h"
+#include "async_writer.h"
 #include "spice_ckt.h"
+#include "parallel.h"
 #include "MXMLUtil.h"
 
 
@@ -33,8 +38,11 @@
  */
 VTKHook::VTKHook ( SolverBase & solver, const std::string & name, void * param)
     : Hook ( solver, name ), _vtk_prefix ( SolverSpecify::out_prefix ),
-      _ddm ( false ), _mixA ( false ), _ddm_ac ( false )
+      _ddm ( false ), _mixA ( false ), _ddm_ac ( false ), _writer ( 0 )
 {
+  bool async = true;
+  int  queue = 2;
+
   this->count  =0;
   this->_t_step=0;
   this->_f_step=0;
@@ -55,13 +63,25 @@ VTKHook::VTKHook ( SolverBase & solver, const std::string & name, void * param)
       _v_step=parm_it->get_real() * PhysicalUnit::V;
     if ( parm_it->name() == "istep" && parm_it->type() == Parser::REAL )
       _i_step=parm_it->get_real() * PhysicalUnit::A;
+    if ( parm_it->name() == "async" && parm_it->type() == Parser::BOOL )
+      async=parm_it->get_bool();
+    if ( parm_it->name() == "queue" && parm_it->type() == Parser::INTEGER )
+      queue=parm_it->get_int();
   }
 
-  const SimulationSystem &system = get_solver().get_system();
+  // write vtk file in background, the solver only waits for taking the snapshot
+  if ( async )
+    _writer = new AsyncWriter ( queue > 0 ? queue : 1 );
 
-  std::ostringstream vtk_filename;
-  vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-  system.export_vtk ( vtk_filename.str(), false );
+  // the initial state of a resumed pass is the last state of previous one, which is already exported
+  if ( SolverSpecify::AdaptResume )
+    this->_resume();
+  else
+  {
+    std::ostringstream vtk_filename;
+    vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
+    this->_export_vtk ( vtk_filename.str() );
+  }
 
   SolverSpecify::SolverType solver_type = this->get_solver().solver_type();
 
@@ -84,7 +104,75 @@ VTKHook::VTKHook ( SolverBase & solver, const std::string & name, void * param)
  * destructor, close file
  */
 VTKHook::~VTKHook()
-{}
+{
+  // wait pending files
+  delete _writer;
+}
+
+
+/*----------------------------------------------------------------------
+ * export current solution to vtk file
+ */
+void VTKHook::_export_vtk ( const std::string & filename )
+{
+#ifdef HAVE_VTK
+  MESSAGE<<"Write System to XML VTK file "<< filename << "...\n" << std::endl; RECORD();
+
+  VTKIO vtk_io ( get_solver().get_system() );
+  vtk_io.set_async_writer ( _writer );
+  vtk_io.write ( filename );
+#else
+  MESSAGE<<"Genius is not compiled with XML VTK support, skip VTK export... "<< std::endl; RECORD();
+#endif
+}
+
+
+/*----------------------------------------------------------------------
+ * restore the state of vtk series from prefix.pvd
+ */
+void VTKHook::_resume()
+{
+  // the first file prefix0.vtu is written by the constructor of first pass
+  this->count = 1;
+
+  if ( !Genius::processor_id() )
+  {
+    std::string pvd_filename = _vtk_prefix + ".pvd";
+    std::ifstream in ( pvd_filename.c_str() );
+
+    std::string line;
+    while ( std::getline ( in, line ) )
+    {
+      std::string::size_type t = line.find ( "timestep=\"" );
+      std::string::size_type f = line.find ( "file=\"" );
+      if ( t == std::string::npos || f == std::string::npos ) continue;
+
+      std::string::size_type f_end = line.find ( '"', f+6 );
+      std::string file = line.substr ( f+6, f_end-f-6 );
+      time_sequence.push_back ( std::make_pair ( atof ( line.c_str() +t+10 ), file ) );
+
+      // file name is prefix<count>.vtu
+      if ( file.size() > _vtk_prefix.size() )
+        this->count = std::max ( this->count, static_cast<unsigned int> ( atoi ( file.c_str() +_vtk_prefix.size() ) ) + 1 );
+    }
+
+    if ( !time_sequence.empty() )
+    {
+      double last = time_sequence.back().first;
+      if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_VScan.size() )
+        _v_last = last*PhysicalUnit::V;
+      if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_IScan.size() )
+        _i_last = last*PhysicalUnit::A;
+      if ( SolverSpecify::Type==SolverSpecify::TRANSIENT )
+        _t_last = last*PhysicalUnit::ps;
+    }
+  }
+
+  Parallel::broadcast ( this->count );
+  Parallel::broadcast ( _v_last );
+  Parallel::broadcast ( _i_last );
+  Parallel::broadcast ( _t_last );
+}
 
 
 /*----------------------------------------------------------------------
@@ -92,7 +180,9 @@ VTKHook::~VTKHook()
  */
 void VTKHook::on_init()
 {
-  time_sequence.clear();
+  // keep the sequence restored from previous pass
+  if ( !SolverSpecify::AdaptResume )
+    time_sequence.clear();
 }
 
 
@@ -134,10 +224,8 @@ void VTKHook::post_solve()
 
     if ( std::fabs ( Vscan - this->_v_last ) >= this->_v_step )
     {
-      const SimulationSystem &system = get_solver().get_system();
-
       vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-      system.export_vtk ( vtk_filename.str(),false );
+      this->_export_vtk ( vtk_filename.str() );
 
       time_sequence.push_back ( std::make_pair ( Vscan/PhysicalUnit::V, vtk_filename.str() ) );
       _v_last = Vscan;
@@ -165,10 +253,8 @@ void VTKHook::post_solve()
 
     if ( std::fabs ( Iscan - this->_i_last ) >= this->_i_step )
     {
-      const SimulationSystem &system = get_solver().get_system();
-
       vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-      system.export_vtk ( vtk_filename.str(),false );
+      this->_export_vtk ( vtk_filename.str() );
 
       time_sequence.push_back ( std::make_pair ( Iscan/PhysicalUnit::A, vtk_filename.str() ) );
       _i_last = Iscan;
@@ -178,28 +264,22 @@ void VTKHook::post_solve()
 
   if ( SolverSpecify::Type==SolverSpecify::OP )
   {
-    const SimulationSystem &system = get_solver().get_system();
-
     vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-    system.export_vtk ( vtk_filename.str(), false );
+    this->_export_vtk ( vtk_filename.str() );
   }
 
   if ( SolverSpecify::Type==SolverSpecify::TRACE )
   {
-    const SimulationSystem &system = get_solver().get_system();
-
     vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-    system.export_vtk ( vtk_filename.str(), false );
+    this->_export_vtk ( vtk_filename.str() );
   }
 
   if ( SolverSpecify::Type==SolverSpecify::TRANSIENT )
   {
     if ( SolverSpecify::clock - this->_t_last >= this->_t_step )
     {
-      const SimulationSystem &system = get_solver().get_system();
-
       vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-      system.export_vtk ( vtk_filename.str(), false );
+      this->_export_vtk ( vtk_filename.str() );
 
       time_sequence.push_back ( std::make_pair ( SolverSpecify::clock/PhysicalUnit::ps, vtk_filename.str() ) );
       _t_last = SolverSpecify::clock;
@@ -210,10 +290,8 @@ void VTKHook::post_solve()
 
   if ( SolverSpecify::Type==SolverSpecify::ACSWEEP )
   {
-    const SimulationSystem &system = get_solver().get_system();
-
     vtk_filename << _vtk_prefix << ( this->count++ ) << ".vtu";
-    system.export_vtk ( vtk_filename.str(), false );
+    this->_export_vtk ( vtk_filename.str() );
 
     time_sequence.push_back ( std::make_pair ( SolverSpecify::Freq*PhysicalUnit::us, vtk_filename.str() ) );
     _f_last = SolverSpecify::Freq;
@@ -258,6 +336,9 @@ void VTKHook::post_iteration()
  */
 void VTKHook::on_close()
 {
+  // all the vtk files should be on disk before we leave the solver
+  if ( _writer ) _writer->flush();
+
   if ( time_sequence.size() ==0 ) return;
 
   if ( !Genius::processor_id() )
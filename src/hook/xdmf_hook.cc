@@ -0,0 +1,192 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <cmath>
+
+#include "solver_base.h"
+#include "xdmf_hook.h"
+#include "xdmf_io.h"
+#include "solver_specify.h"
+#include "boundary_condition_collector.h"
+#include "spice_ckt.h"
+#include "MXMLUtil.h"
+
+
+/*----------------------------------------------------------------------
+ * constructor, open the file for writing
+ */
+XDMFHook::XDMFHook ( SolverBase & solver, const std::string & name, void * param)
+    : Hook ( solver, name ), _prefix ( SolverSpecify::out_prefix ), _single ( true ), _xdmf ( 0 ),
+      _last ( 0 ), _t_step ( 0 ), _v_step ( 0 ), _i_step ( 0 ), _count ( 0 )
+{
+  const std::vector<Parser::Parameter> & parm_list = *((std::vector<Parser::Parameter> *)param);
+  for ( std::vector<Parser::Parameter>::const_iterator parm_it = parm_list.begin();
+        parm_it != parm_list.end(); parm_it++ )
+  {
+    if ( parm_it->name() == "tstep" && parm_it->type() == Parser::REAL )
+      _t_step=parm_it->get_real() * PhysicalUnit::s;
+    if ( parm_it->name() == "vstep" && parm_it->type() == Parser::REAL )
+      _v_step=parm_it->get_real() * PhysicalUnit::V;
+    if ( parm_it->name() == "istep" && parm_it->type() == Parser::REAL )
+      _i_step=parm_it->get_real() * PhysicalUnit::A;
+    if ( parm_it->name() == "single" && parm_it->type() == Parser::BOOL )
+      _single=parm_it->get_bool();
+    if ( parm_it->name() == "prefix" && parm_it->type() == Parser::STRING )
+      _prefix=parm_it->get_string();
+  }
+}
+
+
+/*----------------------------------------------------------------------
+ * destructor, close file
+ */
+XDMFHook::~XDMFHook()
+{
+  delete _xdmf;
+}
+
+
+/*----------------------------------------------------------------------
+ *   This is executed before the initialization of the solver
+ */
+void XDMFHook::on_init()
+{
+  MESSAGE<<"Write solution series to XDMF file "<< _prefix << ".xmf ...\n" << std::endl; RECORD();
+
+  // after mesh adaptation, the new mesh and following steps are appended to the series
+  delete _xdmf;
+  _xdmf = new XDMFIO ( get_solver().get_system(), _prefix, _single );
+  _xdmf->write_mesh ( SolverSpecify::AdaptResume );
+  _count = 0;
+}
+
+
+/*----------------------------------------------------------------------
+ *   This is executed previously to each solution step.
+ */
+void XDMFHook::pre_solve()
+{}
+
+
+/*----------------------------------------------------------------------
+ * @return the scan value of current step
+ */
+double XDMFHook::_scan_value() const
+{
+  if ( SolverSpecify::Type==SolverSpecify::TRANSIENT )
+    return SolverSpecify::clock;
+
+  if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_VScan.size() )
+  {
+    if ( get_solver().solver_type() == SolverSpecify::DDML1MIXA ||
+         get_solver().solver_type() == SolverSpecify::DDML2MIXA ||
+         get_solver().solver_type() == SolverSpecify::EBML3MIXA )
+      return _solver.get_system().get_circuit()->get_voltage_from_sync ( SolverSpecify::Electrode_VScan[0] );
+
+    const BoundaryCondition * bc = _solver.get_system().get_bcs()->get_bc ( SolverSpecify::Electrode_VScan[0] );
+    return bc->ext_circuit()->Vapp();
+  }
+
+  if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_IScan.size() )
+  {
+    if ( get_solver().solver_type() == SolverSpecify::DDML1MIXA ||
+         get_solver().solver_type() == SolverSpecify::DDML2MIXA ||
+         get_solver().solver_type() == SolverSpecify::EBML3MIXA )
+      return _solver.get_system().get_circuit()->get_current_from_sync ( SolverSpecify::Electrode_IScan[0] );
+
+    const BoundaryCondition * bc = _solver.get_system().get_bcs()->get_bc ( SolverSpecify::Electrode_IScan[0] );
+    return bc->ext_circuit()->Iapp();
+  }
+
+  return _count;
+}
+
+
+/*----------------------------------------------------------------------
+ *  This is executed after each solution step.
+ */
+void XDMFHook::post_solve()
+{
+  if ( !_xdmf ) return;
+
+  double value = _scan_value();
+
+  double step = 0, unit = 1.0;
+  if ( SolverSpecify::Type==SolverSpecify::TRANSIENT )
+  { step = _t_step; unit = PhysicalUnit::ps; }
+  if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_VScan.size() )
+  { step = _v_step; unit = PhysicalUnit::V; }
+  if ( SolverSpecify::Type==SolverSpecify::DCSWEEP && SolverSpecify::Electrode_IScan.size() )
+  { step = _i_step; unit = PhysicalUnit::A; }
+
+  // always write the first step
+  if ( _xdmf->n_steps() && std::abs ( value - _last ) < step ) return;
+
+  _xdmf->write_step ( value/unit );
+  _last = value;
+  _count++;
+
+  mxml_node_t *eSolution = get_solver().current_dom_solution_elem();
+  if ( eSolution )
+  {
+    std::ostringstream step_string;
+    step_string << _prefix << ".xmf:" << _xdmf->n_steps()-1;
+
+    mxml_node_t *eOutput  = mxmlFindElement ( eSolution, eSolution, "output", NULL, NULL, MXML_DESCEND_FIRST );
+    mxml_node_t *eXdmf = mxmlNewElement ( eOutput, "xdmf" );
+    mxml_node_t *eFile    = mxmlNewElement ( eXdmf, "file" );
+    mxmlAdd ( eFile, MXML_ADD_AFTER, NULL, MXMLQVariant::makeQVString ( step_string.str() ) );
+  }
+}
+
+
+/*----------------------------------------------------------------------
+ *  This is executed after each (nonlinear) iteration
+ */
+void XDMFHook::post_iteration()
+{}
+
+
+/*----------------------------------------------------------------------
+ * This is executed after the finalization of the solver
+ */
+void XDMFHook::on_close()
+{
+  delete _xdmf;
+  _xdmf = 0;
+}
+
+
+#ifdef DLLHOOK
+
+// dll interface
+extern "C"
+{
+  Hook* get_hook ( SolverBase & solver, const std::string & name, void * fun_data )
+  {
+    return new XDMFHook ( solver, name, fun_data );
+  }
+
+}
+
+#endif
+
@@ -5,6 +5,7 @@
 #include "asinh.hpp"
 #include "interpolation_2d_csa.h"
 #include "parallel.h"
+#include "threads.h"
 
 Interpolation2D_CSA::Interpolation2D_CSA()
 {}
@@ -118,24 +119,55 @@ double Interpolation2D_CSA::get_interpolated_value(const Point & point, int grou
   pout.y = point.y();
   CSA::csa_approximatepoints(field, 1, &pout);
 
+  double value = _field_value(group, pout.z);
+
+#if defined(HAVE_FENV_H) && defined(DEBUG)
+  feclearexcept(FE_INVALID);
+#endif
+
+  return value;
+}
+
+
+void Interpolation2D_CSA::get_interpolated_values(const std::vector<Point> & points, int group, std::vector<double> & values) const
+{
+  std::vector<CSA::point> pout(points.size());
+  for(unsigned int n=0; n<points.size(); ++n)
+  {
+    pout[n].x = points[n].x();
+    pout[n].y = points[n].y();
+  }
+
+  ApproximateBody body;
+  body.field = field_map.find(group)->second;
+  body.points = &pout;
+  Threads::parallel_for(0, pout.size(), body);
+
+  values.resize(points.size());
+  for(unsigned int n=0; n<points.size(); ++n)
+    values[n] = _field_value(group, pout[n].z);
+
+#if defined(HAVE_FENV_H) && defined(DEBUG)
+  feclearexcept(FE_INVALID);
+#endif
+}
+
+
+double Interpolation2D_CSA::_field_value(int group, double z) const
+{
   InterpolationType type = _interpolation_type.find(group)->second;
 
   switch(type)
   {
   case Linear    : break;
-  case SignedLog : pout.z = pout.z>0 ? exp(pout.z)-1 : 1-exp(-pout.z) ; break;
-  case Asinh     : pout.z = sinh(pout.z); break;
+  case SignedLog : z = z>0 ? exp(z)-1 : 1-exp(-z) ; break;
+  case Asinh     : z = sinh(z); break;
   }
 
   double vmin = field_limit.find(group)->second.first;
   double vmax = field_limit.find(group)->second.second;
-  if(pout.z<vmin) pout.z = vmin;
-  if(pout.z>vmax) pout.z = vmax;
-
-#if defined(HAVE_FENV_H) && defined(DEBUG)
-  feclearexcept(FE_INVALID);
-#endif
+  if(z<vmin) z = vmin;
+  if(z>vmax) z = vmax;
 
-  return pout.z;
+  return z;
 }
-
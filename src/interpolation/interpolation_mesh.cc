@@ -0,0 +1,354 @@
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <algorithm>
+
+#include "config.h"
+#include "asinh.hpp"
+#include "interpolation_mesh.h"
+#include "serial_mesh.h"
+#include "elem.h"
+#include "fe_type.h"
+#include "fe_interface.h"
+#include "point_locator_tree.h"
+#include "parallel.h"
+#include "threads.h"
+
+
+InterpolationMesh::InterpolationMesh(const MeshBase & mesh)
+  : _mesh(new SerialMesh(dynamic_cast<const UnstructuredMesh &>(mesh)))
+{
+  // we need the whole mesh to locate any point
+  if( !_mesh->is_serial() )
+    _mesh->allgather();
+
+  _locator = AutoPtr<PointLocatorBase>(new PointLocatorTree(*_mesh));
+  _locator->enable_out_of_mesh_mode();
+}
+
+
+InterpolationMesh::~InterpolationMesh()
+{
+  clear();
+}
+
+
+void InterpolationMesh::clear()
+{
+  _value.clear();
+  _valid.clear();
+  _node_bins.clear();
+}
+
+
+void InterpolationMesh::add_scatter_data(const Point & point, int group, double value)
+{
+  const Elem * elem = (*_locator)(point);
+  if( elem == NULL ) return;
+
+  unsigned int nearest = 0;
+  for(unsigned int i=1; i<elem->n_nodes(); ++i)
+    if( (elem->point(i) - point).size_sq() < (elem->point(nearest) - point).size_sq() )
+      nearest = i;
+
+  add_node_data(elem->node(nearest), point, group, value);
+}
+
+
+void InterpolationMesh::add_node_data(unsigned int node_id, const Point &, int group, double value)
+{
+  std::vector<double> & values = _value[group];
+  std::vector<int> & valid = _valid[group];
+  if( values.size() < _mesh->max_node_id() )
+  {
+    values.resize(_mesh->max_node_id(), 0.0);
+    valid.resize(_mesh->max_node_id(), 0);
+  }
+
+  values[node_id] = scaleValue(_interpolation_type[group], value);
+  valid[node_id] = 1;
+}
+
+
+void InterpolationMesh::setup(int group)
+{
+  std::vector<int> & valid = _valid[group];
+  _value[group].resize(_mesh->max_node_id(), 0.0);
+  valid.resize(_mesh->max_node_id(), 0);
+
+  // built once, the nearest node search of points out of mesh is cheap
+  _node_bins[group].build(*_mesh, valid);
+}
+
+
+void InterpolationMesh::broadcast(unsigned int root)
+{
+  std::vector<int> groups;
+  std::map<int, std::vector<double> >::iterator it=_value.begin();
+  for(; it!=_value.end(); ++it)
+    groups.push_back(it->first);
+  Parallel::broadcast(groups, root);
+
+  for(unsigned int n=0; n<groups.size(); ++n)
+  {
+    Parallel::broadcast(_value[groups[n]], root);
+    Parallel::broadcast(_valid[groups[n]], root);
+    setup(groups[n]);
+  }
+}
+
+
+double InterpolationMesh::get_interpolated_value(const Point & point, int group) const
+{
+  return _value_at((*_locator)(point), point, group);
+}
+
+
+void InterpolationMesh::get_interpolated_values(const std::vector<Point> & points, int group, std::vector<double> & values) const
+{
+  values.resize(points.size());
+
+  // the point locator caches the last element, each thread needs its own one
+  unsigned int n_threads = Threads::n_threads();
+  std::vector<PointLocatorBase *> locators;
+  for(unsigned int t=0; t<n_threads; ++t)
+  {
+    locators.push_back(new PointLocatorTree(*_mesh, _locator.get()));
+    locators.back()->enable_out_of_mesh_mode();
+  }
+
+  InterpolateBody body;
+  body.interpolator = this;
+  body.points = &points;
+  body.values = &values;
+  body.locators = &locators;
+  body.group = group;
+  Threads::parallel_for(0, points.size(), body, n_threads);
+
+  for(unsigned int t=0; t<locators.size(); ++t)
+    delete locators[t];
+}
+
+
+void InterpolationMesh::InterpolateBody::operator() (unsigned int begin, unsigned int end, unsigned int tid)
+{
+  const PointLocatorBase & locator = *(*locators)[tid];
+  for(unsigned int n=begin; n<end; ++n)
+  {
+    const Point & p = (*points)[n];
+    (*values)[n] = interpolator->_value_at(locator(p), p, group);
+  }
+}
+
+
+double InterpolationMesh::_value_at(const Elem * elem, const Point & p, int group) const
+{
+  InterpolationType type = _interpolation_type.find(group)->second;
+  const std::vector<double> & values = _value.find(group)->second;
+  const std::vector<int> & valid = _valid.find(group)->second;
+
+  if( elem == NULL )
+    return _nearest_node_value(p, group);
+
+  double weights[max_elem_nodes];
+  shape_weights(elem, p, weights);
+
+  // only the nodes have value take part in
+  double sum = 0.0, weight_sum = 0.0;
+  for(unsigned int i=0; i<elem->n_nodes(); ++i)
+  {
+    if( !valid[elem->node(i)] ) continue;
+    sum += weights[i]*values[elem->node(i)];
+    weight_sum += weights[i];
+  }
+
+  if( weight_sum <= 0.0 )
+    return _nearest_node_value(p, group);
+
+  return unscaleValue(type, sum/weight_sum);
+}
+
+
+double InterpolationMesh::_nearest_node_value(const Point & p, int group) const
+{
+  InterpolationType type = _interpolation_type.find(group)->second;
+  const std::vector<double> & values = _value.find(group)->second;
+
+  unsigned int nearest = _node_bins.find(group)->second.nearest(*_mesh, p);
+  if( nearest == invalid_uint ) return 0.0;
+
+  return unscaleValue(type, values[nearest]);
+}
+
+
+void InterpolationMesh::shape_weights(const Elem * elem, const Point & p, double * weights)
+{
+  genius_assert(elem->n_nodes() <= max_elem_nodes);
+
+  switch(elem->type())
+  {
+      case EDGE2       :
+      case EDGE2_FVM   :
+      case TRI3        :
+      case TRI3_FVM    :
+      case QUAD4       :
+      case QUAD4_FVM   :
+      case TET4        :
+      case TET4_FVM    :
+      case PYRAMID5    :
+      case PRISM6      :
+      case PRISM6_FVM  :
+      case HEX8        :
+      case HEX8_FVM    :
+      {
+        const unsigned int dim = elem->dim();
+        const FEType fe_type(FIRST, LAGRANGE);
+        const Point ref = FEInterface::inverse_map(dim, fe_type, elem, p);
+        for(unsigned int i=0; i<elem->n_nodes(); ++i)
+          weights[i] = FEInterface::shape(dim, fe_type, elem, i, ref);
+        return;
+      }
+      default : break;
+  }
+
+  // shape function is not available for this element type, use inverse distance weight
+  const Real tol = 1e-10*elem->hmin();
+  double sum = 0.0;
+  for(unsigned int i=0; i<elem->n_nodes(); ++i)
+  {
+    double d = (elem->point(i) - p).size();
+    if(d <= tol)
+    {
+      for(unsigned int j=0; j<elem->n_nodes(); ++j)
+        weights[j] = 0.0;
+      weights[i] = 1.0;
+      return;
+    }
+    weights[i] = 1.0/d;
+    sum += weights[i];
+  }
+  for(unsigned int i=0; i<elem->n_nodes(); ++i)
+    weights[i] /= sum;
+}
+
+
+void InterpolationMesh::NodeBins::build(const MeshBase & mesh, const std::vector<int> & valid)
+{
+  std::vector<unsigned int> valid_nodes;
+  for(unsigned int n=0; n<valid.size(); ++n)
+    if( valid[n] ) valid_nodes.push_back(n);
+
+  n[0] = n[1] = n[2] = 1;
+  h = 1.0;
+  offset.assign(2, 0);
+  nodes.clear();
+  if( valid_nodes.empty() ) return;
+
+  // bounding box of the nodes
+  Point hi;
+  lo = hi = mesh.point(valid_nodes[0]);
+  for(unsigned int v=1; v<valid_nodes.size(); ++v)
+  {
+    const Point & p = mesh.point(valid_nodes[v]);
+    for(unsigned int d=0; d<3; ++d)
+    {
+      lo(d) = std::min(lo(d), p(d));
+      hi(d) = std::max(hi(d), p(d));
+    }
+  }
+
+  // bin size, about one node per bin in the dimensions the nodes spread over
+  double measure = 1.0, max_extent = 0.0;
+  unsigned int dim = 0;
+  for(unsigned int d=0; d<3; ++d)
+    max_extent = std::max(max_extent, hi(d)-lo(d));
+  for(unsigned int d=0; d<3; ++d)
+    if( hi(d)-lo(d) > 1e-10*max_extent )
+    {
+      measure *= hi(d)-lo(d);
+      dim++;
+    }
+  if( dim > 0 )
+    h = std::pow(measure/valid_nodes.size(), 1.0/dim);
+  for(unsigned int d=0; d<3; ++d)
+    n[d] = std::min(static_cast<unsigned int>((hi(d)-lo(d))/h) + 1, 1024u);
+
+  // counting sort of nodes into bins
+  std::vector<unsigned int> node_bin(valid_nodes.size());
+  offset.assign(n[0]*n[1]*n[2]+1, 0);
+  for(unsigned int v=0; v<valid_nodes.size(); ++v)
+  {
+    const Point & p = mesh.point(valid_nodes[v]);
+    unsigned int ijk[3];
+    for(unsigned int d=0; d<3; ++d)
+      ijk[d] = std::min(static_cast<unsigned int>((p(d)-lo(d))/h), n[d]-1);
+    node_bin[v] = bin(ijk[0], ijk[1], ijk[2]);
+    offset[node_bin[v]+1]++;
+  }
+  for(unsigned int b=1; b<offset.size(); ++b)
+    offset[b] += offset[b-1];
+
+  nodes.resize(valid_nodes.size());
+  std::vector<unsigned int> cursor(offset.begin(), offset.end()-1);
+  for(unsigned int v=0; v<valid_nodes.size(); ++v)
+    nodes[cursor[node_bin[v]]++] = valid_nodes[v];
+}
+
+
+unsigned int InterpolationMesh::NodeBins::nearest(const MeshBase & mesh, const Point & p) const
+{
+  if( nodes.empty() ) return invalid_uint;
+
+  // the bin of p, clamped into the grid
+  int c[3];
+  for(unsigned int d=0; d<3; ++d)
+  {
+    double x = (p(d)-lo(d))/h;
+    c[d] = x < 0.0 ? 0 : std::min(static_cast<int>(x), static_cast<int>(n[d])-1);
+  }
+
+  unsigned int nearest = invalid_uint;
+  double dist = std::numeric_limits<double>::max();
+
+  // search the shells of bins around c, until the nodes out of the searched block can not be nearer
+  for(int r=0; ; ++r)
+  {
+    int b0[3], b1[3];
+    for(unsigned int d=0; d<3; ++d)
+    {
+      b0[d] = std::max(c[d]-r, 0);
+      b1[d] = std::min(c[d]+r, static_cast<int>(n[d])-1);
+    }
+
+    for(int k=b0[2]; k<=b1[2]; ++k)
+      for(int j=b0[1]; j<=b1[1]; ++j)
+        for(int i=b0[0]; i<=b1[0]; ++i)
+        {
+          // only the bins on the shell, inner ones are searched before
+          if( std::abs(i-c[0]) != r && std::abs(j-c[1]) != r && std::abs(k-c[2]) != r ) continue;
+          const unsigned int b = bin(i, j, k);
+          for(unsigned int m=offset[b]; m<offset[b+1]; ++m)
+          {
+            double d = (mesh.point(nodes[m]) - p).size_sq();
+            if( d < dist ) { dist = d; nearest = nodes[m]; }
+          }
+        }
+
+    // lower bound of the distance to bins out of the block
+    double bound = std::numeric_limits<double>::max();
+    for(unsigned int d=0; d<3; ++d)
+    {
+      if( b0[d] > 0 )
+        bound = std::min(bound, std::max(p(d) - (lo(d) + b0[d]*h), 0.0));
+      if( b1[d] < static_cast<int>(n[d])-1 )
+        bound = std::min(bound, std::max(lo(d) + (b1[d]+1)*h - p(d), 0.0));
+    }
+
+    // the whole grid is searched
+    if( bound == std::numeric_limits<double>::max() ) break;
+    if( nearest != invalid_uint && dist <= bound*bound ) break;
+  }
+
+  return nearest;
+}
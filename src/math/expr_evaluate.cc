@@ -96,18 +96,43 @@ ExprEvalute::ExprEvalute(const std::string & expr)
   e.SetValueList(&vlist);
 
   e.Parse(expr);
+
+  _x = vlist.GetAddress("x");
+  _y = vlist.GetAddress("y");
+  _z = vlist.GetAddress("z");
+  _t = vlist.GetAddress("t");
+
+  // compile the expression, the tree is kept for what the program can not do
+  _program.bind_input(_x, 0);
+  _program.bind_input(_y, 1);
+  _program.bind_input(_z, 2);
+  _program.bind_input(_t, 3);
+  for(ExprEval::ValueList::size_type pos=0; pos<vlist.Count(); ++pos)
+  {
+    std::string name;
+    vlist.Item(pos, &name);
+    if(vlist.IsConstant(name))
+      _program.bind_constant(vlist.GetAddress(name));
+  }
+  _program.compile(e);
 }
 
 
 
 double ExprEvalute::eval(double x, double y, double z, double t)
 {
+  if(_program.compiled())
+  {
+    const double input[4] = {x, y, z, t};
+    double result;
+    if(_program.eval(input, result)) return result;
+  }
+
   //assign variable value to the expr
-  *(vlist.GetAddress("x")) = x;
-  *(vlist.GetAddress("y")) = y;
-  *(vlist.GetAddress("z")) = z;
-  *(vlist.GetAddress("t")) = t;
+  *_x = x;
+  *_y = y;
+  *_z = z;
+  *_t = t;
 
   return e.Evaluate();
 }
-
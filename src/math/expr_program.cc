@@ -0,0 +1,349 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <cmath>
+#include <cfloat>
+
+#include "genius_common.h"
+#include "expr_program.h"
+#include "mathfunc.h"
+
+
+ExprProgram::ExprProgram()
+  : _compiled(false), _n_registers(4), _result(0)
+{}
+
+
+void ExprProgram::bind_input(const double *var, unsigned int index)
+{
+  genius_assert(index < 4);
+  _inputs[var] = index;
+}
+
+
+void ExprProgram::bind_constant(const double *var)
+{
+  _constant_vars[var] = *var;
+}
+
+
+bool ExprProgram::compile(const ExprEval::Expression &e)
+{
+  _code.clear();
+  _n_registers = 4;
+  _constant_value.clear();
+  _constant_register.clear();
+
+  int result = e.Lower(*this);
+  _compiled = (result >= 0);
+  if(!_compiled)
+  {
+    _code.clear();
+    return false;
+  }
+  _result = result;
+
+  // constant registers are never written by instructions, set them once
+  _registers.assign(_n_registers, 0.0);
+  std::map<unsigned int, double>::const_iterator it = _constant_value.begin();
+  for( ; it != _constant_value.end(); ++it)
+    _registers[it->first] = it->second;
+
+  return true;
+}
+
+
+int ExprProgram::Value(double val)
+{
+  std::map<double, unsigned int>::const_iterator it = _constant_register.find(val);
+  if(it != _constant_register.end())
+    return it->second;
+
+  unsigned int r = _n_registers++;
+  _constant_register[val] = r;
+  _constant_value[r] = val;
+  return r;
+}
+
+
+int ExprProgram::Variable(const double *var)
+{
+  std::map<const double *, unsigned int>::const_iterator input = _inputs.find(var);
+  if(input != _inputs.end())
+    return input->second;
+
+  std::map<const double *, double>::const_iterator constant = _constant_vars.find(var);
+  if(constant != _constant_vars.end())
+    return Value(constant->second);
+
+  // other variable, read it at evaluation time
+  Instruction ins;
+  ins.op = OP_LOAD;
+  ins.dst = _n_registers++;
+  for(unsigned int i=0; i<5; ++i) ins.arg[i] = 0;
+  ins.ptr = var;
+  _code.push_back(ins);
+  return ins.dst;
+}
+
+
+int ExprProgram::Operator(const std::string &name, const std::vector<int> &args)
+{
+  const unsigned int n = args.size();
+
+  if(name == "+" && n == 2)   return _emit(OP_ADD, args);
+  if(name == "-" && n == 2)   return _emit(OP_SUB, args);
+  if(name == "*" && n == 2)   return _emit(OP_MUL, args);
+  if(name == "/" && n == 2)   return _emit(OP_DIV, args);
+  if(name == "^" && n == 2)   return _emit(OP_POW, args);
+  if(name == "neg" && n == 1) return _emit(OP_NEG, args);
+
+  if(name == "abs" && n == 1)     return _emit(OP_ABS, args);
+  if(name == "mod" && n == 2)     return _emit(OP_MOD, args);
+  if(name == "ipart" && n == 1)   return _emit(OP_IPART, args);
+  if(name == "fpart" && n == 1)   return _emit(OP_FPART, args);
+  if((name == "min" || name == "max") && n >= 2)
+  {
+    // n-ary min/max as a chain of binary ones, left to right
+    OpCode op = (name == "min" ? OP_MIN : OP_MAX);
+    std::vector<int> pair(2);
+    pair[0] = args[0];
+    for(unsigned int i=1; i<n; ++i)
+    {
+      pair[1] = args[i];
+      pair[0] = _emit(op, pair);
+    }
+    return pair[0];
+  }
+  if(name == "sqrt" && n == 1)    return _emit(OP_SQRT, args);
+  if(name == "sin" && n == 1)     return _emit(OP_SIN, args);
+  if(name == "cos" && n == 1)     return _emit(OP_COS, args);
+  if(name == "tan" && n == 1)     return _emit(OP_TAN, args);
+  if(name == "sinh" && n == 1)    return _emit(OP_SINH, args);
+  if(name == "cosh" && n == 1)    return _emit(OP_COSH, args);
+  if(name == "tanh" && n == 1)    return _emit(OP_TANH, args);
+  if(name == "asin" && n == 1)    return _emit(OP_ASIN, args);
+  if(name == "acos" && n == 1)    return _emit(OP_ACOS, args);
+  if(name == "atan" && n == 1)    return _emit(OP_ATAN, args);
+  if(name == "atan2" && n == 2)   return _emit(OP_ATAN2, args);
+  if(name == "log" && n == 1)     return _emit(OP_LOG10, args);
+  if(name == "ln" && n == 1)      return _emit(OP_LN, args);
+  if(name == "exp" && n == 1)     return _emit(OP_EXP, args);
+  if(name == "logn" && n == 2)    return _emit(OP_LOGN, args);
+  if(name == "erf" && n == 1)     return _emit(OP_ERF, args);
+  if(name == "erfc" && n == 1)    return _emit(OP_ERFC, args);
+  if(name == "ceil" && n == 1)    return _emit(OP_CEIL, args);
+  if(name == "floor" && n == 1)   return _emit(OP_FLOOR, args);
+  if(name == "deg" && n == 1)     return _emit(OP_DEG, args);
+  if(name == "rad" && n == 1)     return _emit(OP_RAD, args);
+  if(name == "if" && n == 3)      return _emit(OP_IF, args);
+  if(name == "select" && (n == 3 || n == 4))
+  {
+    // select(c, neg, zero) is select(c, neg, zero, zero)
+    std::vector<int> select_args(args);
+    if(n == 3) select_args.push_back(args[2]);
+    return _emit(OP_SELECT, select_args);
+  }
+  if(name == "equal" && n == 2)   return _emit(OP_EQUAL, args);
+  if(name == "above" && n == 2)   return _emit(OP_ABOVE, args);
+  if(name == "below" && n == 2)   return _emit(OP_BELOW, args);
+  if(name == "clip" && n == 3)    return _emit(OP_CLIP, args);
+  if(name == "clamp" && n == 3)   return _emit(OP_CLAMP, args);
+  if(name == "rescale" && n == 5) return _emit(OP_RESCALE, args);
+  if(name == "and" && n == 2)     return _emit(OP_AND, args);
+  if(name == "or" && n == 2)      return _emit(OP_OR, args);
+  if(name == "not" && n == 1)     return _emit(OP_NOT, args);
+
+  // rand, random, poly, hyperbolic inverse... are left to the expression tree
+  return -1;
+}
+
+
+int ExprProgram::_emit(OpCode op, const std::vector<int> &args)
+{
+  Instruction ins;
+  ins.op = op;
+  ins.ptr = 0;
+  for(unsigned int i=0; i<5; ++i)
+    ins.arg[i] = i < args.size() ? args[i] : 0;
+
+  // constant folding, the operator is executed on a scratch register file
+  bool constant = true;
+  for(unsigned int i=0; i<args.size(); ++i)
+    if(_constant_value.find(args[i]) == _constant_value.end()) constant = false;
+
+  if(constant)
+  {
+    double reg[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    bool bad = false;
+    Instruction scratch = ins;
+    for(unsigned int i=0; i<args.size(); ++i)
+    {
+      reg[i] = _constant_value[args[i]];
+      scratch.arg[i] = i;
+    }
+    scratch.dst = args.size();
+    _execute(scratch, reg, bad);
+    // keep the instruction if it fails, the error is reported at evaluation time
+    if(!bad)
+      return Value(reg[scratch.dst]);
+  }
+
+  ins.dst = _n_registers++;
+  _code.push_back(ins);
+  return ins.dst;
+}
+
+
+// the checks match the errno/exception checks of the expression tree
+#define EXPR_UNARY(OP, EXPR) \
+  case OP: { const double x = a; r = (EXPR); } break;
+
+#define EXPR_UNARY_CHECKED(OP, EXPR) \
+  case OP: { const double x = a; r = (EXPR); if(!(std::abs(r) <= DBL_MAX)) bad = true; } break;
+
+#define EXPR_BINARY(OP, EXPR) \
+  case OP: { const double x = a, y = b; r = (EXPR); } break;
+
+#define EXPR_BINARY_CHECKED(OP, EXPR) \
+  case OP: { const double x = a, y = b; r = (EXPR); if(!(std::abs(r) <= DBL_MAX)) bad = true; } break;
+
+void ExprProgram::_execute(const Instruction &ins, double *reg, bool &bad)
+{
+  double & r = reg[ins.dst];
+  const double a = reg[ins.arg[0]];
+  const double b = reg[ins.arg[1]];
+  const double c = reg[ins.arg[2]];
+  const double d = reg[ins.arg[3]];
+  const double e = reg[ins.arg[4]];
+
+  switch(ins.op)
+  {
+  case OP_LOAD:
+    r = *ins.ptr;
+    break;
+
+    EXPR_BINARY(OP_ADD, x + y)
+    EXPR_BINARY(OP_SUB, x - y)
+    EXPR_BINARY(OP_MUL, x * y)
+
+  case OP_DIV:
+    if(b == 0.0) { bad = true; r = 0.0; }
+    else r = a/b;
+    break;
+
+    EXPR_UNARY(OP_NEG, -x)
+    EXPR_BINARY_CHECKED(OP_POW, pow(x, y))
+
+    EXPR_UNARY(OP_ABS, std::abs(x))
+    EXPR_BINARY_CHECKED(OP_MOD, fmod(x, y))
+    EXPR_UNARY(OP_IPART, x < 0 ? ceil(x) : floor(x))
+    EXPR_UNARY(OP_FPART, x - (x < 0 ? ceil(x) : floor(x)))
+    EXPR_BINARY(OP_MIN, y < x ? y : x)
+    EXPR_BINARY(OP_MAX, y > x ? y : x)
+
+    EXPR_UNARY_CHECKED(OP_SQRT, sqrt(x))
+    EXPR_UNARY_CHECKED(OP_SIN, sin(x))
+    EXPR_UNARY_CHECKED(OP_COS, cos(x))
+    EXPR_UNARY_CHECKED(OP_TAN, tan(x))
+    EXPR_UNARY_CHECKED(OP_SINH, sinh(x))
+    EXPR_UNARY_CHECKED(OP_COSH, cosh(x))
+    EXPR_UNARY_CHECKED(OP_TANH, tanh(x))
+    EXPR_UNARY_CHECKED(OP_ASIN, asin(x))
+    EXPR_UNARY_CHECKED(OP_ACOS, acos(x))
+    EXPR_UNARY_CHECKED(OP_ATAN, atan(x))
+    EXPR_BINARY_CHECKED(OP_ATAN2, atan2(x, y))
+    EXPR_UNARY_CHECKED(OP_LOG10, log10(x))
+    EXPR_UNARY_CHECKED(OP_LN, log(x))
+    EXPR_UNARY_CHECKED(OP_EXP, exp(x))
+
+  case OP_LOGN:
+    {
+      double base = log(b);
+      if(base == 0.0) { bad = true; r = 0.0; break; }
+      r = log(a)/base;
+      if(!(std::abs(r) <= DBL_MAX)) bad = true;
+    }
+    break;
+
+    EXPR_UNARY(OP_ERF, Erf(x))
+    EXPR_UNARY(OP_ERFC, Erfc(x))
+    EXPR_UNARY(OP_CEIL, ceil(x))
+    EXPR_UNARY(OP_FLOOR, floor(x))
+    EXPR_UNARY(OP_DEG, (x * 180.0) / 3.1415926535897932)
+    EXPR_UNARY(OP_RAD, (x * 3.1415926535897932) / 180.0)
+
+  case OP_IF:
+    r = (a == 0.0 ? c : b);
+    break;
+  case OP_SELECT:
+    r = (a < 0.0 ? b : (a == 0.0 ? c : d));
+    break;
+
+    EXPR_BINARY(OP_EQUAL, x == y ? 1.0 : 0.0)
+    EXPR_BINARY(OP_ABOVE, x > y ? 1.0 : 0.0)
+    EXPR_BINARY(OP_BELOW, x < y ? 1.0 : 0.0)
+
+  case OP_CLIP:
+    r = (a < b ? b : (a > c ? c : a));
+    break;
+  case OP_CLAMP:
+    {
+      if(b == c) { r = b; break; }
+      double tmp = fmod(a - b, c - b);
+      r = (tmp < 0 ? tmp + c : tmp + b);
+    }
+    break;
+  case OP_RESCALE:
+    {
+      double odiff = c - b;
+      r = (odiff == 0.0 ? d : (a - b) * (e - d) / odiff + d);
+    }
+    break;
+
+    EXPR_BINARY(OP_AND, (x == 0.0 || y == 0.0) ? 0.0 : 1.0)
+    EXPR_BINARY(OP_OR, (x == 0.0 && y == 0.0) ? 0.0 : 1.0)
+    EXPR_UNARY(OP_NOT, x == 0.0 ? 1.0 : 0.0)
+  }
+}
+
+#undef EXPR_UNARY
+#undef EXPR_UNARY_CHECKED
+#undef EXPR_BINARY
+#undef EXPR_BINARY_CHECKED
+
+
+bool ExprProgram::eval(const double *input, double &result)
+{
+  genius_assert(_compiled);
+
+  double * reg = &_registers[0];
+  for(unsigned int i=0; i<4; ++i)
+    reg[i] = input[i];
+
+  bool bad = false;
+  for(unsigned int i=0; i<_code.size(); ++i)
+    _execute(_code[i], reg, bad);
+
+  result = reg[_result];
+  return !bad;
+}
@@ -0,0 +1,180 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <set>
+#include <map>
+#include <algorithm>
+
+#include "genius_petsc.h"
+#include "genius_common.h"
+#include "mat_row_redirect.h"
+
+
+void MatRowRedirect::build(Mat mat, const std::vector<PetscInt> &src_rows, const std::vector<PetscInt> &dst_rows, const std::vector<PetscInt> &clear_rows)
+{
+  genius_assert(src_rows.size() == dst_rows.size());
+
+  this->clear();
+
+  _src_rows   = src_rows;
+  _dst_rows   = dst_rows;
+  _clear_rows = clear_rows;
+
+  MatGetOwnershipRange(mat, &_row_begin, &_row_end);
+  _row_slot.assign(_row_end - _row_begin, -1);
+
+  std::set<PetscInt> cleared(clear_rows.begin(), clear_rows.end());
+
+  // source rows in order, each with its destination rows
+  std::multimap<PetscInt, PetscInt> redirect;
+  for(unsigned int n=0; n<src_rows.size(); ++n)
+    redirect.insert(std::make_pair(src_rows[n], dst_rows[n]));
+
+  std::set<PetscInt> rows(cleared);
+  for(unsigned int n=0; n<src_rows.size(); ++n)
+    rows.insert(src_rows[n]);
+
+  _target_begin.push_back(0);
+  _capture_begin.push_back(0);
+  for(std::set<PetscInt>::const_iterator it = rows.begin(); it != rows.end(); ++it)
+  {
+    PetscInt row = *it;
+    genius_assert(row >= _row_begin && row < _row_end);
+    _row_slot[row - _row_begin] = _cleared.size();
+
+    bool is_cleared = cleared.find(row) != cleared.end();
+    _cleared.push_back(is_cleared);
+
+    // the row itself is kept unless cleared
+    if( !is_cleared ) _targets.push_back(row);
+
+    // row is added to its destinations, which are zeroed after adding if they are cleared
+    std::pair<std::multimap<PetscInt, PetscInt>::const_iterator, std::multimap<PetscInt, PetscInt>::const_iterator> range = redirect.equal_range(row);
+    for(std::multimap<PetscInt, PetscInt>::const_iterator dst = range.first; dst != range.second; ++dst)
+      if( cleared.find(dst->second) == cleared.end() )
+        _targets.push_back(dst->second);
+
+    _target_begin.push_back(_targets.size());
+
+    // capture slots of cleared row are its nonzero columns
+    if( is_cleared )
+    {
+      PetscInt ncols;
+      const PetscInt * cols;
+      MatGetRow(mat, row, &ncols, &cols, PETSC_NULL);
+      std::vector<PetscInt>::size_type begin = _capture_cols.size();
+      _capture_cols.insert(_capture_cols.end(), cols, cols+ncols);
+      MatRestoreRow(mat, row, &ncols, &cols, PETSC_NULL);
+      std::sort(_capture_cols.begin()+begin, _capture_cols.end());
+    }
+    _capture_begin.push_back(_capture_cols.size());
+  }
+  _capture_vals.assign(_capture_cols.size(), 0.0);
+  _missed = false;
+
+  _mat = mat;
+}
+
+
+void MatRowRedirect::clear()
+{
+  _mat = 0;
+
+  _src_rows.clear();
+  _dst_rows.clear();
+  _clear_rows.clear();
+  _row_slot.clear();
+  _target_begin.clear();
+  _targets.clear();
+  _cleared.clear();
+  _capture_begin.clear();
+  _capture_cols.clear();
+  _capture_vals.clear();
+  _missed = false;
+}
+
+
+void MatRowRedirect::begin_assembly()
+{
+  std::fill(_capture_vals.begin(), _capture_vals.end(), 0.0);
+  _missed = false;
+}
+
+
+int MatRowRedirect::capture_position(int s, PetscInt col) const
+{
+  std::vector<PetscInt>::const_iterator begin = _capture_cols.begin() + _capture_begin[s];
+  std::vector<PetscInt>::const_iterator end   = _capture_cols.begin() + _capture_begin[s+1];
+  std::vector<PetscInt>::const_iterator it = std::lower_bound(begin, end, col);
+  if( it == end || *it != col ) return -1;
+  return it - _capture_cols.begin();
+}
+
+
+PetscErrorCode MatRowRedirect::add_values(PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], const PetscScalar v[])
+{
+  PetscErrorCode ierr = 0;
+  for(PetscInt i=0; i<m; ++i)
+  {
+    const PetscScalar * vi = v + i*n;
+    int s = slot(rows[i]);
+    if( s < 0 )
+    {
+      ierr = MatSetValues(_mat, 1, &rows[i], n, cols, vi, ADD_VALUES);
+      continue;
+    }
+
+    if( _cleared[s] )
+    {
+      for(PetscInt j=0; j<n; ++j)
+      {
+        if( cols[j] < 0 ) continue;
+        int pos = capture_position(s, cols[j]);
+        if( pos >= 0 )
+          _capture_vals[pos] += vi[j];
+        else
+          _missed = true; // the solver falls back to assemble this step without the table
+      }
+    }
+
+    for(unsigned int k=_target_begin[s]; k<_target_begin[s+1]; ++k)
+      ierr = MatSetValues(_mat, 1, &_targets[k], n, cols, vi, ADD_VALUES);
+  }
+  return ierr;
+}
+
+
+PetscErrorCode MatRowRedirect::get_values(PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], PetscScalar v[]) const
+{
+  for(PetscInt i=0; i<m; ++i)
+  {
+    int s = slot(rows[i]);
+    genius_assert(s >= 0 && _cleared[s]);
+
+    for(PetscInt j=0; j<n; ++j)
+    {
+      int pos = capture_position(s, cols[j]);
+      v[i*n+j] = pos >= 0 ? _capture_vals[pos] : 0.0;
+    }
+  }
+  return 0;
+}
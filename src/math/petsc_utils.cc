@@ -26,6 +26,7 @@
 
 #include "genius_petsc.h"
 #include "petsc_utils.h"
+#include "mat_row_redirect.h"
 
 
 namespace PetscUtils
@@ -536,6 +537,42 @@ namespace PetscUtils
 
 
 
+  /*-------------------------------------------------------------------
+   * @brief add values to matrix with ADD_VALUES, redirect rows if a row redirect table is given
+   */
+  PetscErrorCode  MatAddValues(MatRowRedirect * redirect, Mat mat, PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], const PetscScalar v[])
+  {
+    if( redirect )
+      return redirect->add_values(m, rows, n, cols, v);
+    return ::MatSetValues(mat, m, rows, n, cols, v, ADD_VALUES);
+  }
+
+
+
+  /*-------------------------------------------------------------------
+   * @brief add a value to matrix with ADD_VALUES, redirect row if a row redirect table is given
+   */
+  PetscErrorCode  MatAddValue(MatRowRedirect * redirect, Mat mat, PetscInt row, PetscInt col, PetscScalar v)
+  {
+    if( redirect )
+      return redirect->add_values(1, &row, 1, &col, &v);
+    return ::MatSetValue(mat, row, col, v, ADD_VALUES);
+  }
+
+
+
+  /*-------------------------------------------------------------------
+   * @brief get values of matrix, or the values captured for cleared rows if a row redirect table is given
+   */
+  PetscErrorCode  MatGetValues(const MatRowRedirect * redirect, Mat mat, PetscInt m, const PetscInt rows[], PetscInt n, const PetscInt cols[], PetscScalar v[])
+  {
+    if( redirect )
+      return redirect->get_values(m, rows, n, cols, v);
+    return ::MatGetValues(mat, m, rows, n, cols, v);
+  }
+
+
+
   /*-------------------------------------------------------------------
    * @brief add real DenseVector to PetscVec by dof_indices
    *
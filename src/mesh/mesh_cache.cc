@@ -0,0 +1,718 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+#include "mesh_cache.h"
+#include "mesh_base.h"
+#include "boundary_info.h"
+#include "elem.h"
+#include "node.h"
+#include "parallel.h"
+#include "perf_log.h"
+#include "log.h"
+
+
+static const char mesh_cache_magic[8] = {'G','E','N','M','E','S','H','C'};
+
+// sections are aligned for in place access of any value type
+static const size_t mesh_cache_align = 8;
+
+static size_t mesh_cache_aligned(size_t n)
+{ return (n + mesh_cache_align - 1)/mesh_cache_align*mesh_cache_align; }
+
+
+
+unsigned long long MeshCacheFile::hash(const void * p, size_t n, unsigned long long h)
+{
+  // 64bit FNV-1a
+  const unsigned char * c = static_cast<const unsigned char *>(p);
+  for(size_t i=0; i<n; ++i)
+  {
+    h ^= c[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+
+bool MeshCacheFile::open(const std::string & file_name, unsigned long long key)
+{
+  close();
+
+#ifdef HAVE_SYS_MMAN_H
+  {
+    int fd = ::open(file_name.c_str(), O_RDONLY);
+    if( fd >= 0 )
+    {
+      struct stat st;
+      if( fstat(fd, &st) == 0 && st.st_size > 0 )
+      {
+        void * data = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if( data != MAP_FAILED )
+        {
+          _image = static_cast<const char *>(data);
+          _image_size = st.st_size;
+          _mapped = true;
+        }
+      }
+      ::close(fd);
+    }
+  }
+#else
+  {
+    std::ifstream in(file_name.c_str(), std::ios::binary);
+    if(in.good())
+    {
+      in.seekg(0, std::ios::end);
+      const std::streamoff size = in.tellg();
+      in.seekg(0, std::ios::beg);
+      if(size > 0)
+      {
+        _buffer.resize(size);
+        in.read(&_buffer[0], size);
+        if(in.good())
+        {
+          _image = &_buffer[0];
+          _image_size = _buffer.size();
+        }
+      }
+    }
+  }
+#endif
+
+  if( !_image ) return false;
+
+  if( !_parse(key) )
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+
+void MeshCacheFile::close()
+{
+#ifdef HAVE_SYS_MMAN_H
+  if( _mapped )
+    munmap(const_cast<char *>(_image), _image_size);
+#endif
+  _image = 0;
+  _image_size = 0;
+  _mapped = false;
+  std::vector<char>().swap(_buffer);
+  _sections.clear();
+  _section_size.clear();
+}
+
+
+bool MeshCacheFile::_parse(unsigned long long key)
+{
+  const size_t size = _image_size;
+  if( size < sizeof(Header) + sizeof(unsigned long long) ) return false;
+
+  Header header;
+  std::memcpy(&header, _image, sizeof(Header));
+  if( std::memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) ) return false;
+  if( header.version != version || header.key != key ) return false;
+
+  // section sizes follow the header, then the sections and the checksum
+  const size_t table = static_cast<size_t>(header.n_sections)*sizeof(unsigned long long);
+  if( size < sizeof(Header) + table + sizeof(unsigned long long) ) return false;
+  const unsigned long long * section_size = reinterpret_cast<const unsigned long long *>(_image + sizeof(Header));
+
+  std::vector<const char *> sections;
+  std::vector<size_t> sizes;
+  size_t offset = sizeof(Header) + table;
+  for(unsigned int i=0; i<header.n_sections; ++i)
+  {
+    if( section_size[i] > size ) return false;
+    sections.push_back(_image + offset);
+    sizes.push_back(section_size[i]);
+    offset += mesh_cache_aligned(section_size[i]);
+    if( offset > size ) return false;
+  }
+  if( offset + sizeof(unsigned long long) != size ) return false;
+
+  unsigned long long sum;
+  std::memcpy(&sum, _image + offset, sizeof(sum));
+  if( sum != hash(_image + sizeof(Header), offset - sizeof(Header)) ) return false;
+
+  _sections.swap(sections);
+  _section_size.swap(sizes);
+  return true;
+}
+
+
+void MeshCacheFile::_add_section(const void * p, size_t n)
+{
+  const char * c = static_cast<const char *>(p);
+  _new_sections.push_back(std::vector<char>(c, c+n));
+}
+
+
+bool MeshCacheFile::write(const std::string & file_name, unsigned long long key) const
+{
+  Header header;
+  std::memset(&header, 0, sizeof(Header));
+  std::memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+  header.version    = version;
+  header.n_sections = _new_sections.size();
+  header.key        = key;
+
+  std::vector<unsigned long long> section_size;
+  for(unsigned int i=0; i<_new_sections.size(); ++i)
+    section_size.push_back(_new_sections[i].size());
+
+  const char padding[mesh_cache_align] = {0};
+
+  unsigned long long sum = 14695981039346656037ULL;
+  if(!section_size.empty())
+    sum = hash(&section_size[0], section_size.size()*sizeof(unsigned long long), sum);
+  for(unsigned int i=0; i<_new_sections.size(); ++i)
+  {
+    const std::vector<char> & data = _new_sections[i];
+    if(!data.empty())
+      sum = hash(&data[0], data.size(), sum);
+    sum = hash(padding, mesh_cache_aligned(data.size()) - data.size(), sum);
+  }
+
+  // write to a temporary file first, a partial file never has a valid name
+  const std::string tmp_name  = file_name + ".tmp";
+  bool ok = false;
+  {
+    std::ofstream out(tmp_name.c_str(), std::ios::binary);
+    if(out.good())
+    {
+      out.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+      if(!section_size.empty())
+        out.write(reinterpret_cast<const char *>(&section_size[0]), section_size.size()*sizeof(unsigned long long));
+      for(unsigned int i=0; i<_new_sections.size(); ++i)
+      {
+        const std::vector<char> & data = _new_sections[i];
+        if(!data.empty())
+          out.write(&data[0], data.size());
+        out.write(padding, mesh_cache_aligned(data.size()) - data.size());
+      }
+      out.write(reinterpret_cast<const char *>(&sum), sizeof(sum));
+      ok = out.good();
+    }
+  }
+  if(ok) ok = std::rename(tmp_name.c_str(), file_name.c_str()) == 0;
+
+  if(!ok) std::remove(tmp_name.c_str());
+  return ok;
+}
+
+
+
+
+MeshCache::MeshCache(MeshBase & mesh, const std::string & dir, unsigned int options)
+  : _mesh(mesh), _dir(dir), _key(14695981039346656037ULL), _n_sides(0)
+{
+  if(_dir.empty()) return;
+
+  // renumbering of distributed mesh is not supported
+  if( !mesh.is_serial() || mesh.max_elem_id() != mesh.n_elem() || mesh.max_node_id() != mesh.n_nodes() )
+  { _dir.clear(); return; }
+
+  START_LOG("MeshCache()", "MeshCache");
+
+  _elems.resize(mesh.n_elem(), NULL);
+  _nodes.resize(mesh.n_nodes(), NULL);
+
+  const unsigned int version = MeshCacheFile::version;
+  _add(version);
+  _add(options);
+  _add(mesh.n_nodes());
+  _add(mesh.n_elem());
+
+  MeshBase::node_iterator node_it = mesh.nodes_begin();
+  MeshBase::node_iterator node_it_end = mesh.nodes_end();
+  for(; node_it != node_it_end; ++node_it)
+  {
+    Node * node = *node_it;
+    _nodes[node->id()] = node;
+    _add(node->id());
+    for(unsigned int d=0; d<3; ++d)
+      _add((*node)(d));
+  }
+
+  MeshBase::element_iterator elem_it = mesh.elements_begin();
+  MeshBase::element_iterator elem_it_end = mesh.elements_end();
+  for(; elem_it != elem_it_end; ++elem_it)
+  {
+    Elem * elem = *elem_it;
+    // refined mesh has elem hierarchy, not cached
+    if( elem->level() != 0 ) { _dir.clear(); break; }
+
+    _elems[elem->id()] = elem;
+    _n_sides += elem->n_neighbors();
+    _add(elem->id());
+    _add(static_cast<int>(elem->type()));
+    _add(elem->subdomain_id());
+    for(unsigned int i=0; i<elem->n_nodes(); ++i)
+      _add(elem->node(i));
+  }
+
+  STOP_LOG("MeshCache()", "MeshCache");
+}
+
+
+std::string MeshCache::_file_name(const std::string & dir, unsigned long long key, const char * suffix)
+{
+  std::ostringstream name;
+  name << dir << "/" << std::hex << std::setw(16) << std::setfill('0') << key
+       << std::dec << suffix;
+  return name.str();
+}
+
+
+bool MeshCache::_check_topology() const
+{
+  if( _file.n_sections() < n_topology_sections ) return false;
+
+  const unsigned int n_nodes = _nodes.size();
+  const unsigned int n_elem  = _elems.size();
+
+  unsigned int n;
+  const unsigned int * node_order = _file.section<unsigned int>(0, n);
+  if( n != n_nodes ) return false;
+  const unsigned int * elem_order = _file.section<unsigned int>(1, n);
+  if( n != n_elem ) return false;
+  const unsigned int * neighbors = _file.section<unsigned int>(2, n);
+  if( n != _n_sides ) return false;
+
+  // the orders must be permutations
+  {
+    std::vector<bool> used(n_nodes, false);
+    for(unsigned int i=0; i<n_nodes; ++i)
+    {
+      if( node_order[i] >= n_nodes || used[node_order[i]] ) return false;
+      used[node_order[i]] = true;
+    }
+  }
+  {
+    std::vector<bool> used(n_elem, false);
+    for(unsigned int i=0; i<n_elem; ++i)
+    {
+      if( elem_order[i] >= n_elem || used[elem_order[i]] ) return false;
+      used[elem_order[i]] = true;
+    }
+  }
+
+  for(unsigned int i=0; i<_n_sides; ++i)
+    if( neighbors[i] != invalid_uint && neighbors[i] >= n_elem ) return false;
+
+  return true;
+}
+
+
+bool MeshCache::load()
+{
+  if(!enabled()) return false;
+
+  START_LOG("load()", "MeshCache");
+
+  bool hit = _file.open(_file_name(_dir, _key, ".mesh"), _key) && _check_topology();
+
+  Parallel::min(hit);
+  if(!hit)
+  {
+    _file.close();
+    STOP_LOG("load()", "MeshCache");
+    return false;
+  }
+
+  unsigned int n;
+  const unsigned int * node_order = _file.section<unsigned int>(0, n);
+  const unsigned int * elem_order = _file.section<unsigned int>(1, n);
+  const unsigned int * neighbors  = _file.section<unsigned int>(2, n);
+
+  // renumber the mesh as reorder_elems() did
+  _mesh.reorder_elems(elem_order, node_order);
+
+  // set neighbors, elem in new order
+  std::vector<Elem *> elems(_elems.size());
+  for(unsigned int i=0; i<_elems.size(); ++i)
+    elems[_elems[i]->id()] = _elems[i];
+
+  for(unsigned int i=0, s=0; i<elems.size(); ++i)
+  {
+    Elem * elem = elems[i];
+    for(unsigned int j=0; j<elem->n_neighbors(); ++j, ++s)
+      elem->set_neighbor(j, neighbors[s] == invalid_uint ? NULL : elems[neighbors[s]]);
+  }
+
+  STOP_LOG("load()", "MeshCache");
+
+  MESSAGE<<"(loaded from cache)"; RECORD();
+  return true;
+}
+
+
+void MeshCache::add_topology()
+{
+  if(!enabled()) return;
+
+  if( Genius::processor_id() != 0 ) return;
+
+  const unsigned int n_nodes = _nodes.size();
+  const unsigned int n_elem  = _elems.size();
+
+  std::vector<unsigned int> node_order(n_nodes);
+  for(unsigned int i=0; i<n_nodes; ++i)
+    node_order[i] = _nodes[i]->id();
+
+  std::vector<unsigned int> elem_order(n_elem);
+  for(unsigned int i=0; i<n_elem; ++i)
+    elem_order[i] = _elems[i]->id();
+
+  std::vector<const Elem *> elems(n_elem);
+  for(unsigned int i=0; i<n_elem; ++i)
+    elems[_elems[i]->id()] = _elems[i];
+
+  std::vector<unsigned int> neighbors;
+  neighbors.reserve(_n_sides);
+  for(unsigned int i=0; i<n_elem; ++i)
+  {
+    const Elem * elem = elems[i];
+    for(unsigned int j=0; j<elem->n_neighbors(); ++j)
+    {
+      const Elem * neighbor = elem->neighbor(j);
+      neighbors.push_back( neighbor ? neighbor->id() : invalid_uint );
+    }
+  }
+  genius_assert(neighbors.size() == _n_sides);
+
+  _file.add_section(node_order);
+  _file.add_section(elem_order);
+  _file.add_section(neighbors);
+}
+
+
+void MeshCache::save()
+{
+  if(!enabled()) return;
+
+  if( Genius::processor_id() != 0 ) return;
+
+  START_LOG("save()", "MeshCache");
+
+  if( !_file.write(_file_name(_dir, _key, ".mesh"), _key) )
+  {
+    MESSAGE<<"Warning: can not write mesh cache to directory "<< _dir << "." << std::endl; RECORD();
+  }
+
+  STOP_LOG("save()", "MeshCache");
+}
+
+
+
+// sections of the mesh built from input
+namespace {
+
+  enum MeshSection
+  {
+    // magic number, subdomains, nodes, elems and extra boundary descriptions
+    MeshInfo = 0,
+    // x, y, z of each node
+    MeshNodes,
+    // type, subdomain id and nodes of each elem
+    MeshElems,
+    // subdomain label and material, then boundary label and description, then extra descriptions
+    MeshStrings,
+    // boundary id and if its label is user defined
+    MeshBoundaryIds,
+    // elem, side and boundary id of each boundary side
+    MeshBoundarySides,
+    // node and boundary id of each boundary node
+    MeshBoundaryNodes,
+    MeshSectionEnd
+  };
+
+  // strings are saved as length and characters
+  void pack_string(std::vector<char> & data, const std::string & s)
+  {
+    const unsigned int n = s.size();
+    const char * c = reinterpret_cast<const char *>(&n);
+    data.insert(data.end(), c, c+sizeof(n));
+    data.insert(data.end(), s.begin(), s.end());
+  }
+
+  bool unpack_string(const char * & p, const char * end, std::string & s)
+  {
+    unsigned int n;
+    if( static_cast<size_t>(end - p) < sizeof(n) ) return false;
+    std::memcpy(&n, p, sizeof(n));
+    p += sizeof(n);
+    if( static_cast<size_t>(end - p) < n ) return false;
+    s.assign(p, n);
+    p += n;
+    return true;
+  }
+
+  // build the mesh from the sections, false if the entry is not consistent
+  bool unpack_mesh(MeshBase & mesh, const MeshCacheFile & file)
+  {
+    if( file.n_sections() != MeshSectionEnd ) return false;
+
+    unsigned int n;
+    const unsigned int * info = file.section<unsigned int>(MeshInfo, n);
+    if( n != 5 ) return false;
+    const unsigned int n_subdomains = info[1];
+    const unsigned int n_nodes      = info[2];
+    const unsigned int n_elem       = info[3];
+    const unsigned int n_extra      = info[4];
+
+    const Real * points = file.section<Real>(MeshNodes, n);
+    if( n != 3*n_nodes ) return false;
+
+    mesh.magic_num() = info[0];
+    mesh.set_n_subdomains() = n_subdomains;
+
+    mesh.reserve_nodes(n_nodes);
+    for(unsigned int i=0; i<n_nodes; ++i)
+      mesh.add_point(Point(points[3*i+0], points[3*i+1], points[3*i+2]), i);
+
+    const int * conn = file.section<int>(MeshElems, n);
+    const int * conn_end = conn + n;
+    mesh.reserve_elem(n_elem);
+    for(unsigned int i=0; i<n_elem; ++i)
+    {
+      if( conn_end - conn < 2 ) return false;
+      const int type      = *conn++;
+      const int subdomain = *conn++;
+      if( type < 0 || type >= INVALID_ELEM || subdomain < 0 || static_cast<unsigned int>(subdomain) >= n_subdomains ) return false;
+
+      Elem * elem = Elem::build(static_cast<ElemType>(type)).release();
+      elem->subdomain_id() = subdomain;
+      elem->set_id() = i;
+      if( conn_end - conn < static_cast<int>(elem->n_nodes()) ) { delete elem; return false; }
+      for(unsigned int v=0; v<elem->n_nodes(); ++v, ++conn)
+      {
+        if( *conn < 0 || static_cast<unsigned int>(*conn) >= n_nodes ) { delete elem; return false; }
+        elem->set_node(v) = mesh.node_ptr(*conn);
+      }
+      mesh.add_elem(elem);
+    }
+    if( conn != conn_end ) return false;
+
+    const char * s = file.section<char>(MeshStrings, n);
+    const char * s_end = s + n;
+    for(unsigned int i=0; i<n_subdomains; ++i)
+    {
+      std::string label, material;
+      if( !unpack_string(s, s_end, label) || !unpack_string(s, s_end, material) ) return false;
+      mesh.set_subdomain_label(i, label);
+      mesh.set_subdomain_material(i, material);
+    }
+
+    BoundaryInfo & boundary_info = *mesh.boundary_info;
+
+    const int * ids = file.section<int>(MeshBoundaryIds, n);
+    if( n%2 ) return false;
+    for(unsigned int i=0; i<n; i+=2)
+    {
+      std::string label, description;
+      if( !unpack_string(s, s_end, label) || !unpack_string(s, s_end, description) ) return false;
+      const short int id = ids[i];
+      boundary_info.get_boundary_ids().insert(id);
+      boundary_info.set_label_to_id(id, label, ids[i+1] != 0);
+      boundary_info.set_description_to_id(id, description);
+    }
+
+    for(unsigned int i=0; i<n_extra; ++i)
+    {
+      std::string description;
+      if( !unpack_string(s, s_end, description) ) return false;
+      boundary_info.add_extra_description(description);
+    }
+    if( s != s_end ) return false;
+
+    const int * sides = file.section<int>(MeshBoundarySides, n);
+    if( n%3 ) return false;
+    for(unsigned int i=0; i<n; i+=3)
+    {
+      if( sides[i] < 0 || static_cast<unsigned int>(sides[i]) >= n_elem ) return false;
+      const Elem * elem = mesh.elem(sides[i]);
+      if( sides[i+1] < 0 || static_cast<unsigned int>(sides[i+1]) >= elem->n_sides() ) return false;
+      boundary_info.add_side(elem, sides[i+1], sides[i+2]);
+    }
+
+    const int * nodes = file.section<int>(MeshBoundaryNodes, n);
+    if( n%2 ) return false;
+    for(unsigned int i=0; i<n; i+=2)
+    {
+      if( nodes[i] < 0 || static_cast<unsigned int>(nodes[i]) >= n_nodes ) return false;
+      boundary_info.add_node(mesh.node_ptr(nodes[i]), nodes[i+1]);
+    }
+
+    return true;
+  }
+
+}
+
+
+bool MeshCache::load_mesh(MeshBase & mesh, const std::string & dir, unsigned long long input_key)
+{
+  if(dir.empty()) return false;
+
+  START_LOG("load_mesh()", "MeshCache");
+
+  MeshCacheFile file;
+  bool hit = file.open(_file_name(dir, input_key, ".input"), input_key);
+  if( hit && !unpack_mesh(mesh, file) )
+  {
+    // partial mesh of a bad entry
+    mesh.clear();
+    hit = false;
+  }
+
+  STOP_LOG("load_mesh()", "MeshCache");
+  return hit;
+}
+
+
+void MeshCache::save_mesh(MeshBase & mesh, const std::string & dir, unsigned long long input_key)
+{
+  if(dir.empty()) return;
+
+  // the mesh is saved with its node/elem id as index
+  if( !mesh.is_serial() || mesh.max_elem_id() != mesh.n_elem() || mesh.max_node_id() != mesh.n_nodes() )
+    return;
+
+  START_LOG("save_mesh()", "MeshCache");
+
+  const BoundaryInfo & boundary_info = *mesh.boundary_info;
+
+  std::vector<unsigned int> info;
+  info.push_back(mesh.magic_num());
+  info.push_back(mesh.n_subdomains());
+  info.push_back(mesh.n_nodes());
+  info.push_back(mesh.n_elem());
+  info.push_back(boundary_info.extra_descriptions().size());
+
+  std::vector<Real> points(3*mesh.n_nodes());
+  {
+    MeshBase::node_iterator node_it = mesh.nodes_begin();
+    MeshBase::node_iterator node_it_end = mesh.nodes_end();
+    for(; node_it != node_it_end; ++node_it)
+    {
+      const Node * node = *node_it;
+      for(unsigned int d=0; d<3; ++d)
+        points[3*node->id()+d] = (*node)(d);
+    }
+  }
+
+  std::vector<int> conn;
+  for(unsigned int i=0; i<mesh.n_elem(); ++i)
+  {
+    const Elem * elem = mesh.elem(i);
+    // refined mesh has elem hierarchy, not cached
+    if( elem->level() != 0 )
+    {
+      STOP_LOG("save_mesh()", "MeshCache");
+      return;
+    }
+    conn.push_back(static_cast<int>(elem->type()));
+    conn.push_back(elem->subdomain_id());
+    for(unsigned int v=0; v<elem->n_nodes(); ++v)
+      conn.push_back(elem->node(v));
+  }
+
+  std::vector<char> strings;
+  for(unsigned int i=0; i<mesh.n_subdomains(); ++i)
+  {
+    pack_string(strings, mesh.subdomain_label_by_id(i));
+    pack_string(strings, mesh.subdomain_material(i));
+  }
+
+  std::vector<int> ids;
+  const std::set<short int> & boundary_ids = boundary_info.get_boundary_ids();
+  for(std::set<short int>::const_iterator it=boundary_ids.begin(); it!=boundary_ids.end(); ++it)
+  {
+    ids.push_back(*it);
+    ids.push_back(boundary_info.boundary_id_has_user_defined_label(*it) ? 1 : 0);
+    pack_string(strings, boundary_info.get_label_by_id(*it));
+    pack_string(strings, boundary_info.get_description_by_id(*it));
+  }
+
+  for(unsigned int i=0; i<boundary_info.extra_descriptions().size(); ++i)
+    pack_string(strings, boundary_info.extra_descriptions()[i]);
+
+  std::vector<int> sides;
+  {
+    std::vector<unsigned int>       el;
+    std::vector<unsigned short int> sl;
+    std::vector<short int>          il;
+    boundary_info.build_side_list(el, sl, il);
+    for(unsigned int i=0; i<el.size(); ++i)
+    {
+      sides.push_back(el[i]);
+      sides.push_back(sl[i]);
+      sides.push_back(il[i]);
+    }
+  }
+
+  std::vector<int> nodes;
+  {
+    std::vector<unsigned int> nl;
+    std::vector<short int>    il;
+    boundary_info.build_node_list(nl, il);
+    for(unsigned int i=0; i<nl.size(); ++i)
+    {
+      nodes.push_back(nl[i]);
+      nodes.push_back(il[i]);
+    }
+  }
+
+  MeshCacheFile file;
+  file.add_section(info);
+  file.add_section(points);
+  file.add_section(conn);
+  file.add_section(strings);
+  file.add_section(ids);
+  file.add_section(sides);
+  file.add_section(nodes);
+
+  if( !file.write(_file_name(dir, input_key, ".input"), input_key) )
+  {
+    MESSAGE<<"Warning: can not write mesh cache to directory "<< dir << "." << std::endl; RECORD();
+  }
+
+  STOP_LOG("save_mesh()", "MeshCache");
+}
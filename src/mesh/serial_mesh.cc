@@ -360,43 +360,34 @@ void SerialMesh::reorder_elems()
       }
     }
 
-    // ok, assign ordered index to each elem
+    // also order nodes by the first elem (in new order) they belong to
+    std::vector<const Elem *> ordered_elems(_elements.size());
     for(unsigned int n=0; n<_elements.size(); ++n)
-      _elements[n]->set_id () = new_order[_elements[n]->id()];
+      if( new_order[_elements[n]->id()] != invalid_uint )
+        ordered_elems[new_order[_elements[n]->id()]] = _elements[n];
 
-    // sort the elems by new ID
-    DofObject::Less less;
-    std::sort( _elements.begin(), _elements.end(), less );
-  }
-
-
-  // also sort nodes
-  {
-    std::vector<bool> visit_flag(n_nodes(), false);
-    std::vector<unsigned int> new_order(n_nodes(), invalid_uint);
-    unsigned int new_index = 0;
-    for(unsigned int n=0; n<_elements.size(); ++n)
+    std::vector<bool> node_visit_flag(n_nodes(), false);
+    std::vector<unsigned int> node_new_order(n_nodes(), invalid_uint);
+    unsigned int node_new_index = 0;
+    for(unsigned int n=0; n<ordered_elems.size(); ++n)
     {
-      const Elem * elem = _elements[n];
+      const Elem * elem = ordered_elems[n];
+      if( !elem ) continue;
       for( unsigned int v=0; v<elem->n_nodes(); ++v)
       {
         const Node * node = elem->get_node(v);
 
-        if( !visit_flag[node->id()] )
+        if( !node_visit_flag[node->id()] )
         {
-          new_order[node->id()] = new_index++;
-          visit_flag[node->id()] = true;
+          node_new_order[node->id()] = node_new_index++;
+          node_visit_flag[node->id()] = true;
         }
       }
     }
 
-    // ok, assign ordered index to each node
-    for (unsigned int n=0; n<_nodes.size(); ++n)
-      _nodes[n]->set_id() = new_order[_nodes[n]->id()];
-
-    // sort the nodes by new ID
-    DofObject::Less less;
-    std::sort( _nodes.begin(), _nodes.end(), less );
+    genius_assert(new_order.size() == _elements.size());
+    genius_assert(node_new_order.size() == _nodes.size());
+    this->reorder_elems(&new_order[0], &node_new_order[0]);
   }
 
   STOP_LOG("reorder_elems()", "Mesh");
@@ -404,6 +395,26 @@ void SerialMesh::reorder_elems()
 
 
 
+void SerialMesh::reorder_elems(const unsigned int * elem_order, const unsigned int * node_order)
+{
+  // ok, assign ordered index to each elem
+  for(unsigned int n=0; n<_elements.size(); ++n)
+    _elements[n]->set_id () = elem_order[_elements[n]->id()];
+
+  // sort the elems by new ID
+  DofObject::Less less;
+  std::sort( _elements.begin(), _elements.end(), less );
+
+  // ok, assign ordered index to each node
+  for (unsigned int n=0; n<_nodes.size(); ++n)
+    _nodes[n]->set_id() = node_order[_nodes[n]->id()];
+
+  // sort the nodes by new ID
+  std::sort( _nodes.begin(), _nodes.end(), less );
+}
+
+
+
 void SerialMesh::reorder_nodes()
 {
   START_LOG("reorder_nodes()", "Mesh");
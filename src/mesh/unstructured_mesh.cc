@@ -21,6 +21,9 @@
 
 // C++ includes
 #include <fstream>
+#include <set>
+#include <map>
+#include <algorithm>
 
 
 // Local includes
@@ -30,6 +33,7 @@
 #include "mesh_tools.h" // For n_levels
 #include "perf_log.h"
 #include "elem.h"
+#include "threads.h"
 
 #if defined(HAVE_TR1_UNORDERED_MAP)
 #include <tr1/unordered_map>
@@ -132,7 +136,8 @@ UnstructuredMesh::~UnstructuredMesh ()
 void UnstructuredMesh::find_neighbors()
 {
   //_find_neighbors_by_key();
-  _find_neighbors_by_ukey();
+  //_find_neighbors_by_ukey();
+  _find_neighbors_by_sort();
 }
 
 
@@ -438,6 +443,344 @@ void UnstructuredMesh::_find_neighbors_by_ukey()
 
 
 
+namespace {
+
+  // side of an element, identified by its sorted vertex ids. unused slots are invalid_uint
+  struct SideRecord
+  {
+    unsigned int key[4];
+    unsigned int elem;
+    unsigned int side;
+  };
+
+  // build the side records of elements [begin, end), element e owns records from offset[e]
+  class SideRecordBuilder
+  {
+  public:
+    SideRecordBuilder(const std::vector<Elem *> & elems, const std::vector<unsigned int> & offset, std::vector<SideRecord> & records)
+      : _elems(elems), _offset(offset), _records(records) {}
+
+    void operator() (unsigned int begin, unsigned int end, unsigned int)
+    {
+      std::vector<unsigned int> local_nodes;
+      for(unsigned int e=begin; e<end; ++e)
+      {
+        const Elem * elem = _elems[e];
+        for(unsigned int s=0; s<elem->n_neighbors(); ++s)
+        {
+          SideRecord & record = _records[_offset[e]+s];
+          local_nodes.clear();
+          elem->nodes_on_side(s, local_nodes);
+          genius_assert(local_nodes.size() <= 4);
+          for(unsigned int i=0; i<4; ++i)
+            record.key[i] = i<local_nodes.size() ? elem->node(local_nodes[i]) : invalid_uint;
+          std::sort(record.key, record.key+local_nodes.size());
+          record.elem = e;
+          record.side = s;
+        }
+      }
+    }
+
+  private:
+    const std::vector<Elem *> & _elems;
+    const std::vector<unsigned int> & _offset;
+    std::vector<SideRecord> & _records;
+  };
+
+  // stable LSD radix sort of side records by key, 16 bits per pass.
+  // the pass is skipped when all the records have the same digit, i.e. the unused key slots
+  void radix_sort_side_records(std::vector<SideRecord> & records)
+  {
+    std::vector<SideRecord> buffer(records.size());
+    std::vector<unsigned int> count(65537);
+
+    for(int word=3; word>=0; --word)
+      for(unsigned int shift=0; shift<32; shift+=16)
+      {
+        std::fill(count.begin(), count.end(), 0);
+        for(unsigned int n=0; n<records.size(); ++n)
+          count[((records[n].key[word] >> shift) & 0xffff) + 1]++;
+
+        if( std::find(count.begin(), count.end(), records.size()) != count.end() ) continue;
+
+        for(unsigned int d=1; d<count.size(); ++d)
+          count[d] += count[d-1];
+        for(unsigned int n=0; n<records.size(); ++n)
+          buffer[count[(records[n].key[word] >> shift) & 0xffff]++] = records[n];
+        records.swap(buffer);
+      }
+  }
+
+  bool same_side(const SideRecord & a, const SideRecord & b)
+  { return std::equal(a.key, a.key+4, b.key); }
+
+  // build the FVM geometry of elements, each element only touches its own data
+  class FVMGeometryBuilder
+  {
+  public:
+    FVMGeometryBuilder(const std::vector<Elem *> & elems): _elems(elems) {}
+
+    void operator() (unsigned int begin, unsigned int end, unsigned int)
+    {
+      for(unsigned int e=begin; e<end; ++e)
+        _elems[e]->prepare_for_fvm();
+    }
+
+  private:
+    const std::vector<Elem *> & _elems;
+  };
+
+  void prepare_for_fvm_parallel(const std::vector<Elem *> & elems)
+  {
+    START_LOG("prepare_for_fvm()", "Mesh");
+    FVMGeometryBuilder builder(elems);
+    Threads::parallel_for_dynamic(0, elems.size(), 1024, builder);
+    STOP_LOG("prepare_for_fvm()", "Mesh");
+  }
+
+}
+
+
+void UnstructuredMesh::_find_neighbors_by_sort()
+{
+  genius_assert(this->n_nodes() != 0);
+  genius_assert(this->n_elem()  != 0);
+
+  START_LOG("find_neighbors()", "Mesh");
+
+  // flat array of elements and the offset of their sides
+  std::vector<Elem *> elems;
+  std::vector<unsigned int> offset(1, 0);
+  const element_iterator el_end = this->elements_end();
+  for (element_iterator el = this->elements_begin(); el != el_end; ++el)
+  {
+    Elem* elem = *el;
+    if(!elem) continue;
+    for (unsigned int s=0; s<elem->n_neighbors(); s++)
+      elem->set_neighbor(s,NULL);
+    elems.push_back(elem);
+    offset.push_back(offset.back() + elem->n_neighbors());
+  }
+
+  START_LOG("find_neighbors(key)", "Mesh");
+  std::vector<SideRecord> records(offset.back());
+  SideRecordBuilder builder(elems, offset, records);
+  Threads::parallel_for_dynamic(0, elems.size(), 1024, builder);
+  STOP_LOG("find_neighbors(key)", "Mesh");
+
+  START_LOG("find_neighbors(sort)", "Mesh");
+  radix_sort_side_records(records);
+  STOP_LOG("find_neighbors(sort)", "Mesh");
+
+  // sides with the same key are adjacent now, pair them in the order of element,
+  // the same as the map based search
+  for(unsigned int n=0; n+1<records.size(); )
+  {
+    if( !same_side(records[n], records[n+1]) ) { ++n; continue; }
+
+    Elem * neighbor = elems[records[n].elem];
+    const unsigned int ns = records[n].side;
+    Elem * element = elems[records[n+1].elem];
+    const unsigned int ms = records[n+1].side;
+
+    // So share a side.  Is this a mixed pair
+    // of subactive and active/ancestor
+    // elements?
+    // If not, then we're neighbors.
+    // If so, then the subactive's neighbor is
+    if (element->subactive() == neighbor->subactive())
+    {
+      element->set_neighbor (ms,neighbor);
+      neighbor->set_neighbor(ns,element);
+    }
+    else if (element->subactive())
+    {
+      element->set_neighbor(ms,neighbor);
+    }
+    else if (neighbor->subactive())
+    {
+      neighbor->set_neighbor(ns,element);
+    }
+    n += 2;
+  }
+
+#ifdef ENABLE_AMR
+  // child element with NULL neighbor gets the neighbor from its parent,
+  // see _find_neighbors_by_ukey()
+  element_iterator end = this->not_level_elements_end(0);
+  for (element_iterator el = this->not_level_elements_begin(0);
+       el != end; ++el)
+  {
+    Elem* elem = *el;
+    if(!elem) continue;
+
+    assert (elem->parent() != NULL);
+    for (unsigned int s=0; s < elem->n_neighbors(); s++)
+      if (elem->neighbor(s) == NULL)
+      {
+        elem->set_neighbor(s, elem->parent()->neighbor(s));
+      }
+  }
+#endif // AMR
+
+  STOP_LOG("find_neighbors()", "Mesh");
+}
+
+
+
+#ifdef ENABLE_AMR
+
+namespace {
+  // sort elements by refinement level, parents come first
+  struct ElemLevelLess
+  {
+    bool operator() (const Elem *a, const Elem *b) const
+    { return a->level() < b->level(); }
+  };
+}
+
+
+void UnstructuredMesh::find_neighbors_incremental()
+{
+  START_LOG("find_neighbors_incremental()", "Mesh");
+
+  // the patch: elements created or re-activated by the last refinement step,
+  // together with all the elements which may share a side with them.
+  // neighbor information outside the patch is still valid.
+  std::set<Elem *> patch;
+  {
+    const element_iterator el_end = this->elements_end();
+    for (element_iterator el = this->elements_begin(); el != el_end; ++el)
+    {
+      Elem* elem = *el;
+      if(!elem) continue;
+
+      const Elem::RefinementState flag = elem->refinement_flag();
+      if( flag != Elem::JUST_REFINED && flag != Elem::JUST_COARSENED ) continue;
+
+      patch.insert(elem);
+
+      // children of coarsened element are subactive now
+      if( flag == Elem::JUST_COARSENED )
+        for (unsigned int c=0; c<elem->n_children(); c++)
+          patch.insert(elem->child(c));
+
+      // new child shares sides with its siblings and with the
+      // neighbors (and their descendants) of its parent
+      const Elem * host = elem;
+      if( flag == Elem::JUST_REFINED && elem->parent() )
+      {
+        host = elem->parent();
+        for (unsigned int c=0; c<host->n_children(); c++)
+          patch.insert(host->child(c));
+      }
+
+      for (unsigned int s=0; s<host->n_neighbors(); s++)
+      {
+        const Elem * neighbor = host->neighbor(s);
+        if(!neighbor) continue;
+
+        std::vector<const Elem*> family;
+        neighbor->family_tree(family);
+        for(unsigned int f=0; f<family.size(); ++f)
+          patch.insert(const_cast<Elem *>(family[f]));
+      }
+    }
+  }
+
+  // save the old neighbor information and reset the patch
+  std::map<const Elem *, std::vector<Elem *> > old_neighbors;
+  for (std::set<Elem *>::iterator it=patch.begin(); it!=patch.end(); ++it)
+  {
+    Elem* elem = *it;
+    std::vector<Elem *> & neighbors = old_neighbors[elem];
+    for (unsigned int s=0; s<elem->n_neighbors(); s++)
+    {
+      neighbors.push_back(elem->neighbor(s));
+      elem->set_neighbor(s,NULL);
+    }
+  }
+
+  // match the sides inside the patch, the same as _find_neighbors_by_ukey()
+  {
+    typedef ElemKey                         key_type;
+    typedef std::pair<Elem*, unsigned char> val_type;
+
+#if defined(HAVE_UNORDERED_MAP)
+    typedef std::unordered_map<key_type, val_type, ElemKey::Hash, ElemKey::Equal> map_type;
+#elif defined(HAVE_TR1_UNORDERED_MAP) || defined(HAVE_TR1_UNORDERED_MAP_WITH_STD_HEADER)
+    typedef std::tr1::unordered_map<key_type, val_type, ElemKey::Hash, ElemKey::Equal> map_type;
+#else
+    typedef std::map<key_type, val_type, ElemKey::Less>  map_type;
+#endif
+
+    map_type side_to_elem_map;
+
+    for (std::set<Elem *>::iterator it=patch.begin(); it!=patch.end(); ++it)
+    {
+      Elem* element = *it;
+
+      for (unsigned int ms=0; ms<element->n_neighbors(); ms++)
+      {
+        if (element->neighbor(ms) != NULL) continue;
+
+        const AutoPtr<DofObject> side = element->side(ms);
+        const Elem* side_elem = dynamic_cast<const Elem*>(side.get());
+        const ElemKey key(side_elem);
+
+        map_type::iterator another_side_it = side_to_elem_map.find(key);
+        if( another_side_it !=  side_to_elem_map.end())
+        {
+          Elem* neighbor = another_side_it->second.first;
+          const unsigned int ns = another_side_it->second.second;
+
+          if (element->subactive() == neighbor->subactive())
+          {
+            element->set_neighbor (ms,neighbor);
+            neighbor->set_neighbor(ns,element);
+          }
+          else if (element->subactive())
+          {
+            element->set_neighbor(ms,neighbor);
+          }
+          else if (neighbor->subactive())
+          {
+            neighbor->set_neighbor(ns,element);
+          }
+          side_to_elem_map.erase (another_side_it);
+        }
+        else
+          side_to_elem_map.insert ( std::make_pair(key, std::make_pair(element, ms)) );
+      }
+    }
+  }
+
+  // sides without partner in the patch: restore the link to element outside the patch,
+  // or get the (coarser) neighbor from the parent.
+  // process parents before children since the child may ask its parent for neighbor.
+  std::vector<Elem *> patch_elems(patch.begin(), patch.end());
+  std::stable_sort(patch_elems.begin(), patch_elems.end(), ElemLevelLess());
+  for (unsigned int n=0; n<patch_elems.size(); ++n)
+  {
+    Elem* elem = patch_elems[n];
+    const std::vector<Elem *> & neighbors = old_neighbors[elem];
+    for (unsigned int s=0; s<elem->n_neighbors(); s++)
+    {
+      if (elem->neighbor(s) != NULL) continue;
+
+      if (neighbors[s] && !patch.count(neighbors[s]))
+        elem->set_neighbor(s, neighbors[s]);
+      else if (elem->parent())
+        elem->set_neighbor(s, elem->parent()->neighbor(s));
+    }
+  }
+
+  STOP_LOG("find_neighbors_incremental()", "Mesh");
+}
+
+#endif // AMR
+
+
 // ------------------------------------------------------------
 // UnstructuredMesh class member functions for mesh modification
 void UnstructuredMesh::all_first_order ()
@@ -550,10 +893,15 @@ void UnstructuredMesh::all_first_order ()
 
 
 
-bool UnstructuredMesh::convert_to_fvm_mesh (std::string &error)
+bool UnstructuredMesh::convert_to_fvm_mesh (std::string &error, bool incremental, bool build_geometry)
 {
   genius_assert(this->_is_prepared);
 
+  START_LOG("convert_to_fvm_mesh()", "Mesh");
+
+  // the geometry of FVM elements are built in parallel after the conversion loop
+  std::vector<Elem *> fvm_elems;
+
   // here we convert all the active FEM element to FVM element, maybe only element belongs to local
   // procesor needs to be converted.
   const_element_iterator endit = local_elements_end();
@@ -563,10 +911,21 @@ bool UnstructuredMesh::convert_to_fvm_mesh (std::string &error)
 
     assert (fem_elem != NULL);
 
+    // element converted by previous call already has its FVM geometry,
+    // only the ones touched by last refinement step should be rebuilt
+    if ( incremental && Elem::fvm_compatible_type(fem_elem->type()) == fem_elem->type() )
+    {
+      if ( fem_elem->refinement_flag() == Elem::JUST_REFINED ||
+           fem_elem->refinement_flag() == Elem::JUST_COARSENED )
+        fvm_elems.push_back(fem_elem);
+      continue;
+    }
+
     // can this element be used in FVM?
     if ( fem_elem->fvm_compatible_test() == false )
     {
       error = "incompatible mesh element";
+      STOP_LOG("convert_to_fvm_mesh()", "Mesh");
       return false;
     }
 
@@ -614,9 +973,9 @@ bool UnstructuredMesh::convert_to_fvm_mesh (std::string &error)
       fvm_elem->set_node(v) = fem_elem->get_node(v);
 
     /*
-     * build cell's geometry information for FVM usage
+     * cell's geometry information for FVM usage is built later
      */
-    fvm_elem->prepare_for_fvm();
+    fvm_elems.push_back(fvm_elem);
 
     /*
      * set the subdomain id
@@ -674,16 +1033,34 @@ bool UnstructuredMesh::convert_to_fvm_mesh (std::string &error)
   }
 
 
+  // build cell's geometry information for FVM usage,
+  // the geometry which can be set by Elem::unpack_fvm_geometry() is left to the caller
+  if(!build_geometry)
+  {
+    std::vector<Elem *> elems;
+    for(unsigned int n=0; n<fvm_elems.size(); ++n)
+      if( !fvm_elems[n]->n_fvm_geometry() ) elems.push_back(fvm_elems[n]);
+    fvm_elems.swap(elems);
+  }
+  prepare_for_fvm_parallel(fvm_elems);
+
+  STOP_LOG("convert_to_fvm_mesh()", "Mesh");
+
   return true;
 }
 
 
 
 
-bool UnstructuredMesh::convert_to_cylindrical_fvm_mesh (std::string &error)
+bool UnstructuredMesh::convert_to_cylindrical_fvm_mesh (std::string &error, bool incremental, bool build_geometry)
 {
   genius_assert(this->_is_prepared);
 
+  START_LOG("convert_to_cylindrical_fvm_mesh()", "Mesh");
+
+  // the geometry of FVM elements are built in parallel after the conversion loop
+  std::vector<Elem *> fvm_elems;
+
   // here we convert all the active FEM element to FVM element, maybe only element belongs to local
   // procesor needs to be converted.
   const_element_iterator endit = local_elements_end();
@@ -693,16 +1070,28 @@ bool UnstructuredMesh::convert_to_cylindrical_fvm_mesh (std::string &error)
 
     assert (fem_elem != NULL);
 
+    // element converted by previous call already has its FVM geometry,
+    // only the ones touched by last refinement step should be rebuilt
+    if ( incremental && Elem::cylindrical_fvm_compatible_type(fem_elem->type()) == fem_elem->type() )
+    {
+      if ( fem_elem->refinement_flag() == Elem::JUST_REFINED ||
+           fem_elem->refinement_flag() == Elem::JUST_COARSENED )
+        fvm_elems.push_back(fem_elem);
+      continue;
+    }
+
     // can this element be used in FVM?
     if ( fem_elem->fvm_compatible_test() == false )
     {
       error = "incompatible mesh element";
+      STOP_LOG("convert_to_cylindrical_fvm_mesh()", "Mesh");
       return false;
     }
     // 2d only
     if ( fem_elem->dim() != 2 )
     {
       error = "cylindrical mesh only support 2D element";
+      STOP_LOG("convert_to_cylindrical_fvm_mesh()", "Mesh");
       return false;
     }
     // r dimention should be positive
@@ -715,6 +1104,7 @@ bool UnstructuredMesh::convert_to_cylindrical_fvm_mesh (std::string &error)
       if(rmin < 0.0)
       {
         error = "cylindrical mesh requires r(x) dimension be positive";
+        STOP_LOG("convert_to_cylindrical_fvm_mesh()", "Mesh");
         return false;
       }
     }
@@ -763,9 +1153,9 @@ bool UnstructuredMesh::convert_to_cylindrical_fvm_mesh (std::string &error)
       fvm_elem->set_node(v) = fem_elem->get_node(v);
 
     /*
-     * build cell's geometry information for FVM usage
+     * cell's geometry information for FVM usage is built later
      */
-    fvm_elem->prepare_for_fvm();
+    fvm_elems.push_back(fvm_elem);
 
     /*
      * set the subdomain id
@@ -822,6 +1212,19 @@ bool UnstructuredMesh::convert_to_cylindrical_fvm_mesh (std::string &error)
 
   }
 
+  // build cell's geometry information for FVM usage,
+  // the geometry which can be set by Elem::unpack_fvm_geometry() is left to the caller
+  if(!build_geometry)
+  {
+    std::vector<Elem *> elems;
+    for(unsigned int n=0; n<fvm_elems.size(); ++n)
+      if( !fvm_elems[n]->n_fvm_geometry() ) elems.push_back(fvm_elems[n]);
+    fvm_elems.swap(elems);
+  }
+  prepare_for_fvm_parallel(fvm_elems);
+
+  STOP_LOG("convert_to_cylindrical_fvm_mesh()", "Mesh");
+
   return true;
 }
 
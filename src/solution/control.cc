@@ -21,6 +21,8 @@
 
 //  $Id: control.cc,v 1.54 2008/07/09 12:56:23 gdiso Exp $
 
+#include <limits>
+
 #include "genius_common.h"
 
 #ifdef WINDOWS
@@ -45,6 +47,7 @@
 #include "control.h"
 #include "mesh_tools.h"
 #include "mesh_communication.h"
+#include "mesh_cache.h"
 #include "mesh_refinement.h"
 #include "mesh_modification.h"
 #include "boundary_info.h"
@@ -88,9 +91,8 @@
 #include "advanced_model.h"
 #include "petsc_type.h"
 
-#include "interpolation_2d_csa.h"
+#include "interpolation_mesh.h"
 #include "interpolation_3d_qshep.h"
-#include "interpolation_3d_nbtet.h"
 
 #include "dlhook.h"
 #ifndef DLLHOOK
@@ -98,7 +100,9 @@
  #include "rawfile_hook.h"
  #include "gnuplot_hook.h"
  #include "probe_hook.h"
+ #include "probeset_hook.h"
  #include "vtk_hook.h"
+ #include "xdmf_hook.h"
 #include "cgns_hook.h"
 #endif
 
@@ -257,6 +261,57 @@ int SolverControl::mainloop()
 
 
 //------------------------------------------------------------------------------
+namespace {
+
+  template <typename T>
+  void mesh_input_add(unsigned long long & key, const T & v)
+  { key = MeshCacheFile::hash(&v, sizeof(T), key); }
+
+  void mesh_input_add(unsigned long long & key, const std::string & s)
+  { key = MeshCacheFile::hash(s.c_str(), s.size()+1, key); }
+
+  // hash of the cards read by mesh generator, the key of the generated mesh in the mesh cache
+  unsigned long long mesh_input_key(Parser::InputParser & decks)
+  {
+    unsigned long long key = MeshCacheFile::hash(0, 0);
+
+    // mesh generator scales the dimension by um
+    mesh_input_add(key, static_cast<double>(PhysicalUnit::um));
+
+    for( decks.begin(); !decks.end(); decks.next() )
+    {
+      Parser::Card c = decks.get_current_card();
+      if( c.key() != "MESH"   && c.key() != "X.MESH" && c.key() != "Y.MESH" && c.key() != "Z.MESH" &&
+          c.key() != "REGION" && c.key() != "FACE"   && c.key() != "ELIMINATE" &&
+          c.key() != "SPREAD" && c.key() != "SPREAD3D" )
+        continue;
+
+      mesh_input_add(key, c.key());
+      for(unsigned int idx=0; idx<c.parameter_size(); idx++)
+      {
+        const Parser::Parameter p = c.get_parameter(idx);
+        mesh_input_add(key, p.name());
+        mesh_input_add(key, static_cast<int>(p.type()));
+        for(unsigned int i=0; i<p.array_size(); ++i)
+        {
+          switch(p.type())
+          {
+            case Parser::BOOL    : mesh_input_add(key, p.get_bool(i) ? 1 : 0); break;
+            case Parser::INTEGER : mesh_input_add(key, p.get_int(i)); break;
+            case Parser::REAL    : mesh_input_add(key, p.get_real(i)); break;
+            case Parser::STRING  :
+            case Parser::ENUM    : mesh_input_add(key, p.get_string(i)); break;
+            default: break;
+          }
+        }
+      }
+    }
+    return key;
+  }
+
+}
+
+
 int  SolverControl::do_mesh()
 {
 
@@ -265,7 +320,23 @@ int  SolverControl::do_mesh()
     // build meshgenerator only on processor 0
     // I am afraid about mesh generator may have different
     // behavior due to float point round-off error
-    if (Genius::processor_id() == 0)
+    // the generated mesh is cached by the content of the mesh cards.
+    // conform refinement needs the mesh generator, the cache is not used then
+    const std::string cache_dir = decks().is_card_exist("REFINE.CONFORM") ? std::string() : system().mesh_cache_dir();
+    bool cache_hit = false;
+    unsigned long long input_key = 0;
+
+    if (Genius::processor_id() == 0 && !cache_dir.empty())
+    {
+      input_key = mesh_input_key(decks());
+      cache_hit = MeshCache::load_mesh(mesh(), cache_dir, input_key);
+      if( cache_hit )
+      {
+        MESSAGE<<"Mesh loaded from cache.\n"; RECORD();
+      }
+    }
+
+    if (Genius::processor_id() == 0 && !cache_hit)
     {
       // which mesh generator should we use?
       for( decks().begin(); !decks().end(); decks().next() )
@@ -311,6 +382,8 @@ int  SolverControl::do_mesh()
         MESSAGE<<"ERROR: Mesh generation failed." << std::endl; RECORD();
         genius_error();
       }
+
+      MeshCache::save_mesh(mesh(), cache_dir, input_key);
     }
 
     // since we only build mesh on processor 0,
@@ -1033,6 +1106,38 @@ int SolverControl::do_solve( const Parser::Card & c )
   SolverSpecify::out_prefix = c.get_string("out.prefix", "result");
   SolverSpecify::out_append = c.get_bool("out.append", false);
 
+  // mesh adaptation during DC sweep/transient, only DDM solvers support it
+  SolverSpecify::AdaptInterval = 0;
+  SolverSpecify::AdaptRequest  = false;
+  SolverSpecify::AdaptResume   = false;
+  if( (SolverSpecify::Type == SolverSpecify::DCSWEEP || SolverSpecify::Type == SolverSpecify::TRANSIENT) &&
+      (SolverSpecify::Solver == SolverSpecify::DDML1 || SolverSpecify::Solver == SolverSpecify::DDML2 || SolverSpecify::Solver == SolverSpecify::EBML3) )
+    SolverSpecify::AdaptInterval = c.get_int("adapt.interval", 0);
+
+  // the solver stops every AdaptInterval steps, the mesh is adapted and a new solver continues the job
+  do
+  {
+    if( SolverSpecify::AdaptRequest )
+    {
+      SolverSpecify::AdaptRequest = false;
+      do_refine_adaptive(c);
+      // the hooks of new solver continue writing to the output files of previous pass
+      SolverSpecify::AdaptResume = true;
+    }
+
+    run_solver();
+  } while( SolverSpecify::AdaptRequest );
+
+  SolverSpecify::AdaptResume = false;
+
+  return 0;
+}
+
+
+
+
+int SolverControl::run_solver()
+{
   SolverBase * solver = NULL;
 
   // call each solver here
@@ -1173,10 +1278,14 @@ int SolverControl::do_solve( const Parser::Card & c )
         hook = new CGNSHook(*solver, "cgns_hook", (void *)(&(it->second.second)));
       if((*it).second.first=="vtk")
         hook = new VTKHook(*solver, "vtk_hook", (void *)(&(it->second.second)));
+      if((*it).second.first=="xdmf")
+        hook = new XDMFHook(*solver, "xdmf_hook", (void *)(&(it->second.second)));
       if((*it).second.first=="cv")
         hook = new CVHook (*solver, "cv_hook",  (void *)(&(it->second.second)));
       if((*it).second.first=="probe")
         hook = new ProbeHook (*solver, "probe_hook",  (void *)(&(it->second.second)));
+      if((*it).second.first=="probeset")
+        hook = new ProbeSetHook (*solver, "probeset_hook",  (void *)(&(it->second.second)));
 
       if(hook) solver->add_hook(hook);
     }
@@ -1583,11 +1692,8 @@ int SolverControl::do_refine_conform(const Parser::Card & c)
   // TODO can we refine during the solver solution processing?
 
   // save previous solution
-  AutoPtr<InterpolationBase> interpolator;
-  if( mesh().mesh_dimension() == 2 )
-    interpolator = AutoPtr<InterpolationBase>(new Interpolation2D_CSA);
-  else
-    interpolator = AutoPtr<InterpolationBase>(new Interpolation3D_nbtet);
+  // the old mesh is kept by the interpolator, data are transferred by its shape functions
+  AutoPtr<InterpolationBase> interpolator(new InterpolationMesh(mesh()));
 
   if( DopingSolver.get() == NULL )
   {
@@ -1711,11 +1817,8 @@ int SolverControl::do_refine_hierarchical(const Parser::Card & c)
   MESSAGE<<"Hierarchical mesh refinement...\n"<<std::endl; RECORD();
 
   // save previous solution
-  AutoPtr<InterpolationBase> interpolator;
-  if( mesh().mesh_dimension() == 2 )
-    interpolator = AutoPtr<InterpolationBase>(new Interpolation2D_CSA);
-  else
-    interpolator = AutoPtr<InterpolationBase>(new Interpolation3D_nbtet);
+  // the old mesh is kept by the interpolator, data are transferred by its shape functions
+  AutoPtr<InterpolationBase> interpolator(new InterpolationMesh(mesh()));
 
   if( DopingSolver.get() == NULL )
   {
@@ -1744,14 +1847,25 @@ int SolverControl::do_refine_hierarchical(const Parser::Card & c)
     // at least one refine criterion should be exist!
     genius_assert(c.is_parameter_exist("error.refine.fraction") || c.is_parameter_exist("cell.refine.fraction") || c.is_parameter_exist("error.refine.threshold"));
 
+    // the max refinement level, 0 for unlimited
+    unsigned int max_level = c.get_int("max.level", 0) > 0 ? c.get_int("max.level", 0) : invalid_uint;
+
+    // when the mesh already reaches max.elem, only coarsen it
+    bool refine_allowed = true;
+    if( c.get_int("max.elem", 0) > 0 && mesh().n_active_elem() >= static_cast<unsigned int>(c.get_int("max.elem", 0)) )
+    {
+      MESSAGE<<"  Mesh has "<<mesh().n_active_elem()<<" elements, reaches max.elem. No element will be refined.\n"<<std::endl; RECORD();
+      refine_allowed = false;
+    }
+
     if(c.is_parameter_exist("error.refine.fraction") )
-      mesh_refinement.flag_elements_by_error_fraction (error_per_cell, c.get_real("error.refine.fraction", 0.3), c.get_real("error.coarsen.fraction", 0.0));
+      mesh_refinement.flag_elements_by_error_fraction (error_per_cell, refine_allowed ? c.get_real("error.refine.fraction", 0.3) : 0.0, c.get_real("error.coarsen.fraction", 0.0), max_level);
 
     if(c.is_parameter_exist("cell.refine.fraction") )
-      mesh_refinement.flag_elements_by_elem_fraction  (error_per_cell, c.get_real("cell.refine.fraction",  0.3), c.get_real("cell.coarsen.fraction",  0.0));
+      mesh_refinement.flag_elements_by_elem_fraction  (error_per_cell, refine_allowed ? c.get_real("cell.refine.fraction",  0.3) : 0.0, c.get_real("cell.coarsen.fraction",  0.0), max_level);
 
     if(c.is_parameter_exist("error.refine.threshold") )
-      mesh_refinement.flag_elements_by_error_threshold(error_per_cell, c.get_real("error.refine.threshold",0.1), c.get_real("error.coarsen.threshold",0.0));
+      mesh_refinement.flag_elements_by_error_threshold(error_per_cell, refine_allowed ? c.get_real("error.refine.threshold",0.1) : std::numeric_limits<Real>::max(), c.get_real("error.coarsen.threshold",0.0), max_level);
 
     // call MeshRefinement class to do FEM refine
     mesh_refinement.refine_and_coarsen_elements ();
@@ -1769,8 +1883,9 @@ int SolverControl::do_refine_hierarchical(const Parser::Card & c)
   MeshCommunication mesh_comm;
   mesh_comm.broadcast(mesh());
 
-  // now we can build solution system again
-  system().build_simulation_system();
+  // now we can build solution system again.
+  // hierarchical refinement keeps untouched elements, their topology and FVM geometry can be reused
+  system().build_simulation_system(c.get_bool("incremental", false));
   system().sync_print_info();
 
   // set doping profile to semiconductor region
@@ -1802,6 +1917,155 @@ int SolverControl::do_refine_hierarchical(const Parser::Card & c)
 }
 
 
+
+/*------------------------------------------------------------------
+ * @return true if solution variable is valid at any node of the system
+ */
+static bool system_has_node_variable(const SimulationSystem & system, SolutionVariable variable)
+{
+  bool valid = false;
+  for( unsigned int r=0; r<system.n_regions() && !valid; r++)
+  {
+    const SimulationRegion * region = system.region(r);
+    SimulationRegion::const_processor_node_iterator on_processor_nodes_it = region->on_processor_nodes_begin();
+    if( on_processor_nodes_it != region->on_processor_nodes_end() )
+      valid = (*on_processor_nodes_it)->node_data()->is_variable_valid(variable);
+  }
+  Parallel::max(valid);
+  return valid;
+}
+
+
+/*------------------------------------------------------------------
+ * exchange the solution of current and last time step at all the nodes,
+ * so the last step can be saved/restored by the interpolator as well
+ */
+static void swap_last_step(SimulationSystem & system)
+{
+  for(unsigned int r=0; r<system.n_regions(); r++)
+  {
+    SimulationRegion * region = system.region(r);
+    SimulationRegion::local_node_iterator node_it = region->on_local_nodes_begin();
+    SimulationRegion::local_node_iterator node_it_end = region->on_local_nodes_end();
+    for(; node_it!=node_it_end; ++node_it)
+    {
+      FVM_NodeData * node_data = (*node_it)->node_data();
+      std::swap(node_data->psi(), node_data->psi_last());
+      std::swap(node_data->n(),   node_data->n_last());
+      std::swap(node_data->p(),   node_data->p_last());
+      std::swap(node_data->T(),   node_data->T_last());
+      std::swap(node_data->Tn(),  node_data->Tn_last());
+      std::swap(node_data->Tp(),  node_data->Tp_last());
+    }
+  }
+}
+
+
+int SolverControl::do_refine_adaptive(const Parser::Card & c)
+{
+  MESSAGE<<"Adapt mesh to the solution of step "<<(SolverSpecify::Type==SolverSpecify::TRANSIENT ? SolverSpecify::T_Cycles : SolverSpecify::DC_Cycles)<<"...\n"<<std::endl; RECORD();
+
+  // save the solution, it will be interpolated to the new mesh
+  // the old mesh is kept by the interpolator, data are transferred by its shape functions
+  AutoPtr<InterpolationBase> interpolator(new InterpolationMesh(mesh()));
+
+  std::vector<std::string> solution_variables;
+  if( system_has_node_variable(system(), POTENTIAL) )   solution_variables.push_back("potential");
+  if( system_has_node_variable(system(), ELECTRON) )    solution_variables.push_back("electron");
+  if( system_has_node_variable(system(), HOLE) )        solution_variables.push_back("hole");
+  if( system_has_node_variable(system(), TEMPERATURE) ) solution_variables.push_back("temperature");
+  if( system_has_node_variable(system(), E_TEMP) )      solution_variables.push_back("elec_temperature");
+  if( system_has_node_variable(system(), H_TEMP) )      solution_variables.push_back("hole_temperature");
+
+  // BDF2 needs the solution of last time step as well
+  bool transient = SolverSpecify::Type==SolverSpecify::TRANSIENT;
+
+  for(unsigned int n=0; n<solution_variables.size(); n++)
+  {
+    // carrier densities span many orders of magnitude
+    bool is_density = solution_variables[n] == "electron" || solution_variables[n] == "hole";
+    system().fill_interpolator(interpolator.get(), solution_variables[n], is_density ? InterpolationBase::Asinh : InterpolationBase::Linear);
+  }
+
+  if(transient)
+  {
+    swap_last_step(system());
+    for(unsigned int n=0; n<solution_variables.size(); n++)
+    {
+      bool is_density = solution_variables[n] == "electron" || solution_variables[n] == "hole";
+      system().fill_interpolator(interpolator.get(), solution_variables[n], is_density ? InterpolationBase::Asinh : InterpolationBase::Linear,
+                                 solution_variables[n] + ".last");
+    }
+    swap_last_step(system());
+  }
+
+  // save electrode state and its transient history, boundary conditions will be rebuilt with the system
+  std::map<std::string, std::vector<Real> > electrode_state;
+  for(unsigned int b=0; b<system().get_bcs()->n_bcs(); b++)
+  {
+    const BoundaryCondition * bc = system().get_bcs()->get_bc(b);
+    if( bc==NULL || !bc->is_electrode() ) continue;
+    bc->ext_circuit()->save_state(electrode_state[bc->label()]);
+  }
+
+  // build a REFINE.HIERARCHICAL card from adapt.* parameters of SOLVE card
+  Parser::Card refine_card;
+  refine_card.set_key("REFINE.HIERARCHICAL");
+  refine_card.insert("variable", c.get_string("adapt.variable", "potential"));
+  refine_card.insert("measure", c.get_string("adapt.measure", "linear"));
+  refine_card.insert("error.refine.fraction", c.get_real("adapt.refine.fraction", 0.1));
+  refine_card.insert("error.coarsen.fraction", c.get_real("adapt.coarsen.fraction", 0.0));
+  refine_card.insert("max.level", c.get_int("adapt.max.level", 0));
+  refine_card.insert("max.elem", c.get_int("adapt.max.elem", 0));
+
+  // refine the mesh and rebuild the system, doping and mole fraction are transferred here
+  do_refine_hierarchical(refine_card);
+
+  // restore the solution on the new mesh, the last time step is restored first and moved into place
+  if(transient)
+  {
+    for(unsigned int n=0; n<solution_variables.size(); n++)
+      system().do_interpolation(interpolator.get(), solution_variables[n], solution_variables[n] + ".last");
+    swap_last_step(system());
+  }
+
+  for(unsigned int n=0; n<solution_variables.size(); n++)
+    system().do_interpolation(interpolator.get(), solution_variables[n]);
+
+  // DC sweep has no history, the interpolated solution is also the solution of last step
+  if(!transient)
+  {
+    for(unsigned int r=0; r<system().n_regions(); r++)
+    {
+      SimulationRegion * region = system().region(r);
+      SimulationRegion::local_node_iterator node_it = region->on_local_nodes_begin();
+      SimulationRegion::local_node_iterator node_it_end = region->on_local_nodes_end();
+      for(; node_it!=node_it_end; ++node_it)
+      {
+        FVM_NodeData * node_data = (*node_it)->node_data();
+        node_data->psi_last() = node_data->psi();
+        node_data->n_last()   = node_data->n();
+        node_data->p_last()   = node_data->p();
+        node_data->T_last()   = node_data->T();
+        node_data->Tn_last()  = node_data->Tn();
+        node_data->Tp_last()  = node_data->Tp();
+      }
+    }
+  }
+
+  // restore electrode state, the transient continues with the same circuit history
+  for(unsigned int b=0; b<system().get_bcs()->n_bcs(); b++)
+  {
+    BoundaryCondition * bc = system().get_bcs()->get_bc(b);
+    if( bc==NULL || !bc->is_electrode() ) continue;
+    if( electrode_state.find(bc->label()) == electrode_state.end() ) continue;
+    bc->ext_circuit()->load_state(electrode_state[bc->label()]);
+  }
+
+  return 0;
+}
+
+
 /*--------------------------------------------------------------------
  * uniform refine the mesh, it is intended to be used only for test!
  */
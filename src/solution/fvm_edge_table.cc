@@ -0,0 +1,98 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include "fvm_edge_table.h"
+#include "fvm_node_data.h"
+
+
+void FVM_EdgeTable::build(const std::vector< std::pair<FVM_Node *, FVM_Node *> > & edges)
+{
+  clear();
+
+  const unsigned int n_edges = edges.size();
+  _node.reserve(2*n_edges);
+  _node_data.reserve(2*n_edges);
+  _length.reserve(n_edges);
+  _cv_area.reserve(n_edges);
+  _on_processor.reserve(n_edges);
+
+  for(unsigned int e=0; e<n_edges; ++e)
+  {
+    FVM_Node * fvm_n1 = edges[e].first;
+    FVM_Node * fvm_n2 = edges[e].second;
+
+    _node.push_back(fvm_n1);
+    _node.push_back(fvm_n2);
+    _node_data.push_back(fvm_n1->node_data());
+    _node_data.push_back(fvm_n2->node_data());
+    _length.push_back(fvm_n1->distance(fvm_n2));
+    _cv_area.push_back(fvm_n1->cv_surface_area(fvm_n2));
+    _on_processor.push_back( (fvm_n1->on_processor() ? 1 : 0) | (fvm_n2->on_processor() ? 2 : 0) );
+  }
+}
+
+
+void FVM_EdgeTable::build_offsets()
+{
+  std::vector<unsigned int> & local_offset  = _local_offset[FVM_Node::solver_index()];
+  std::vector<unsigned int> & global_offset = _global_offset[FVM_Node::solver_index()];
+
+  local_offset.resize(_node.size());
+  global_offset.resize(_node.size());
+  for(unsigned int n=0; n<_node.size(); ++n)
+  {
+    local_offset[n]  = _node[n]->local_offset();
+    global_offset[n] = _node[n]->global_offset();
+  }
+}
+
+
+void FVM_EdgeTable::clear()
+{
+  _node.clear();
+  _node_data.clear();
+  _length.clear();
+  _cv_area.clear();
+  _on_processor.clear();
+  for(unsigned int s=0; s<4; ++s)
+  {
+    _local_offset[s].clear();
+    _global_offset[s].clear();
+  }
+}
+
+
+size_t FVM_EdgeTable::memory_size() const
+{
+  size_t counter = sizeof(*this);
+  counter += _node.capacity()*sizeof(FVM_Node *);
+  counter += _node_data.capacity()*sizeof(const FVM_NodeData *);
+  counter += _length.capacity()*sizeof(Real);
+  counter += _cv_area.capacity()*sizeof(Real);
+  counter += _on_processor.capacity()*sizeof(unsigned char);
+  for(unsigned int s=0; s<4; ++s)
+  {
+    counter += _local_offset[s].capacity()*sizeof(unsigned int);
+    counter += _global_offset[s].capacity()*sizeof(unsigned int);
+  }
+  return counter;
+}
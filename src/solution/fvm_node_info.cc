@@ -26,6 +26,7 @@
 #include "elem.h"
 #include "fvm_node_info.h"
 #include "boundary_info.h"
+#include "object_pool.h"
 
 // TNT matrix-vector library
 #include <TNT/tnt.h>
@@ -35,10 +36,29 @@
 unsigned int FVM_Node::_solver_index=0;
 
 
+ObjectPool & FVM_Node::pool()
+{
+  // never freed, objects may be deleted during static destruction
+  static ObjectPool * arena = new ObjectPool("FVM_Node");
+  return *arena;
+}
+
+
+void * FVM_Node::operator new (size_t size)
+{
+  return pool().allocate(size);
+}
+
+
+void FVM_Node::operator delete (void * p, size_t size)
+{
+  pool().deallocate(p, size);
+}
+
+
 FVM_Node::FVM_Node(const Node *n)
     : _node(n),
     _node_data(0),
-    _ghost_nodes(0),
     _volume(0),
     _boundary_id(BoundaryInfo::invalid_id),
     _bc_type(INVALID_BC_TYPE),
@@ -56,7 +76,6 @@ FVM_Node::~FVM_Node()
 {
   _node = 0;
   delete _node_data;
-  delete _ghost_nodes;
 }
 
 
@@ -100,11 +119,12 @@ void FVM_Node::set_fvm_node_neighbor(FVM_Node *nb, Real s, Real abs)
 
 void FVM_Node::set_ghost_node(FVM_Node * fn, unsigned int sub_id, Real area)
 {
-  if( _ghost_nodes == NULL)
-    _ghost_nodes = new std::map< FVM_Node *, std::pair<unsigned int, Real> >;
-
-  std::pair<unsigned int, Real> gf(sub_id,area);
-  _ghost_nodes->insert( std::pair< FVM_Node *, std::pair<unsigned int, Real> >(fn, gf) );
+  // keep the flat array sorted by FVM_Node pointer, existing entry is not changed
+  std::pair< FVM_Node *, std::pair<unsigned int, Real> > ghost(fn, std::make_pair(sub_id, area));
+  std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::iterator it =
+    std::lower_bound(_ghost_nodes.begin(), _ghost_nodes.end(), ghost, GhostLess());
+  if( it != _ghost_nodes.end() && it->first == fn ) return;
+  _ghost_nodes.insert(it, ghost);
 }
 
 
@@ -112,18 +132,16 @@ void FVM_Node::set_ghost_node_area(unsigned int sub_id, Real area)
 {
   // the sub_id of boundary face equal to this FVM_Node and _ghost_nodes are empty
   // this is a boundary face, not interface face
-  if( sub_id == _subdomain_id && _ghost_nodes==NULL )
+  if( sub_id == _subdomain_id && _ghost_nodes.empty() )
   {
-    _ghost_nodes = new std::map< FVM_Node *, std::pair<unsigned int, Real> >;
-    std::pair<unsigned int, Real> gf(invalid_uint, area);
-    _ghost_nodes->insert( std::pair< FVM_Node *, std::pair<unsigned int, Real> >((FVM_Node *)NULL, gf) );
+    set_ghost_node((FVM_Node *)NULL, invalid_uint, area);
     return;
   }
 
   // else we find in ghost nodes which matches sub_id
-  genius_assert(_ghost_nodes);
-  std::map< FVM_Node *, std::pair<unsigned int, Real> >::iterator it = _ghost_nodes->begin();
-  for(; it!=_ghost_nodes->end(); ++it)
+  genius_assert(!_ghost_nodes.empty());
+  std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::iterator it = _ghost_nodes.begin();
+  for(; it!=_ghost_nodes.end(); ++it)
     if( (*it).second.first ==  sub_id )
     {
       (*it).second.second = area;
@@ -229,10 +247,10 @@ bool FVM_Node::posotive_cv_surface_area_to_each_neighbor(bool fix)
     cv_surface_area_map[node] += cv;
   }
 
-  if(_ghost_nodes)
+  if(!_ghost_nodes.empty())
   {
-    std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator it = _ghost_nodes->begin();
-    for(; it != _ghost_nodes->end(); ++it)
+    std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::const_iterator it = _ghost_nodes.begin();
+    for(; it != _ghost_nodes.end(); ++it)
     {
       const FVM_Node * ghost_fvm_node = it->first;
       if(!ghost_fvm_node) continue;
@@ -270,10 +288,10 @@ bool FVM_Node::posotive_cv_surface_area_to_each_neighbor(bool fix)
       }
     }
 
-    if(_ghost_nodes)
+    if(!_ghost_nodes.empty())
     {
-      std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator it = _ghost_nodes->begin();
-      for(; it != _ghost_nodes->end(); ++it)
+      std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::const_iterator it = _ghost_nodes.begin();
+      for(; it != _ghost_nodes.end(); ++it)
       {
         FVM_Node * ghost_fvm_node = it->first;
         if(!ghost_fvm_node) continue;
@@ -329,12 +347,12 @@ bool FVM_Node::on_boundary() const
 
 std::vector<unsigned int> FVM_Node::subdomains() const
 {
-  genius_assert(_ghost_nodes);
+  genius_assert(!_ghost_nodes.empty());
 
   std::set<unsigned int> subdomains_set;
   subdomains_set.insert(_subdomain_id);
-  std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator it = _ghost_nodes->begin();
-  for( ; it != _ghost_nodes->end(); ++it)
+  std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::const_iterator it = _ghost_nodes.begin();
+  for( ; it != _ghost_nodes.end(); ++it)
   {
     if( !it->first ) continue;
     subdomains_set.insert(  it->second.first );
@@ -347,7 +365,7 @@ std::vector<unsigned int> FVM_Node::subdomains() const
 
 Real FVM_Node::outside_boundary_surface_area() const
 {
-  genius_assert(_ghost_nodes);
+  genius_assert(!_ghost_nodes.empty());
   Real area = 0.0;
   fvm_ghost_node_iterator  it = ghost_node_begin();
   for(; it!=ghost_node_end(); ++it )
@@ -385,9 +403,78 @@ Real FVM_Node::sup_laplace_unit() const
 unsigned int FVM_Node::n_pure_ghost_node() const
 {
   // sun NULL ghost node
-  if( _ghost_nodes->find(NULL)!=_ghost_nodes->end() )
-    return _ghost_nodes->size() -1 ;
-  return _ghost_nodes->size();
+  // NULL is the smallest key
+  if( !_ghost_nodes.empty() && _ghost_nodes.front().first == NULL )
+    return _ghost_nodes.size() -1 ;
+  return _ghost_nodes.size();
+}
+
+
+void FVM_Node::PDE_nodes(std::vector<const FVM_Node *> & v_nodes, bool elem_based) const
+{
+  std::set<const FVM_Node *> nodes;
+
+  //only consider neighbor nodes, link this node by an edge
+  if( elem_based==false )
+  {
+    nodes.insert(this);
+    for(fvm_neighbor_node_iterator nit = neighbor_node_begin(); nit != neighbor_node_end(); ++nit)
+      nodes.insert((*nit).first);
+
+    // consider ghost nodes in other regions
+    if( !_ghost_nodes.empty() )
+      for(fvm_ghost_node_iterator  git = ghost_node_begin(); git!=ghost_node_end(); ++git)
+      {
+        FVM_Node *ghost_node = (*git).first;
+        if(!ghost_node) continue;
+        nodes.insert(ghost_node);
+        for(fvm_neighbor_node_iterator nit = ghost_node->neighbor_node_begin(); nit != ghost_node->neighbor_node_end(); ++nit)
+          nodes.insert((*nit).first);
+      }
+  }
+  // consider all the nodes belongs to neighbor elements
+  else
+  {
+    std::set<const Elem *> elems;
+
+    // search for all the neighbor elements in this region
+    fvm_element_iterator element_it = elem_begin();
+    for( ; element_it != elem_end(); ++element_it)
+    {
+      const Elem * e = (*element_it).first;
+      elems.insert(e);
+      for(unsigned int n=0; n<e->n_sides(); ++n)
+        if( e->neighbor(n) ) elems.insert(e->neighbor(n));
+    }
+
+    // consider ghost nodes in other regions
+    if( !_ghost_nodes.empty() )
+    {
+      for(fvm_ghost_node_iterator  git = ghost_node_begin(); git != ghost_node_end(); ++git)
+      {
+        FVM_Node *ghost_node = (*git).first;
+        if(!ghost_node) continue;
+
+        for(element_it = ghost_node->elem_begin(); element_it != ghost_node->elem_end(); ++element_it)
+        {
+          const Elem * e = (*element_it).first;
+          elems.insert(e);
+          for(unsigned int n=0; n<e->n_sides(); ++n)
+            if( e->neighbor(n) ) elems.insert(e->neighbor(n));
+        }
+      }
+    }
+
+    std::set<const Elem *>::const_iterator elem_it = elems.begin();
+    for( ; elem_it != elems.end(); ++elem_it)
+    {
+      const Elem * e = *elem_it;
+      for(unsigned int v=0; v<e->n_vertices(); v++)
+        nodes.insert(e->get_fvm_node(v));
+    }
+  }
+
+  v_nodes.insert(v_nodes.end(), nodes.begin(), nodes.end());
 }
 
 
@@ -401,7 +488,7 @@ void FVM_Node::PDE_node_pattern(std::vector<std::pair<unsigned int, unsigned int
     v_region_nodes.push_back( std::pair<unsigned int, unsigned int>(subdomain_id (), fvm_node_neighbors()+1) );
 
     // consider ghost nodes in other regions
-    if( _ghost_nodes!=NULL && !_ghost_nodes->empty() )
+    if( !_ghost_nodes.empty() )
       for(fvm_ghost_node_iterator  git = ghost_node_begin(); git!=ghost_node_end(); ++git)
       {
         FVM_Node *ghost_node = (*git).first;
@@ -427,7 +514,7 @@ void FVM_Node::PDE_node_pattern(std::vector<std::pair<unsigned int, unsigned int
     }
 
     // consider ghost nodes in other regions
-    if( _ghost_nodes!=NULL && !_ghost_nodes->empty() )
+    if( !_ghost_nodes.empty() )
     {
       for(fvm_ghost_node_iterator  git = ghost_node_begin(); git != ghost_node_end(); ++git)
       {
@@ -482,7 +569,7 @@ void FVM_Node::PDE_node_pattern(std::vector<std::pair<unsigned int, unsigned int
     v_off_region_nodes.push_back( std::pair<unsigned int, unsigned int>(subdomain_id (), off_nodes) );
 
     // consider ghost nodes in other regions
-    if( _ghost_nodes!=NULL && !_ghost_nodes->empty() )
+    if( !_ghost_nodes.empty() )
     {
       for(fvm_ghost_node_iterator  git = ghost_node_begin(); git!=ghost_node_end(); ++git)
       {
@@ -518,7 +605,7 @@ void FVM_Node::PDE_node_pattern(std::vector<std::pair<unsigned int, unsigned int
     }
 
     // consider ghost nodes in other regions
-    if( _ghost_nodes!=NULL && !_ghost_nodes->empty() )
+    if( !_ghost_nodes.empty() )
     {
       for(fvm_ghost_node_iterator  git = ghost_node_begin(); git != ghost_node_end(); ++git)
       {
@@ -577,7 +664,7 @@ void FVM_Node::PDE_off_processor_node_pattern(std::vector<std::pair<unsigned int
     v_region_nodes.push_back( std::pair<unsigned int, unsigned int>(subdomain_id (), nodes) );
 
     // we should consider ghost node, since it has the same root node
-    if( _ghost_nodes!=NULL && !_ghost_nodes->empty() )
+    if( !_ghost_nodes.empty() )
       for(fvm_ghost_node_iterator  git = ghost_node_begin(); git!=ghost_node_end(); ++git)
       {
         FVM_Node *ghost_node = (*git).first;
@@ -607,7 +694,7 @@ void FVM_Node::PDE_off_processor_node_pattern(std::vector<std::pair<unsigned int
     }
 
     // consider ghost nodes in other regions
-    if( _ghost_nodes!=NULL && !_ghost_nodes->empty() )
+    if( !_ghost_nodes.empty() )
     {
       for(fvm_ghost_node_iterator  git = ghost_node_begin(); git != ghost_node_end(); ++git)
       {
@@ -689,10 +776,10 @@ void FVM_Node::prepare_gradient()
   genius_assert(r2.size() == neighbors);
   genius_assert(r3.size() == neighbors);
 
-  if(_ghost_nodes)
+  if(!_ghost_nodes.empty())
   {
-    std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator g_it = _ghost_nodes->begin();
-    for( ; g_it != _ghost_nodes->end(); ++g_it)
+    std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::const_iterator g_it = _ghost_nodes.begin();
+    for( ; g_it != _ghost_nodes.end(); ++g_it)
     {
       const FVM_Node *ghost_node = g_it->first;
       if(!ghost_node) continue;
@@ -765,10 +852,10 @@ VectorValue<PetscScalar> FVM_Node::gradient(SolutionVariable var, bool ghost) co
     dphi_array.push_back(dphi);
   }
 
-  if(ghost && _ghost_nodes)
+  if(ghost && !_ghost_nodes.empty())
   {
-    std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator g_it = _ghost_nodes->begin();
-    for( ; g_it != _ghost_nodes->end(); ++ g_it)
+    std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >::const_iterator g_it = _ghost_nodes.begin();
+    for( ; g_it != _ghost_nodes.end(); ++ g_it)
     {
       const FVM_Node *ghost_node = g_it->first;
       if(!ghost_node) continue;
@@ -819,8 +906,10 @@ void FVM_Node::operator += (const FVM_Node &other_node)
 
 void FVM_Node::prepare_for_use()
 {
-  //std::vector< std::pair<const Elem *, unsigned int> >(_elem_has_this_node).swap(_elem_has_this_node);
-  //std::vector< std::pair<FVM_Node *, Real> >(_fvm_node_neighbor).swap(_fvm_node_neighbor);
+  // the lists are complete now, drop the spare capacity left by push_back
+  std::vector< std::pair<const Elem *, unsigned int> >(_elem_has_this_node).swap(_elem_has_this_node);
+  std::vector< std::pair<FVM_Node *, std::pair<Real, Real> > >(_fvm_node_neighbor).swap(_fvm_node_neighbor);
+  std::vector< std::pair< FVM_Node *, std::pair<unsigned int, Real> > >(_ghost_nodes).swap(_ghost_nodes);
   FNLess less;
   std::sort( _fvm_node_neighbor.begin(), _fvm_node_neighbor.end(), less );
 
@@ -837,12 +926,7 @@ size_t FVM_Node::memory_size() const
   counter += _elem_has_this_node.capacity()*sizeof(std::pair<const Elem *, unsigned int>);
   counter += _fvm_node_neighbor.capacity()*sizeof(std::pair<FVM_Node *, std::pair<Real, Real> >);
 
-  if(_ghost_nodes)
-  {
-    std::map< FVM_Node *, std::pair<unsigned int, Real> >::const_iterator it = _ghost_nodes->begin();
-    for( ; it != _ghost_nodes->end(); ++it )
-      counter += sizeof(it->first) + sizeof(it->second);
-  }
+  counter += _ghost_nodes.capacity()*sizeof(std::pair< FVM_Node *, std::pair<unsigned int, Real> >);
 
   return counter;
 }
@@ -0,0 +1,265 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <algorithm>
+#include <map>
+
+#include "fvm_node_order.h"
+#include "fvm_node_info.h"
+#include "node.h"
+
+
+FVM_NodeOrder fvm_node_order(const std::string & order)
+{
+  if(order == "rcm")     return RCMNodeOrder;
+  if(order == "hilbert") return HilbertNodeOrder;
+  if(order == "morton")  return MortonNodeOrder;
+  return MeshNodeOrder;
+}
+
+
+namespace
+{
+
+  // bits per axis of the space filling curve key, 3*21 bits fit into 64bit key
+  const unsigned int sfc_bits = 21;
+
+  /**
+   * quantize node coordinates into the integer lattice of region bounding box.
+   * the axis with zero extent is dropped, so a 2D mesh gets a 2D curve.
+   */
+  void quantize(const std::vector<const FVM_Node *> & nodes, std::vector<unsigned int> & X, unsigned int & dim)
+  {
+    Real min[3] = { 1e30,  1e30,  1e30};
+    Real max[3] = {-1e30, -1e30, -1e30};
+    for(unsigned int n=0; n<nodes.size(); ++n)
+    {
+      const Node * node = nodes[n]->root_node();
+      for(unsigned int i=0; i<3; ++i)
+      {
+        min[i] = std::min(min[i], (*node)(i));
+        max[i] = std::max(max[i], (*node)(i));
+      }
+    }
+
+    Real extent = 0.0;
+    for(unsigned int i=0; i<3; ++i)
+      extent = std::max(extent, max[i]-min[i]);
+
+    std::vector<unsigned int> axis;
+    for(unsigned int i=0; i<3; ++i)
+      if( max[i]-min[i] > 1e-10*extent ) axis.push_back(i);
+    dim = axis.size();
+
+    // same scale for each axis, keep the aspect ratio of region
+    const unsigned int lattice = (1u << sfc_bits) - 1;
+    Real scale = extent > 0.0 ? lattice/extent : 0.0;
+
+    X.resize(nodes.size()*dim);
+    for(unsigned int n=0; n<nodes.size(); ++n)
+    {
+      const Node * node = nodes[n]->root_node();
+      for(unsigned int d=0; d<dim; ++d)
+      {
+        Real x = ((*node)(axis[d]) - min[axis[d]])*scale;
+        X[n*dim+d] = std::min(lattice, static_cast<unsigned int>(std::max(0.0, x)));
+      }
+    }
+  }
+
+
+  /**
+   * transpose the coordinates into Hilbert index, see
+   * J. Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707, 2004
+   */
+  void axes_to_transpose(unsigned int * X, unsigned int dim)
+  {
+    const unsigned int M = 1u << (sfc_bits-1);
+
+    // inverse undo
+    for(unsigned int Q = M; Q > 1; Q >>= 1)
+    {
+      unsigned int P = Q - 1;
+      for(unsigned int i=0; i<dim; ++i)
+      {
+        if( X[i] & Q ) X[0] ^= P;
+        else
+        {
+          unsigned int t = (X[0]^X[i]) & P;
+          X[0] ^= t;
+          X[i] ^= t;
+        }
+      }
+    }
+
+    // gray encode
+    for(unsigned int i=1; i<dim; ++i)
+      X[i] ^= X[i-1];
+    unsigned int t = 0;
+    for(unsigned int Q = M; Q > 1; Q >>= 1)
+      if( X[dim-1] & Q ) t ^= Q-1;
+    for(unsigned int i=0; i<dim; ++i)
+      X[i] ^= t;
+  }
+
+
+  unsigned long long interleave(const unsigned int * X, unsigned int dim)
+  {
+    unsigned long long key = 0;
+    for(int b=sfc_bits-1; b>=0; --b)
+      for(unsigned int i=0; i<dim; ++i)
+        key = (key << 1) | ((X[i] >> b) & 1u);
+    return key;
+  }
+
+
+  void sfc_order(FVM_NodeOrder order, const std::vector<const FVM_Node *> & nodes, std::vector<unsigned int> & perm)
+  {
+    std::vector<unsigned int> X;
+    unsigned int dim;
+    quantize(nodes, X, dim);
+
+    std::vector< std::pair<unsigned long long, unsigned int> > keys(nodes.size());
+    for(unsigned int n=0; n<nodes.size(); ++n)
+    {
+      unsigned int * x = dim ? &X[n*dim] : 0;
+      if( dim && order == HilbertNodeOrder )
+        axes_to_transpose(x, dim);
+      keys[n] = std::make_pair(dim ? interleave(x, dim) : 0ull, n);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    perm.resize(nodes.size());
+    for(unsigned int n=0; n<keys.size(); ++n)
+      perm[n] = keys[n].second;
+  }
+
+
+  /**
+   * breadth first search from start, neighbors are visited in increasing degree.
+   * @return the last visited node
+   */
+  unsigned int bfs(unsigned int start,
+                   const std::vector< std::vector<unsigned int> > & graph,
+                   std::vector<int> & level,
+                   std::vector<unsigned int> & visit)
+  {
+    unsigned int head = visit.size();
+    level[start] = 0;
+    visit.push_back(start);
+    while( head < visit.size() )
+    {
+      unsigned int v = visit[head++];
+      const std::vector<unsigned int> & adj = graph[v];
+      for(unsigned int k=0; k<adj.size(); ++k)
+        if( level[adj[k]] < 0 )
+        {
+          level[adj[k]] = level[v] + 1;
+          visit.push_back(adj[k]);
+        }
+    }
+    return visit.back();
+  }
+
+
+  struct DegreeLess
+  {
+    DegreeLess(const std::vector< std::vector<unsigned int> > & g) : graph(g) {}
+    bool operator() (unsigned int a, unsigned int b) const
+    {
+      if( graph[a].size() != graph[b].size() ) return graph[a].size() < graph[b].size();
+      return a < b;
+    }
+    const std::vector< std::vector<unsigned int> > & graph;
+  };
+
+
+  void rcm_order(const std::vector<const FVM_Node *> & nodes, std::vector<unsigned int> & perm)
+  {
+    std::map<const FVM_Node *, unsigned int> index;
+    for(unsigned int n=0; n<nodes.size(); ++n)
+      index.insert(std::make_pair(nodes[n], n));
+
+    std::vector< std::vector<unsigned int> > graph(nodes.size());
+    for(unsigned int n=0; n<nodes.size(); ++n)
+    {
+      FVM_Node::fvm_neighbor_node_iterator it = nodes[n]->neighbor_node_begin();
+      for( ; it != nodes[n]->neighbor_node_end(); ++it)
+      {
+        std::map<const FVM_Node *, unsigned int>::const_iterator pos = index.find((*it).first);
+        if( pos != index.end() && pos->second != n )
+          graph[n].push_back(pos->second);
+      }
+    }
+
+    DegreeLess less(graph);
+    for(unsigned int n=0; n<graph.size(); ++n)
+      std::sort(graph[n].begin(), graph[n].end(), less);
+
+    std::vector<unsigned int> by_degree(nodes.size());
+    for(unsigned int n=0; n<nodes.size(); ++n)
+      by_degree[n] = n;
+    std::sort(by_degree.begin(), by_degree.end(), less);
+
+    std::vector<int> level(nodes.size(), -1);
+    perm.clear();
+    perm.reserve(nodes.size());
+    for(unsigned int n=0; n<by_degree.size(); ++n)
+    {
+      unsigned int start = by_degree[n];
+      if( level[start] >= 0 ) continue;
+
+      // the last node of a search from min degree node is a pseudo-peripheral node,
+      // start the Cuthill-McKee search again from it
+      std::vector<unsigned int> component;
+      unsigned int far = bfs(start, graph, level, component);
+      for(unsigned int k=0; k<component.size(); ++k)
+        level[component[k]] = -1;
+      bfs(far, graph, level, perm);
+    }
+
+    std::reverse(perm.begin(), perm.end());
+  }
+
+}
+
+
+void fvm_node_order_rank(FVM_NodeOrder order, const std::vector<const FVM_Node *> & nodes, std::vector<unsigned int> & rank)
+{
+  std::vector<unsigned int> perm;
+  switch(order)
+  {
+    case RCMNodeOrder     : rcm_order(nodes, perm); break;
+    case HilbertNodeOrder :
+    case MortonNodeOrder  : sfc_order(order, nodes, perm); break;
+    default :
+    {
+      perm.resize(nodes.size());
+      for(unsigned int n=0; n<nodes.size(); ++n)
+        perm[n] = n;
+    }
+  }
+
+  rank.resize(nodes.size());
+  for(unsigned int n=0; n<perm.size(); ++n)
+    rank[perm[n]] = n;
+}
@@ -19,11 +19,14 @@
 /*                                                                              */
 /********************************************************************************/
 
+#include <algorithm>
+
 #include "elem.h"
 #include "simulation_region.h"
 #include "boundary_condition.h"
 #include "material.h"
 #include "parallel.h"
+#include "fvm_node_order.h"
 
 // static member
 std::map<unsigned int,  SimulationRegion *>  SimulationRegion::_subdomain_id_to_region_map;
@@ -31,7 +34,7 @@ std::map<unsigned int,  SimulationRegion *>  SimulationRegion::_subdomain_id_to_
 
 
 SimulationRegion::SimulationRegion(const std::string &name, const std::string &material, const double T, const double z)
-  :_region_name(name), _region_material(material), _T_external(T), _z_width(z)
+  :_region_name(name), _region_material(material), _T_external(T), _z_width(z), _node_order(MeshNodeOrder), _row_redirect(0)
 {}
 
 
@@ -89,7 +92,7 @@ void SimulationRegion::region_node(std::vector<unsigned int> & nodes) const
 
 FVM_Node * SimulationRegion::region_fvm_node(const Node* node) const
 {
-  std::map<unsigned int, FVM_Node *>::const_iterator it = _region_node.find( node->id() );
+  RegionNodeMap::const_iterator it = _region_node.find( node->id() );
   if( it!=_region_node.end() )
     return (*it).second;
   return NULL;
@@ -98,7 +101,7 @@ FVM_Node * SimulationRegion::region_fvm_node(const Node* node) const
 
 FVM_Node * SimulationRegion::region_fvm_node(unsigned int id) const
 {
-  std::map<unsigned int, FVM_Node *>::const_iterator it = _region_node.find( id );
+  RegionNodeMap::const_iterator it = _region_node.find( id );
   if( it!=_region_node.end() )
     return (*it).second;
   return NULL;
@@ -107,7 +110,7 @@ FVM_Node * SimulationRegion::region_fvm_node(unsigned int id) const
 
 FVM_NodeData * SimulationRegion::region_node_data(const Node* node) const
 {
-  std::map<unsigned int, FVM_Node *>::const_iterator it = _region_node.find( node->id() );
+  RegionNodeMap::const_iterator it = _region_node.find( node->id() );
   if( it!=_region_node.end() )
     return (*it).second->node_data();
   return NULL;
@@ -116,7 +119,7 @@ FVM_NodeData * SimulationRegion::region_node_data(const Node* node) const
 
 FVM_NodeData * SimulationRegion::region_node_data(unsigned int id) const
 {
-  std::map<unsigned int, FVM_Node *>::const_iterator it = _region_node.find( id );
+  RegionNodeMap::const_iterator it = _region_node.find( id );
   if( it!=_region_node.end() )
     return (*it).second->node_data();
   return NULL;
@@ -131,7 +134,7 @@ void SimulationRegion::clear()
     delete _region_cell_data[n];
   _region_cell_data.clear();
 
-  std::map<unsigned int, FVM_Node *>::iterator it = _region_node.begin();
+  RegionNodeMap::iterator it = _region_node.begin();
 
   for( ; it != _region_node.end(); it++ )
   {
@@ -150,6 +153,7 @@ void SimulationRegion::clear()
   _node_data_storage.clear();
 
   _region_edges.clear();
+  _edge_table.clear();
   _region_elem_edge_in_edges_index.clear();
   _region_neighbors.clear();
   _region_boundaries.clear();
@@ -175,10 +179,13 @@ void SimulationRegion::rebuild_region_fvm_node_list()
   _region_image_node.clear();
 
 
+  std::vector<FVM_Node *> nodes;
+  ordered_region_nodes(nodes);
+
   // fill on_local and on_processor node vector
-  for(std::map<unsigned int, FVM_Node *>::iterator nodes_it = _region_node.begin(); nodes_it != _region_node.end(); nodes_it++)
+  for(unsigned int n=0; n<nodes.size(); ++n)
   {
-    FVM_Node * fvm_node = (*nodes_it).second;
+    FVM_Node * fvm_node = nodes[n];
     if( fvm_node->on_local() )
     {
       genius_assert(fvm_node->node_data());
@@ -209,11 +216,30 @@ void SimulationRegion::rebuild_region_fvm_node_list()
 }
 
 
+void SimulationRegion::ordered_region_nodes(std::vector<FVM_Node *> & nodes) const
+{
+  nodes.clear();
+  nodes.reserve(_region_node.size());
+  for(RegionNodeMap::const_iterator nodes_it = _region_node.begin(); nodes_it != _region_node.end(); nodes_it++)
+    nodes.push_back((*nodes_it).second);
+
+  if( _node_order == MeshNodeOrder ) return;
+
+  std::vector<unsigned int> rank;
+  fvm_node_order_rank(_node_order, std::vector<const FVM_Node *>(nodes.begin(), nodes.end()), rank);
+
+  std::vector<FVM_Node *> ordered(nodes.size());
+  for(unsigned int n=0; n<nodes.size(); ++n)
+    ordered[rank[n]] = nodes[n];
+  nodes.swap(ordered);
+}
+
+
 void SimulationRegion::prepare_for_use()
 {
   START_LOG("prepare_for_use()", "SimulationRegion");
 
-  std::map<unsigned int, FVM_Node *>::iterator nodes_it = _region_node.begin();
+  RegionNodeMap::iterator nodes_it = _region_node.begin();
   for(; nodes_it != _region_node.end(); ++nodes_it)
   {
     FVM_Node * fvm_node = (*nodes_it).second;
@@ -233,26 +259,7 @@ void SimulationRegion::prepare_for_use()
   }
 
 
-  // fix extra on local cells
-  // neighbor elem of an on processor element is marked as on local previously
-  // they are set to hold FVM_Node
-  // now, we can remove them from region cells if they don't have on processor node
-  {
-    std::vector<const Elem *> cells = _region_cell;
-    _region_cell.clear();
-    for(unsigned int n=0; n<cells.size(); ++n)
-    {
-      const Elem * elem =  cells[n];
-      if(elem->on_processor())
-      {_region_cell.push_back(elem); continue;}
-      for( unsigned int m=0; m<elem->n_nodes(); m++ )
-        if( elem->get_node(m)->on_processor() )
-        {
-          _region_cell.push_back(elem);
-          break;
-        }
-    }
-  }
+  remove_extra_local_cells();
 
 
 
@@ -276,9 +283,43 @@ void SimulationRegion::prepare_for_use()
         region_edge_map[edge_nodes].push_back(std::make_pair(elem, n));
       }
     }
-    EdgeCellMap::const_iterator  edge_it = region_edge_map.begin();
-    for(; edge_it != region_edge_map.end(); ++edge_it)
+
+    // edges are visited in the order of their end nodes, so the edge loops stream over node data and dofs
+    std::vector<EdgeCellMap::const_iterator> edge_list;
+    edge_list.reserve(region_edge_map.size());
+    if( _node_order == MeshNodeOrder )
+    {
+      for(EdgeCellMap::const_iterator edge_it = region_edge_map.begin(); edge_it != region_edge_map.end(); ++edge_it)
+        edge_list.push_back(edge_it);
+    }
+    else
+    {
+      std::vector<FVM_Node *> nodes;
+      ordered_region_nodes(nodes);
+      std::map<unsigned int, unsigned int> node_rank;
+      for(unsigned int n=0; n<nodes.size(); ++n)
+        node_rank.insert(std::make_pair(nodes[n]->root_node()->id(), n));
+
+      typedef std::pair< std::pair<unsigned int, unsigned int>, unsigned int > EdgeKey;
+      std::vector<EdgeKey> edge_keys;
+      edge_keys.reserve(region_edge_map.size());
+      std::vector<EdgeCellMap::const_iterator> edge_its;
+      edge_its.reserve(region_edge_map.size());
+      for(EdgeCellMap::const_iterator edge_it = region_edge_map.begin(); edge_it != region_edge_map.end(); ++edge_it)
+      {
+        unsigned int r1 = node_rank.find(edge_it->first.first)->second;
+        unsigned int r2 = node_rank.find(edge_it->first.second)->second;
+        edge_keys.push_back( std::make_pair(std::make_pair(std::min(r1, r2), std::max(r1, r2)), edge_its.size()) );
+        edge_its.push_back(edge_it);
+      }
+      std::sort(edge_keys.begin(), edge_keys.end());
+      for(unsigned int n=0; n<edge_keys.size(); ++n)
+        edge_list.push_back(edge_its[edge_keys[n].second]);
+    }
+
+    for(unsigned int ie=0; ie<edge_list.size(); ++ie)
     {
+      EdgeCellMap::const_iterator  edge_it = edge_list[ie];
       const std::pair<unsigned int, unsigned int> & edge_nodes = edge_it->first;
       unsigned int edge_index =  _region_edges.size();
       _region_edges.push_back( std::make_pair(region_fvm_node(edge_nodes.first), region_fvm_node(edge_nodes.second)) );
@@ -298,12 +339,65 @@ void SimulationRegion::prepare_for_use()
           _region_elem_edge_in_edges_index[elem][local_edge_index] = edge_index;
       }
     }
+
+    _edge_table.build(_region_edges);
   }
 
   STOP_LOG("prepare_for_use()", "SimulationRegion");
 }
 
 
+void SimulationRegion::restore_for_use(const std::vector<FVM_Node *> & fvm_nodes, const unsigned int * edges, unsigned int n_edges, const unsigned int * cell_edges)
+{
+  START_LOG("restore_for_use()", "SimulationRegion");
+
+  // the surface area of cached FVM_Node is already fixed, only sort the lists and build gradient
+  RegionNodeMap::iterator nodes_it = _region_node.begin();
+  for(; nodes_it != _region_node.end(); ++nodes_it)
+    (*nodes_it).second->prepare_for_use();
+
+  remove_extra_local_cells();
+
+  _region_edges.reserve(n_edges);
+  for(unsigned int n=0; n<n_edges; ++n)
+    _region_edges.push_back( std::make_pair(fvm_nodes[edges[2*n]], fvm_nodes[edges[2*n+1]]) );
+
+  for(element_iterator elem_it = elements_begin(); elem_it != elements_end(); elem_it++)
+  {
+    const Elem * elem = *elem_it;
+    _region_elem_edge_in_edges_index[elem].assign(cell_edges, cell_edges + elem->n_edges());
+    cell_edges += elem->n_edges();
+  }
+
+  _edge_table.build(_region_edges);
+
+  STOP_LOG("restore_for_use()", "SimulationRegion");
+}
+
+
+void SimulationRegion::remove_extra_local_cells()
+{
+  // fix extra on local cells
+  // neighbor elem of an on processor element is marked as on local previously
+  // they are set to hold FVM_Node
+  // now, we can remove them from region cells if they don't have on processor node
+  std::vector<const Elem *> cells = _region_cell;
+  _region_cell.clear();
+  for(unsigned int n=0; n<cells.size(); ++n)
+  {
+    const Elem * elem =  cells[n];
+    if(elem->on_processor())
+    {_region_cell.push_back(elem); continue;}
+    for( unsigned int m=0; m<elem->n_nodes(); m++ )
+      if( elem->get_node(m)->on_processor() )
+      {
+        _region_cell.push_back(elem);
+        break;
+      }
+  }
+}
+
+
 void SimulationRegion::prepare_for_use_parallel()
 {
   START_LOG("prepare_for_use_parallel()", "SimulationRegion");
@@ -382,7 +476,7 @@ void SimulationRegion::sync_fvm_node_volume()
   // here we force all the fvm_node volume to be positive
   {
     std::map<unsigned int, Real> fvm_node_volume_map;
-    std::map<unsigned int, FVM_Node *>::iterator nodes_it = _region_node.begin();
+    RegionNodeMap::iterator nodes_it = _region_node.begin();
     for(; nodes_it != _region_node.end(); ++nodes_it)
     {
       const FVM_Node * fvm_node = (*nodes_it).second;
@@ -433,21 +527,19 @@ bool SimulationRegion::is_neighbor(const SimulationRegion *r) const
 
 void SimulationRegion::remove_remote_object()
 {
-  std::vector<unsigned int> remote_nodes;
-
-  std::map< unsigned int, FVM_Node * >::iterator it = _region_node.begin();
+  RegionNodeMap::iterator it = _region_node.begin();
   for( ; it != _region_node.end(); ++it)
   {
     FVM_Node * fvm_node = it->second;
     if( !fvm_node->on_local() )
     {
       delete fvm_node;
-      remote_nodes.push_back(it->first);
+      it->second = NULL;
     }
   }
 
-  for(unsigned int n=0; n<remote_nodes.size(); ++n)
-    _region_node.erase( remote_nodes[n] );
+  // remove them in one pass
+  _region_node.erase_null();
 }
 
 
@@ -807,7 +899,7 @@ BoundaryCondition * SimulationRegion::floating_metal() const
 
 void SimulationRegion::add_hanging_node_on_side(const Node * node, const Elem * elem, unsigned int s)
 {
-  std::map<unsigned int, FVM_Node *>::iterator it = _region_node.find(node->id());
+  RegionNodeMap::iterator it = _region_node.find(node->id());
   genius_assert( it!=_region_node.end() );
 
   const FVM_Node * fvm_node = (*it).second;
@@ -817,7 +909,7 @@ void SimulationRegion::add_hanging_node_on_side(const Node * node, const Elem *
 
 void SimulationRegion::add_hanging_node_on_edge(const Node * node, const Elem * elem, unsigned int e)
 {
-  std::map<unsigned int, FVM_Node *>::iterator it = _region_node.find(node->id());
+  RegionNodeMap::iterator it = _region_node.find(node->id());
   genius_assert( it!=_region_node.end() );
 
   const FVM_Node * fvm_node = (*it).second;
@@ -835,7 +927,7 @@ size_t SimulationRegion::memory_size() const
   counter += _region_cell.capacity()*sizeof(const Elem *);
   counter += _region_cell_data.capacity()*sizeof(FVM_CellData *);
   counter += _cell_data_storage.memory_size();
-  std::map<unsigned int, FVM_Node *>::const_iterator it = _region_node.begin();
+  RegionNodeMap::const_iterator it = _region_node.begin();
   for( ; it != _region_node.end(); it++ )
   {
     counter += it->second->memory_size();
@@ -848,6 +940,7 @@ size_t SimulationRegion::memory_size() const
   counter += _region_image_node.capacity()*sizeof(FVM_Node *);
   counter +=  _node_data_storage.memory_size();
   counter += _region_edges.capacity()*sizeof(std::pair<FVM_Node *, FVM_Node *>);
+  counter += _edge_table.memory_size();
 
   return counter;
 }
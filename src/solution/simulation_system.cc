@@ -22,12 +22,14 @@
 //  $Id: simulation_system.cc,v 1.53 2008/07/09 09:10:08 gdiso Exp $
 
 #include <sstream>
+#include <iomanip>
 #include <numeric>
 #include <queue>
 #include <algorithm>
 
 #include "parser.h"
 #include "unstructured_mesh.h"
+#include "mesh_cache.h"
 #include "simulation_system.h"
 #include "simulation_region.h"
 #include "semiconductor_region.h"
@@ -55,7 +57,9 @@
 #include "interpolation_2d_csa.h"
 
 #include "perf_log.h"
+#include "object_pool.h"
 #include "sync_file.h"
+#include "threads.h"
 
 
 #if defined(HAVE_TR1_UNORDERED_MAP)
@@ -69,7 +73,7 @@
 
 
 SimulationSystem::SimulationSystem(MeshBase & mesh)
-  : _mesh(mesh), _cylindrical_mesh(false), _distributed_mesh(true), _resistive_metal_mode(false), _block_partition(false),
+  : _mesh(mesh), _cylindrical_mesh(false), _distributed_mesh(true), _resistive_metal_mode(false), _block_partition(false), _node_order(MeshNodeOrder), _mesh_cache_dir(""), _memory_report(false),
     _bcs(0), _electrical_source(0),
     _field_source(0), _spice_ckt(0), _global_z_width(false)
 {
@@ -83,7 +87,7 @@ SimulationSystem::SimulationSystem(MeshBase & mesh)
 
 
 SimulationSystem::SimulationSystem(MeshBase & mesh, Parser::InputParser & _decks)
-  :  _T_external(300.0), _mesh(mesh), _cylindrical_mesh(false), _distributed_mesh(true), _resistive_metal_mode(false), _block_partition(false),
+  :  _T_external(300.0), _mesh(mesh), _cylindrical_mesh(false), _distributed_mesh(true), _resistive_metal_mode(false), _block_partition(false), _node_order(MeshNodeOrder), _mesh_cache_dir(""), _memory_report(false),
     _bcs(0), _electrical_source(0),
     _field_source(0), _spice_ckt(0), _global_z_width(false), _z_width(1.0)
 {
@@ -146,6 +150,12 @@ SimulationSystem::SimulationSystem(MeshBase & mesh, Parser::InputParser & _decks
       _distributed_mesh = c.get_bool("distributedmesh", true);
       _resistive_metal_mode = c.get_bool("resistivemetal", false);
       _block_partition = c.get_bool("blockpartition", false);
+      _node_order = fvm_node_order(c.get_string("node.order", "mesh"));
+      _mesh_cache_dir = c.get_string("mesh.cache", "");
+      _memory_report = c.get_bool("memory.report", false);
+
+      if( c.is_parameter_exist("threads") && c.get_int("threads", 1) > 0 )
+        Threads::set_n_threads(c.get_int("threads", 1));
 
       double res = c.get_real("leakage.res", 1e12)*PhysicalUnit::V/PhysicalUnit::A;
       double cap = c.get_real("leakage.cap", 1e-18)*PhysicalUnit::C/PhysicalUnit::V;
@@ -348,13 +358,13 @@ bool SimulationSystem::has_complex_compound_semiconductor_region() const
 }
 
 
-void SimulationSystem::build_simulation_system()
+void SimulationSystem::build_simulation_system(bool incremental)
 {
   // sync resistive_metal_mode
   Parallel::broadcast(_resistive_metal_mode);
 
   // each region has its own FVM mesh
-  build_region_fvm_mesh();
+  build_region_fvm_mesh(incremental);
 
   // boundary condition
   _bcs->bc_setup();
@@ -380,12 +390,248 @@ void SimulationSystem::build_simulation_system()
 
 
 
-void SimulationSystem::build_region_fvm_mesh()
+namespace {
+
+  // sections of the prepared simulation structure in the mesh cache entry, after the mesh topology.
+  // FVM_Node is saved in the order of its root node id and subdomain id, and referred by this index
+  enum FVMCacheSection
+  {
+    // begin of each elem in ElemGeometry, n_elem+1 values
+    ElemGeometryOffset = MeshCache::n_topology_sections,
+    // FVM geometry of elems, see Elem::pack_fvm_geometry()
+    ElemGeometry,
+    // root node id and subdomain id of FVM_Node
+    FVMNodeInfo,
+    // control volume and norm of FVM_Node
+    FVMNodeReal,
+    // begin of each FVM_Node in FVMNodeElems, n_fvm_node+1 values
+    FVMNodeElemOffset,
+    // elem id and local index of the root node
+    FVMNodeElems,
+    // begin of each FVM_Node in FVMNodeNeighbors
+    FVMNodeNeighborOffset,
+    // neighbor FVM_Node index
+    FVMNodeNeighbors,
+    // surface area and abs surface area to the neighbor
+    FVMNodeNeighborArea,
+    // begin of each FVM_Node in FVMNodeGhosts
+    FVMNodeGhostOffset,
+    // ghost FVM_Node index (invalid_uint for boundary) and subdomain id
+    FVMNodeGhosts,
+    // area of the ghost node
+    FVMNodeGhostArea,
+    // begin of each region in RegionEdges, n_region+1 values
+    RegionEdgeOffset,
+    // FVM_Node index pair of region edges
+    RegionEdges,
+    // begin of each region in RegionCellEdges, n_region+1 values
+    RegionCellEdgeOffset,
+    // region edge index of each edge of region cells, cell by cell
+    RegionCellEdges,
+    FVMCacheSectionEnd
+  };
+
+  // n+1 offsets start from 0 and end with size
+  bool valid_offsets(const unsigned int * offset, unsigned int n_offset, unsigned int n, unsigned int size)
+  {
+    if( n_offset != n+1 || offset[0] != 0 || offset[n] != size ) return false;
+    for(unsigned int i=0; i<n; ++i)
+      if( offset[i] > offset[i+1] ) return false;
+    return true;
+  }
+
+  // check the cached structure against the mesh, which is loaded from the same entry
+  bool valid_fvm_cache(const MeshCache & cache, const MeshBase & mesh)
+  {
+    if( cache.n_sections() != FVMCacheSectionEnd ) return false;
+
+    const unsigned int n_elem    = mesh.n_elem();
+    const unsigned int n_regions = mesh.n_subdomains();
+    unsigned int n, m;
+
+    const unsigned int * offset = cache.section<unsigned int>(ElemGeometryOffset, n);
+    cache.section<Real>(ElemGeometry, m);
+    if( !valid_offsets(offset, n, n_elem, m) ) return false;
+
+    const unsigned int * info = cache.section<unsigned int>(FVMNodeInfo, n);
+    if( n%2 ) return false;
+    const unsigned int n_fvm_nodes = n/2;
+    for(unsigned int i=0; i<n_fvm_nodes; ++i)
+      if( info[2*i] >= mesh.n_nodes() || info[2*i+1] >= n_regions ) return false;
+    cache.section<Real>(FVMNodeReal, n);
+    if( n != 4*n_fvm_nodes ) return false;
+
+    const unsigned int * elems = cache.section<unsigned int>(FVMNodeElems, m);
+    offset = cache.section<unsigned int>(FVMNodeElemOffset, n);
+    if( m%2 || !valid_offsets(offset, n, n_fvm_nodes, m/2) ) return false;
+    for(unsigned int i=0; i<m; i+=2)
+      if( elems[i] >= n_elem || elems[i+1] >= mesh.elem(elems[i])->n_nodes() ) return false;
+
+    const unsigned int * neighbors = cache.section<unsigned int>(FVMNodeNeighbors, m);
+    offset = cache.section<unsigned int>(FVMNodeNeighborOffset, n);
+    if( !valid_offsets(offset, n, n_fvm_nodes, m) ) return false;
+    for(unsigned int i=0; i<m; ++i)
+      if( neighbors[i] >= n_fvm_nodes ) return false;
+    cache.section<Real>(FVMNodeNeighborArea, n);
+    if( n != 2*m ) return false;
+
+    const unsigned int * ghosts = cache.section<unsigned int>(FVMNodeGhosts, m);
+    offset = cache.section<unsigned int>(FVMNodeGhostOffset, n);
+    if( m%2 || !valid_offsets(offset, n, n_fvm_nodes, m/2) ) return false;
+    for(unsigned int i=0; i<m; i+=2)
+      if( ghosts[i] != invalid_uint && ghosts[i] >= n_fvm_nodes ) return false;
+    cache.section<Real>(FVMNodeGhostArea, n);
+    if( n != m/2 ) return false;
+
+    const unsigned int * edges = cache.section<unsigned int>(RegionEdges, m);
+    const unsigned int * edge_offset = cache.section<unsigned int>(RegionEdgeOffset, n);
+    if( m%2 || !valid_offsets(edge_offset, n, n_regions, m/2) ) return false;
+    for(unsigned int i=0; i<m; ++i)
+      if( edges[i] >= n_fvm_nodes ) return false;
+
+    // region cells are all the elems of the subdomain in serial
+    std::vector<unsigned int> region_cell_edges(n_regions+1, 0);
+    for(unsigned int i=0; i<n_elem; ++i)
+      region_cell_edges[mesh.elem(i)->subdomain_id()+1] += mesh.elem(i)->n_edges();
+    std::partial_sum(region_cell_edges.begin(), region_cell_edges.end(), region_cell_edges.begin());
+
+    const unsigned int * cell_edges = cache.section<unsigned int>(RegionCellEdges, m);
+    offset = cache.section<unsigned int>(RegionCellEdgeOffset, n);
+    if( !valid_offsets(offset, n, n_regions, m) ) return false;
+    for(unsigned int r=0; r<n_regions; ++r)
+    {
+      if( offset[r+1] != region_cell_edges[r+1] ) return false;
+      for(unsigned int i=offset[r]; i<offset[r+1]; ++i)
+        if( cell_edges[i] >= edge_offset[r+1] - edge_offset[r] ) return false;
+    }
+
+    return true;
+  }
+
+  // order of FVM_Node in the mesh cache
+  struct FVMNodeCacheLess
+  {
+    bool operator()(const FVM_Node * a, const FVM_Node * b) const
+    {
+      if( a->root_node()->id() != b->root_node()->id() )
+        return a->root_node()->id() < b->root_node()->id();
+      return a->subdomain_id() < b->subdomain_id();
+    }
+  };
+
+  // append the prepared simulation structure to the new mesh cache entry
+  void add_fvm_cache_sections(MeshCache & cache, const MeshBase & mesh, std::vector<FVM_Node *> & fvm_nodes,
+                              const std::vector<SimulationRegion *> & regions)
+  {
+    std::sort(fvm_nodes.begin(), fvm_nodes.end(), FVMNodeCacheLess());
+    std::map<const FVM_Node *, unsigned int> fvm_node_index;
+    for(unsigned int i=0; i<fvm_nodes.size(); ++i)
+      fvm_node_index.insert( std::make_pair(fvm_nodes[i], i) );
+
+    std::vector<unsigned int> geometry_offset(1, 0);
+    std::vector<Real> geometry;
+    for(unsigned int i=0; i<mesh.n_elem(); ++i)
+    {
+      const Elem * elem = mesh.elem(i);
+      if( elem->n_fvm_geometry() )
+      {
+        geometry.resize(geometry.size() + elem->n_fvm_geometry());
+        elem->pack_fvm_geometry(&geometry[geometry_offset.back()]);
+      }
+      geometry_offset.push_back(geometry.size());
+    }
+
+    std::vector<unsigned int> info, elem_offset(1, 0), elems, neighbor_offset(1, 0), neighbors, ghost_offset(1, 0), ghosts;
+    std::vector<Real> real, neighbor_area, ghost_area;
+    for(unsigned int i=0; i<fvm_nodes.size(); ++i)
+    {
+      const FVM_Node * fvm_node = fvm_nodes[i];
+      info.push_back(fvm_node->root_node()->id());
+      info.push_back(fvm_node->subdomain_id());
+      real.push_back(fvm_node->volume());
+      for(unsigned int d=0; d<3; ++d)
+        real.push_back(fvm_node->norm()(d));
+
+      for(FVM_Node::fvm_element_iterator it = fvm_node->elem_begin(); it != fvm_node->elem_end(); ++it)
+      {
+        elems.push_back(it->first->id());
+        elems.push_back(it->second);
+      }
+      elem_offset.push_back(elems.size()/2);
+
+      for(FVM_Node::fvm_neighbor_node_iterator it = fvm_node->neighbor_node_begin(); it != fvm_node->neighbor_node_end(); ++it)
+      {
+        neighbors.push_back(fvm_node_index.find(it->first)->second);
+        neighbor_area.push_back(it->second.first);
+        neighbor_area.push_back(it->second.second);
+      }
+      neighbor_offset.push_back(neighbors.size());
+
+      for(FVM_Node::fvm_ghost_node_iterator it = fvm_node->ghost_node_begin(); it != fvm_node->ghost_node_end(); ++it)
+      {
+        ghosts.push_back(it->first ? fvm_node_index.find(it->first)->second : invalid_uint);
+        ghosts.push_back(it->second.first);
+        ghost_area.push_back(it->second.second);
+      }
+      ghost_offset.push_back(ghosts.size()/2);
+    }
+
+    std::vector<unsigned int> edge_offset(1, 0), edges, cell_edge_offset(1, 0), cell_edges;
+    for(unsigned int r=0; r<regions.size(); ++r)
+    {
+      const SimulationRegion * region = regions[r];
+      SimulationRegion::const_edge_iterator edge_it = region->edges_begin();
+      for(; edge_it != region->edges_end(); ++edge_it)
+      {
+        edges.push_back(fvm_node_index.find(edge_it->first)->second);
+        edges.push_back(fvm_node_index.find(edge_it->second)->second);
+      }
+      edge_offset.push_back(edges.size()/2);
+
+      SimulationRegion::const_element_iterator elem_it = region->elements_begin();
+      for(; elem_it != region->elements_end(); ++elem_it)
+        for(unsigned int e=0; e<(*elem_it)->n_edges(); ++e)
+          cell_edges.push_back(region->elem_edge_index(*elem_it, e));
+      cell_edge_offset.push_back(cell_edges.size());
+    }
+
+    cache.add_section(geometry_offset);
+    cache.add_section(geometry);
+    cache.add_section(info);
+    cache.add_section(real);
+    cache.add_section(elem_offset);
+    cache.add_section(elems);
+    cache.add_section(neighbor_offset);
+    cache.add_section(neighbors);
+    cache.add_section(neighbor_area);
+    cache.add_section(ghost_offset);
+    cache.add_section(ghosts);
+    cache.add_section(ghost_area);
+    cache.add_section(edge_offset);
+    cache.add_section(edges);
+    cache.add_section(cell_edge_offset);
+    cache.add_section(cell_edges);
+  }
+
+}
+
+
+
+void SimulationSystem::build_region_fvm_mesh(bool incremental)
 {
   START_LOG("build_region_fvm_mesh()", "SimulationSystem");
 
   MESSAGE<<"Building simulation data structure on all processors..."<<std::endl;  RECORD();
 
+  // mesh is broadcast (and rebuilt) on other processors, incremental build only works in serial
+  if( Genius::n_processors() > 1 ) incremental = false;
+
+  // the mesh cache entry stays mapped during the build.
+  // the prepared simulation structure is cached in serial, when all the elems are local
+  AutoPtr<MeshCache> cache;
+  bool fvm_cache_hit  = false;
+  bool fvm_cache_save = false;
+
   // we should convert initial mesh elements to FVM element
   // NOTE: for parallel situation, only local elements are converted for saving memory
   // the mesh is prepared after the function call all_fvm_elem ()
@@ -400,14 +646,41 @@ void SimulationSystem::build_region_fvm_mesh()
     mesh.count_mesh_dimension();
     mesh.build_mesh_bounding_box();
 
-    // this function will renumber the the node/elem
-    mesh.all_first_order();
+    if(incremental)
+    {
+      // mesh is already first order and ordered by previous build,
+      // only update the neighbors around refined/coarsened elements
+      mesh.find_neighbors_incremental();
+    }
+    else
+    {
+      // this function will renumber the the node/elem
+      mesh.all_first_order();
+
+      // the neighbors and elem/node order only depend on the mesh, and the prepared
+      // structure on the build options as well. reuse them when the same mesh was prepared before
+      const unsigned int options = (_cylindrical_mesh ? 1 : 0) | (static_cast<unsigned int>(_node_order) << 1);
+      cache = AutoPtr<MeshCache>(new MeshCache(mesh, _mesh_cache_dir, options));
+      const bool hit = cache->load();
+      if( !hit )
+      {
+        // let all the elements find their neighbors
+        mesh.find_neighbors();
 
-    // let all the elements find their neighbors
-    mesh.find_neighbors();
+        // reorder the elem/node index by Reverse Cuthill-McKee Algorithm
+        mesh.reorder_elems();
+      }
 
-    // reorder the elem/node index by Reverse Cuthill-McKee Algorithm
-    mesh.reorder_elems();
+      const bool serial = Genius::n_processors() == 1;
+      fvm_cache_hit = hit && serial && valid_fvm_cache(*cache, mesh);
+      if( cache->enabled() && (!hit || (serial && !fvm_cache_hit)) )
+      {
+        cache->add_topology();
+        // the entry is completed after the simulation regions are prepared
+        fvm_cache_save = serial;
+        if( !fvm_cache_save ) cache->save();
+      }
+    }
     MESSAGE<<std::endl;  RECORD();
 
 
@@ -439,7 +712,7 @@ void SimulationSystem::build_region_fvm_mesh()
     if(_cylindrical_mesh)
     {
       std::string error;
-      if( mesh.convert_to_cylindrical_fvm_mesh (error) == false )
+      if( mesh.convert_to_cylindrical_fvm_mesh (error, incremental, !fvm_cache_hit) == false )
       {
         MESSAGE<<"  bad mesh."<<std::endl;  RECORD();
         MESSAGE<<"  ERROR:" << error <<std::endl;  RECORD();
@@ -449,7 +722,7 @@ void SimulationSystem::build_region_fvm_mesh()
     else
     {
       std::string error;
-      if( mesh.convert_to_fvm_mesh (error) == false )
+      if( mesh.convert_to_fvm_mesh (error, incremental, !fvm_cache_hit) == false )
       {
         MESSAGE<<"  bad mesh."<<std::endl;  RECORD();
         MESSAGE<<"  ERROR:" << error <<std::endl;  RECORD();
@@ -457,6 +730,23 @@ void SimulationSystem::build_region_fvm_mesh()
       }
     }
 
+    // FVM geometry of the elems from the cache
+    if( fvm_cache_hit )
+    {
+      unsigned int n;
+      const unsigned int * offset = cache->section<unsigned int>(ElemGeometryOffset, n);
+      const Real * geometry = cache->section<Real>(ElemGeometry, n);
+      for(unsigned int i=0; i<_mesh.n_elem(); ++i)
+      {
+        Elem * elem = _mesh.elem(i);
+        if( !elem->n_fvm_geometry() ) continue;
+        if( offset[i+1] - offset[i] == elem->n_fvm_geometry() )
+          elem->unpack_fvm_geometry(geometry + offset[i]);
+        else
+          elem->prepare_for_fvm();
+      }
+    }
+
     //std::cout<<"FVM MESH " << _mesh.memory_usage()/(1024*1024)<<std::endl;
 
 
@@ -550,293 +840,351 @@ void SimulationSystem::build_region_fvm_mesh()
   // search in all the LOCAL element
   MeshBase::element_iterator       el  = _mesh.local_elements_begin();
   const MeshBase::element_iterator end = _mesh.local_elements_end();
-  for (; el != end; ++el)
-  {
-    Elem * elem = *el;
-    genius_assert(elem->on_local());
 
-    std::vector<FVM_Node *> elem_fvm_nodes(elem->n_nodes());
-    std::vector<FVM_Node *> global_elem_fvm_nodes(elem->n_nodes(), (FVM_Node *)0);
+  // FVM_Node restored from the mesh cache, by index
+  std::vector<FVM_Node *> cached_fvm_nodes;
 
-    for (unsigned int n=0; n<elem->n_nodes(); n++)
+  if( fvm_cache_hit )
+  {
+    unsigned int n;
+    const unsigned int * info = cache->section<unsigned int>(FVMNodeInfo, n);
+    cached_fvm_nodes.resize(n/2);
+    const Real * real = cache->section<Real>(FVMNodeReal, n);
+    for(unsigned int i=0; i<cached_fvm_nodes.size(); ++i)
     {
-      Node * node = elem->get_node(n);
-
-      // only set informations for local node
-      genius_assert( node->on_local() );
-
-      // create a fvm node from cell's node
-      FVM_Node *fvm_node = new FVM_Node( node );
-      genius_assert(fvm_node);
+      const Node * node = _mesh.node_ptr(info[2*i]);
+      FVM_Node * fvm_node = new FVM_Node( node );
+      fvm_node->set_subdomain_id( info[2*i+1] );
+      fvm_node->set_control_volume( real[4*i] );
+      fvm_node->set_norm( VectorValue<Real>(real[4*i+1], real[4*i+2], real[4*i+3]) );
+      cached_fvm_nodes[i] = fvm_node;
+      _node_to_fvm_node_map.insert( std::make_pair(node, fvm_node) );
+    }
 
-      // set the subdomain_id of fvm node the same as the element
-      fvm_node->set_subdomain_id( elem->subdomain_id () );
+    const unsigned int * elem_offset     = cache->section<unsigned int>(FVMNodeElemOffset, n);
+    const unsigned int * node_elems      = cache->section<unsigned int>(FVMNodeElems, n);
+    const unsigned int * neighbor_offset = cache->section<unsigned int>(FVMNodeNeighborOffset, n);
+    const unsigned int * neighbors       = cache->section<unsigned int>(FVMNodeNeighbors, n);
+    const Real *         neighbor_area   = cache->section<Real>(FVMNodeNeighborArea, n);
+    const unsigned int * ghost_offset    = cache->section<unsigned int>(FVMNodeGhostOffset, n);
+    const unsigned int * ghosts          = cache->section<unsigned int>(FVMNodeGhosts, n);
+    const Real *         ghost_area      = cache->section<Real>(FVMNodeGhostArea, n);
+    for(unsigned int i=0; i<cached_fvm_nodes.size(); ++i)
+    {
+      FVM_Node * fvm_node = cached_fvm_nodes[i];
 
-      // the fvm node belongs to which cell, also record the local index of the root node
-      fvm_node->add_elem_it_belongs(elem, n) ;
+      for(unsigned int k=elem_offset[i]; k<elem_offset[i+1]; ++k)
+      {
+        Elem * elem = _mesh.elem(node_elems[2*k]);
+        fvm_node->add_elem_it_belongs(elem, node_elems[2*k+1]);
+        elem->hold_fvm_node(node_elems[2*k+1], fvm_node);
+      }
 
-      // set the partial volume associated with this node
-      // only on_local FVM elements own non-zero value!
-      fvm_node->set_control_volume( elem->partial_volume_truncated(n) );
+      // the surface areas are saved after they were fixed by prepare_for_use
+      for(unsigned int k=neighbor_offset[i]; k<neighbor_offset[i+1]; ++k)
+        fvm_node->append_fvm_node_neighbor(cached_fvm_nodes[neighbors[k]], neighbor_area[2*k], neighbor_area[2*k+1]);
 
-      // buffer for later use
-      elem_fvm_nodes[n] = fvm_node;
-      // if this node already has a FVM_Node
-      std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range(node);
-      while (pos.first != pos.second)
+      // ghost nodes, and the boundary area as the ghost node of NULL
+      for(unsigned int k=ghost_offset[i]; k<ghost_offset[i+1]; ++k)
       {
-        FVM_Node *  fvm_current = (*pos.first).second;
-        if ( fvm_current->subdomain_id () == fvm_node->subdomain_id () )
-        {
-          global_elem_fvm_nodes[n] = fvm_current;
-          break;
-        }
-        ++pos.first;
+        FVM_Node * ghost = ghosts[2*k] == invalid_uint ? (FVM_Node *)NULL : cached_fvm_nodes[ghosts[2*k]];
+        fvm_node->set_ghost_node(ghost, ghosts[2*k+1], ghost_area[k]);
       }
     }
-
-    // process FVM_Node neighbor information
-    for (unsigned int e=0; e<elem->n_edges(); e++)
+  }
+  else
+  {
+    for (; el != end; ++el)
     {
-      //elem edges
-      std::pair<unsigned int, unsigned int> edge_nodes;
-      elem->nodes_on_edge(e, edge_nodes);
+      Elem * elem = *el;
+      genius_assert(elem->on_local());
+
+      std::vector<FVM_Node *> elem_fvm_nodes(elem->n_nodes());
+      std::vector<FVM_Node *> global_elem_fvm_nodes(elem->n_nodes(), (FVM_Node *)0);
 
-      // surface area associated with this edge
-      Real surface_area = elem->partial_area_with_edge(e);
+      for (unsigned int n=0; n<elem->n_nodes(); n++)
+      {
+        Node * node = elem->get_node(n);
 
-      FVM_Node * fvm_node1  = elem_fvm_nodes[edge_nodes.first];
-      FVM_Node * fvm_node1g = global_elem_fvm_nodes[edge_nodes.first];
-      FVM_Node * fvm_node2  = elem_fvm_nodes[edge_nodes.second];
-      FVM_Node * fvm_node2g = global_elem_fvm_nodes[edge_nodes.second];
+        // only set informations for local node
+        genius_assert( node->on_local() );
 
-      fvm_node1->add_fvm_node_neighbor(fvm_node2g ? fvm_node2g : fvm_node2, surface_area);
-      fvm_node2->add_fvm_node_neighbor(fvm_node1g ? fvm_node1g : fvm_node1, surface_area);
-    }
+        // create a fvm node from cell's node
+        FVM_Node *fvm_node = new FVM_Node( node );
+        genius_assert(fvm_node);
 
-    // at last, we insert this FVM Node into
-    // std::multimap<const Node * , FVM_Node *> _node_to_fvm_node_map;
-    for (unsigned int n=0; n<elem->n_nodes(); n++)
-    {
-      FVM_Node * fvm_node   = elem_fvm_nodes[n];
-      FVM_Node * fvm_node_g = global_elem_fvm_nodes[n];
+        // set the subdomain_id of fvm node the same as the element
+        fvm_node->set_subdomain_id( elem->subdomain_id () );
+
+        // the fvm node belongs to which cell, also record the local index of the root node
+        fvm_node->add_elem_it_belongs(elem, n) ;
+
+        // set the partial volume associated with this node
+        // only on_local FVM elements own non-zero value!
+        fvm_node->set_control_volume( elem->partial_volume_truncated(n) );
+
+        // buffer for later use
+        elem_fvm_nodes[n] = fvm_node;
+        // if this node already has a FVM_Node
+        std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range(node);
+        while (pos.first != pos.second)
+        {
+          FVM_Node *  fvm_current = (*pos.first).second;
+          if ( fvm_current->subdomain_id () == fvm_node->subdomain_id () )
+          {
+            global_elem_fvm_nodes[n] = fvm_current;
+            break;
+          }
+          ++pos.first;
+        }
+      }
 
-      if(fvm_node_g)
+      // process FVM_Node neighbor information
+      for (unsigned int e=0; e<elem->n_edges(); e++)
       {
-        *fvm_node_g +=  *fvm_node;
-        delete fvm_node;
-        fvm_node = fvm_node_g;
+        //elem edges
+        std::pair<unsigned int, unsigned int> edge_nodes;
+        elem->nodes_on_edge(e, edge_nodes);
+
+        // surface area associated with this edge
+        Real surface_area = elem->partial_area_with_edge(e);
+
+        FVM_Node * fvm_node1  = elem_fvm_nodes[edge_nodes.first];
+        FVM_Node * fvm_node1g = global_elem_fvm_nodes[edge_nodes.first];
+        FVM_Node * fvm_node2  = elem_fvm_nodes[edge_nodes.second];
+        FVM_Node * fvm_node2g = global_elem_fvm_nodes[edge_nodes.second];
+
+        fvm_node1->add_fvm_node_neighbor(fvm_node2g ? fvm_node2g : fvm_node2, surface_area);
+        fvm_node2->add_fvm_node_neighbor(fvm_node1g ? fvm_node1g : fvm_node1, surface_area);
       }
-      else
+
+      // at last, we insert this FVM Node into
+      // std::multimap<const Node * , FVM_Node *> _node_to_fvm_node_map;
+      for (unsigned int n=0; n<elem->n_nodes(); n++)
       {
-        _node_to_fvm_node_map.insert( std::make_pair(elem->get_node(n), fvm_node) );
+        FVM_Node * fvm_node   = elem_fvm_nodes[n];
+        FVM_Node * fvm_node_g = global_elem_fvm_nodes[n];
+
+        if(fvm_node_g)
+        {
+          *fvm_node_g +=  *fvm_node;
+          delete fvm_node;
+          fvm_node = fvm_node_g;
+        }
+        else
+        {
+          _node_to_fvm_node_map.insert( std::make_pair(elem->get_node(n), fvm_node) );
+        }
+
+        elem->hold_fvm_node( n, fvm_node );
       }
 
-      elem->hold_fvm_node( n, fvm_node );
     }
 
-  }
-
 
 
 
 
 
-  // prepare ghost node information
-  {
-    Iter it_fvm_end = _node_to_fvm_node_map.end();
-    for(Iter  it_fvm = _node_to_fvm_node_map.begin(); it_fvm != it_fvm_end; ++it_fvm )
+    // prepare ghost node information
     {
-      // skip nonlocal fvm_node
-      if( !it_fvm->second->on_local() ) continue;
+      Iter it_fvm_end = _node_to_fvm_node_map.end();
+      for(Iter  it_fvm = _node_to_fvm_node_map.begin(); it_fvm != it_fvm_end; ++it_fvm )
+      {
+        // skip nonlocal fvm_node
+        if( !it_fvm->second->on_local() ) continue;
 
-      // the FVM Nodes with same root node. they will be ghost nodes in different region
-      std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range( it_fvm->first );
+        // the FVM Nodes with same root node. they will be ghost nodes in different region
+        std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range( it_fvm->first );
 
-      // insert them into ghost node map. The interface area is set to 0.0 here, will be changed later.
-      while (pos.first != pos.second)
-      {
-        if ( pos.first != it_fvm )
-         it_fvm->second->set_ghost_node( (*pos.first).second, (*pos.first).second->subdomain_id (), 0.0 );
+        // insert them into ghost node map. The interface area is set to 0.0 here, will be changed later.
+        while (pos.first != pos.second)
+        {
+          if ( pos.first != it_fvm )
+           it_fvm->second->set_ghost_node( (*pos.first).second, (*pos.first).second->subdomain_id (), 0.0 );
 
-        ++pos.first;
+          ++pos.first;
+        }
       }
     }
   }
 
-
   MESSAGE<<std::endl;  RECORD();
   STOP_LOG("build_region_fvm_mesh(3)", "SimulationSystem");
 
 
-  START_LOG("build_region_fvm_mesh(4)", "SimulationSystem");
-  MESSAGE<<"  Building boundary cells...";  RECORD();
-  // we scan boundary face to find the area of interface side
-  // NOTE here we should use side list of active elements!
-  std::vector<unsigned int>       elems;
-  std::vector<unsigned short int> sides;
-  std::vector<short int>          bds;
-  _mesh.boundary_info->build_active_side_list (elems, sides, bds);
-
+  // boundary area and norm are restored with FVM_Node from the cache
+  if( !fvm_cache_hit )
   {
-    typedef const Node *                    key_type;
-    typedef std::pair<unsigned int, Real>   val_type;
-    typedef std::pair<key_type, val_type>   key_val_pair;
+    START_LOG("build_region_fvm_mesh(4)", "SimulationSystem");
+    MESSAGE<<"  Building boundary cells...";  RECORD();
+    // we scan boundary face to find the area of interface side
+    // NOTE here we should use side list of active elements!
+    std::vector<unsigned int>       elems;
+    std::vector<unsigned short int> sides;
+    std::vector<short int>          bds;
+    _mesh.boundary_info->build_active_side_list (elems, sides, bds);
 
-#if defined(HAVE_UNORDERED_MAP)
-    typedef std::unordered_multimap<key_type, val_type> map_type;
-#elif defined(HAVE_TR1_UNORDERED_MAP) || defined(HAVE_TR1_UNORDERED_MAP_WITH_STD_HEADER)
-    typedef std::tr1::unordered_multimap<key_type, val_type> map_type;
-#else
-    typedef std::multimap<key_type, val_type>  map_type;
-#endif
-
-    // map <node , pair<subdomain_id, boundary_area> >
-    map_type bd_area_map;
-    typedef map_type::iterator Bda_It;
-
-    for (size_t nbd=0; nbd<elems.size(); nbd++ )
     {
-      // get the element which has boundary/interface side
-      const Elem* elem = _mesh.elem(elems[nbd]);
-      if( !elem || !elem->on_local() ) continue;
-
-      // get the side
-      AutoPtr<Elem> side (elem->build_side(sides[nbd]));
+      typedef const Node *                    key_type;
+      typedef std::pair<unsigned int, Real>   val_type;
+      typedef std::pair<key_type, val_type>   key_val_pair;
+
+  #if defined(HAVE_UNORDERED_MAP)
+      typedef std::unordered_multimap<key_type, val_type> map_type;
+  #elif defined(HAVE_TR1_UNORDERED_MAP) || defined(HAVE_TR1_UNORDERED_MAP_WITH_STD_HEADER)
+      typedef std::tr1::unordered_multimap<key_type, val_type> map_type;
+  #else
+      typedef std::multimap<key_type, val_type>  map_type;
+  #endif
+
+      // map <node , pair<subdomain_id, boundary_area> >
+      map_type bd_area_map;
+      typedef map_type::iterator Bda_It;
+
+      for (size_t nbd=0; nbd<elems.size(); nbd++ )
+      {
+        // get the element which has boundary/interface side
+        const Elem* elem = _mesh.elem(elems[nbd]);
+        if( !elem || !elem->on_local() ) continue;
 
-      // build corresponding FVM elem of the side
-      AutoPtr<Elem> fvm_side = Elem::build (Elem::fvm_compatible_type(side->type()), side->parent());
+        // get the side
+        AutoPtr<Elem> side (elem->build_side(sides[nbd]));
 
-      for (unsigned int v=0; v < side->n_vertices(); v++)
-        fvm_side->set_node(v) = side->get_node(v);
+        // build corresponding FVM elem of the side
+        AutoPtr<Elem> fvm_side = Elem::build (Elem::fvm_compatible_type(side->type()), side->parent());
 
-      fvm_side->prepare_for_fvm();
+        for (unsigned int v=0; v < side->n_vertices(); v++)
+          fvm_side->set_node(v) = side->get_node(v);
 
-      for (unsigned int v=0; v < fvm_side->n_vertices(); v++)
-      {
-        const Node * node = fvm_side->get_node(v);
-        if( !node->on_local() ) continue;
+        fvm_side->prepare_for_fvm();
 
-        // if we can find this node exists in bd_area_map
-        if ( bd_area_map.find(node) != bd_area_map.end() )
+        for (unsigned int v=0; v < fvm_side->n_vertices(); v++)
         {
+          const Node * node = fvm_side->get_node(v);
+          if( !node->on_local() ) continue;
 
-          std::pair<Bda_It, Bda_It> pos = bd_area_map.equal_range(node);
-
-          //if Node has same subdomain_id as the element. assign area to this node
-          while (pos.first != pos.second)
+          // if we can find this node exists in bd_area_map
+          if ( bd_area_map.find(node) != bd_area_map.end() )
           {
-            if ( (*pos.first).second.first == elem->subdomain_id() )
+
+            std::pair<Bda_It, Bda_It> pos = bd_area_map.equal_range(node);
+
+            //if Node has same subdomain_id as the element. assign area to this node
+            while (pos.first != pos.second)
             {
-              (*pos.first).second.second +=  fvm_side->partial_volume_truncated(v);
-              break;
+              if ( (*pos.first).second.first == elem->subdomain_id() )
+              {
+                (*pos.first).second.second +=  fvm_side->partial_volume_truncated(v);
+                break;
+              }
+              ++pos.first;
             }
-            ++pos.first;
-          }
-          // not find? insert a new Node
-          if (pos.first == pos.second)
-            bd_area_map.insert(pos.first, std::make_pair(node, std::make_pair(elem->subdomain_id(), fvm_side->partial_volume_truncated(v))));
+            // not find? insert a new Node
+            if (pos.first == pos.second)
+              bd_area_map.insert(pos.first, std::make_pair(node, std::make_pair(elem->subdomain_id(), fvm_side->partial_volume_truncated(v))));
 
+          }
+          else // not find? insert a new Node
+          {
+            bd_area_map.insert(std::make_pair(node, std::make_pair(elem->subdomain_id(), fvm_side->partial_volume_truncated(v))));
+          }
         }
-        else // not find? insert a new Node
-        {
-          bd_area_map.insert(std::make_pair(node, std::make_pair(elem->subdomain_id(), fvm_side->partial_volume_truncated(v))));
-        }
-      }
 
-    }
+      }
 
 
-    // set FVM interface area
-    Bda_It it_bd = bd_area_map.begin();
-    Bda_It it_bd_end = bd_area_map.end();
-    for( ; it_bd != it_bd_end; ++it_bd )
-    {
-      // the FVM Nodes with same root node. they may be ghost nodes in different region
-      std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range( (*it_bd).first );
+      // set FVM interface area
+      Bda_It it_bd = bd_area_map.begin();
+      Bda_It it_bd_end = bd_area_map.end();
+      for( ; it_bd != it_bd_end; ++it_bd )
+      {
+        // the FVM Nodes with same root node. they may be ghost nodes in different region
+        std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range( (*it_bd).first );
 
-      // skip nonlocal fvm_node
-      if(! (*pos.first).second->on_local() ) continue;
+        // skip nonlocal fvm_node
+        if(! (*pos.first).second->on_local() ) continue;
 
-      // insert them into ghost node map.
-      while (pos.first != pos.second)
-      {
-        // set ghost node with the same subdomain id as boundary node
-        (*pos.first).second->set_ghost_node_area( (*it_bd).second.first, (*it_bd).second.second );
+        // insert them into ghost node map.
+        while (pos.first != pos.second)
+        {
+          // set ghost node with the same subdomain id as boundary node
+          (*pos.first).second->set_ghost_node_area( (*it_bd).second.first, (*it_bd).second.second );
 
-        ++pos.first;
+          ++pos.first;
+        }
       }
     }
-  }
-  MESSAGE<<std::endl;  RECORD();
-  STOP_LOG("build_region_fvm_mesh(4)", "SimulationSystem");
+    MESSAGE<<std::endl;  RECORD();
+    STOP_LOG("build_region_fvm_mesh(4)", "SimulationSystem");
 
 
-  START_LOG("build_region_fvm_mesh(5)", "SimulationSystem");
-  MESSAGE<<"  Building norm vector for each interface...";  RECORD();
-  // build norm vector of interface
-  {
-    std::multimap<const Node * , std::pair<unsigned int, VectorValue<Real> > > bd_norm_map;
-    typedef std::multimap<const Node * , std::pair<unsigned int, VectorValue<Real> > >::iterator Bdn_It;
-    for (size_t nbd=0; nbd<elems.size(); nbd++ )
+    START_LOG("build_region_fvm_mesh(5)", "SimulationSystem");
+    MESSAGE<<"  Building norm vector for each interface...";  RECORD();
+    // build norm vector of interface
     {
-      // get the element which has boundary/interface side
-      const Elem* elem = _mesh.elem(elems[nbd]);
+      std::multimap<const Node * , std::pair<unsigned int, VectorValue<Real> > > bd_norm_map;
+      typedef std::multimap<const Node * , std::pair<unsigned int, VectorValue<Real> > >::iterator Bdn_It;
+      for (size_t nbd=0; nbd<elems.size(); nbd++ )
+      {
+        // get the element which has boundary/interface side
+        const Elem* elem = _mesh.elem(elems[nbd]);
 
-      if(!elem || !elem->on_local()) continue;
+        if(!elem || !elem->on_local()) continue;
 
-      // the vector norm to boundary/interface
-      VectorValue<Real> norm = elem->outside_unit_normal(sides[nbd]);
+        // the vector norm to boundary/interface
+        VectorValue<Real> norm = elem->outside_unit_normal(sides[nbd]);
 
-      // get the side
-      AutoPtr<Elem> side (elem->build_side(sides[nbd]));
-      for (unsigned int v=0; v < side->n_vertices(); v++)
-      {
-        const Node * node = side->get_node(v);
-        bd_norm_map.insert(std::make_pair(node, std::make_pair(elem->subdomain_id(), norm)));
+        // get the side
+        AutoPtr<Elem> side (elem->build_side(sides[nbd]));
+        for (unsigned int v=0; v < side->n_vertices(); v++)
+        {
+          const Node * node = side->get_node(v);
+          bd_norm_map.insert(std::make_pair(node, std::make_pair(elem->subdomain_id(), norm)));
+        }
       }
-    }
 
-    // classify norm vector to each FVM_Node
-    std::map<FVM_Node *, std::vector<VectorValue<Real> > > fvm_norm_vectors;
-    Bdn_It it_bd = bd_norm_map.begin();
-    for( ; it_bd != bd_norm_map.end(); ++it_bd )
-    {
-      const Node * node = (*it_bd).first;
-      unsigned int sub_id = (*it_bd).second.first;
+      // classify norm vector to each FVM_Node
+      std::map<FVM_Node *, std::vector<VectorValue<Real> > > fvm_norm_vectors;
+      Bdn_It it_bd = bd_norm_map.begin();
+      for( ; it_bd != bd_norm_map.end(); ++it_bd )
+      {
+        const Node * node = (*it_bd).first;
+        unsigned int sub_id = (*it_bd).second.first;
 
-      // the FVM Nodes with same root node. they may be ghost nodes in different region
-      std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range( node );
+        // the FVM Nodes with same root node. they may be ghost nodes in different region
+        std::pair<Iter, Iter> pos = _node_to_fvm_node_map.equal_range( node );
 
-      // skip fvm_node not on processor
-      if(! (*pos.first).second->on_processor() ) continue;
+        // skip fvm_node not on processor
+        if(! (*pos.first).second->on_processor() ) continue;
 
-      while (pos.first != pos.second)
-      {
-        FVM_Node * fvm_node = (*pos.first).second;
-        if( sub_id == fvm_node->subdomain_id() )
-          fvm_norm_vectors[fvm_node].push_back((*it_bd).second.second);
-        ++pos.first;
+        while (pos.first != pos.second)
+        {
+          FVM_Node * fvm_node = (*pos.first).second;
+          if( sub_id == fvm_node->subdomain_id() )
+            fvm_norm_vectors[fvm_node].push_back((*it_bd).second.second);
+          ++pos.first;
+        }
       }
-    }
 
-    // ok, save average norm vector to FVM_Node
-    std::map<FVM_Node *, std::vector<VectorValue<Real> > >::iterator it = fvm_norm_vectors.begin();
-    for(; it!=fvm_norm_vectors.end(); ++it)
-    {
-      const std::vector<VectorValue<Real> > & norms = it->second;
-      VectorValue<Real> norm;
-      for(unsigned int n=0; n<norms.size(); ++n)
+      // ok, save average norm vector to FVM_Node
+      std::map<FVM_Node *, std::vector<VectorValue<Real> > >::iterator it = fvm_norm_vectors.begin();
+      for(; it!=fvm_norm_vectors.end(); ++it)
       {
-        norm += norms[n];
+        const std::vector<VectorValue<Real> > & norms = it->second;
+        VectorValue<Real> norm;
+        for(unsigned int n=0; n<norms.size(); ++n)
+        {
+          norm += norms[n];
+        }
+        norm /= norms.size();
+        it->first->set_norm(norm.unit());
       }
-      norm /= norms.size();
-      it->first->set_norm(norm.unit());
     }
-  }
 
-  MESSAGE<<std::endl;  RECORD();
-  STOP_LOG("build_region_fvm_mesh(5)", "SimulationSystem");
+    MESSAGE<<std::endl;  RECORD();
+    STOP_LOG("build_region_fvm_mesh(5)", "SimulationSystem");
+  }
 
 
   START_LOG("build_region_fvm_mesh(6)", "SimulationSystem");
@@ -890,7 +1238,19 @@ void SimulationSystem::build_region_fvm_mesh()
   // ask all the regions to do some pre process
   for(unsigned int n = 0; n < this->n_regions(); n++)
   {
-    _simulation_regions[n]->prepare_for_use();
+    _simulation_regions[n]->set_node_order(_node_order);
+    if( fvm_cache_hit )
+    {
+      unsigned int m;
+      const unsigned int * edge_offset = cache->section<unsigned int>(RegionEdgeOffset, m);
+      const unsigned int * edges = cache->section<unsigned int>(RegionEdges, m);
+      const unsigned int * cell_edge_offset = cache->section<unsigned int>(RegionCellEdgeOffset, m);
+      const unsigned int * cell_edges = cache->section<unsigned int>(RegionCellEdges, m);
+      _simulation_regions[n]->restore_for_use(cached_fvm_nodes, edges + 2*edge_offset[n],
+                                              edge_offset[n+1] - edge_offset[n], cell_edges + cell_edge_offset[n]);
+    }
+    else
+      _simulation_regions[n]->prepare_for_use();
   }
   // pre process should be executed in parallel
   for(unsigned int n = 0; n < this->n_regions(); n++)
@@ -898,6 +1258,17 @@ void SimulationSystem::build_region_fvm_mesh()
     _simulation_regions[n]->prepare_for_use_parallel();
   }
 
+  if( fvm_cache_save )
+  {
+    std::vector<FVM_Node *> fvm_nodes;
+    fvm_nodes.reserve(_node_to_fvm_node_map.size());
+    Iter it_fvm_end = _node_to_fvm_node_map.end();
+    for(Iter it_fvm = _node_to_fvm_node_map.begin(); it_fvm != it_fvm_end; ++it_fvm )
+      fvm_nodes.push_back((*it_fvm).second);
+    add_fvm_cache_sections(*cache, _mesh, fvm_nodes, _simulation_regions);
+    cache->save();
+  }
+
   MESSAGE<<std::endl;  RECORD();
   STOP_LOG("build_region_fvm_mesh(6)", "SimulationSystem");
 
@@ -932,7 +1303,10 @@ void SimulationSystem::build_region_fvm_mesh()
   STOP_LOG("build_region_fvm_mesh(7)", "SimulationSystem");
 
 
-  MESSAGE<<"Simulation data structure build ok.\n"<<std::endl;  RECORD();
+  MESSAGE<<"Simulation data structure build ok."<<std::endl;  RECORD();
+  if(_memory_report)
+    memory_report();
+  MESSAGE<<std::endl;  RECORD();
 
 
   STOP_LOG("build_region_fvm_mesh()", "SimulationSystem");
@@ -1110,13 +1484,14 @@ void SimulationSystem::estimate_error (const Parser::Card &c, ErrorVector & erro
  */
 void SimulationSystem::fill_interpolator(InterpolationBase *interpolator,
     const std::string & variable_string,
-    InterpolationBase::InterpolationType type) const
+    InterpolationBase::InterpolationType type,
+    const std::string & group) const
 {
   SolutionVariable variable = solution_string_to_enum(FormatVariableString(variable_string));
   genius_assert(variable!=INVALID_Variable);
   genius_assert(variable_data_type(variable)==SCALAR);
 
-  int group_code = interpolator->set_group_code(variable_string);
+  int group_code = interpolator->set_group_code(group.empty() ? variable_string : group);
 
   std::map<unsigned int, double> value_map;
   for( unsigned int r=0; r<this->n_regions(); r++)
@@ -1150,7 +1525,7 @@ void SimulationSystem::fill_interpolator(InterpolationBase *interpolator,
   // fill the interpolator
   std::map<unsigned int, double>::const_iterator it = value_map.begin();
   for(; it != value_map.end(); ++it)
-    interpolator->add_scatter_data(_mesh.point(it->first), group_code, it->second);
+    interpolator->add_node_data(it->first, _mesh.point(it->first), group_code, it->second);
 
   interpolator->setup(group_code);
 }
@@ -1159,15 +1534,17 @@ void SimulationSystem::fill_interpolator(InterpolationBase *interpolator,
 /**
  * get data from interpolator after mesh refinement
  */
-void SimulationSystem::do_interpolation(const InterpolationBase * interpolator , const std::string & variable_string)
+void SimulationSystem::do_interpolation(const InterpolationBase * interpolator , const std::string & variable_string, const std::string & group)
 {
   SolutionVariable variable = solution_string_to_enum(FormatVariableString(variable_string));
   genius_assert(variable!=INVALID_Variable);
   genius_assert(variable_data_type(variable)==SCALAR);
 
-  int group_code = interpolator->group_code(variable_string);
+  int group_code = interpolator->group_code(group.empty() ? variable_string : group);
 
-  // fill gradient of var for all the cells in each region
+  // collect all the local nodes need the value, and interpolate them in one batch
+  std::vector<FVM_NodeData *> node_data_list;
+  std::vector<Point> points;
   for(unsigned int n=0; n<n_regions(); n++)
   {
     SimulationRegion * region = this->region(n);
@@ -1181,11 +1558,16 @@ void SimulationSystem::do_interpolation(const InterpolationBase * interpolator ,
       FVM_NodeData * node_data = fvm_node->node_data();
       if(node_data->is_variable_valid(variable))
       {
-        double value = interpolator->get_interpolated_value(*(fvm_node->root_node()), group_code);
-        node_data->set_variable_real(variable, value);
+        node_data_list.push_back(node_data);
+        points.push_back(*(fvm_node->root_node()));
       }
     }
   }
+
+  std::vector<double> values;
+  interpolator->get_interpolated_values(points, group_code, values);
+  for(unsigned int n=0; n<node_data_list.size(); n++)
+    node_data_list[n]->set_variable_real(variable, values[n]);
 }
 
 
@@ -1340,6 +1722,42 @@ size_t SimulationSystem::memory_size() const
 }
 
 
+void SimulationSystem::memory_report() const
+{
+  const double MB = 1024.0*1024.0;
+
+  double mesh_size   = _mesh.memory_size()/MB;
+  double system_size = this->memory_size()/MB;
+  double rss         = Genius::memory_size().second/MB;
+  Parallel::max(mesh_size);
+  Parallel::max(system_size);
+  Parallel::max(rss);
+
+  std::ostringstream report;
+  report << std::fixed << std::setprecision(1);
+  report << "Memory usage (max of processors): mesh " << mesh_size << " MB, regions "
+         << system_size << " MB, resident " << rss << " MB." << std::endl;
+
+  // the same pools in the same order on all the processors
+  std::vector<const ObjectPool *> pools;
+  pools.push_back(&Node::pool());
+  pools.push_back(&Elem::pool());
+  pools.push_back(&FVM_Node::pool());
+  for(unsigned int n=0; n<pools.size(); ++n)
+  {
+    double pool_size = pools[n]->memory_size()/MB;
+    double n_objects = pools[n]->n_objects();
+    Parallel::max(pool_size);
+    Parallel::max(n_objects);
+    report << "  " << pools[n]->name() << " arena: " << static_cast<size_t>(n_objects)
+           << " objects in " << pool_size << " MB." << std::endl;
+  }
+
+  MESSAGE<<report.str();
+  RECORD();
+}
+
+
 
 void SimulationSystem::export_vtk(const std::string& filename, bool ascii) const
 {
@@ -40,6 +40,7 @@
 #include "spice_ckt.h"
 #include "material.h"
 #include "solver_specify.h"
+#include "async_writer.h"
 
 #ifdef HAVE_VTK
 
@@ -92,6 +93,36 @@ public:
 private:
   std::string _header;
 };
+
+
+/**
+ * snapshot of a vtk grid, written by the I/O thread of AsyncWriter
+ */
+class VTKIO::VTKWriteJob : public AsyncWriter::Job
+{
+public:
+  VTKWriteJob(vtkUnstructuredGrid * grid, const std::string &header, const std::string &filename)
+    : _grid(grid), _header(header), _filename(filename)
+  {}
+
+  virtual ~VTKWriteJob()
+  { _grid->Delete(); }
+
+  virtual void write()
+  {
+    XMLUnstructuredGridWriter* writer = XMLUnstructuredGridWriter::New();
+    writer->SetInput(_grid);
+    writer->setExtraHeader(_header);
+    writer->SetFileName(_filename.c_str());
+    writer->Write();
+    writer->Delete();
+  }
+
+private:
+  vtkUnstructuredGrid * _grid;
+  std::string _header;
+  std::string _filename;
+};
 #endif
 
 // private functions
@@ -1907,7 +1938,14 @@ void VTKIO::write (const std::string& name)
 
 
     // only processor 0 write VTK file
-    if(Genius::processor_id() == 0)
+    if(Genius::processor_id() == 0 && _async_writer)
+    {
+      // the grid is a snapshot of current solution, hand it to the I/O thread, which also deletes it
+      _async_writer->submit(new VTKWriteJob(_vtk_grid, this->export_extra_info(), name));
+      _vtk_grid = NULL;
+    }
+
+    if(Genius::processor_id() == 0 && _vtk_grid)
     {
       XMLUnstructuredGridWriter* writer = XMLUnstructuredGridWriter::New();
       writer->SetInput(_vtk_grid);
@@ -1919,7 +1957,8 @@ void VTKIO::write (const std::string& name)
 
     }
     //clean up
-    _vtk_grid->Delete();
+    if(_vtk_grid) _vtk_grid->Delete();
+    _vtk_grid = NULL;
 #endif
 
   }
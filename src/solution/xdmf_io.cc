@@ -0,0 +1,409 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <iomanip>
+#include <sstream>
+
+#include "genius_common.h"
+#include "xdmf_io.h"
+#include "elem.h"
+#include "mesh_base.h"
+#include "boundary_info.h"
+#include "parallel.h"
+#include "simulation_system.h"
+#include "simulation_region.h"
+#include "boundary_condition_collector.h"
+
+using PhysicalUnit::um;
+
+
+namespace
+{
+  // the footer of index file
+  const char * xdmf_footer = "  </Grid>\n  </Domain>\n</Xdmf>\n";
+
+  // @return the size of file, 0 if it does not exist
+  unsigned long file_size(const std::string & file)
+  {
+    std::ifstream in(file.c_str(), std::ifstream::binary | std::ifstream::ate);
+    if(!in.good()) return 0;
+    return static_cast<unsigned long>(in.tellg());
+  }
+}
+
+
+XDMFIO::XDMFIO(const SimulationSystem & system, const std::string & prefix, bool single)
+  : _system(system), _prefix(prefix), _precision(single ? 4 : 8),
+    _n_nodes(0), _n_cells(0), _topology_size(0), _step_base(0), _field_offset(0), _footer_pos(0)
+{
+  const SolutionVariable candidates[] = { POTENTIAL, ELECTRON, HOLE, TEMPERATURE, E_TEMP, H_TEMP };
+  const char * names[] = { "potential", "electron", "hole", "temperature", "elec_temperature", "hole_temperature" };
+  for(unsigned int n=0; n<sizeof(candidates)/sizeof(SolutionVariable); ++n)
+  {
+    // export the variable if it is valid at any node
+    bool valid = false;
+    for( unsigned int r=0; r<_system.n_regions() && !valid; r++)
+    {
+      const SimulationRegion * region = _system.region(r);
+      SimulationRegion::const_processor_node_iterator node_it = region->on_processor_nodes_begin();
+      SimulationRegion::const_processor_node_iterator node_it_end = region->on_processor_nodes_end();
+      for(; node_it!=node_it_end && !valid; ++node_it)
+        valid = (*node_it)->node_data()->is_variable_valid(candidates[n]);
+    }
+    Parallel::max(valid);
+    if(valid)
+    {
+      _variables.push_back(candidates[n]);
+      _variable_names.push_back(names[n]);
+    }
+  }
+}
+
+
+XDMFIO::~XDMFIO()
+{
+  if(_field_out.is_open())
+    _field_out.close();
+  if(_index_out.is_open())
+    _index_out.close();
+}
+
+
+
+void XDMFIO::write_mesh(bool append)
+{
+  const MeshBase & mesh = _system.mesh();
+
+  std::vector<double> Na, Nd;
+  _gather_node_variable(DOPING_Na, Na);
+  _gather_node_variable(DOPING_Nd, Nd);
+
+  if(Genius::processor_id() != 0) return;
+
+  // continue the files only if the index file is valid
+  append = append && _resume_index();
+
+  std::string mesh_file = _prefix + ".mesh.bin";
+  unsigned long offset = append ? file_size(mesh_file) : 0;
+  std::ofstream out(mesh_file.c_str(), std::ofstream::binary | (append ? std::ofstream::app : std::ofstream::trunc));
+
+  // node location in um, always in double precision
+  _n_nodes = mesh.n_nodes();
+  std::vector<double> pts(3*_n_nodes);
+  for(unsigned int n=0; n<_n_nodes; ++n)
+  {
+    const Point & p = mesh.point(n);
+    pts[3*n+0] = p(0)/um;
+    pts[3*n+1] = p(1)/um;
+    pts[3*n+2] = p(2)/um;
+  }
+  _geometry = _write_block(out, offset, mesh_file, "geometry", pts, 8);
+
+  // mixed topology, each cell is written as xdmf cell type followed by its nodes
+  std::vector<int> topology;
+  std::vector<double> region;
+  MeshBase::const_element_iterator       elem_it  = mesh.active_elements_begin();
+  const MeshBase::const_element_iterator elem_it_end = mesh.active_elements_end();
+  for (; elem_it != elem_it_end; ++elem_it)
+  {
+    const Elem * elem = *elem_it;
+    switch(elem->type())
+    {
+        case EDGE2:
+        case EDGE2_FVM:
+        topology.push_back(2);  topology.push_back(2); break; // polyline with 2 nodes
+        case TRI3:
+        case TRI3_FVM:
+        case TRI3_CY_FVM:
+        topology.push_back(4);  break;
+        case QUAD4:
+        case QUAD4_FVM:
+        case QUAD4_CY_FVM:
+        topology.push_back(5);  break;
+        case TET4:
+        case TET4_FVM:
+        topology.push_back(6);  break;
+        case PYRAMID5:
+        case PYRAMID5_FVM:
+        topology.push_back(7);  break;
+        case PRISM6:
+        case PRISM6_FVM:
+        topology.push_back(8);  break;
+        case HEX8:
+        case HEX8_FVM:
+        topology.push_back(9);  break;
+        default:
+        {
+          std::cerr<<"element type "<<elem->type()<<" not implemented"<<std::endl;
+          genius_error();
+        }
+    }
+    for(unsigned int i=0; i<elem->n_nodes(); ++i)
+      topology.push_back(elem->node(i));
+    region.push_back(elem->subdomain_id());
+  }
+  _n_cells = region.size();
+  _topology_size = topology.size();
+  _cell_static.clear();
+  _node_static.clear();
+
+  _topology.name = "topology";
+  _topology.file = mesh_file;
+  _topology.offset = offset;
+  _topology.precision = 4;
+  out.write(reinterpret_cast<const char *>(&topology[0]), topology.size()*sizeof(int));
+  offset += topology.size()*sizeof(int);
+
+  _cell_static.push_back(_write_block(out, offset, mesh_file, "region", region, 4));
+
+  _node_static.push_back(_write_block(out, offset, mesh_file, "Na", Na, _precision));
+  _node_static.push_back(_write_block(out, offset, mesh_file, "Nd", Nd, _precision));
+
+  out.close();
+
+  // field file, truncate it unless we continue it
+  std::string field_file = _prefix + ".fields.bin";
+  _field_offset = append ? file_size(field_file) : 0;
+  _field_out.open(field_file.c_str(), std::ofstream::binary | (append ? std::ofstream::app : std::ofstream::trunc));
+
+  if(!append)
+    _write_index_header();
+}
+
+
+
+void XDMFIO::write_step(double time)
+{
+  std::vector< std::vector<double> > values(_variables.size());
+  for(unsigned int v=0; v<_variables.size(); ++v)
+    _gather_node_variable(_variables[v], values[v]);
+
+  if(Genius::processor_id() != 0) return;
+
+  std::string field_file = _prefix + ".fields.bin";
+
+  std::vector<DataBlock> blocks;
+  for(unsigned int v=0; v<_variables.size(); ++v)
+  {
+    blocks.push_back(_write_block(_field_out, _field_offset, field_file, _variable_names[v], values[v], _precision));
+  }
+  _field_out.flush();
+
+  _steps.push_back(std::make_pair(time, blocks));
+
+  _append_index_step(_steps.size()-1);
+}
+
+
+
+void XDMFIO::_gather_node_variable(SolutionVariable variable, std::vector<double> & values) const
+{
+  const double scale = variable_unit(variable);
+
+  std::vector<unsigned int> order;
+  std::vector<double> local;
+
+  for( unsigned int r=0; r<_system.n_regions(); r++)
+  {
+    const SimulationRegion * region = _system.region(r);
+    SimulationRegion::const_processor_node_iterator node_it = region->on_processor_nodes_begin();
+    SimulationRegion::const_processor_node_iterator node_it_end = region->on_processor_nodes_end();
+    for(; node_it!=node_it_end; ++node_it)
+    {
+      const FVM_Node * fvm_node = *node_it;
+      const FVM_NodeData * node_data = fvm_node->node_data();
+
+      // if the fvm_node lies on the interface of two material regions,
+      // we shall use the node data in the more important region.
+      if( fvm_node->boundary_id() != BoundaryInfo::invalid_id )
+      {
+        unsigned int bc_index = _system.get_bcs()->get_bc_index_by_bd_id(fvm_node->boundary_id());
+        const BoundaryCondition * bc = _system.get_bcs()->get_bc(bc_index);
+        const FVM_Node * primary_fvm_node = (*bc->region_node_begin(fvm_node->root_node())).second.second;
+        node_data = primary_fvm_node->node_data();
+      }
+
+      order.push_back(fvm_node->root_node()->id());
+      local.push_back(node_data->is_variable_valid(variable) ? node_data->get_variable_real(variable)/scale : 0.0);
+    }
+  }
+
+  Parallel::gather(0, order);
+  Parallel::gather(0, local);
+
+  if(Genius::processor_id() == 0)
+  {
+    values.assign(_system.mesh().n_nodes(), 0.0);
+    for(unsigned int n=0; n<order.size(); ++n)
+      values[order[n]] = local[n];
+  }
+}
+
+
+
+XDMFIO::DataBlock XDMFIO::_write_block(std::ofstream & out, unsigned long & offset, const std::string & file, const std::string & name,
+                                       const std::vector<double> & values, unsigned int precision)
+{
+  DataBlock block;
+  block.name = name;
+  block.file = file;
+  block.offset = offset;
+  block.precision = precision;
+
+  if(values.empty()) return block;
+
+  if(precision == 4)
+  {
+    std::vector<float> buffer(values.begin(), values.end());
+    out.write(reinterpret_cast<const char *>(&buffer[0]), buffer.size()*sizeof(float));
+    offset += buffer.size()*sizeof(float);
+  }
+  else
+  {
+    out.write(reinterpret_cast<const char *>(&values[0]), values.size()*sizeof(double));
+    offset += values.size()*sizeof(double);
+  }
+
+  return block;
+}
+
+
+
+void XDMFIO::_write_data_item(std::ofstream & out, const DataBlock & block, const std::string & dims, const std::string & type) const
+{
+  // the binary files are in the same directory as xmf file
+  std::string file = block.file;
+  if(file.rfind('/') < file.size())
+    file = file.substr(file.rfind('/')+1);
+
+  out << "        <DataItem Dimensions=\"" << dims << "\" NumberType=\"" << type << "\" Precision=\"" << block.precision
+      << "\" Format=\"Binary\" Endian=\"Native\" Seek=\"" << block.offset << "\">" << file << "</DataItem>\n";
+}
+
+
+
+void XDMFIO::_write_index_header()
+{
+  std::string xmf_file = _prefix + ".xmf";
+  _index_out.open(xmf_file.c_str(), std::ofstream::trunc);
+
+  _index_out << "<?xml version=\"1.0\" ?>\n";
+  _index_out << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n";
+  _index_out << "<Xdmf Version=\"2.0\">\n";
+  _index_out << "  <Domain>\n";
+  _index_out << "  <Grid Name=\"" << _prefix << "\" GridType=\"Collection\" CollectionType=\"Temporal\">\n";
+
+  _footer_pos = _index_out.tellp();
+  _write_index_footer();
+}
+
+
+
+bool XDMFIO::_resume_index()
+{
+  std::string xmf_file = _prefix + ".xmf";
+
+  std::string content;
+  {
+    std::ifstream in(xmf_file.c_str());
+    if(!in.good()) return false;
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    content = buffer.str();
+  }
+
+  const std::string footer(xdmf_footer);
+  if(content.size() < footer.size() || content.compare(content.size()-footer.size(), footer.size(), footer) != 0)
+    return false;
+
+  // count the steps written before
+  _step_base = 0;
+  for(std::string::size_type pos = content.find("GridType=\"Uniform\""); pos != std::string::npos;
+      pos = content.find("GridType=\"Uniform\"", pos+1))
+    _step_base++;
+
+  _index_out.open(xmf_file.c_str(), std::ofstream::in | std::ofstream::out);
+  _footer_pos = content.size() - footer.size();
+  return _index_out.good();
+}
+
+
+
+void XDMFIO::_write_index_footer()
+{
+  _index_out << xdmf_footer;
+  _index_out.flush();
+}
+
+
+
+void XDMFIO::_append_index_step(unsigned int s)
+{
+  std::ostringstream n_nodes, n_nodes_3, n_cells, topology_size;
+  n_nodes << _n_nodes;
+  n_nodes_3 << _n_nodes << " 3";
+  n_cells << _n_cells;
+  topology_size << _topology_size;
+
+  // overwrite the footer, the index file is valid again after the new footer is written
+  _index_out.seekp(_footer_pos);
+
+  std::ofstream & out = _index_out;
+  out << "    <Grid Name=\"step" << _step_base + s << "\" GridType=\"Uniform\">\n";
+  out << "      <Time Value=\"" << std::setprecision(12) << _steps[s].first << "\"/>\n";
+
+  out << "      <Topology TopologyType=\"Mixed\" NumberOfElements=\"" << _n_cells << "\">\n";
+  _write_data_item(out, _topology, topology_size.str(), "Int");
+  out << "      </Topology>\n";
+
+  out << "      <Geometry GeometryType=\"XYZ\">\n";
+  _write_data_item(out, _geometry, n_nodes_3.str(), "Float");
+  out << "      </Geometry>\n";
+
+  for(unsigned int n=0; n<_cell_static.size(); ++n)
+  {
+    out << "      <Attribute Name=\"" << _cell_static[n].name << "\" AttributeType=\"Scalar\" Center=\"Cell\">\n";
+    _write_data_item(out, _cell_static[n], n_cells.str(), "Float");
+    out << "      </Attribute>\n";
+  }
+
+  for(unsigned int n=0; n<_node_static.size(); ++n)
+  {
+    out << "      <Attribute Name=\"" << _node_static[n].name << "\" AttributeType=\"Scalar\" Center=\"Node\">\n";
+    _write_data_item(out, _node_static[n], n_nodes.str(), "Float");
+    out << "      </Attribute>\n";
+  }
+
+  const std::vector<DataBlock> & blocks = _steps[s].second;
+  for(unsigned int n=0; n<blocks.size(); ++n)
+  {
+    out << "      <Attribute Name=\"" << blocks[n].name << "\" AttributeType=\"Scalar\" Center=\"Node\">\n";
+    _write_data_item(out, blocks[n], n_nodes.str(), "Float");
+    out << "      </Attribute>\n";
+  }
+
+  out << "    </Grid>\n";
+
+  _footer_pos = _index_out.tellp();
+  _write_index_footer();
+}
+
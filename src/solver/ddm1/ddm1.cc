@@ -149,11 +149,7 @@ int DDM1Solver::solve()
 int DDM1Solver::post_solve_process()
 {
 
-  VecScatterBegin(scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-  VecScatterEnd  (scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-
-  PetscScalar *lxx;
-  VecGetArray(lx, &lxx);
+  PetscScalar *lxx = get_local_array(x, lx);
 
   //search for all the regions
   for(unsigned int n=0; n<_system.n_regions(); n++)
@@ -176,7 +172,7 @@ int DDM1Solver::post_solve_process()
     bc->DDM1_Post_Process();
   }
 
-  VecRestoreArray(lx, &lxx);
+  restore_local_array(x, lx, &lxx);
 
   return DDMSolverBase::post_solve_process();
 }
@@ -188,11 +184,7 @@ int DDM1Solver::post_solve_process()
  */
 void DDM1Solver::flush_system(Vec v)
 {
-  VecScatterBegin(scatter, v, lx, INSERT_VALUES, SCATTER_FORWARD);
-  VecScatterEnd  (scatter, v, lx, INSERT_VALUES, SCATTER_FORWARD);
-
-  PetscScalar *lxx;
-  VecGetArray(lx, &lxx);
+  PetscScalar *lxx = get_local_array(v, lx);
 
   //search for all the regions
   for(unsigned int n=0; n<_system.n_regions(); n++)
@@ -201,7 +193,7 @@ void DDM1Solver::flush_system(Vec v)
     region->DDM1_Update_Solution(lxx);
   }
 
-  VecRestoreArray(lx, &lxx);
+  restore_local_array(v, lx, &lxx);
 }
 
 
@@ -635,7 +627,9 @@ void DDM1Solver::error_norm()
   VecPointwiseMult(f, f, L);
 
 
-  VecGetArray(lx, &xx);  // solution value
+  // lx holds the solution of last function evaluation, which is x itself when local_is_global
+  Vec sx = local_is_global ? x : lx;
+  VecGetArray(sx, &xx);  // solution value
   VecGetArray(lf, &ff);  // function value
 
   // do clear
@@ -750,7 +744,7 @@ void DDM1Solver::error_norm()
   electrode_norm       = sqrt(norm_buffer[6]);
 
 
-  VecRestoreArray(lx, &xx);
+  VecRestoreArray(sx, &xx);
   VecRestoreArray(lf, &ff);
 
 }
@@ -760,8 +754,9 @@ void DDM1Solver::error_norm()
 bool DDM1Solver::pseudo_time_step_convergence_test()
 {
   PetscScalar *lxx;
-  // get PetscScalar array contains solution from local solution vector lx
-  VecGetArray(lx, &lxx);
+  // get PetscScalar array contains solution from local solution vector lx, or x itself when local_is_global
+  Vec sx = local_is_global ? x : lx;
+  VecGetArray(sx, &lxx);
 
   int unconverged_node = 0;
   for(unsigned int n=0; n<_system.n_regions(); n++)
@@ -773,7 +768,7 @@ bool DDM1Solver::pseudo_time_step_convergence_test()
   Parallel::sum(unconverged_node);
 
   // restore array back to Vec
-  VecRestoreArray(lx, &lxx);
+  VecRestoreArray(sx, &lxx);
 
   MESSAGE <<"------> Pseudo time step unconverged solution: " << unconverged_node << "\n\n\n";
   RECORD();
@@ -799,13 +794,8 @@ void DDM1Solver::build_petsc_sens_residual(Vec x, Vec r)
 
   START_LOG("DDM1Solver_Residual()", "DDM1Solver");
 
-  // scatte global solution vector x to local vector lx
-  VecScatterBegin(scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-  VecScatterEnd  (scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-
-  PetscScalar *lxx;
-  // get PetscScalar array contains solution from local solution vector lx
-  VecGetArray(lx, &lxx);
+  // get PetscScalar array contains solution, scatter global solution vector x to local vector lx if necessary
+  PetscScalar *lxx = get_local_array(x, lx);
 
   // clear old data
   VecZeroEntries (r);
@@ -878,7 +868,7 @@ void DDM1Solver::build_petsc_sens_residual(Vec x, Vec r)
 #endif
 
   // restore array back to Vec
-  VecRestoreArray(lx, &lxx);
+  restore_local_array(x, lx, &lxx);
 
   // assembly the function Vec
   VecAssemblyBegin(r);
@@ -904,26 +894,35 @@ void DDM1Solver::build_petsc_sens_jacobian(Vec x, Mat *, Mat *)
 
   START_LOG("DDM1Solver_Jacobian()", "DDM1Solver");
 
-  // scatte global solution vector x to local vector lx
-  VecScatterBegin(scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-  VecScatterEnd  (scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-
-  PetscScalar *lxx;
-  // get PetscScalar array contains solution from local solution vector lx
-  VecGetArray(lx, &lxx);
+  // get PetscScalar array contains solution, scatter global solution vector x to local vector lx if necessary
+  PetscScalar *lxx = get_local_array(x, lx);
 
   MatZeroEntries(J);
 
-  START_LOG("DDM1Solver_Jacobian(R)", "DDM1Solver");
+  // the row redirect table is rebuilt at the first assembly, since the nonzero pattern and dof map may change.
+  // region with hanging node moves rows by itself, keep the old way for it
+  if( !jacobian_matrix_first_assemble )
+    _row_redirect.clear();
+  bool row_redirect = _row_redirect.valid();
+  if( row_redirect )
+    _row_redirect.begin_assembly();
+  _set_row_redirect( row_redirect ? &_row_redirect : 0 );
 
   // flag for indicate ADD_VALUES operator.
   InsertMode add_value_flag = NOT_SET_VALUES;
 
-  // evaluate Jacobian matrix of governing equations of DDML1 in all the regions
-  for(unsigned int n=0; n<_system.n_regions(); n++)
+  _region_jacobian(lxx, add_value_flag);
+
+  START_LOG("DDM1Solver_Jacobian(B)", "DDM1Solver");
+  // before first assemble, resereve none zero pattern for each boundary
+
+  if( !jacobian_matrix_first_assemble )
   {
-    SimulationRegion * region = _system.region(n);
-    region->DDM1_Jacobian(lxx, &J, add_value_flag);
+    for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); b++)
+    {
+      BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+      bc->DDM1_Jacobian_Reserve(&J, add_value_flag);
+    }
   }
 
 
@@ -931,74 +930,65 @@ void DDM1Solver::build_petsc_sens_jacobian(Vec x, Mat *, Mat *)
   genius_assert( !fetestexcept(FE_INVALID) );
 #endif
 
-  // evaluate Jacobian matrix of time derivative if necessary
-  if(SolverSpecify::TimeDependent == true)
-    for(unsigned int n=0; n<_system.n_regions(); n++)
+  // evaluate Jacobian matrix of governing equations of DDML1 for all the boundaries
+  if( row_redirect )
+  {
+    // boundary rows had been added to their destination rows during region assembly,
+    // the preprocess only reads the captured values of cleared rows
+    std::vector<PetscInt> src_row,  dst_row,  clear_row;
+    for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); b++)
     {
-      SimulationRegion * region = _system.region(n);
-      region->DDM1_Time_Dependent_Jacobian(lxx, &J, add_value_flag);
+      BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+      bc->DDM1_Jacobian_Preprocess(lxx, &J, src_row, dst_row, clear_row);
     }
 
-
-  // evaluate pseudo time step if necessary
-  if(SolverSpecify::Type == SolverSpecify::OP && SolverSpecify::PseudoTimeMethod == true)
-    for(unsigned int n=0; n<_system.n_regions(); n++)
+    // the boundary rows changed, or some value of cleared rows was not captured.
+    // drop the table, assemble the regions again and move the rows in the old way
+    if( !_row_redirect.match(src_row, dst_row, clear_row) )
     {
-      SimulationRegion * region = _system.region(n);
-      region->DDM1_Pseudo_Time_Step_Jacobian(lxx, &J, add_value_flag);
+      _row_redirect.clear();
+      _set_row_redirect(0);
+      row_redirect = false;
+
+      // flush the pending values before zero the matrix
+      MatAssemblyBegin(J, MAT_FLUSH_ASSEMBLY);
+      MatAssemblyEnd(J, MAT_FLUSH_ASSEMBLY);
+      MatZeroEntries(J);
+      add_value_flag = NOT_SET_VALUES;
+      _region_jacobian(lxx, add_value_flag);
     }
-
-  // process hanging node here
-  for(unsigned int n=0; n<_system.n_regions(); n++)
-  {
-    SimulationRegion * region = _system.region(n);
-    region->DDM1_Jacobian_Hanging_Node(lxx, &J, add_value_flag);
   }
 
-  STOP_LOG("DDM1Solver_Jacobian(R)", "DDM1Solver");
-
-#if defined(HAVE_FENV_H) && defined(DEBUG)
-  genius_assert( !fetestexcept(FE_INVALID) );
-#endif
+  if( !row_redirect )
+  {
+    MatAssemblyBegin(J, MAT_FINAL_ASSEMBLY);
+    MatAssemblyEnd(J, MAT_FINAL_ASSEMBLY);
 
-  START_LOG("DDM1Solver_Jacobian(B)", "DDM1Solver");
-  // before first assemble, resereve none zero pattern for each boundary
+    // we do not allow zero insert/add to matrix
+    if( !jacobian_matrix_first_assemble )
+      genius_assert(!MatSetOption(J, MAT_IGNORE_ZERO_ENTRIES, PETSC_TRUE));
 
-  if( !jacobian_matrix_first_assemble )
-  {
+    std::vector<PetscInt> src_row,  dst_row,  clear_row;
     for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); b++)
     {
       BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
-      bc->DDM1_Jacobian_Reserve(&J, add_value_flag);
+      bc->DDM1_Jacobian_Preprocess(lxx, &J, src_row, dst_row, clear_row);
     }
-  }
 
+    bool hanging_node = false;
+    for(unsigned int n=0; n<_system.n_regions(); n++)
+      hanging_node = hanging_node || _system.region(n)->has_2d_hanging_node() || _system.region(n)->has_3d_hanging_node();
+    if( !jacobian_matrix_first_assemble && !hanging_node )
+      _row_redirect.build(J, src_row, dst_row, clear_row);
 
-#if defined(HAVE_FENV_H) && defined(DEBUG)
-  genius_assert( !fetestexcept(FE_INVALID) );
-#endif
-
-  // evaluate Jacobian matrix of governing equations of DDML1 for all the boundaries
-  MatAssemblyBegin(J, MAT_FINAL_ASSEMBLY);
-  MatAssemblyEnd(J, MAT_FINAL_ASSEMBLY);
-
-  // we do not allow zero insert/add to matrix
-  if( !jacobian_matrix_first_assemble )
-    genius_assert(!MatSetOption(J, MAT_IGNORE_ZERO_ENTRIES, PETSC_TRUE));
+    //add source rows to destination rows
+    PetscUtils::MatAddRowToRow(J, src_row, dst_row);
+    // clear row
+    PetscUtils::MatZeroRows(J, clear_row.size(), clear_row.empty() ? NULL : &clear_row[0], 0.0);
 
-  std::vector<PetscInt> src_row,  dst_row,  clear_row;
-  for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); b++)
-  {
-    BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
-    bc->DDM1_Jacobian_Preprocess(lxx, &J, src_row, dst_row, clear_row);
+    add_value_flag = NOT_SET_VALUES;
   }
 
-  //add source rows to destination rows
-  PetscUtils::MatAddRowToRow(J, src_row, dst_row);
-  // clear row
-  PetscUtils::MatZeroRows(J, clear_row.size(), clear_row.empty() ? NULL : &clear_row[0], 0.0);
-
-  add_value_flag = NOT_SET_VALUES;
   for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); b++)
   {
     BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
@@ -1012,7 +1002,7 @@ void DDM1Solver::build_petsc_sens_jacobian(Vec x, Mat *, Mat *)
 #endif
 
   // restore array back to Vec
-  VecRestoreArray(lx, &lxx);
+  restore_local_array(x, lx, &lxx);
 
   // assembly the matrix
   MatAssemblyBegin(J, MAT_FINAL_ASSEMBLY);
@@ -1027,17 +1017,84 @@ void DDM1Solver::build_petsc_sens_jacobian(Vec x, Mat *, Mat *)
   if(!jacobian_matrix_first_assemble)
     jacobian_matrix_first_assemble = true;
 
+  _set_row_redirect(0);
+
   STOP_LOG("DDM1Solver_Jacobian()", "DDM1Solver");
 
 }
 
+
+
+/*------------------------------------------------------------------
+ * evaluate the region part of Jacobian, the boundary conditions are processed later
+ */
+void DDM1Solver::_region_jacobian(PetscScalar * lxx, InsertMode & add_value_flag)
+{
+  START_LOG("DDM1Solver_Jacobian(R)", "DDM1Solver");
+
+  // evaluate Jacobian matrix of governing equations of DDML1 in all the regions
+  for(unsigned int n=0; n<_system.n_regions(); n++)
+  {
+    SimulationRegion * region = _system.region(n);
+    region->DDM1_Jacobian(lxx, &J, add_value_flag);
+  }
+
+
+#if defined(HAVE_FENV_H) && defined(DEBUG)
+  genius_assert( !fetestexcept(FE_INVALID) );
+#endif
+
+  // evaluate Jacobian matrix of time derivative if necessary
+  if(SolverSpecify::TimeDependent == true)
+    for(unsigned int n=0; n<_system.n_regions(); n++)
+    {
+      SimulationRegion * region = _system.region(n);
+      region->DDM1_Time_Dependent_Jacobian(lxx, &J, add_value_flag);
+    }
+
+
+  // evaluate pseudo time step if necessary
+  if(SolverSpecify::Type == SolverSpecify::OP && SolverSpecify::PseudoTimeMethod == true)
+    for(unsigned int n=0; n<_system.n_regions(); n++)
+    {
+      SimulationRegion * region = _system.region(n);
+      region->DDM1_Pseudo_Time_Step_Jacobian(lxx, &J, add_value_flag);
+    }
+
+  // process hanging node here
+  for(unsigned int n=0; n<_system.n_regions(); n++)
+  {
+    SimulationRegion * region = _system.region(n);
+    region->DDM1_Jacobian_Hanging_Node(lxx, &J, add_value_flag);
+  }
+
+  STOP_LOG("DDM1Solver_Jacobian(R)", "DDM1Solver");
+
+#if defined(HAVE_FENV_H) && defined(DEBUG)
+  genius_assert( !fetestexcept(FE_INVALID) );
+#endif
+}
+
+
+
+/*------------------------------------------------------------------
+ * hand the row redirect table to regions and boundary conditions
+ */
+void DDM1Solver::_set_row_redirect(MatRowRedirect * redirect)
+{
+  for(unsigned int n=0; n<_system.n_regions(); n++)
+    _system.region(n)->set_row_redirect(redirect);
+  for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); b++)
+    _system.get_bcs()->get_bc(b)->set_row_redirect(redirect);
+}
+
 void DDM1Solver::set_trace_electrode(BoundaryCondition *bc)
 {
   // we needn't scatter again
   // scatte global solution vector x to local vector lx
   //VecScatterBegin(scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
   //VecScatterEnd  (scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
-  bc->DDM1_Electrode_Trace(lx, &J, pdI_pdx, pdF_pdV);
+  bc->DDM1_Electrode_Trace(local_is_global ? x : lx, &J, pdI_pdx, pdF_pdV);
 }
 
 
@@ -620,8 +620,8 @@ void OhmicContactBC::DDM1_Jacobian_Preprocess(PetscScalar *, Mat *jac, std::vect
         row[2] = fvm_node->global_offset()+2;
 
         //NOTE MatGetValues only get value from local block!
-        MatGetValues(*jac, 1, &row[1], 3, &row[0], &A1[0]);
-        MatGetValues(*jac, 1, &row[2], 3, &row[0], &A2[0]);
+        PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[1], 3, &row[0], &A1[0]);
+        PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[2], 3, &row[0], &A2[0]);
 
         JM[0] = (A1[0]-A2[0]);
         JM[1] = (A1[1]-A2[1]);
@@ -640,8 +640,8 @@ void OhmicContactBC::DDM1_Jacobian_Preprocess(PetscScalar *, Mat *jac, std::vect
           col[1] = fvm_nb_node->global_offset()+1;
           col[2] = fvm_nb_node->global_offset()+2;
 
-          MatGetValues(*jac, 1, &row[1], 3, &col[0], &A1[0]);
-          MatGetValues(*jac, 1, &row[2], 3, &col[0], &A2[0]);
+          PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[1], 3, &col[0], &A1[0]);
+          PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[2], 3, &col[0], &A2[0]);
 
           JN[0] = (A1[0]-A2[0]);
           JN[1] = (A1[1]-A2[1]);
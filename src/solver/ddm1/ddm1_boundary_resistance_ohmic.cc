@@ -34,6 +34,7 @@
 #include "boundary_condition_resistance_ohmic.h"
 #include "parallel.h"
 #include "mathfunc.h"
+#include "petsc_utils.h"
 
 using PhysicalUnit::kb;
 using PhysicalUnit::e;
@@ -666,8 +667,8 @@ void IF_Metal_OhmicBC::DDM1_Jacobian_Preprocess(PetscScalar *x, Mat *jac, std::v
       row[2] = semiconductor_node->global_offset()+2;
 
       //NOTE MatGetValues only get value from local block!
-      MatGetValues(*jac, 1, &row[1], 3, &row[0], &A1[0]);
-      MatGetValues(*jac, 1, &row[2], 3, &row[0], &A2[0]);
+      PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[1], 3, &row[0], &A1[0]);
+      PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[2], 3, &row[0], &A2[0]);
 
       J_col[row[0]] += (-(A1[0]-A2[0]));
       J_col[row[1]] += (-(A1[1]-A2[1]));
@@ -689,8 +690,8 @@ void IF_Metal_OhmicBC::DDM1_Jacobian_Preprocess(PetscScalar *x, Mat *jac, std::v
         col[1] = semiconductor_nb_node->global_offset()+1;
         col[2] = semiconductor_nb_node->global_offset()+2;
 
-        MatGetValues(*jac, 1, &row[1], 3, &col[0], &A1[0]);
-        MatGetValues(*jac, 1, &row[2], 3, &col[0], &A2[0]);
+        PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[1], 3, &col[0], &A1[0]);
+        PetscUtils::MatGetValues(row_redirect(), *jac, 1, &row[2], 3, &col[0], &A2[0]);
 
         J_col[col[0]] += (-(A1[0]-A2[0]));
         J_col[col[1]] += (-(A1[1]-A2[1]));
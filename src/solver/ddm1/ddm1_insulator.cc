@@ -23,6 +23,8 @@
 
 #include "elem.h"
 #include "simulation_system.h"
+#include "petsc_utils.h"
+#include "mat_row_redirect.h"
 #include "insulator_region.h"
 
 using PhysicalUnit::kb;
@@ -88,22 +90,21 @@ void InsulatorSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, InsertMode
   y.reserve(2*n_edge());
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     {
       // electrostatic potential, as independent variable
@@ -117,18 +118,18 @@ void InsulatorSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, InsertMode
       PetscScalar eps = 0.5*(eps1+eps2);
 
       // "flux" from node 2 to node 1
-      PetscScalar f =  eps*fvm_n1->cv_surface_area(fvm_n2)*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
+      PetscScalar f =  eps*edges.cv_surface_area(ie)*(V2 - V1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        iy.push_back(fvm_n1->global_offset());
+        iy.push_back(edges.global_offset1(ie));
         y.push_back(f);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        iy.push_back(fvm_n2->global_offset());
+        iy.push_back(edges.global_offset2(ie));
         y.push_back(-f);
       }
     }
@@ -160,6 +161,9 @@ void InsulatorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, InsertM
     MatAssemblyEnd(*jac, MAT_FLUSH_ASSEMBLY);
   }
 
+  // boundary rows are redirected if the solver gives a row redirect table
+  MatRowRedirect * redirect = _row_redirect;
+
   //the indepedent variable number, since we only process edges, 2 is enough
   adtl::AutoDScalar::numdir=2;
 
@@ -168,27 +172,26 @@ void InsulatorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, InsertM
 
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     // the row/colume position of variables in the matrix
     PetscInt row[2],col[2];
-    row[0] = col[0] = fvm_n1->global_offset();
-    row[1] = col[1] = fvm_n2->global_offset();
+    row[0] = col[0] = edges.global_offset1(ie);
+    row[1] = col[1] = edges.global_offset2(ie);
 
     // here we use AD, however it is great overkill for such a simple problem.
     {
@@ -202,17 +205,17 @@ void InsulatorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, InsertM
 
       PetscScalar eps = 0.5*(eps1+eps2);
 
-      AutoDScalar f =  eps*fvm_n1->cv_surface_area(fvm_n2)*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
+      AutoDScalar f =  eps*edges.cv_surface_area(ie)*(V2 - V1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        MatSetValues(*jac, 1, &row[0], 2, &col[0], f.getADValue(), ADD_VALUES);
+        PetscUtils::MatAddValues(redirect, *jac, 1, &row[0], 2, &col[0], f.getADValue());
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        MatSetValues(*jac, 1, &row[1], 2, &col[0], (-f).getADValue(), ADD_VALUES);
+        PetscUtils::MatAddValues(redirect, *jac, 1, &row[1], 2, &col[0], (-f).getADValue());
       }
     }
   }
@@ -22,6 +22,8 @@
 
 #include "elem.h"
 #include "simulation_system.h"
+#include "petsc_utils.h"
+#include "mat_row_redirect.h"
 #include "resistance_region.h"
 #include "solver_specify.h"
 #include "boundary_info.h"
@@ -100,22 +102,21 @@ void MetalSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, InsertMode &ad
   const double sigma = this->get_conductance();
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     {
       // electrostatic potential, as independent variable
@@ -123,21 +124,21 @@ void MetalSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, InsertMode &ad
       PetscScalar V2   =  x[n2_local_offset];
 
       // truncated to positive
-      double S = std::abs(fvm_n1->cv_surface_area(fvm_n2));
+      double S = std::abs(edges.cv_surface_area(ie));
 
       // "flux" from node 2 to node 1
-      PetscScalar f = sigma*S*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
+      PetscScalar f = sigma*S*(V2 - V1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        iy.push_back(fvm_n1->global_offset());
+        iy.push_back(edges.global_offset1(ie));
         y.push_back(f);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        iy.push_back(fvm_n2->global_offset());
+        iy.push_back(edges.global_offset2(ie));
         y.push_back(-f);
       }
     }
@@ -198,30 +199,32 @@ void MetalSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, InsertMode
     MatAssemblyEnd(*jac, MAT_FLUSH_ASSEMBLY);
   }
 
+  // boundary rows are redirected if the solver gives a row redirect table
+  MatRowRedirect * redirect = _row_redirect;
+
   const double sigma = this->get_conductance();
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     // the row/colume position of variables in the matrix
     PetscInt row[2],col[2];
-    row[0] = col[0] = fvm_n1->global_offset();
-    row[1] = col[1] = fvm_n2->global_offset();
+    row[0] = col[0] = edges.global_offset1(ie);
+    row[1] = col[1] = edges.global_offset2(ie);
 
     // here we use AD, however it is great overkill for such a simple problem.
     {
@@ -230,19 +233,19 @@ void MetalSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, InsertMode
       AutoDScalar V2   =  x[n2_local_offset];   V2.setADValue(1,1.0);
 
       // truncated to positive
-      double S = std::abs(fvm_n1->cv_surface_area(fvm_n2));
-      AutoDScalar f =  sigma*S*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
+      double S = std::abs(edges.cv_surface_area(ie));
+      AutoDScalar f =  sigma*S*(V2 - V1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
 
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        MatSetValues(*jac, 1, &row[0], 2, &col[0], f.getADValue(), ADD_VALUES);
+        PetscUtils::MatAddValues(redirect, *jac, 1, &row[0], 2, &col[0], f.getADValue());
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        MatSetValues(*jac, 1, &row[1], 2, &col[0], (-f).getADValue(), ADD_VALUES);
+        PetscUtils::MatAddValues(redirect, *jac, 1, &row[1], 2, &col[0], (-f).getADValue());
       }
     }
   }
@@ -267,7 +270,7 @@ void MetalSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, InsertMode
     AutoDScalar V   =  x[fvm_node->local_offset()];  V.setADValue(0, 1.0);
     AutoDScalar current = -cap*(V-fvm_node_data->psi())/SolverSpecify::dt - (V-fvm_node_data->psi())/res;
 
-    MatSetValue(*jac, fvm_node->global_offset(), fvm_node->global_offset(), current.getADValue(0), ADD_VALUES);
+    PetscUtils::MatAddValue(redirect, *jac, fvm_node->global_offset(), fvm_node->global_offset(), current.getADValue(0));
   }
 
   // boundary condition should be processed later!
@@ -328,6 +331,9 @@ void MetalSimulationRegion::DDM1_Pseudo_Time_Step_Jacobian(PetscScalar * x, Mat
     MatAssemblyEnd(*jac, MAT_FLUSH_ASSEMBLY);
   }
 
+  // boundary rows are redirected if the solver gives a row redirect table
+  MatRowRedirect * redirect = _row_redirect;
+
   if(this->connect_to_low_resistance_solderpad()) return;
 
   //the indepedent variable number, 1 for each node
@@ -354,7 +360,7 @@ void MetalSimulationRegion::DDM1_Pseudo_Time_Step_Jacobian(PetscScalar * x, Mat
     AutoDScalar V(x[local_offset]);   V.setADValue(0, 1.0);              // psi
     AutoDScalar f_V = -cap*(V-node_data->psi())/SolverSpecify::PseudoTimeStepMetal;
 
-    MatSetValue(*jac, global_offset, global_offset, f_V.getADValue(0), ADD_VALUES);
+    PetscUtils::MatAddValue(redirect, *jac, global_offset, global_offset, f_V.getADValue(0));
   }
 
   // the last operator is ADD_VALUES
@@ -22,7 +22,10 @@
 //  $Id: ddm1_semiconductor.cc,v 1.26 2008/07/09 05:58:16 gdiso Exp $
 
 #include "elem.h"
+#include "fvm_elem_kernel.h"
 #include "simulation_system.h"
+#include "petsc_utils.h"
+#include "mat_row_redirect.h"
 #include "semiconductor_region.h"
 #include "solver_specify.h"
 #include "log.h"
@@ -39,6 +42,192 @@ using PhysicalUnit::us;
 #define DEBUG
 
 
+namespace
+{
+  /**
+   * the gradient of psi and fermi potentials in the cell for high field mobility,
+   * called by fvm_elem_dispatch with the concrete elem type
+   */
+  struct DDM1_HighFieldGradient
+  {
+    DDM1_HighFieldGradient(const PetscScalar * _x, const AdvancedModel * model, PetscScalar _Vt)
+      : x(_x), self_consistently(model->HighFieldMobilitySelfConsistently),
+        truc(model->QuasiFermiCarrierTruc), Vt(_Vt)
+    {}
+
+    const PetscScalar * x;
+    bool   self_consistently;
+    double truc;
+    PetscScalar Vt;
+
+    VectorValue<PetscScalar> E;
+    VectorValue<PetscScalar> Jnv;
+    VectorValue<PetscScalar> Jpv;
+
+    template <typename ElemT>
+    void operator() (const ElemT & elem)
+    {
+      PetscScalar psi_vertex[fvm_elem_max_nodes];
+      PetscScalar phin_vertex[fvm_elem_max_nodes];
+      PetscScalar phip_vertex[fvm_elem_max_nodes];
+
+      for(unsigned int nd=0; nd<elem.n_fvm_nodes(); ++nd)
+      {
+        const FVM_Node * fvm_node = elem.fvm_node(nd);
+        const FVM_NodeData * fvm_node_data = fvm_node->node_data();
+
+        PetscScalar V;  // electrostatic potential
+        PetscScalar n;  // electron density
+        PetscScalar p;  // hole density
+
+        if(self_consistently)
+        {
+          // use values in the current iteration
+          V  =  x[fvm_node->local_offset()+0];
+          n  =  std::max(x[fvm_node->local_offset()+1], truc*fvm_node_data->ni());
+          p  =  std::max(x[fvm_node->local_offset()+2], truc*fvm_node_data->ni());
+        }
+        else
+        {
+          // n and p will use previous solution value
+          V  =  x[fvm_node->local_offset()+0];
+          n  =  fvm_node_data->n() + 1.0*std::pow(cm, -3);
+          p  =  fvm_node_data->p() + 1.0*std::pow(cm, -3);
+        }
+
+        psi_vertex[nd] = V;
+        //fermi potential
+        phin_vertex[nd] = V - Vt*log(n/fvm_node_data->ni());
+        phip_vertex[nd] = V + Vt*log(p/fvm_node_data->ni());
+      }
+
+      // compute the gradient
+      E   = - elem.gradient_kernel(psi_vertex);  // E = - grad(psi)
+      Jnv = - elem.gradient_kernel(phin_vertex); // we only need the direction of Jnv, here Jnv = - gradient of Fn
+      Jpv = - elem.gradient_kernel(phip_vertex); // Jpv = - gradient of Fp
+    }
+  };
+
+
+  /**
+   * AD version of DDM1_HighFieldGradient, the independent variables are
+   * psi, n and p of each node, in the order of elem nodes
+   */
+  struct DDM1_HighFieldGradientAD
+  {
+    DDM1_HighFieldGradientAD(const PetscScalar * _x, const AdvancedModel * model, PetscScalar _Vt)
+      : x(_x), self_consistently(model->HighFieldMobilitySelfConsistently),
+        truc(model->QuasiFermiCarrierTruc), Vt(_Vt)
+    {}
+
+    const PetscScalar * x;
+    bool   self_consistently;
+    double truc;
+    PetscScalar Vt;
+
+    VectorValue<AutoDScalar> E;
+    VectorValue<AutoDScalar> Jnv;
+    VectorValue<AutoDScalar> Jpv;
+
+    template <typename ElemT>
+    void operator() (const ElemT & elem)
+    {
+      PetscScalar psi_vertex[fvm_elem_max_nodes];
+      AutoDScalar phin_vertex[fvm_elem_max_nodes];
+      AutoDScalar phip_vertex[fvm_elem_max_nodes];
+
+      for(unsigned int nd=0; nd<elem.n_fvm_nodes(); ++nd)
+      {
+        const FVM_Node * fvm_node = elem.fvm_node(nd);
+        const FVM_NodeData * fvm_node_data = fvm_node->node_data();
+
+        AutoDScalar V;               // electrostatic potential
+        AutoDScalar n;               // electron density
+        AutoDScalar p;               // hole density
+
+        if(self_consistently)
+        {
+          // use values in the current iteration
+          V  =  x[fvm_node->local_offset()+0];   V.setADValue(3*nd+0, 1.0);
+          n  =  std::max(x[fvm_node->local_offset()+1], truc*fvm_node_data->ni());
+          p  =  std::max(x[fvm_node->local_offset()+2], truc*fvm_node_data->ni());
+
+          if(x[fvm_node->local_offset()+1] > truc*fvm_node_data->ni())
+            n.setADValue(3*nd+1, 1.0);
+
+          if(x[fvm_node->local_offset()+2] > truc*fvm_node_data->ni())
+            p.setADValue(3*nd+2, 1.0);
+        }
+        else
+        {
+          // n and p use previous solution value
+          V  =  x[fvm_node->local_offset()+0];   V.setADValue(3*nd+0, 1.0);
+          n  =  fvm_node_data->n() + 1.0*std::pow(cm, -3);
+          p  =  fvm_node_data->p() + 1.0*std::pow(cm, -3);
+        }
+
+        psi_vertex[nd]  = V.getValue();
+        //fermi potential
+        phin_vertex[nd] = V - Vt*log(n/fvm_node_data->ni());
+        phip_vertex[nd] = V + Vt*log(p/fvm_node_data->ni());
+      }
+
+      // compute the gradient
+      // psi are independent variables, take the gradient coefficients as derivatives
+      E   = - fvm_gradient_ad(elem, psi_vertex, 0, 3);  // E = - grad(psi)
+      Jnv = - elem.gradient_kernel(phin_vertex); // we only need the direction of Jnv, here Jnv = - gradient of Fn
+      Jpv = - elem.gradient_kernel(phip_vertex); // the same as Jnv
+    }
+  };
+
+
+  /**
+   * the E field in the insulator elem, for ESurface model
+   */
+  struct DDM1_InsulatorField
+  {
+    DDM1_InsulatorField(const PetscScalar * _x) : x(_x) {}
+
+    const PetscScalar * x;
+
+    VectorValue<PetscScalar> E;
+
+    template <typename ElemT>
+    void operator() (const ElemT & elem)
+    {
+      PetscScalar psi_vertex[fvm_elem_max_nodes];
+      for(unsigned int nd=0; nd<elem.n_fvm_nodes(); ++nd)
+        psi_vertex[nd] = x[elem.fvm_node(nd)->local_offset()+0];
+      E = - elem.gradient_kernel(psi_vertex);
+    }
+  };
+
+
+  /**
+   * AD version of DDM1_InsulatorField, the independent variables are
+   * psi of each node, begin at ad_offset
+   */
+  struct DDM1_InsulatorFieldAD
+  {
+    DDM1_InsulatorFieldAD(const PetscScalar * _x, unsigned int _ad_offset) : x(_x), ad_offset(_ad_offset) {}
+
+    const PetscScalar * x;
+    unsigned int ad_offset;
+
+    VectorValue<AutoDScalar> E;
+
+    template <typename ElemT>
+    void operator() (const ElemT & elem)
+    {
+      PetscScalar psi_vertex[fvm_elem_max_nodes];
+      for(unsigned int nd=0; nd<elem.n_fvm_nodes(); ++nd)
+        psi_vertex[nd] = x[elem.fvm_node(nd)->local_offset()+0];
+      E = - fvm_gradient_ad(elem, psi_vertex, ad_offset, 1);
+    }
+  };
+}
+
+
 ///////////////////////////////////////////////////////////////////////
 //----------------Function and Jacobian evaluate---------------------//
 ///////////////////////////////////////////////////////////////////////
@@ -159,24 +348,23 @@ void SemiconductorSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, Insert
     Jp_edge_buffer.reserve(n_edge());
 
     // search all the edges of this region
-    const_edge_iterator it = edges_begin();
-    const_edge_iterator it_end = edges_end();
-    for(; it!=it_end; ++it)
+    const FVM_EdgeTable & edges = edge_table();
+    for(unsigned int ie=0; ie<edges.size(); ++ie)
     {
       // fvm_node of node1
-      const FVM_Node * fvm_n1 = (*it).first;
+      const FVM_Node * fvm_n1 = edges.node1(ie);
       // fvm_node of node2
-      const FVM_Node * fvm_n2 = (*it).second;
+      const FVM_Node * fvm_n2 = edges.node2(ie);
 
       // fvm_node_data of node1
-      const FVM_NodeData * n1_data =  fvm_n1->node_data();
+      const FVM_NodeData * n1_data =  edges.data1(ie);
       // fvm_node_data of node2
-      const FVM_NodeData * n2_data =  fvm_n2->node_data();
+      const FVM_NodeData * n2_data =  edges.data2(ie);
 
-      const unsigned int n1_local_offset = fvm_n1->local_offset();
-      const unsigned int n2_local_offset = fvm_n2->local_offset();
+      const unsigned int n1_local_offset = edges.local_offset1(ie);
+      const unsigned int n2_local_offset = edges.local_offset2(ie);
 
-      const double length = fvm_n1->distance(fvm_n2);
+      const double length = edges.length(ie);
 
       // build S-G current along edge
 
@@ -228,18 +416,18 @@ void SemiconductorSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, Insert
       PetscScalar eps = 0.5*(eps1+eps2);
 
       // "flux" from node 2 to node 1
-      PetscScalar f =  eps*fvm_n1->cv_surface_area(fvm_n2)*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
+      PetscScalar f =  eps*edges.cv_surface_area(ie)*(V2 - V1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        iflux.push_back(fvm_n1->global_offset());
+        iflux.push_back(edges.global_offset1(ie));
         flux.push_back(f);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        iflux.push_back(fvm_n2->global_offset());
+        iflux.push_back(edges.global_offset2(ie));
         flux.push_back(-f);
       }
     }
@@ -282,47 +470,11 @@ void SemiconductorSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, Insert
     {
       // build the gradient of psi and fermi potential in this cell.
       // which are the vector of electric field and current density.
-      std::vector<PetscScalar> psi_vertex(elem->n_nodes());
-      std::vector<PetscScalar> phin_vertex(elem->n_nodes());
-      std::vector<PetscScalar> phip_vertex(elem->n_nodes());
-
-      for(unsigned int nd=0; nd<elem->n_nodes(); ++nd)
-      {
-        const FVM_Node * fvm_node = elem->get_fvm_node(nd);
-        const FVM_NodeData * fvm_node_data = fvm_node->node_data();
-
-        PetscScalar V;  // electrostatic potential
-        PetscScalar n;  // electron density
-        PetscScalar p;  // hole density
-
-        if(get_advanced_model()->HighFieldMobilitySelfConsistently)
-        {
-          double truc = get_advanced_model()->QuasiFermiCarrierTruc;
-          // use values in the current iteration
-          V  =  x[fvm_node->local_offset()+0];
-          n  =  std::max(x[fvm_node->local_offset()+1], truc*fvm_node_data->ni());
-          p  =  std::max(x[fvm_node->local_offset()+2], truc*fvm_node_data->ni());
-        }
-        else
-        {
-          // n and p will use previous solution value
-          V  =  x[fvm_node->local_offset()+0];
-          n  =  fvm_node_data->n() + 1.0*std::pow(cm, -3);
-          p  =  fvm_node_data->p() + 1.0*std::pow(cm, -3);
-        }
-
-        psi_vertex[nd] = V;
-        //fermi potential
-        phin_vertex[nd] = V - Vt*log(n/fvm_node_data->ni());
-        phip_vertex[nd] = V + Vt*log(p/fvm_node_data->ni());
-
-      }
-
-
-      // compute the gradient
-      E = - elem->gradient(psi_vertex);  // E = - grad(psi)
-      Jnv = - elem->gradient(phin_vertex); // we only need the direction of Jnv, here Jnv = - gradient of Fn
-      Jpv = - elem->gradient(phip_vertex); // Jpv = - gradient of Fp
+      DDM1_HighFieldGradient kernel(x, get_advanced_model(), Vt);
+      fvm_elem_dispatch(elem, kernel);
+      E   = kernel.E;
+      Jnv = kernel.Jnv;
+      Jpv = kernel.Jpv;
     }
 
     if(highfield_mob)
@@ -337,15 +489,9 @@ void SemiconductorSimulationRegion::DDM1_Function(PetscScalar * x, Vec f, Insert
         const Elem * elem_insul=elem->neighbor(sides[0]);
         SimulationRegion * region_insul=regions[0];
 
-        std::vector<PetscScalar> psi_vertex_neighbor;
-        for(unsigned int nd=0; nd<elem_insul->n_nodes(); ++nd)
-        {
-          const FVM_Node * fvm_node_neighbor = elem_insul->get_fvm_node(nd);
-          PetscScalar V_neighbor = x[fvm_node_neighbor->local_offset()+0];
-          psi_vertex_neighbor.push_back(V_neighbor);
-        }
-
-        VectorValue<PetscScalar> E_insul    = - elem_insul->gradient(psi_vertex_neighbor);
+        DDM1_InsulatorField insul_kernel(x);
+        fvm_elem_dispatch(elem_insul, insul_kernel);
+        const VectorValue<PetscScalar> & E_insul = insul_kernel.E;
 
         // interface normal, point to semiconductor side
         Point norm = - elem->outside_unit_normal(sides[0]);
@@ -776,6 +922,9 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
     MatAssemblyEnd(*jac, MAT_FLUSH_ASSEMBLY);
   }
 
+  // boundary rows are redirected if the solver gives a row redirect table
+  MatRowRedirect * redirect = _row_redirect;
+
   //common used variable
   const PetscScalar T   = T_external();
   const PetscScalar Vt  = kb*T/e;
@@ -795,24 +944,23 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
     mt->set_ad_num(adtl::AutoDScalar::numdir);
 
     // search all the edges of this region
-    const_edge_iterator it = edges_begin();
-    const_edge_iterator it_end = edges_end();
-    for(; it!=it_end; ++it)
+    const FVM_EdgeTable & edges = edge_table();
+    for(unsigned int ie=0; ie<edges.size(); ++ie)
     {
       // fvm_node of node1
-      const FVM_Node * fvm_n1 = (*it).first;
+      const FVM_Node * fvm_n1 = edges.node1(ie);
       // fvm_node of node2
-      const FVM_Node * fvm_n2 = (*it).second;
+      const FVM_Node * fvm_n2 = edges.node2(ie);
 
       // fvm_node_data of node1
-      const FVM_NodeData * n1_data =  fvm_n1->node_data();
+      const FVM_NodeData * n1_data =  edges.data1(ie);
       // fvm_node_data of node2
-      const FVM_NodeData * n2_data =  fvm_n2->node_data();
+      const FVM_NodeData * n2_data =  edges.data2(ie);
 
-      const unsigned int n1_local_offset = fvm_n1->local_offset();
-      const unsigned int n2_local_offset = fvm_n2->local_offset();
+      const unsigned int n1_local_offset = edges.local_offset1(ie);
+      const unsigned int n2_local_offset = edges.local_offset2(ie);
 
-      const double length = fvm_n1->distance(fvm_n2);
+      const double length = edges.length(ie);
 
       // build S-G current along edge
 
@@ -862,23 +1010,23 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
       // poisson's equation
 
       const PetscScalar eps = 0.5*(eps1+eps2);
-      AutoDScalar f_phi =  eps*fvm_n1->cv_surface_area(fvm_n2)*(V2 - V1)/length ;
+      AutoDScalar f_phi =  eps*edges.cv_surface_area(ie)*(V2 - V1)/length ;
 
       PetscInt row[2],col[2];
-      row[0] = col[0] = fvm_n1->global_offset();
-      row[1] = col[1] = fvm_n2->global_offset();
+      row[0] = col[0] = edges.global_offset1(ie);
+      row[1] = col[1] = edges.global_offset2(ie);
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        MatSetValue(*jac, row[0], col[0], f_phi.getADValue(0), ADD_VALUES);
-        MatSetValue(*jac, row[0], col[1], f_phi.getADValue(3), ADD_VALUES);
+        PetscUtils::MatAddValue(redirect, *jac, row[0], col[0], f_phi.getADValue(0));
+        PetscUtils::MatAddValue(redirect, *jac, row[0], col[1], f_phi.getADValue(3));
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        MatSetValue(*jac, row[1], col[0], -f_phi.getADValue(0), ADD_VALUES);
-        MatSetValue(*jac, row[1], col[1], -f_phi.getADValue(3), ADD_VALUES);
+        PetscUtils::MatAddValue(redirect, *jac, row[1], col[0], -f_phi.getADValue(0));
+        PetscUtils::MatAddValue(redirect, *jac, row[1], col[1], -f_phi.getADValue(3));
       }
 
     }
@@ -936,51 +1084,11 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
       // which are the vector of electric field and current density.
       // here use type AutoDScalar, we should make sure the order of independent variable keeps the
       // same all the time
-      std::vector<AutoDScalar> psi_vertex;
-      std::vector<AutoDScalar> phin_vertex;
-      std::vector<AutoDScalar> phip_vertex;
-
-      for(unsigned int nd=0; nd<elem->n_nodes(); ++nd)
-      {
-        const FVM_Node * fvm_node = elem->get_fvm_node(nd);
-        const FVM_NodeData * fvm_node_data = fvm_node->node_data();
-
-        AutoDScalar V;               // electrostatic potential
-        AutoDScalar n;               // electron density
-        AutoDScalar p;               // hole density
-
-        if(get_advanced_model()->HighFieldMobilitySelfConsistently)
-        {
-          double truc = get_advanced_model()->QuasiFermiCarrierTruc;
-          // use values in the current iteration
-          V  =  x[fvm_node->local_offset()+0];   V.setADValue(3*nd+0, 1.0);
-          n  =  std::max(x[fvm_node->local_offset()+1], truc*fvm_node_data->ni());
-          p  =  std::max(x[fvm_node->local_offset()+2], truc*fvm_node_data->ni());
-
-          if(x[fvm_node->local_offset()+1] > truc*fvm_node_data->ni())
-            n.setADValue(3*nd+1, 1.0);
-
-          if(x[fvm_node->local_offset()+2] > truc*fvm_node_data->ni())
-            p.setADValue(3*nd+2, 1.0);
-        }
-        else
-        {
-          // n and p use previous solution value
-          V  =  x[fvm_node->local_offset()+0];   V.setADValue(3*nd+0, 1.0);
-          n  =  fvm_node_data->n() + 1.0*std::pow(cm, -3);
-          p  =  fvm_node_data->p() + 1.0*std::pow(cm, -3);
-        }
-
-        psi_vertex.push_back  ( V );
-        //fermi potential
-        phin_vertex.push_back ( V - Vt*log(n/fvm_node_data->ni()) );
-        phip_vertex.push_back ( V + Vt*log(p/fvm_node_data->ni()) );
-      }
-
-      // compute the gradient
-      E   = - elem->gradient(psi_vertex);  // E = - grad(psi)
-      Jnv = - elem->gradient(phin_vertex); // we only need the direction of Jnv, here Jnv = - gradient of Fn
-      Jpv = - elem->gradient(phip_vertex); // the same as Jnv
+      DDM1_HighFieldGradientAD kernel(x, get_advanced_model(), Vt);
+      fvm_elem_dispatch(elem, kernel);
+      E   = kernel.E;
+      Jnv = kernel.Jnv;
+      Jpv = kernel.Jpv;
     }
 
     if(highfield_mob)
@@ -996,20 +1104,14 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
         const Elem * elem_insul=elem->neighbor(sides[0]);
         SimulationRegion * region_insul=regions[0];
 
-        std::vector<AutoDScalar> psi_vertex_neighbor;
-        for(unsigned int nd=0; nd<elem_insul->n_nodes(); ++nd)
-        {
-          const FVM_Node * fvm_node_neighbor = elem_insul->get_fvm_node(nd);
-          AutoDScalar V_neighbor = x[fvm_node_neighbor->local_offset()+0];
-          V_neighbor.setADValue(3*elem->n_nodes()+nd, 1.0);
-          psi_vertex_neighbor.push_back(V_neighbor);
-        }
-
-        VectorValue<AutoDScalar> E_insul    = - elem_insul->gradient(psi_vertex_neighbor);
-
-        // we need more AD variable
+        // we need more AD variable, before E_insul is evaluated, or its derivatives are dropped
         adtl::AutoDScalar::numdir += 1*elem_insul->n_nodes();
         mt->set_ad_num(adtl::AutoDScalar::numdir);
+
+        DDM1_InsulatorFieldAD insul_kernel(x, 3*elem->n_nodes());
+        fvm_elem_dispatch(elem_insul, insul_kernel);
+        const VectorValue<AutoDScalar> & E_insul = insul_kernel.E;
+
         for(unsigned int nd=0; nd<elem_insul->n_nodes(); ++nd)
         {
           const FVM_Node * fvm_node = elem_insul->get_fvm_node(nd);
@@ -1232,8 +1334,8 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
           AutoDScalar f_Jn  =  Jn*truncated_partial_area ;
           AutoDScalar f_Jp  = -Jp*truncated_partial_area;
           // general coding always has some overkill... bypass it.
-          MatSetValues(*jac, 1, &row[1], cell_col.size(), &cell_col[0], f_Jn.getADValue(), ADD_VALUES);
-          MatSetValues(*jac, 1, &row[2], cell_col.size(), &cell_col[0], f_Jp.getADValue(), ADD_VALUES);
+          PetscUtils::MatAddValues(redirect, *jac, 1, &row[1], cell_col.size(), &cell_col[0], f_Jn.getADValue());
+          PetscUtils::MatAddValues(redirect, *jac, 1, &row[2], cell_col.size(), &cell_col[0], f_Jp.getADValue());
         }
 
         if( fvm_n2->on_processor() )
@@ -1241,8 +1343,8 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
           // flux on edge
           AutoDScalar f_Jn  = -Jn*truncated_partial_area ;
           AutoDScalar f_Jp  =  Jp*truncated_partial_area;
-          MatSetValues(*jac, 1, &row[4], cell_col.size(), &cell_col[0], f_Jn.getADValue(), ADD_VALUES);
-          MatSetValues(*jac, 1, &row[5], cell_col.size(), &cell_col[0], f_Jp.getADValue(), ADD_VALUES);
+          PetscUtils::MatAddValues(redirect, *jac, 1, &row[4], cell_col.size(), &cell_col[0], f_Jn.getADValue());
+          PetscUtils::MatAddValues(redirect, *jac, 1, &row[5], cell_col.size(), &cell_col[0], f_Jp.getADValue());
         }
 
         // BandBandTunneling && ImpactIonization
@@ -1256,16 +1358,16 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
           {
             // continuity equation
             AutoDScalar continuity = 0.5*GBTBT1*truncated_partial_volume;
-            MatSetValues(*jac, 1, &row[1], cell_col.size(), &cell_col[0], continuity.getADValue(), ADD_VALUES);
-            MatSetValues(*jac, 1, &row[2], cell_col.size(), &cell_col[0], continuity.getADValue(), ADD_VALUES);
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[1], cell_col.size(), &cell_col[0], continuity.getADValue());
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[2], cell_col.size(), &cell_col[0], continuity.getADValue());
           }
 
           if( fvm_n2->on_processor() )
           {
             // continuity equation
             AutoDScalar continuity = 0.5*GBTBT2*truncated_partial_volume;
-            MatSetValues(*jac, 1, &row[4], cell_col.size(), &cell_col[0], continuity.getADValue(), ADD_VALUES);
-            MatSetValues(*jac, 1, &row[5], cell_col.size(), &cell_col[0], continuity.getADValue(), ADD_VALUES);
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[4], cell_col.size(), &cell_col[0], continuity.getADValue());
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[5], cell_col.size(), &cell_col[0], continuity.getADValue());
           }
         }
 
@@ -1319,8 +1421,8 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
             // continuity equation
             AutoDScalar electron_continuity = (riin1*GIIn+riip1*GIIp)*truncated_partial_volume ;
             AutoDScalar hole_continuity     = (riin1*GIIn+riip1*GIIp)*truncated_partial_volume ;
-            MatSetValues(*jac, 1, &row[1], cell_col.size(), &cell_col[0], electron_continuity.getADValue(), ADD_VALUES);
-            MatSetValues(*jac, 1, &row[2], cell_col.size(), &cell_col[0], hole_continuity.getADValue(), ADD_VALUES);
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[1], cell_col.size(), &cell_col[0], electron_continuity.getADValue());
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[2], cell_col.size(), &cell_col[0], hole_continuity.getADValue());
           }
 
           if( fvm_n2->on_processor() )
@@ -1328,8 +1430,8 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
             // continuity equation
             AutoDScalar electron_continuity = (riin2*GIIn+riip2*GIIp)*truncated_partial_volume ;
             AutoDScalar hole_continuity     = (riin2*GIIn+riip2*GIIp)*truncated_partial_volume ;
-            MatSetValues(*jac, 1, &row[4], cell_col.size(), &cell_col[0], electron_continuity.getADValue(), ADD_VALUES);
-            MatSetValues(*jac, 1, &row[5], cell_col.size(), &cell_col[0], hole_continuity.getADValue(), ADD_VALUES);
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[4], cell_col.size(), &cell_col[0], electron_continuity.getADValue());
+            PetscUtils::MatAddValues(redirect, *jac, 1, &row[5], cell_col.size(), &cell_col[0], hole_continuity.getADValue());
           }
         }
 
@@ -1380,9 +1482,9 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
 
 
     // ADD to Jacobian matrix,
-    MatSetValues(*jac, 1, &index[0], 3, &index[0], rho.getADValue(), ADD_VALUES);
-    MatSetValues(*jac, 1, &index[1], 3, &index[0], R.getADValue(), ADD_VALUES);
-    MatSetValues(*jac, 1, &index[2], 3, &index[0], R.getADValue(), ADD_VALUES);
+    PetscUtils::MatAddValues(redirect, *jac, 1, &index[0], 3, &index[0], rho.getADValue());
+    PetscUtils::MatAddValues(redirect, *jac, 1, &index[1], 3, &index[0], R.getADValue());
+    PetscUtils::MatAddValues(redirect, *jac, 1, &index[2], 3, &index[0], R.getADValue());
 
     if (get_advanced_model()->Trap)
     {
@@ -1390,13 +1492,13 @@ void SemiconductorSimulationRegion::DDM1_Jacobian(PetscScalar * x, Mat *jac, Ins
       mt->trap->Calculate(true,p,n,ni,T);
 
       AutoDScalar TrappedC = mt->trap->ChargeAD(true) * fvm_node->volume();
-      MatSetValues(*jac, 1, &index[0], 3, &index[0], TrappedC.getADValue(), ADD_VALUES);
+      PetscUtils::MatAddValues(redirect, *jac, 1, &index[0], 3, &index[0], TrappedC.getADValue());
 
       AutoDScalar GElec = - mt->trap->ElectronTrapRate(true,n,ni,T) * fvm_node->volume();
       AutoDScalar GHole = - mt->trap->HoleTrapRate    (true,p,ni,T) * fvm_node->volume();
 
-      MatSetValues(*jac, 1, &index[1], 3, &index[0], GElec.getADValue(), ADD_VALUES);
-      MatSetValues(*jac, 1, &index[2], 3, &index[0], GHole.getADValue(), ADD_VALUES);
+      PetscUtils::MatAddValues(redirect, *jac, 1, &index[1], 3, &index[0], GElec.getADValue());
+      PetscUtils::MatAddValues(redirect, *jac, 1, &index[2], 3, &index[0], GHole.getADValue());
     }
   }
 
@@ -1497,6 +1599,9 @@ void SemiconductorSimulationRegion::DDM1_Time_Dependent_Jacobian(PetscScalar * x
     MatAssemblyEnd(*jac, MAT_FLUSH_ASSEMBLY);
   }
 
+  // boundary rows are redirected if the solver gives a row redirect table
+  MatRowRedirect * redirect = _row_redirect;
+
   //the indepedent variable number, 1 for each node
   adtl::AutoDScalar::numdir = 1;
   //synchronize with material database
@@ -1526,16 +1631,16 @@ void SemiconductorSimulationRegion::DDM1_Time_Dependent_Jacobian(PetscScalar * x
       AutoDScalar Tp_BDF2 = -((2-r)/(1-r)*p - 1.0/(r*(1-r))*node_data->p() + (1-r)/r*node_data->p_last())
                        / (SolverSpecify::dt_last+SolverSpecify::dt)*fvm_node->volume();
       // ADD to Jacobian matrix
-      MatSetValue(*jac, index[0], index[0], Tn_BDF2.getADValue(0), ADD_VALUES);
-      MatSetValue(*jac, index[1], index[1], Tp_BDF2.getADValue(0), ADD_VALUES);
+      PetscUtils::MatAddValue(redirect, *jac, index[0], index[0], Tn_BDF2.getADValue(0));
+      PetscUtils::MatAddValue(redirect, *jac, index[1], index[1], Tp_BDF2.getADValue(0));
     }
     else //first order
     {
       AutoDScalar Tn_BDF1 = -(n - node_data->n())/SolverSpecify::dt*fvm_node->volume();
       AutoDScalar Tp_BDF1 = -(p - node_data->p())/SolverSpecify::dt*fvm_node->volume();
       // ADD to Jacobian matrix
-      MatSetValue(*jac, index[0], index[0], Tn_BDF1.getADValue(0), ADD_VALUES);
-      MatSetValue(*jac, index[1], index[1], Tp_BDF1.getADValue(0), ADD_VALUES);
+      PetscUtils::MatAddValue(redirect, *jac, index[0], index[0], Tn_BDF1.getADValue(0));
+      PetscUtils::MatAddValue(redirect, *jac, index[1], index[1], Tp_BDF1.getADValue(0));
     }
   }
 
@@ -1611,6 +1716,9 @@ void SemiconductorSimulationRegion::DDM1_Pseudo_Time_Step_Jacobian(PetscScalar *
     MatAssemblyEnd(*jac, MAT_FLUSH_ASSEMBLY);
   }
 
+  // boundary rows are redirected if the solver gives a row redirect table
+  MatRowRedirect * redirect = _row_redirect;
+
   //the indepedent variable number, 1 for each node
   adtl::AutoDScalar::numdir = 1;
   //synchronize with material database
@@ -1632,7 +1740,7 @@ void SemiconductorSimulationRegion::DDM1_Pseudo_Time_Step_Jacobian(PetscScalar *
 
     AutoDScalar V(x[local_offset]);   V.setADValue(0, 1.0);              // psi
     AutoDScalar f_V = -node_data->eps()*(V-node_data->psi())/SolverSpecify::PseudoTimeStepPotential*fvm_node->volume();
-    MatSetValue(*jac, global_offset, global_offset, f_V.getADValue(0), ADD_VALUES);
+    PetscUtils::MatAddValue(redirect, *jac, global_offset, global_offset, f_V.getADValue(0));
   }
 
 
@@ -1650,10 +1758,10 @@ void SemiconductorSimulationRegion::DDM1_Pseudo_Time_Step_Jacobian(PetscScalar *
     AutoDScalar p(x[local_offset+2]);   p.setADValue(0, 1.0);              // hole density
 
     AutoDScalar f_n = -(n-node_data->n())/SolverSpecify::PseudoTimeStepCarrier*fvm_node->volume();
-    MatSetValue(*jac, global_offset+1, global_offset+1, f_n.getADValue(0), ADD_VALUES);
+    PetscUtils::MatAddValue(redirect, *jac, global_offset+1, global_offset+1, f_n.getADValue(0));
 
     AutoDScalar f_p = -(p-node_data->p())/SolverSpecify::PseudoTimeStepCarrier*fvm_node->volume();
-    MatSetValue(*jac, global_offset+2, global_offset+2, f_p.getADValue(0), ADD_VALUES);
+    PetscUtils::MatAddValue(redirect, *jac, global_offset+2, global_offset+2, f_p.getADValue(0));
   }
 
   // the last operator is ADD_VALUES
@@ -106,26 +106,25 @@ void MetalSimulationRegion::DDM1R_Function(PetscScalar * x, Vec f, InsertMode &a
   const PetscScalar mu    = sigma/ion; // electron mobility
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     {
-      double length = fvm_n1->distance(fvm_n2);
-      double cv_surface_area = fvm_n1->cv_surface_area(fvm_n2);
+      double length = edges.length(ie);
+      double cv_surface_area = edges.cv_surface_area(ie);
       // electrostatic potential, as independent variable
       PetscScalar V1   =  x[n1_local_offset];
       PetscScalar V2   =  x[n2_local_offset];
@@ -140,21 +139,21 @@ void MetalSimulationRegion::DDM1R_Function(PetscScalar * x, Vec f, InsertMode &a
       PetscScalar f_jn =  mu*In_dd(Vt,V1-V2,n1,n2,length)*std::abs(cv_surface_area);
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
-        iy.push_back(fvm_n1->global_offset()+0);
+        iy.push_back(edges.global_offset1(ie)+0);
         y.push_back(f_psi);
 
-        iy.push_back(fvm_n1->global_offset()+1);
+        iy.push_back(edges.global_offset1(ie)+1);
         y.push_back(f_jn);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
-        iy.push_back(fvm_n2->global_offset()+0);
+        iy.push_back(edges.global_offset2(ie)+0);
         y.push_back(-f_psi);
 
-        iy.push_back(fvm_n2->global_offset()+1);
+        iy.push_back(edges.global_offset2(ie)+1);
         y.push_back(-f_jn);
       }
     }
@@ -224,27 +223,26 @@ void MetalSimulationRegion::DDM1R_Jacobian(PetscScalar * x, Mat *jac, InsertMode
   mt->set_ad_num(adtl::AutoDScalar::numdir);
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     // here we use AD, however it is great overkill for such a simple problem.
     {
-      double length = fvm_n1->distance(fvm_n2);
-      double cv_surface_area = fvm_n1->cv_surface_area(fvm_n2);
+      double length = edges.length(ie);
+      double cv_surface_area = edges.cv_surface_area(ie);
 
       // electrostatic potential, as independent variable
       AutoDScalar V1   =  x[n1_local_offset];    V1.setADValue(0,1.0);
@@ -261,21 +259,21 @@ void MetalSimulationRegion::DDM1R_Jacobian(PetscScalar * x, Mat *jac, InsertMode
       AutoDScalar f_jn =  mu*In_dd(Vt,V1-V2,n1,n2,length)*std::abs(cv_surface_area);
 
       PetscInt row[4], col[4];
-      row[0] = col[0] = fvm_n1->global_offset();
-      row[1] = col[1] = fvm_n1->global_offset()+1;
-      row[2] = col[2] = fvm_n2->global_offset();
-      row[3] = col[3] = fvm_n2->global_offset()+1;
+      row[0] = col[0] = edges.global_offset1(ie);
+      row[1] = col[1] = edges.global_offset1(ie)+1;
+      row[2] = col[2] = edges.global_offset2(ie);
+      row[3] = col[3] = edges.global_offset2(ie)+1;
 
       // ignore thoese ghost nodes
 
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
         MatSetValue(*jac, row[0], col[0], f_psi.getADValue(0), ADD_VALUES);
         MatSetValue(*jac, row[0], col[2], f_psi.getADValue(2), ADD_VALUES);
         MatSetValues(*jac, 1, &row[1], 4, &col[0], f_jn.getADValue(), ADD_VALUES);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
         MatSetValue(*jac, row[2], col[0], -f_psi.getADValue(0), ADD_VALUES);
         MatSetValue(*jac, row[2], col[2], -f_psi.getADValue(2), ADD_VALUES);
@@ -97,24 +97,23 @@ void ElectrodeSimulationRegion::DDM2_Function(PetscScalar * x, Vec f, InsertMode
   y.reserve(4*n_edge());
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_global_offset = fvm_n1->global_offset();
-    const unsigned int n2_global_offset = fvm_n2->global_offset();
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_global_offset = edges.global_offset1(ie);
+    const unsigned int n2_global_offset = edges.global_offset2(ie);
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     {
       //for node 1 of the edge
@@ -138,11 +137,11 @@ void ElectrodeSimulationRegion::DDM2_Function(PetscScalar * x, Vec f, InsertMode
 
 
       // "flux" from node 2 to node 1
-      PetscScalar f_psi =  eps*fvm_n1->cv_surface_area(fvm_n2)*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
-      PetscScalar f_q =  kap*fvm_n1->cv_surface_area(fvm_n2)*(T2 - T1)/fvm_n1->distance(fvm_n2) ;
+      PetscScalar f_psi =  eps*edges.cv_surface_area(ie)*(V2 - V1)/edges.length(ie) ;
+      PetscScalar f_q =  kap*edges.cv_surface_area(ie)*(T2 - T1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
         iy.push_back(n1_global_offset+0);
         y.push_back(f_psi);
@@ -150,7 +149,7 @@ void ElectrodeSimulationRegion::DDM2_Function(PetscScalar * x, Vec f, InsertMode
         y.push_back(f_q);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
         iy.push_back(n2_global_offset+0);
         y.push_back(-f_psi);
@@ -196,24 +195,23 @@ void ElectrodeSimulationRegion::DDM2_Jacobian(PetscScalar * x, Mat *jac, InsertM
   mt->set_ad_num(adtl::AutoDScalar::numdir);
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_global_offset = fvm_n1->global_offset();
-    const unsigned int n2_global_offset = fvm_n2->global_offset();
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_global_offset = edges.global_offset1(ie);
+    const unsigned int n2_global_offset = edges.global_offset2(ie);
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     {
       //for node 1 of the edge
@@ -237,11 +235,11 @@ void ElectrodeSimulationRegion::DDM2_Jacobian(PetscScalar * x, Mat *jac, InsertM
 
 
       // "flux" from node 2 to node 1
-      AutoDScalar f_psi =  eps*fvm_n1->cv_surface_area(fvm_n2)*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
-      AutoDScalar f_q =  kap*fvm_n1->cv_surface_area(fvm_n2)*(T2 - T1)/fvm_n1->distance(fvm_n2) ;
+      AutoDScalar f_psi =  eps*edges.cv_surface_area(ie)*(V2 - V1)/edges.length(ie) ;
+      AutoDScalar f_q =  kap*edges.cv_surface_area(ie)*(T2 - T1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
         MatSetValue(*jac, n1_global_offset, n1_global_offset, f_psi.getADValue(0), ADD_VALUES);
         MatSetValue(*jac, n1_global_offset, n2_global_offset, f_psi.getADValue(1), ADD_VALUES);
@@ -250,7 +248,7 @@ void ElectrodeSimulationRegion::DDM2_Jacobian(PetscScalar * x, Mat *jac, InsertM
         MatSetValue(*jac, n1_global_offset+1, n2_global_offset+1, f_q.getADValue(1), ADD_VALUES);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
         MatSetValue(*jac, n2_global_offset, n1_global_offset, -f_psi.getADValue(0), ADD_VALUES);
         MatSetValue(*jac, n2_global_offset, n2_global_offset, -f_psi.getADValue(1), ADD_VALUES);
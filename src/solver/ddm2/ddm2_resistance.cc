@@ -103,24 +103,23 @@ void MetalSimulationRegion::DDM2_Function(PetscScalar * x, Vec f, InsertMode &ad
   y.reserve(4*n_edge());
 
   // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_global_offset = fvm_n1->global_offset();
-    const unsigned int n2_global_offset = fvm_n2->global_offset();
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_global_offset = edges.global_offset1(ie);
+    const unsigned int n2_global_offset = edges.global_offset2(ie);
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     {
       //for node 1 of the edge
@@ -138,14 +137,14 @@ void MetalSimulationRegion::DDM2_Function(PetscScalar * x, Vec f, InsertMode &ad
       PetscScalar kap = 0.5*(kap1+kap2);       // kapa at mid point of the edge
 
       // truncated to positive
-      double S = std::abs(fvm_n1->cv_surface_area(fvm_n2));
+      double S = std::abs(edges.cv_surface_area(ie));
 
       // "flux" from node 2 to node 1
-      PetscScalar f_psi = sigma*S*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
-      PetscScalar f_q   =  kap*S*(T2 - T1)/fvm_n1->distance(fvm_n2) ;
+      PetscScalar f_psi = sigma*S*(V2 - V1)/edges.length(ie) ;
+      PetscScalar f_q   =  kap*S*(T2 - T1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
         iy.push_back(n1_global_offset+0);
         y.push_back(f_psi);
@@ -153,7 +152,7 @@ void MetalSimulationRegion::DDM2_Function(PetscScalar * x, Vec f, InsertMode &ad
         y.push_back(f_q);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
         iy.push_back(n2_global_offset+0);
         y.push_back(-f_psi);
@@ -203,29 +202,28 @@ void MetalSimulationRegion::DDM2_Jacobian(PetscScalar * x, Mat *jac, InsertMode
   const PetscScalar sigma = mt->basic->Conductance();
 
  // search all the edges of this region, do integral over control volume...
-  const_edge_iterator it = edges_begin();
-  const_edge_iterator it_end = edges_end();
-  for(; it!=it_end; ++it)
+  const FVM_EdgeTable & edges = edge_table();
+  for(unsigned int ie=0; ie<edges.size(); ++ie)
   {
     // fvm_node of node1
-    const FVM_Node * fvm_n1 = (*it).first;
+    const FVM_Node * fvm_n1 = edges.node1(ie);
     // fvm_node of node2
-    const FVM_Node * fvm_n2 = (*it).second;
+    const FVM_Node * fvm_n2 = edges.node2(ie);
 
     // fvm_node_data of node1
-    const FVM_NodeData * n1_data =  fvm_n1->node_data();
+    const FVM_NodeData * n1_data =  edges.data1(ie);
     // fvm_node_data of node2
-    const FVM_NodeData * n2_data =  fvm_n2->node_data();
+    const FVM_NodeData * n2_data =  edges.data2(ie);
 
-    const unsigned int n1_global_offset = fvm_n1->global_offset();
-    const unsigned int n2_global_offset = fvm_n2->global_offset();
-    const unsigned int n1_local_offset = fvm_n1->local_offset();
-    const unsigned int n2_local_offset = fvm_n2->local_offset();
+    const unsigned int n1_global_offset = edges.global_offset1(ie);
+    const unsigned int n2_global_offset = edges.global_offset2(ie);
+    const unsigned int n1_local_offset = edges.local_offset1(ie);
+    const unsigned int n2_local_offset = edges.local_offset2(ie);
 
     // the row/colume position of variables in the matrix
     PetscInt row[2],col[2];
-    row[0] = col[0] = fvm_n1->global_offset();
-    row[1] = col[1] = fvm_n2->global_offset();
+    row[0] = col[0] = edges.global_offset1(ie);
+    row[1] = col[1] = edges.global_offset2(ie);
 
     // here we use AD, however it is great overkill for such a simple problem.
     {
@@ -244,13 +242,13 @@ void MetalSimulationRegion::DDM2_Jacobian(PetscScalar * x, Mat *jac, InsertMode
       PetscScalar kap = 0.5*(kap1+kap2);       // kapa at mid point of the edge
 
       // truncated to positive
-      double S = std::abs(fvm_n1->cv_surface_area(fvm_n2));
+      double S = std::abs(edges.cv_surface_area(ie));
       // "flux" from node 2 to node 1
-      AutoDScalar f_psi = sigma*S*(V2 - V1)/fvm_n1->distance(fvm_n2) ;
-      AutoDScalar f_q =  kap*S*(T2 - T1)/fvm_n1->distance(fvm_n2) ;
+      AutoDScalar f_psi = sigma*S*(V2 - V1)/edges.length(ie) ;
+      AutoDScalar f_q =  kap*S*(T2 - T1)/edges.length(ie) ;
 
       // ignore thoese ghost nodes
-      if( fvm_n1->on_processor() )
+      if( edges.on_processor1(ie) )
       {
         MatSetValue(*jac, n1_global_offset, n1_global_offset, f_psi.getADValue(0), ADD_VALUES);
         MatSetValue(*jac, n1_global_offset, n2_global_offset, f_psi.getADValue(1), ADD_VALUES);
@@ -259,7 +257,7 @@ void MetalSimulationRegion::DDM2_Jacobian(PetscScalar * x, Mat *jac, InsertMode
         MatSetValue(*jac, n1_global_offset+1, n2_global_offset+1, f_q.getADValue(1), ADD_VALUES);
       }
 
-      if( fvm_n2->on_processor() )
+      if( edges.on_processor2(ie) )
       {
         MatSetValue(*jac, n2_global_offset, n1_global_offset, -f_psi.getADValue(0), ADD_VALUES);
         MatSetValue(*jac, n2_global_offset, n2_global_offset, -f_psi.getADValue(1), ADD_VALUES);
@@ -352,6 +352,8 @@ int DDMSolverBase::solve_dcsweep()
     Vec xs1, xs2, xs3;
     PetscScalar Vs1=Vscan, Vs2=Vscan, Vs3=Vscan;
     std::stack<PetscScalar> V_retry;
+    // accepted steps since the last mesh adaptation
+    int adapt_steps = 0;
     VecDuplicate ( x,&xs1 );
     VecDuplicate ( x,&xs2 );
     VecDuplicate ( x,&xs3 );
@@ -436,6 +438,16 @@ int DDMSolverBase::solve_dcsweep()
         <<"--------------------------------------------------------------------------------\n"
         <<"      "<<SNESConvergedReasons[reason]<<", total linear iteration " << lits << "\n\n\n";
         RECORD();
+
+        // stop here for mesh adaptation, the sweep will be continued from Vscan on the new mesh
+        if ( SolverSpecify::AdaptInterval > 0 && ++adapt_steps >= SolverSpecify::AdaptInterval && V_retry.empty() &&
+             (Vscan*SolverSpecify::VStep) <= SolverSpecify::VStop*SolverSpecify::VStep* ( 1.0+1e-7 ) )
+        {
+          SolverSpecify::VStart = Vscan;
+          SolverSpecify::VStep  = VStep;
+          SolverSpecify::AdaptRequest = true;
+          break;
+        }
       }
       else // oh, diverged... reduce step and try again
       {
@@ -524,6 +536,8 @@ int DDMSolverBase::solve_dcsweep()
     Vec xs1, xs2, xs3;
     PetscScalar Is1=Iscan, Is2=Iscan, Is3=Iscan;
     std::stack<PetscScalar> I_retry;
+    // accepted steps since the last mesh adaptation
+    int adapt_steps = 0;
     VecDuplicate ( x,&xs1 );
     VecDuplicate ( x,&xs2 );
     VecDuplicate ( x,&xs3 );
@@ -605,6 +619,16 @@ int DDMSolverBase::solve_dcsweep()
         <<"--------------------------------------------------------------------------------\n"
         <<"      "<<SNESConvergedReasons[reason]<<", total linear iteration " << lits << "\n\n\n";
         RECORD();
+
+        // stop here for mesh adaptation, the sweep will be continued from Iscan on the new mesh
+        if ( SolverSpecify::AdaptInterval > 0 && ++adapt_steps >= SolverSpecify::AdaptInterval && I_retry.empty() &&
+             (Iscan*SolverSpecify::IStep) <= SolverSpecify::IStop*SolverSpecify::IStep* ( 1.0+1e-7 ) )
+        {
+          SolverSpecify::IStart = Iscan;
+          SolverSpecify::IStep  = IStep;
+          SolverSpecify::AdaptRequest = true;
+          break;
+        }
       }
       else // oh, diverged... reduce step and try again
       {
@@ -1231,8 +1255,9 @@ int DDMSolverBase::solve_transient()
   // time dependent
   SolverSpecify::TimeDependent = true;
 
-  // if BDF2 scheme is used, we should set SolverSpecify::BDF2_LowerOrder flag to true
-  if ( SolverSpecify::TS_type==SolverSpecify::BDF2 )
+  // if BDF2 scheme is used, we should set SolverSpecify::BDF2_LowerOrder flag to true,
+  // except when resumed after mesh adaptation, the last step and dt_last are carried over to the new mesh
+  if ( SolverSpecify::TS_type==SolverSpecify::BDF2 && !SolverSpecify::AdaptResume )
     SolverSpecify::BDF2_LowerOrder = true;
 
   // we have a previous dc solution
@@ -1268,6 +1293,9 @@ int DDMSolverBase::solve_transient()
   // time step counter
   SolverSpecify::T_Cycles=0;
 
+  // accepted steps since the last mesh adaptation
+  int adapt_steps = 0;
+
   double dt_dynamic_factor = 1.0;
 
   // the main loop of transient solver.
@@ -1460,6 +1488,16 @@ int DDMSolverBase::solve_transient()
     if ( SolverSpecify::TS_type==SolverSpecify::BDF2 )
       SolverSpecify::BDF2_LowerOrder = this->BDF2_positive_defined();
 
+    // stop here for mesh adaptation, the transient will be continued from the last accepted time on the new mesh
+    if ( SolverSpecify::AdaptInterval > 0 && ++adapt_steps >= SolverSpecify::AdaptInterval &&
+         SolverSpecify::clock < SolverSpecify::TStop + 0.5*SolverSpecify::dt )
+    {
+      SolverSpecify::TStart = SolverSpecify::clock - SolverSpecify::dt;
+      SolverSpecify::TStep  = SolverSpecify::dt;
+      SolverSpecify::AdaptRequest = true;
+      break;
+    }
+
     // use by auto step control and predict
     if( SolverSpecify::AutoStep  || SolverSpecify::Predict )
     {
@@ -269,6 +269,58 @@ void MixASolverBase::set_extra_matrix_nonzero_pattern()
 
 
 
+void MixASolverBase::set_extra_matrix_nonzero_columns(std::map<PetscInt, std::vector<PetscInt> > & extra_columns)
+{
+  // spice matrix is small, let each circuit row hold all the circuit dofs and electrode dofs
+  unsigned int n_extra_dofs = this->extra_dofs();
+  std::vector<PetscInt> ckt_columns;
+  for(unsigned int n=0; n<n_extra_dofs; ++n)
+    ckt_columns.push_back(n_global_dofs - n_extra_dofs + n);
+  for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); ++b)
+  {
+    const BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+    if(this->bc_dofs(bc) > 0)
+      ckt_columns.push_back(bc->global_offset());
+  }
+  for(unsigned int n=0; n<n_extra_dofs; ++n)
+    extra_columns[n_global_dofs - n_extra_dofs + n] = ckt_columns;
+
+  // the coupling between electrode nodes and circuit node
+  for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); ++b)
+  {
+    const BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+    if(!bc->is_spice_electrode()) continue;
+
+    unsigned int spice_node_index = _circuit->get_spice_node_by_bc(bc);
+    genius_assert(spice_node_index!=invalid_uint);
+    PetscInt ckt_col = _circuit->global_offset_x(spice_node_index);
+    std::vector<PetscInt> & ckt_row_columns = extra_columns[_circuit->global_offset_f(spice_node_index)];
+
+    const std::vector<const Node *> & bc_nodes = bc->nodes();
+    for(unsigned int nb=0; nb<bc_nodes.size(); ++nb)
+    {
+      BoundaryCondition::const_region_node_iterator  rnode_it     = bc->region_node_begin(bc_nodes[nb]);
+      BoundaryCondition::const_region_node_iterator  end_rnode_it = bc->region_node_end(bc_nodes[nb]);
+      for(; rnode_it!=end_rnode_it; ++rnode_it  )
+      {
+        const FVM_Node * bd_fvm_node = (*rnode_it).second.second;
+        unsigned int local_node_dofs = this->node_dofs( (*rnode_it).second.first );
+        for(unsigned int i=0; i<local_node_dofs; ++i)
+        {
+          extra_columns[bd_fvm_node->global_offset() + i].push_back(ckt_col);
+          ckt_row_columns.push_back(bd_fvm_node->global_offset() + i);
+
+          FVM_Node::fvm_neighbor_node_iterator nb_it = bd_fvm_node->neighbor_node_begin();
+          for(; nb_it != bd_fvm_node->neighbor_node_end(); ++nb_it)
+            ckt_row_columns.push_back((*nb_it).first->global_offset() + i);
+        }
+      }
+    }
+  }
+}
+
+
+
 /*------------------------------------------------------------------
  * return the extra dofs of spice circuit
  */
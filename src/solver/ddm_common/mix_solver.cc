@@ -167,6 +167,29 @@ void MixSolverBase::set_extra_matrix_nonzero_pattern()
 }
 
 
+void MixSolverBase::set_extra_matrix_nonzero_columns(std::map<PetscInt, std::vector<PetscInt> > & extra_columns)
+{
+  // the electrode equations coupled by spice circuit
+  std::vector<PetscInt> electrode_columns;
+  for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); ++b)
+  {
+    const BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+    if(bc->is_spice_electrode())
+      electrode_columns.push_back(bc->global_offset());
+  }
+
+  for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); ++b)
+  {
+    const BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+    if(bc->is_spice_electrode())
+    {
+      std::vector<PetscInt> & columns = extra_columns[bc->array_offset()];
+      columns.insert(columns.end(), electrode_columns.begin(), electrode_columns.end());
+    }
+  }
+}
+
+
 int MixSolverBase::pre_solve_process(bool load_solution)
 {
   // spice voltage source/current source maybe changed, here we load solution vector again 
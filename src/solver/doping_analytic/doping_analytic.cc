@@ -33,6 +33,7 @@
 #include "interpolation_2d_nn.h"
 //#include "interpolation_3d_qshep.h"
 #include "interpolation_3d_nbtet.h"
+#include "threads.h"
 
 using PhysicalUnit::cm;
 using PhysicalUnit::um;
@@ -139,23 +140,52 @@ int DopingAnalytic::solve()
       ion_map.insert(std::make_pair(name, std::make_pair(ion_index, ion_type)));
     }
 
+    // gather the local nodes, the analytic profiles are evaluated in parallel on node batches
+    std::vector<FVM_Node *> nodes;
+    std::vector<double> x, y, z;
     SimulationRegion::local_node_iterator node_it = region->on_local_nodes_begin();
     SimulationRegion::local_node_iterator node_it_end = region->on_local_nodes_end();
     for(; node_it!=node_it_end; ++node_it)
     {
-      FVM_Node * fvm_node = *node_it;
-      FVM_NodeData * node_data = fvm_node->node_data();
+      const Node * node = (*node_it)->root_node();
+      nodes.push_back(*node_it);
+      x.push_back((*node)(0));
+      y.push_back((*node)(1));
+      z.push_back((*node)(2));
+    }
+    if(nodes.empty()) continue;
+
+    std::vector<DopingFunction *> custom_funs;
+    for (std::map<std::string,DopingFunction *>::iterator it = _custom_profile_funs.begin();
+         it!=_custom_profile_funs.end(); it++)
+      custom_funs.push_back(it->second);
+
+    DopingBatch batch(_doping_funs, custom_funs, x, y, z);
+    Threads::parallel_for_dynamic(0, nodes.size(), 256, batch);
+
+    for(unsigned int n=0; n<nodes.size(); ++n)
+    {
+      FVM_NodeData * node_data = nodes[n]->node_data();
       genius_assert(node_data!=NULL);
 
-      const Node * node = fvm_node->root_node();
-      node_data->Na() = doping_Na( node );
-      node_data->Nd() = doping_Nd( node );
+      const Node * node = nodes[n]->root_node();
+      node_data->Na() = batch.Na[n];
+      node_data->Nd() = batch.Nd[n];
+      // the interpolated doping data
+      double unit = 1.0/std::pow(PhysicalUnit::cm,3.0);
+      for(size_t i=0; i<_doping_data.size(); i++)
+      {
+        double d = unit * _do_doping_interp(i, node, "doping");
+        if( d < 0.0 ) node_data->Na() -= d;
+        if( d > 0.0 ) node_data->Nd() += d;
+      }
       // fill custom defined variable
+      unsigned int c = 0;
       for (std::map<std::string,DopingFunction *>::iterator it = _custom_profile_funs.begin();
-           it!=_custom_profile_funs.end(); it++)
+           it!=_custom_profile_funs.end(); it++, c++)
       {
         const std::string & name = it->first;
-        double d = it->second->profile((*node)(0),(*node)(1),(*node)(2));
+        double d = batch.custom[c][n];
         node_data->data<Real>(ion_map[name].first) = d;
         if(ion_map[name].second < 0 ) node_data->Na() += d;
         if(ion_map[name].second > 0 ) node_data->Nd() += d;
@@ -168,6 +198,36 @@ int DopingAnalytic::solve()
 }
 
 
+/*------------------------------------------------------------------
+ * evaluate the analytic doping functions on a range of nodes
+ */
+DopingAnalytic::DopingBatch::DopingBatch(const std::vector<DopingFunction *> &funs, const std::vector<DopingFunction *> &custom_funs,
+                                         const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &z)
+  : Na(x.size(), 0.0), Nd(x.size(), 0.0), custom(custom_funs.size(), std::vector<double>(x.size(), 0.0)),
+    _funs(funs), _custom_funs(custom_funs), _x(x), _y(y), _z(z)
+{}
+
+
+void DopingAnalytic::DopingBatch::operator()(unsigned int begin, unsigned int end, unsigned int)
+{
+  const unsigned int n = end - begin;
+  std::vector<double> d(n);
+
+  for(size_t i=0; i<_funs.size(); i++)
+  {
+    _funs[i]->profiles(n, &_x[begin], &_y[begin], &_z[begin], &d[0]);
+    for(unsigned int k=0; k<n; ++k)
+    {
+      if( d[k] < 0.0 ) Na[begin+k] -= d[k];
+      if( d[k] > 0.0 ) Nd[begin+k] += d[k];
+    }
+  }
+
+  for(size_t i=0; i<_custom_funs.size(); i++)
+    _custom_funs[i]->profiles(n, &_x[begin], &_y[begin], &_z[begin], &custom[i][begin]);
+}
+
+
 //-----------------------------------------------------------------------
 // private functions
 
@@ -710,45 +770,3 @@ double DopingAnalytic::_do_doping_interp(int i, const Node *node, const std::str
 #endif
   return d;
 }
-
-double DopingAnalytic::doping_Na(const Node * node)
-{
-  double dop = 0.0;
-
-  //only add negative value
-  for(size_t i=0; i<_doping_funs.size(); i++)
-  {
-    double d = _doping_funs[i]->profile((*node)(0),(*node)(1),(*node)(2));
-    dop += d < 0.0 ? d: 0.0;
-  }
-  double unit = 1.0/std::pow(PhysicalUnit::cm,3.0);
-  for(size_t i=0; i<_doping_data.size(); i++)
-  {
-    double d = unit * _do_doping_interp(i, node, "Na");
-    dop += d < 0.0 ? d: 0.0;
-  }
-
-  return std::abs(dop);
-}
-
-
-
-double DopingAnalytic::doping_Nd(const Node * node)
-{
-  double dop = 0.0;
-
-  //only add positive value
-  for(size_t i=0; i<_doping_funs.size(); i++)
-  {
-    double d = _doping_funs[i]->profile((*node)(0),(*node)(1),(*node)(2));
-    dop += d > 0.0 ? d: 0.0;
-  }
-  double unit = 1.0/std::pow(PhysicalUnit::cm,3.0);
-  for(size_t i=0; i<_doping_data.size(); i++)
-  {
-    double d = unit * _do_doping_interp(i, node, "Nd");
-    dop += d > 0.0 ? d: 0.0;
-  }
-
-  return std::abs(dop);
-}
@@ -1,6 +1,7 @@
 #include "doping_fun.h"
 
 #include <cmath>
+#include <algorithm>
 //win32 does not have erfc function
 #ifdef WINDOWS
 #include "mathfunc.h"
@@ -9,7 +10,7 @@
 
 //------------------------------------------------------------------
 
-double UniformDopingFunction::profile(double x,double y,double z)
+double UniformDopingFunction::profile(double x,double y,double z) const
 {
   if( x >= _xmin-1e-6 && x <= _xmax+1e-6 &&
       y >= _ymin-1e-6 && y <= _ymax+1e-6 &&
@@ -26,7 +27,7 @@ double UniformDopingFunction::profile(double x,double y,double z)
 /**
  * compute doping concentration by point location
  */
-double AnalyticDopingFunction::profile(double x, double y, double z)
+double AnalyticDopingFunction::profile(double x, double y, double z) const
 {
   double dx, dy, dz;
   if ( _XERFC )
@@ -93,102 +94,126 @@ PolyMaskDopingFunction::PolyMaskDopingFunction(double ion, const std::vector<Poi
     // doping line direction
   double deg = 3.14159265359/180.0;
   _dir = Point( sin(theta*deg)*cos(phi*deg), cos(theta*deg), sin(theta*deg)*sin(phi*deg));
+
+  Plane mask_plane = _mask_mesh.plane();
+  _plane_point = mask_plane.point();
+  _plane_norm = mask_plane.normal();
+
+  // the mask mesh is a linear map of the index pair
+  _loc0 = _mask_mesh.location(std::make_pair(0u, 0u));
+  _step_i = _mask_mesh.location(std::make_pair(1u, 0u)) - _loc0;
+  _step_j = _mask_mesh.location(std::make_pair(0u, 1u)) - _loc0;
+
+  double density_of_doping_line = (_char_lateral/_resolution_factor);
+  _lnorm = (density_of_doping_line*density_of_doping_line)/(3.1415927*_char_lateral*_char_lateral);
+
+  const double eps = 1e-10;
+  _separable = std::abs(_step_i*_dir) < eps*_step_i.size() &&
+               std::abs(_step_j*_dir) < eps*_step_j.size() &&
+               std::abs(_step_i*_step_j) < eps*_step_i.size()*_step_j.size();
 }
 
 
 
-double PolyMaskDopingFunction::profile(double x, double y, double z)
+double PolyMaskDopingFunction::profile(double x, double y, double z) const
 {
-  Point p(x, y, z); // doping point
-  Plane mask_plane = _mask_mesh.plane(); // mask plane
-  Point point_on_plane;
-  {
-    Point  plane_point = mask_plane.point();
-    Point  plane_norm = mask_plane.normal();
+  std::vector<double> buffer;
+  return _profile(Point(x, y, z), buffer);
+}
 
-    double t = (plane_point - p)*plane_norm/(plane_norm*_dir);
-    point_on_plane = p + _dir*t;
-  }
+
+
+void PolyMaskDopingFunction::profiles(unsigned int n, const double *x, const double *y, const double *z, double *result) const
+{
+  std::vector<double> buffer;
+  for(unsigned int i=0; i<n; ++i)
+    result[i] = _profile(Point(x[i], y[i], z[i]), buffer);
+}
+
+
+
+double PolyMaskDopingFunction::_profile(const Point &p, std::vector<double> &buffer) const
+{
+  // doping point project to mask plane along doping line
+  double t = (_plane_point - p)*_plane_norm/(_plane_norm*_dir);
+  Point point_on_plane = p + _dir*t;
 
   double r = (p-point_on_plane)*_dir;
   if( r > _rmax + 5*_char_lateral || r < _rmin - 5*_char_lateral ) return 0.0;
 
-  double profile = 0.0;
-  const double A = prof_func_lnorm();
-  std::vector<double> vecr, vecl;   // array of range/lateral coordinates
-
   // if point outside the doping box, skip
-  typedef std::pair<unsigned int, unsigned int> Idx;
   std::pair<Idx, Idx> range;
   if( !_mask_mesh.index_range(point_on_plane, 5*_char_lateral, range) ) return 0.0;
 
-    // or we have to integral all the doping lines
-  for(unsigned int i=range.first.first; i<=range.second.first; ++i)
-    for(unsigned int j=range.first.second; j<=range.second.second; ++j)
-  {
-    Idx idx = std::make_pair(i,j);
-    if( !_mask_mesh.inside(idx) ) continue;
-
-    Point loc = _mask_mesh.location(idx);
-    Point project_p = loc + _dir*((p-loc)*_dir);
-
-    double r = (project_p - loc)*_dir;
-    double dist = (project_p - p).size();
-
-    vecr.push_back(r);
-    vecl.push_back(dist);
-  }
+  const unsigned int i_begin = range.first.first,  i_end = range.second.first;
+  const unsigned int j_begin = range.first.second, j_end = range.second.second;
+  const double L2 = _char_lateral*_char_lateral;
 
-  std::vector<double> vecfr = prof_func_r(vecr);
-  std::vector<double> vecfl = prof_func_l(vecl);
+  double profile = 0.0;
 
-  for (size_t i=0; i<vecfr.size(); ++i)
+  if(_separable)
   {
-    profile += A*vecfr[i]*vecfl[i];
-  }
-
-  return _ion*profile;
-}
-
+    // all the doping lines have the same range r, and the lateral distance
+    // is separated into the distance along each index direction
+    const double hi2 = _step_i.size_sq(), hj2 = _step_j.size_sq();
+    const double a = (point_on_plane - _loc0)*_step_i/hi2;
+    const double b = (point_on_plane - _loc0)*_step_j/hj2;
+
+    // prefix sum of the lateral function along j
+    buffer.resize(j_end - j_begin + 2);
+    buffer[0] = 0.0;
+    for(unsigned int j=j_begin; j<=j_end; ++j)
+      buffer[j-j_begin+1] = buffer[j-j_begin] + exp(-hj2*(b-j)*(b-j)/L2);
+
+    for(unsigned int i=i_begin; i<=i_end; ++i)
+    {
+      double row = 0.0;
+      for(unsigned int k=0; k<_mask_mesh.n_runs(i); ++k)
+      {
+        const Idx & run = _mask_mesh.run(i, k);
+        if( run.second < j_begin || run.first > j_end ) continue;
+        unsigned int j0 = std::max(run.first, j_begin);
+        unsigned int j1 = std::min(run.second, j_end);
+        row += buffer[j1-j_begin+1] - buffer[j0-j_begin];
+      }
+      if(row != 0.0)
+        profile += row*exp(-hi2*(a-i)*(a-i)/L2);
+    }
 
-std::vector<double> PolyMaskDopingFunction::prof_func_r(const std::vector<double> &rs) const
-{
-  std::vector<double> res;
-  for (std::vector<double>::const_iterator i=rs.begin(); i!=rs.end(); i++)
-  {
-    const double r = *i;
+    return _ion*_lnorm*prof_func_r(r)*profile;
+  }
 
-    double dr;
-    if(r<_rmin)
-      dr = exp(-(r-_rmin)*(r-_rmin)/(_char_depth*_char_depth));
-    else if(r<=_rmax)
-      dr = 1.0;
-    else
-      dr = exp(-(r-_rmax)*(r-_rmax)/(_char_depth*_char_depth));
+  // or we have to integral all the doping lines
+  for(unsigned int i=i_begin; i<=i_end; ++i)
+    for(unsigned int k=0; k<_mask_mesh.n_runs(i); ++k)
+    {
+      const Idx & run = _mask_mesh.run(i, k);
+      if( run.second < j_begin || run.first > j_end ) continue;
+      unsigned int j0 = std::max(run.first, j_begin);
+      unsigned int j1 = std::min(run.second, j_end);
+      for(unsigned int j=j0; j<=j1; ++j)
+      {
+        Point loc = _loc0 + _step_i*i + _step_j*j;
+        double r = (p-loc)*_dir;
+        double dist2 = (p-loc).size_sq() - r*r;
+        profile += prof_func_r(r)*exp(-std::max(dist2, 0.0)/L2);
+      }
+    }
 
-    res.push_back(_peak*dr);
-  }
-  return res;
+  return _ion*_lnorm*profile;
 }
 
-std::vector<double> PolyMaskDopingFunction::prof_func_l(const std::vector<double> &dists) const
-{
-  std::vector<double> res;
-  for (std::vector<double>::const_iterator i=dists.begin(); i!=dists.end(); i++)
-  {
-    const double dist = *i;
-    if (dist==0.0)
-      res.push_back(1.0);
-    else
-      res.push_back( exp( -dist*dist/(_char_lateral*_char_lateral) ) );
-  }
-  return res;
-}
 
-double PolyMaskDopingFunction::prof_func_lnorm() const
+double PolyMaskDopingFunction::prof_func_r(double r) const
 {
-  double density_of_doping_line = (_char_lateral/_resolution_factor);
-  return (density_of_doping_line*density_of_doping_line)/(3.1415927*_char_lateral*_char_lateral);
+  double dr;
+  if(r<_rmin)
+    dr = exp(-(r-_rmin)*(r-_rmin)/(_char_depth*_char_depth));
+  else if(r<=_rmax)
+    dr = 1.0;
+  else
+    dr = exp(-(r-_rmax)*(r-_rmax)/(_char_depth*_char_depth));
+  return _peak*dr;
 }
 
 //------------------------------------------------------------------
@@ -223,11 +248,18 @@ void RecMaskDopingFunction::_init(double xmin, double xmax, double ymin, double
   double doping_zmax = _mask.point().z() + _rmax*_dir.z() + 5*_char_depth;
   _doping_min = Point(doping_xmin,doping_ymin,doping_zmin);
   _doping_max = Point(doping_xmax,doping_ymax,doping_zmax);
+
+  _normal_axis = 1;
+  if( _mask.is_yz_plane() ) _normal_axis = 0;
+  if( _mask.is_xy_plane() ) _normal_axis = 2;
+  Point normal;
+  normal(_normal_axis) = 1.0;
+  _separable = (_dir - normal*(_dir*normal)).size() < 1e-10;
 }
 
 
 
-double RecMaskDopingFunction::profile(double x, double y, double z)
+double RecMaskDopingFunction::profile(double x, double y, double z) const
 {
   Point p(x,y,z);
 
@@ -251,6 +283,23 @@ double RecMaskDopingFunction::profile(double x, double y, double z)
   double profile = 0.0;
   double sample_distance = _char_depth/_resolution_factor;
   const double A = (sample_distance*sample_distance)/(3.1415927*_char_lateral*_char_lateral);
+
+  if(_separable)
+  {
+    // the doping line is normal to the mask, all the lines have the same range
+    // and the lateral gauss function is the product of 1D ones in the mask plane
+    double r = (p - point_on_plane)*_dir;
+    double lateral = 1.0;
+    for(unsigned int k=0; k<3; ++k)
+    {
+      double sum = 0.0;
+      for(double s = hot_area_min(k); s<=hot_area_max(k); s+=sample_distance)
+        sum += (k == _normal_axis ? 1.0 : exp( -(p(k)-s)*(p(k)-s)/(_char_lateral*_char_lateral) ));
+      lateral *= sum;
+    }
+    return _ion*_profile_r(r)*A*lateral;
+  }
+
   for(double sx = hot_area_min.x(); sx<=hot_area_max.x(); sx+=sample_distance)
     for(double sy = hot_area_min.y(); sy<=hot_area_max.y(); sy+=sample_distance)
       for(double sz = hot_area_min.z(); sz<=hot_area_max.z(); sz+=sample_distance)
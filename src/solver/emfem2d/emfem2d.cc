@@ -33,6 +33,7 @@
 #include "petsc_utils.h"
 #include "spline.h"
 #include "parallel.h"
+#include "optical_cache.h"
 
 using PhysicalUnit::V;
 using PhysicalUnit::A;
@@ -65,6 +66,12 @@ int EMFEM2DSolver::create_solver()
   // abstol = 1e-20*n_global_dofs  - the absolute convergence tolerance (absolute size of the residual norm)
   KSPSetTolerances(ksp, 1e-10*n_global_dofs, 1e-20*n_global_dofs, PETSC_DEFAULT, n_global_dofs/10);
 
+  // the reduced basis solution is a good initial guess for the full solve
+  if(_rb_sweep)
+    KSPSetInitialGuessNonzero(ksp, PETSC_TRUE);
+
+  _pc_mode = Unknown_Mode;
+
   // user can do further adjusment from command line
   KSPSetFromOptions (ksp);
 
@@ -96,39 +103,60 @@ int EMFEM2DSolver::solve()
 {
   START_LOG("EM FEM 2D Linear Solver", "solve");
 
-  // for each wave length, solve 2d fem probelm
-  for(unsigned int n=0; n<_optical_sources.size(); ++n)
+  // the optical fields of identical problem are loaded from disk
+  OpticalCache cache(_system, _card);
+  if(cache.enabled())
   {
-    if(_optical_sources[n].TE_weight>0)
+    hash_optical_inputs(cache);
+    if(cache.load())
     {
-      solve_TE_scatter_problem(_optical_sources[n].wave_length,
-                               _optical_sources[n].power*_optical_sources[n].TE_weight,
-                               _optical_sources[n].phi_TE);
-
-      //update solution
-      save_TE_solution(_optical_sources[n].wave_length,
-                       _optical_sources[n].power*_optical_sources[n].TE_weight,
-                       _optical_sources[n].phi_TE,
-                       _optical_sources[n].eta,
-                       _optical_sources[n].eta_auto);
+      STOP_LOG("EM FEM 2D Linear Solver", "solve");
+      return 0;
     }
+    cache.snapshot();
+  }
 
-    if(_optical_sources[n].TM_weight>0)
+  // the rhs is linear in the incident amplitude H*exp(j*phase0), so all the sources
+  // with the same wave length share one solution of unit incident wave for each mode.
+  // we sweep the spectrum with TE first and then TM, consecutive solves have similar
+  // matrices, which makes preconditioner reuse and reduced basis effective.
+  for(unsigned int mode=0; mode<2; ++mode)
+  {
+    std::vector<bool> solved(_optical_sources.size(), false);
+    for(unsigned int n=0; n<_optical_sources.size(); ++n)
     {
-      solve_TM_scatter_problem(_optical_sources[n].wave_length,
-                               _optical_sources[n].power*_optical_sources[n].TM_weight,
-                               _optical_sources[n].phi_TM);
+      if(solved[n]) continue;
+
+      const double lambda = _optical_sources[n].wave_length;
+      std::vector<unsigned int> group;
+      for(unsigned int m=n; m<_optical_sources.size(); ++m)
+      {
+        if(solved[m] || std::abs(_optical_sources[m].wave_length - lambda) > 1e-10*lambda) continue;
+        solved[m] = true;
+        double weight = mode==0 ? _optical_sources[m].TE_weight : _optical_sources[m].TM_weight;
+        if(weight>0) group.push_back(m);
+      }
+      if(group.empty()) continue;
+
+      if(mode==0)
+        solve_TE_scatter_problem(lambda);
+      else
+        solve_TM_scatter_problem(lambda);
 
       //update solution
-      save_TM_solution(_optical_sources[n].wave_length,
-                       _optical_sources[n].power*_optical_sources[n].TM_weight,
-                       _optical_sources[n].phi_TM,
-                       _optical_sources[n].eta,
-                       _optical_sources[n].eta_auto);
+      for(unsigned int g=0; g<group.size(); ++g)
+      {
+        const OpticalSource & source = _optical_sources[group[g]];
+        if(mode==0)
+          save_TE_solution(source.wave_length, source.power*source.TE_weight, source.phi_TE, source.eta, source.eta_auto);
+        else
+          save_TM_solution(source.wave_length, source.power*source.TM_weight, source.phi_TM, source.eta, source.eta_auto);
+      }
     }
-
   }
 
+  cache.save();
+
   STOP_LOG("EM FEM 2D Linear Solver", "solve");
 
   return 0;
@@ -138,6 +166,14 @@ int EMFEM2DSolver::solve()
 
 int EMFEM2DSolver::destroy_solver()
 {
+  for(unsigned int n=0; n<_TE_basis.size(); ++n)
+    VecDestroy(PetscDestroyObject(_TE_basis[n]));
+  _TE_basis.clear();
+
+  for(unsigned int n=0; n<_TM_basis.size(); ++n)
+    VecDestroy(PetscDestroyObject(_TM_basis[n]));
+  _TM_basis.clear();
+
   // clear linear contex
   clear_linear_data();
   return 0;
@@ -145,13 +181,60 @@ int EMFEM2DSolver::destroy_solver()
 
 
 
-void EMFEM2DSolver::solve_TM_scatter_problem(double lambda, double power, double phase0)
+void EMFEM2DSolver::hash_optical_inputs(OpticalCache & cache)
+{
+  for(unsigned int n=0; n<_optical_sources.size(); ++n)
+  {
+    const OpticalSource & source = _optical_sources[n];
+    cache.add(source.wave_length);
+    cache.add(source.power);
+    cache.add(source.TE_weight);
+    cache.add(source.TM_weight);
+    cache.add(source.phi_TE);
+    cache.add(source.phi_TM);
+    cache.add(source.eta);
+    cache.add(source.eta_auto);
+    for(unsigned int r=0; r<_system.n_regions(); ++r)
+    {
+      SimulationRegion * region = _system.region(r);
+      cache.add(region->get_optical_refraction(source.wave_length));
+      cache.add(region->get_optical_Eg(region->T_external()));
+    }
+  }
+}
+
+
+void EMFEM2DSolver::solve_TM_scatter_problem(double lambda)
+{
+  MESSAGE<<"Solve TM Mode. WaveLength = "<<lambda/um<< " um." << std::endl; RECORD();
+
+  build_TM_matrix_rhs(lambda);
+  solve_scatter_problem(TM_Mode, _TM_basis);
+}
+
+
+
+void EMFEM2DSolver::solve_TE_scatter_problem(double lambda)
+{
+  MESSAGE<<"Solve TE Mode. WaveLength = "<<lambda/um<< " um." << std::endl; RECORD();
+
+  build_TE_matrix_rhs(lambda);
+  solve_scatter_problem(TE_Mode, _TE_basis);
+}
+
+
+
+void EMFEM2DSolver::solve_scatter_problem(SCATTER_MODE mode, std::vector<Vec> & basis)
 {
-  MESSAGE<<"Solve TM Mode. WaveLength = "<<lambda/um<< " um, Power = " <<power/(J/s/cm/cm)<<" W/(cm^2)." << std::endl; RECORD();
+  if(_rb_sweep && reduced_basis_solve(basis)) return;
 
-  build_TM_matrix_rhs(lambda, power, phase0);
+  // the preconditioner built for a nearby wave length of the same mode is still a good one
+  if(_pc_reuse && _pc_mode == mode)
+    KSPSetOperators(ksp, A, A, SAME_PRECONDITIONER);
+  else
+    KSPSetOperators(ksp, A, A, SAME_NONZERO_PATTERN);//must reset pc by is call!
+  _pc_mode = mode;
 
-  KSPSetOperators(ksp, A, A, SAME_NONZERO_PATTERN);//must reset pc by is call!
   KSPSolve(ksp,b,x);
 
   KSPConvergedReason reason;
@@ -166,40 +249,141 @@ void EMFEM2DSolver::solve_TM_scatter_problem(double lambda, double power, double
   MESSAGE<<"------> residual norm = "<<rnorm<<" its = "<<its<<" with "<<KSPConvergedReasons[reason]<<"\n\n";
   RECORD();
 
+  if(_rb_sweep && reason>0)
+    extend_reduced_basis(basis);
 }
 
 
 
-void EMFEM2DSolver::solve_TE_scatter_problem(double lambda, double power, double phase0)
+bool EMFEM2DSolver::reduced_basis_solve(const std::vector<Vec> & basis)
 {
-  MESSAGE<<"Solve TE Mode. WaveLength = "<<lambda/um<< " um, Power = " <<power/(J/s/cm/cm)<<" W/(cm^2)." << std::endl; RECORD();
+  const unsigned int m = basis.size();
+  if(!m) return false;
+
+  // QR factorization of A*V by modified Gram-Schmidt, the minimal residual
+  // solution in span(V) is x = V*y with R*y = Q^T*b
+  std::vector<Vec> Q(m);
+  DenseMatrix<Real> R(m, m);
+  for(unsigned int i=0; i<m; ++i)
+  {
+    VecDuplicate(b, &Q[i]);
+    MatMult(A, basis[i], Q[i]);
+    for(unsigned int k=0; k<i; ++k)
+    {
+      PetscScalar r;
+      VecDot(Q[i], Q[k], &r);
+      R(k,i) = r;
+      VecAXPY(Q[i], -r, Q[k]);
+    }
+    PetscReal norm;
+    VecNorm(Q[i], NORM_2, &norm);
+    R(i,i) = norm;
+    if(norm>0) VecScale(Q[i], 1.0/norm);
+  }
 
-  build_TE_matrix_rhs(lambda, power, phase0);
+  std::vector<PetscScalar> c(m), y(m, 0.0);
+  for(unsigned int i=0; i<m; ++i)
+    VecDot(b, Q[i], &c[i]);
 
-  KSPSetOperators(ksp, A, A, SAME_NONZERO_PATTERN);//must reset pc by is call!
-  KSPSolve(ksp,b,x);
+  // back substitution, skip the vectors which are linear dependent under A
+  for(int i=m-1; i>=0; --i)
+  {
+    if(R(i,i) <= 1e-12*R(0,0)) continue;
+    PetscScalar sum = c[i];
+    for(unsigned int k=i+1; k<m; ++k)
+      sum -= R(i,k)*y[k];
+    y[i] = sum/R(i,i);
+  }
 
-  KSPConvergedReason reason;
-  KSPGetConvergedReason(ksp, &reason);
+  VecSet(x, 0.0);
+  VecMAXPY(x, m, &y[0], &basis[0]);
 
-  PetscInt   its;
-  KSPGetIterationNumber(ksp, &its);
+  // residual b - Q*c, computed explicitly to avoid cancellation
+  Vec r;
+  VecDuplicate(b, &r);
+  VecCopy(b, r);
+  for(unsigned int i=0; i<m; ++i)
+    if(R(i,i) > 1e-12*R(0,0))
+      VecAXPY(r, -c[i], Q[i]);
 
-  PetscReal  rnorm;
-  KSPGetResidualNorm(ksp, &rnorm);
+  PetscReal bnorm, rnorm;
+  VecNorm(b, NORM_2, &bnorm);
+  VecNorm(r, NORM_2, &rnorm);
 
-  MESSAGE<<"------> residual norm = "<<rnorm<<" its = "<<its<<" with "<<KSPConvergedReasons[reason]<<"\n\n";
+  VecDestroy(PetscDestroyObject(r));
+  for(unsigned int i=0; i<m; ++i)
+    VecDestroy(PetscDestroyObject(Q[i]));
+
+  bool accept = rnorm <= _rb_tol*bnorm;
+  MESSAGE<<"------> reduced basis of "<<m<<" vectors, relative residual = "<<rnorm/(bnorm+1e-300)
+         <<(accept ? ", accepted\n\n" : ", rejected\n");
   RECORD();
+
+  return accept;
 }
 
 
-void EMFEM2DSolver::build_TE_matrix_rhs(double lambda, double power, double phase0)
+
+void EMFEM2DSolver::extend_reduced_basis(std::vector<Vec> & basis)
+{
+  if(basis.size() >= 2*_rb_size) return;
+
+  // the basis is real, but the scatter problem is complex. add both x and j*x to
+  // keep the complex span, j*(a+jb) = -b+ja on each (real, imag) dof pair
+  Vec v[2];
+  VecDuplicate(x, &v[0]);
+  VecCopy(x, v[0]);
+  VecDuplicate(x, &v[1]);
+  {
+    PetscInt n;
+    PetscScalar *xx, *yy;
+    VecGetLocalSize(x, &n);
+    VecGetArray(x, &xx);
+    VecGetArray(v[1], &yy);
+    for(PetscInt i=0; i<n; i+=2)
+    {
+      yy[i]   = -xx[i+1];
+      yy[i+1] =  xx[i];
+    }
+    VecRestoreArray(v[1], &yy);
+    VecRestoreArray(x, &xx);
+  }
+
+  for(unsigned int k=0; k<2; ++k)
+  {
+    PetscReal norm0;
+    VecNorm(v[k], NORM_2, &norm0);
+
+    // modified Gram-Schmidt, twice is enough
+    for(unsigned int pass=0; pass<2; ++pass)
+      for(unsigned int i=0; i<basis.size(); ++i)
+      {
+        PetscScalar r;
+        VecDot(v[k], basis[i], &r);
+        VecAXPY(v[k], -r, basis[i]);
+      }
+
+    PetscReal norm;
+    VecNorm(v[k], NORM_2, &norm);
+    if(norm > 1e-10*norm0)
+    {
+      VecScale(v[k], 1.0/norm);
+      basis.push_back(v[k]);
+    }
+    else
+      VecDestroy(PetscDestroyObject(v[k]));
+  }
+}
+
+
+void EMFEM2DSolver::build_TE_matrix_rhs(double lambda)
 {
   //wave vector
   double k = 2*M_PI/lambda;
 
-  // wave magnitude, compute from power
-  double H = sqrt(power*sqrt(eps0/mu0));
+  // unit incident wave with zero initial phase
+  const double H = 1.0;
+  const double phase0 = 0.0;
 
   Complex j(0,1);
 
@@ -396,13 +580,14 @@ void EMFEM2DSolver::build_TE_matrix_rhs(double lambda, double power, double phas
 
 
 
-void EMFEM2DSolver::build_TM_matrix_rhs(double lambda, double power, double phase0)
+void EMFEM2DSolver::build_TM_matrix_rhs(double lambda)
 {
   //wave vector
   double k = 2*M_PI/lambda;
 
-  // wave magnitude, compute from power
-  double E = sqrt(power*sqrt(mu0/eps0));
+  // unit incident wave with zero initial phase
+  const double E = 1.0;
+  const double phase0 = 0.0;
 
   Complex j(0,1);
 
@@ -612,6 +797,9 @@ void EMFEM2DSolver::save_TE_solution(double lambda, double power, double phase0,
 
   Complex j(0,1);
 
+  // x is the scatter field of unit incident wave
+  Complex H_scale = H*std::exp(j*phase0);
+
   // the solution is in vec x
   VecScatterBegin(scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
   VecScatterEnd  (scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
@@ -639,7 +827,7 @@ void EMFEM2DSolver::save_TE_solution(double lambda, double power, double phase0,
         double phase = phase0 - k*(node->x()*cos(_incidence_angle)+node->y()*sin(_incidence_angle));
         Complex H_inc = H*std::exp(Complex(0,phase));
         unsigned int local_offset = node->local_dof_id();
-        Complex H_field = H_inc - Complex(lxx[local_offset], lxx[local_offset+1]);
+        Complex H_field = H_inc - H_scale*Complex(lxx[local_offset], lxx[local_offset+1]);
         H_element.push_back(H_field);
       }
       VectorValue<Complex> gradH = elem->gradient(H_element);
@@ -687,7 +875,7 @@ void EMFEM2DSolver::save_TE_solution(double lambda, double power, double phase0,
       unsigned int local_offset = node->local_dof_id();
 
       FVM_NodeData * fvm_node_data = fvm_node->node_data();
-      Complex H_field = H_inc - Complex(lxx[local_offset], lxx[local_offset+1]);
+      Complex H_field = H_inc - H_scale*Complex(lxx[local_offset], lxx[local_offset+1]);
       Complex E_field = node_Exy_map[node];
       if(append)
       {
@@ -716,6 +904,9 @@ void EMFEM2DSolver::save_TM_solution(double lambda, double power, double phase0,
   // wave magnitude, compute from power
   double E = sqrt(power*sqrt(mu0/eps0));
 
+  // x is the scatter field of unit incident wave
+  Complex E_scale = E*std::exp(Complex(0,phase0));
+
   // the solution is in vec x
   VecScatterBegin(scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
   VecScatterEnd  (scatter, x, lx, INSERT_VALUES, SCATTER_FORWARD);
@@ -751,7 +942,7 @@ void EMFEM2DSolver::save_TM_solution(double lambda, double power, double phase0,
       unsigned int local_offset = node->local_dof_id();
 
       FVM_NodeData * fvm_node_data = fvm_node->node_data();
-      Complex E_field = E_inc - Complex(lxx[local_offset], lxx[local_offset+1]);
+      Complex E_field = E_inc - E_scale*Complex(lxx[local_offset], lxx[local_offset+1]);
 
       if(append)
       {
@@ -1047,6 +1238,12 @@ void EMFEM2DSolver::setup_solver_parameters()
   // set preconditioner type
   SolverSpecify::PC = SolverSpecify::preconditioner_type(_card.get_string("pc", "asm"));
 
+  // spectrum sweep
+  _pc_reuse = _card.get_bool("pc.reuse", false);
+  _rb_sweep = _card.get_bool("sweep.rb", false);
+  _rb_tol   = _card.get_real("sweep.rb.tol", 1e-4);
+  _rb_size  = _card.get_int("sweep.rb.size", 8);
+
   // build the absorbing boundary
   build_absorb_chain();
 }
@@ -127,8 +127,21 @@ void FVM_LinearSolver::setup_linear_data()
   else
   {
     ierr = MatSetType(A,MATSEQAIJ); genius_assert(!ierr);
-    // alloc memory for sequence matrix here
-    ierr = MatSeqAIJSetPreallocation(A, 0, &n_nz[0]); genius_assert(!ierr);
+    if( !csr_row_offset.empty() )
+    {
+      // the exact nonzero structure is known, create it at once
+      ierr = MatSeqAIJSetPreallocationCSR(A, &csr_row_offset[0], &csr_columns[0], PETSC_NULL); genius_assert(!ierr);
+      // entries out of the structure are still allowed, with the cost of malloc
+      ierr = MatSetOption(A, MAT_NEW_NONZERO_ALLOCATION_ERR, PETSC_FALSE); genius_assert(!ierr);
+      // PETSc keeps its own copy
+      std::vector<PetscInt>().swap(csr_row_offset);
+      std::vector<PetscInt>().swap(csr_columns);
+    }
+    else
+    {
+      // alloc memory for sequence matrix here
+      ierr = MatSeqAIJSetPreallocation(A, 0, &n_nz[0]); genius_assert(!ierr);
+    }
   }
 
 
@@ -168,6 +168,7 @@ FVM_NonlinearSolver::FVM_NonlinearSolver(SimulationSystem & system): FVM_PDESolv
   // create petsc nonlinear solver context
   ierr = SNESCreate(PETSC_COMM_WORLD, &snes); genius_assert(!ierr);
 
+  local_is_global = false;
 }
 
 
@@ -214,6 +215,11 @@ void FVM_NonlinearSolver::setup_nonlinear_data()
 #endif
   ierr = VecScatterCreate(x, gis, lx, lis, &scatter); genius_assert(!ierr);
 
+  // serial dof map has identity local index set, the scatter is a plain copy and can be skipped
+  local_is_global = ( Genius::n_processors()==1 && local_index_array.size()==n_global_dofs );
+  for(unsigned int i=0; local_is_global && i<local_index_array.size(); ++i)
+    local_is_global = ( local_index_array[i]==static_cast<PetscInt>(i) && global_index_array[i]==static_cast<PetscInt>(i) );
+
 
   // create the jacobian matrix
   ierr = MatCreate(PETSC_COMM_WORLD,&J); genius_assert(!ierr);
@@ -229,8 +235,21 @@ void FVM_NonlinearSolver::setup_nonlinear_data()
   else
   {
     ierr = MatSetType(J,MATSEQAIJ); genius_assert(!ierr);
-    // alloc memory for sequence matrix here
-    ierr = MatSeqAIJSetPreallocation(J, 0, &n_nz[0]); genius_assert(!ierr);
+    if( !csr_row_offset.empty() )
+    {
+      // the exact nonzero structure is known, create it at once
+      ierr = MatSeqAIJSetPreallocationCSR(J, &csr_row_offset[0], &csr_columns[0], PETSC_NULL); genius_assert(!ierr);
+      // entries out of the structure are still allowed, with the cost of malloc
+      ierr = MatSetOption(J, MAT_NEW_NONZERO_ALLOCATION_ERR, PETSC_FALSE); genius_assert(!ierr);
+      // PETSc keeps its own copy
+      std::vector<PetscInt>().swap(csr_row_offset);
+      std::vector<PetscInt>().swap(csr_columns);
+    }
+    else
+    {
+      // alloc memory for sequence matrix here
+      ierr = MatSeqAIJSetPreallocation(J, 0, &n_nz[0]); genius_assert(!ierr);
+    }
   }
 
 
@@ -438,6 +457,48 @@ void FVM_NonlinearSolver::clear_nonlinear_data()
 }
 
 
+/*------------------------------------------------------------------
+ * get the array of v indexed by local offset
+ */
+PetscScalar * FVM_NonlinearSolver::get_local_array(Vec v, Vec lv)
+{
+  PetscScalar * array;
+  if( local_is_global )
+  {
+    // kernels only read the array, do not increase the state of v
+#if PETSC_VERSION_GE(3,2,0)
+    VecGetArrayRead(v, const_cast<const PetscScalar **>(&array));
+#else
+    VecGetArray(v, &array);
+#endif
+    return array;
+  }
+
+  VecScatterBegin(scatter, v, lv, INSERT_VALUES, SCATTER_FORWARD);
+  VecScatterEnd  (scatter, v, lv, INSERT_VALUES, SCATTER_FORWARD);
+  VecGetArray(lv, &array);
+  return array;
+}
+
+
+/*------------------------------------------------------------------
+ * restore the array got by get_local_array()
+ */
+void FVM_NonlinearSolver::restore_local_array(Vec v, Vec lv, PetscScalar ** array)
+{
+  if( local_is_global )
+  {
+#if PETSC_VERSION_GE(3,2,0)
+    VecRestoreArrayRead(v, const_cast<const PetscScalar **>(array));
+#else
+    VecRestoreArray(v, array);
+#endif
+    return;
+  }
+  VecRestoreArray(lv, array);
+}
+
+
 /*------------------------------------------------------------------
  * destructor: destroy context
  */
@@ -40,4 +40,8 @@ void FVM_PDESolver::build_dof_map()
     // for open source version
     set_serial_dof_map();
 #endif
+
+  // the edge loops read dof offsets from edge table
+  for(unsigned int n=0; n<_system.n_regions(); ++n)
+    _system.region(n)->build_edge_table_offsets();
 }
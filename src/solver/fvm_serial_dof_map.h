@@ -21,6 +21,8 @@
 
 
 #include <numeric>
+#include <algorithm>
+#include <map>
 
 #include "boundary_info.h"
 #include "fvm_pde_solver.h"
@@ -264,4 +266,161 @@ void FVM_PDESolver::set_serial_dof_map()
 
   // set n_nz and n_oz for extra dofs
   this->set_extra_matrix_nonzero_pattern();
+
+  // build the exact column structure, n_nz is replaced by exact value
+  this->set_serial_matrix_nonzero_columns();
+}
+
+
+
+void FVM_PDESolver::set_serial_matrix_nonzero_columns()
+{
+  csr_row_offset.clear();
+  csr_columns.clear();
+
+  // only for serial matrix
+  if( Genius::n_processors() > 1 ) return;
+
+  // hanging node moves matrix rows to its parent nodes, the structure can not be predicted by node pattern
+  for(unsigned int n=0; n<_system.n_regions(); ++n)
+    if( _system.region(n)->has_2d_hanging_node() || _system.region(n)->has_3d_hanging_node() ) return;
+
+  // the rows belong to the same node (or bc) share one column set
+  std::vector< std::vector<PetscInt> > patterns;
+  std::vector<unsigned int> row_pattern(n_local_dofs, invalid_uint);
+
+  for(unsigned int n=0; n<_system.n_regions(); ++n)
+  {
+    const SimulationRegion * region = _system.region(n);
+    unsigned int local_node_dofs = this->node_dofs( region );
+    if( !local_node_dofs ) continue;
+
+    SimulationRegion::const_processor_node_iterator it = region->on_processor_nodes_begin();
+    SimulationRegion::const_processor_node_iterator it_end = region->on_processor_nodes_end();
+    for(; it!=it_end; ++it)
+    {
+      const FVM_Node * fvm_node = *it;
+
+      patterns.push_back( std::vector<PetscInt>() );
+      std::vector<PetscInt> & columns = patterns.back();
+
+      // all the nodes involved
+      std::vector<const FVM_Node *> pde_nodes;
+      fvm_node->PDE_nodes(pde_nodes, this->all_neighbor_elements_involved(region));
+      for(unsigned int i=0; i<pde_nodes.size(); ++i)
+      {
+        unsigned int dof = this->node_dofs( _system.region(pde_nodes[i]->subdomain_id()) );
+        for(unsigned int k=0; k<dof; ++k)
+          columns.push_back(pde_nodes[i]->global_offset() + k);
+      }
+
+      // dofs of boundary condition equation
+      if( fvm_node->boundary_id()!=BoundaryInfo::invalid_id )
+      {
+        unsigned int bc_index = _system.get_bcs()->get_bc_index_by_bd_id(fvm_node->boundary_id());
+        const BoundaryCondition * bc = _system.get_bcs()->get_bc(bc_index);
+        for(unsigned int k=0; k<this->bc_dofs( bc ); ++k)
+          columns.push_back(bc->global_offset() + k);
+        if( bc->is_inter_connect_bc() )
+        {
+          const BoundaryCondition * hub = bc->inter_connect_hub();
+          for(unsigned int k=0; k<this->bc_dofs( hub ); ++k)
+            columns.push_back(hub->global_offset() + k);
+        }
+      }
+
+      for(unsigned int i=0; i<local_node_dofs; ++i)
+        row_pattern[fvm_node->local_offset() + i] = patterns.size()-1;
+    }
+  }
+
+
+  // boundary extra equation
+  if(_system.get_bcs()!=NULL)
+  {
+    for(unsigned int b=0; b<_system.get_bcs()->n_bcs(); ++b )
+    {
+      const BoundaryCondition * bc = _system.get_bcs()->get_bc(b);
+      if( bc->local_offset() == invalid_uint ) continue;
+
+      patterns.push_back( std::vector<PetscInt>() );
+      std::vector<PetscInt> & columns = patterns.back();
+
+      std::vector<const BoundaryCondition *> node_bcs;
+      if( !bc->is_inter_connect_hub() )
+        node_bcs.push_back(bc);
+      else
+      {
+        const std::vector<BoundaryCondition * > & inter_connect_bcs = bc->inter_connect();
+        node_bcs.insert(node_bcs.end(), inter_connect_bcs.begin(), inter_connect_bcs.end());
+        // hub couples to the equation of each electrode
+        for(unsigned int i=0; i<inter_connect_bcs.size(); ++i)
+          for(unsigned int k=0; k<this->bc_dofs( inter_connect_bcs[i] ); ++k)
+            columns.push_back(inter_connect_bcs[i]->global_offset() + k);
+      }
+
+      // all the fvm nodes on the boundary and their neighbors
+      for(unsigned int i=0; i<node_bcs.size(); ++i)
+      {
+        const std::vector<const Node *> & nodes = node_bcs[i]->nodes();
+        for(unsigned int n=0; n<nodes.size(); ++n)
+        {
+          BoundaryCondition::const_region_node_iterator rnode_it = node_bcs[i]->region_node_begin(nodes[n]);
+          BoundaryCondition::const_region_node_iterator end_rnode_it = node_bcs[i]->region_node_end(nodes[n]);
+          for(; rnode_it!=end_rnode_it; ++rnode_it )
+          {
+            const SimulationRegion * region = (*rnode_it).second.first;
+            const FVM_Node * fvm_node = (*rnode_it).second.second;
+            unsigned int dof = this->node_dofs( region );
+            if( !dof ) continue;
+
+            for(unsigned int k=0; k<dof; ++k)
+              columns.push_back(fvm_node->global_offset() + k);
+            FVM_Node::fvm_neighbor_node_iterator nit = fvm_node->neighbor_node_begin();
+            for(; nit != fvm_node->neighbor_node_end(); ++nit)
+              for(unsigned int k=0; k<dof; ++k)
+                columns.push_back((*nit).first->global_offset() + k);
+          }
+        }
+      }
+
+      // the bc equation itself and the hub it belongs to
+      for(unsigned int k=0; k<this->bc_dofs( bc ); ++k)
+        columns.push_back(bc->global_offset() + k);
+      if( bc->is_inter_connect_bc() )
+      {
+        const BoundaryCondition * hub = bc->inter_connect_hub();
+        for(unsigned int k=0; k<this->bc_dofs( hub ); ++k)
+          columns.push_back(hub->global_offset() + k);
+      }
+
+      for(unsigned int i=0; i<this->bc_dofs( bc ); ++i)
+        row_pattern[bc->array_offset() + i] = patterns.size()-1;
+    }
+  }
+
+  // extra dofs and the rows coupled to them
+  std::map<PetscInt, std::vector<PetscInt> > extra_columns;
+  this->set_extra_matrix_nonzero_columns(extra_columns);
+
+  // pack into CSR, the diagonal is always kept since MatZeroRows put 1.0 there
+  csr_row_offset.reserve(n_local_dofs+1);
+  csr_row_offset.push_back(0);
+  for(unsigned int row=0; row<n_local_dofs; ++row)
+  {
+    std::vector<PetscInt> columns;
+    if( row_pattern[row] != invalid_uint )
+      columns = patterns[row_pattern[row]];
+    std::map<PetscInt, std::vector<PetscInt> >::const_iterator extra_it = extra_columns.find(row);
+    if( extra_it != extra_columns.end() )
+      columns.insert(columns.end(), (*extra_it).second.begin(), (*extra_it).second.end());
+    columns.push_back(row);
+
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+
+    csr_columns.insert(csr_columns.end(), columns.begin(), columns.end());
+    csr_row_offset.push_back(csr_columns.size());
+    n_nz[row] = columns.size();
+  }
 }
@@ -35,7 +35,7 @@ using PhysicalUnit::mu0;
 double LightThread::dead_factor = 1e-3;
 
 
-std::vector<double> LightThread::advance_to(const Point & p_end, double a_band, double a_tail, double a_fc)
+void LightThread::advance_to(const Point & p_end, double a_band, double a_tail, double a_fc, double power_loss[3])
 {
   const double length = (_p - p_end).size();
   _p = p_end;
@@ -48,19 +48,16 @@ std::vector<double> LightThread::advance_to(const Point & p_end, double a_band,
   _power *= l_band*l_tail*l_fc;
   double dpower = power_start - _power;
 
-  std::vector<double> power_loss(3);
   power_loss[0] = dpower*a_band/(a_band+a_tail+a_fc+1e-30);
   power_loss[1] = dpower*a_tail/(a_band+a_tail+a_fc+1e-30);
   power_loss[2] = dpower*a_fc/(a_band+a_tail+a_fc+1e-30);
-
-  return power_loss;
 }
 
 
-LightThread * LightThread::reflection(const Point & in_p, const Point & norm) const
+void LightThread::reflection(const Point & in_p, const Point & norm, LightThread & reflect_light) const
 {
   Point reflect_dir = (_dir-2*(norm.dot(_dir))*norm).unit();
-  return  new LightThread(in_p, reflect_dir, _E_dir, _wavelength, _init_power, _power);
+  reflect_light.reset(in_p, reflect_dir, _E_dir, _wavelength, _init_power, _power);
 }
 
 #if 0
@@ -166,7 +163,8 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
 
 
 #if 1
-std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear_polarized_simple(const Point & in_p, const Point & norm, double n1, double n2 ) const
+std::pair<bool, bool> LightThread::_interface_light_gen_linear_polarized_simple(const Point & in_p, const Point & norm, double n1, double n2,
+    LightThread & reflect_light, LightThread & refract_light) const
 {
   double n = n2/n1;
 
@@ -220,8 +218,8 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
       double refract_perpendicular = 2*sin(refract_angle)*cos(in_angle)/sin(in_angle+refract_angle);//Ts
       double refract_eff = pow(refract_parallel*cos(_polarization_angle),2)+pow(refract_perpendicular*sin(_polarization_angle),2);
 
-      LightThread * reflect_light = 0;
-      LightThread * refract_light = 0;
+      bool reflect = false;
+      bool refract = false;
 
       // the E_perpendicular keeps the same
       //however, the E_parallel direction should be re-defined as light_dir cross incident_plane.unit_normal
@@ -230,25 +228,27 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
         Point _E_dir_reflect;
         Point E_parallel_reflect = E_parallel.size()*B_perpendicular.cross(reflect_dir);
         _E_dir_reflect = (reflect_parallel*E_parallel_reflect + reflect_perpendicular*E_perpendicular).unit(true);
-        reflect_light = new LightThread(in_p, reflect_dir, _E_dir_reflect, _wavelength, _init_power, reflect_eff*_power);
+        reflect_light.reset(in_p, reflect_dir, _E_dir_reflect, _wavelength, _init_power, reflect_eff*_power);
+        reflect = true;
       }
 
       if( refract_eff >=1e-9 )
       {
         Point E_parallel_refract = E_parallel.size()*B_perpendicular.cross(refract_dir);
         Point _E_dir_refract = (refract_parallel*E_parallel_refract + refract_perpendicular*E_perpendicular).unit(true);
-        refract_light = new LightThread(in_p, refract_dir, _E_dir_refract, _wavelength, _init_power, refract_eff*_power);
+        refract_light.reset(in_p, refract_dir, _E_dir_refract, _wavelength, _init_power, refract_eff*_power);
+        refract = true;
       }
 
-      return std::make_pair(reflect_light, refract_light);
+      return std::make_pair(reflect, refract);
     }
     else //for full reflection
     {
       Point E_parallel_reflect = E_parallel.size()*B_perpendicular.cross(reflect_dir);
       Point _E_dir_reflect = (E_parallel_reflect + E_perpendicular).unit(true);
-      LightThread * reflect_light = new LightThread(in_p, reflect_dir, _E_dir_reflect, _wavelength, _init_power, _power);
+      reflect_light.reset(in_p, reflect_dir, _E_dir_reflect, _wavelength, _init_power, _power);
 
-      return std::make_pair(reflect_light, (LightThread *)0);
+      return std::make_pair(true, false);
     }
   }
   else //if perpendicular incidence, for this instance, full reflection will never happened
@@ -256,10 +256,10 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
     double reflect_eff = (n-1)*(n-1)/((n+1)*(n+1));
     double refract_eff = 4*n/((n+1)*(n+1));
 
-    LightThread * reflect_light = new LightThread(in_p, -_dir, -_E_dir, _wavelength, _init_power, reflect_eff*_power);
-    LightThread * refract_light = new LightThread(in_p,  _dir,  _E_dir, _wavelength, _init_power, refract_eff*_power);
+    reflect_light.reset(in_p, -_dir, -_E_dir, _wavelength, _init_power, reflect_eff*_power);
+    refract_light.reset(in_p,  _dir,  _E_dir, _wavelength, _init_power, refract_eff*_power);
 
-    return std::make_pair(reflect_light, refract_light);
+    return std::make_pair(true, true);
   }
 
 }
@@ -268,8 +268,8 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
 
 // TNT matrix-vector library
 #include <TNT/tnt.h>
-std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear_polarized_stack(const Point & in_p, const Point & norm,
-    double n1, double n2, const ARCoatings *arc, bool inv ) const
+std::pair<bool, bool> LightThread::_interface_light_gen_linear_polarized_stack(const Point & in_p, const Point & norm,
+    double n1, double n2, LightThread & reflect_light, LightThread & refract_light, const ARCoatings *arc, bool inv ) const
 {
   Point incident_plane_norm = norm.cross(_dir);
   if(incident_plane_norm.size() == 0.0)
@@ -360,8 +360,8 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
   double R_TM = std::norm(r_TM);
   double T_TM = Yout_TM.real()/Yin_TM.real()*std::norm(t_TM);
 
-  LightThread * reflect_light = 0;
-  LightThread * refract_light = 0;
+  bool reflect = false;
+  bool refract = false;
 
   //for reflection angle
   Point reflect_dir = (_dir-2*(norm.dot(_dir))*norm).unit(true);
@@ -382,26 +382,32 @@ std::pair<LightThread *, LightThread *> LightThread::_interface_light_gen_linear
   //std::cout<<"COFF " << R_TE << " " << R_TM << " " << T_TE << " " << T_TM << std::endl;
 
   if( reflect_power > 1e-10*_power )
-    reflect_light = new LightThread(in_p, reflect_dir, E_dir_reflect, _wavelength, _init_power, reflect_power);
+  {
+    reflect_light.reset(in_p, reflect_dir, E_dir_reflect, _wavelength, _init_power, reflect_power);
+    reflect = true;
+  }
 
   if( refract_power > 1e-10*_power )
-    refract_light = new LightThread(in_p, refract_dir, E_dir_refract, _wavelength, _init_power, refract_power);
+  {
+    refract_light.reset(in_p, refract_dir, E_dir_refract, _wavelength, _init_power, refract_power);
+    refract = true;
+  }
 
-  return std::make_pair(reflect_light, refract_light);
+  return std::make_pair(reflect, refract);
 }
 
 
 
 
 
-std::pair<LightThread *, LightThread *> LightThread::interface_light_gen_linear_polarized(const Point & in_p, const Point & norm,
-    double n1, double n2, const ARCoatings *arc, bool inv) const
+std::pair<bool, bool> LightThread::interface_light_gen_linear_polarized(const Point & in_p, const Point & norm,
+    double n1, double n2, LightThread & reflect_light, LightThread & refract_light, const ARCoatings *arc, bool inv) const
 {
-  if(norm.dot(_dir) == 0.0 ) return std::make_pair((LightThread *)0, (LightThread *)0);
+  if(norm.dot(_dir) == 0.0 ) return std::make_pair(false, false);
 
   if(arc)
-    return _interface_light_gen_linear_polarized_stack(in_p, norm, n1, n2, arc, inv);
+    return _interface_light_gen_linear_polarized_stack(in_p, norm, n1, n2, reflect_light, refract_light, arc, inv);
   else
-    return _interface_light_gen_linear_polarized_simple(in_p, norm, n1, n2);
+    return _interface_light_gen_linear_polarized_simple(in_p, norm, n1, n2, reflect_light, refract_light);
 }
 
@@ -61,9 +61,9 @@ ObjectTree::~ObjectTree()
 }
 
 
-const Elem * ObjectTree::hit(const LightThread *light) const
+const Elem * ObjectTree::hit(const LightThread &light) const
 {
-  return this->_tree->hit_element(light->start_point(), light->dir());
+  return this->_tree->hit_element(light.start_point(), light.dir());
 }
 
 
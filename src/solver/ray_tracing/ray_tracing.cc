@@ -19,9 +19,8 @@
 /*                                                                              */
 /********************************************************************************/
 
-#include <stack>
 #include <iomanip>
-#include <numeric>
+#include <algorithm>
 
 
 #include "sphere.h"
@@ -31,11 +30,13 @@
 #include "mesh_tools.h"
 #include "field_source.h"
 #include "light_lenses.h"
+#include "optical_cache.h"
 #include "ray_tracing/light_thread.h"
 #include "ray_tracing/object_tree.h"
 #include "ray_tracing/ray_tracing.h"
 #include "ray_tracing/anti_reflection_coating.h"
 #include "parallel.h"
+#include "threads.h"
 
 
 using PhysicalUnit::um;
@@ -52,7 +53,8 @@ using PhysicalUnit::h;
 
 
 RayTraceSolver::RayTraceSolver(SimulationSystem & system, const Parser::Card & c)
-    : SolverBase(system), _card(c), surface_elem_tree(0)
+    : SolverBase(system), _card(c), surface_elem_tree(0), _n_threads(1),
+      _adaptive_rays(false), _adapt_level(0), _adapt_tol(0.1), _ray_density(10.0), _cache_ray_paths(false)
 {
   system.record_active_solver(this->solver_type());
 }
@@ -71,88 +73,260 @@ int RayTraceSolver::create_solver()
   surface_elem_tree = new ObjectTree(mesh);
   build_elems_node_map();
   build_elems_edge_map();
-  build_boundary_elems_map();
   build_anti_reflection_coating_surface_map();
+  build_boundary_elems_map();
   build_elem_carrier_density();
   // parse input deck
   define_lenses();
   create_rays();
 
-  MESSAGE<< _total_rays <<" rays for each wave length."<<std::endl;
+  // threads used by each processor, 0 for auto
+  _n_threads = _card.get_int("threads", 0);
+  if(_n_threads == 0) _n_threads = Threads::n_threads();
+
+  _cache_ray_paths = _card.get_bool("ray.cache.path", false);
+
+  MESSAGE<< _total_rays <<(_adaptive_rays ? " initial" : "")<<" rays for each wave length";
+  if(_n_threads > 1) MESSAGE<<", traced by "<< _n_threads <<" threads";
+  MESSAGE<<"."<<std::endl;
   RECORD();
 
   return 0;
 }
 
 
-int RayTraceSolver::solve()
+/**
+ * trace rays [begin, end) of current wave length. each thread traces its rays in its own
+ * ray buffer, and deposits energy into its own
+ * arrays, which are added to the arrays of solver after all the rays are traced.
+ * thread 0 writes to the arrays of solver directly, so serial run needs no extra memory.
+ * when footprints is given, the energy deposit of each ray is recorded in its footprint instead.
+ * when ray paths are given, the path of each ray is recorded, or the recorded paths are replayed
+ * instead of tracing the rays.
+ */
+class RayTraceSolver::RayBatchTracer
 {
-  START_LOG("solve()", "RayTraceSolver");
-
-  // for each wavelentgh
-  for(unsigned int n=0; n<_optical_sources.size(); ++n)
+public:
+  RayBatchTracer(RayTraceSolver & solver, const std::vector<Point> & start_points, double lamda, double power,
+                 unsigned int n_threads, std::vector<RayFootprint> * footprints=0)
+    : _solver(solver), _start_points(start_points), _lamda(lamda), _power(power), _footprints(footprints),
+      _paths(0), _replay(false), _n_rays(start_points.size()), _buffers(std::max(1u, n_threads)),
+      _n_traced(0), _n_indicator(0)
   {
-    double lamda     = _optical_sources[n].wave_length;
-    double intensity = _optical_sources[n].power;
-    double power     = _dim==2 ? intensity*_wave_plane.min_dist : intensity*_wave_plane.ray_area();
-
-    build_region_refractive_index(lamda);
-
-    // clear and re-create the array to record energy deposition
-    _band_absorption_energy_in_elem.clear();
-    _band_absorption_energy_in_elem.resize(_system.mesh().n_elem(), 0.0);
+    const unsigned int n_elem = solver._band_absorption_energy_in_elem.size();
+    _band.push_back(&solver._band_absorption_energy_in_elem);
+    _total.push_back(&solver._total_absorption_energy_in_elem);
+    for(unsigned int t=1; t<n_threads && !footprints; ++t)
+    {
+      _band.push_back(new std::vector<double>(n_elem, 0.0));
+      _total.push_back(new std::vector<double>(n_elem, 0.0));
+    }
+  }
 
-    _total_absorption_energy_in_elem.clear();
-    _total_absorption_energy_in_elem.resize(_system.mesh().n_elem(), 0.0);
+  ~RayBatchTracer()
+  {
+    for(unsigned int t=1; t<_band.size(); ++t)
+    {
+      delete _band[t];
+      delete _total[t];
+    }
+  }
 
-    MESSAGE<< "  process light of " /*<< std::setiosflags(std::ios::fixed)*/  << lamda/um << " um";
-    RECORD();
+  /**
+   * record the ray paths to paths, or replay them if replay is true
+   */
+  void set_ray_paths(std::vector<RayPath> * paths, bool replay)
+  {
+    _paths = paths;
+    _replay = replay;
+  }
 
-    //process all the rays
-    unsigned int n_on_processor_rays = _wave_plane.n_on_processor_rays();
-    for(unsigned int k=0; k<n_on_processor_rays; ++k)
+  void operator() (unsigned int begin, unsigned int end, unsigned int tid)
+  {
+    const WavePlane & wave_plane = _solver._wave_plane;
+    const unsigned int t = _footprints ? 0 : tid;
+    for(unsigned int k=begin; k<end; ++k)
     {
+      if(_replay)
+      {
+        _solver.replay_ray_path((*_paths)[k], _power, _lamda, *_band[t], *_total[t]);
+        continue;
+      }
+
       // create ray
-      LightThread * light = new  LightThread(_wave_plane.ray_start_point(k),
-                                             _wave_plane.norm,
-                                             _wave_plane.E_dir,
-                                             lamda,
-                                             power,
-                                             power
-                                            );
+      LightThread light(_start_points[k],
+                        wave_plane.norm,
+                        wave_plane.E_dir,
+                        _lamda,
+                        _power,
+                        _power
+                       );
+
+      // the light is lost in lenses
+      if(!_solver._lenses->empty() && !((*_solver._lenses) << light)) continue;
 
-      if(!_lenses->empty())  light = (*_lenses) << light;
+      RayPath * path = _paths ? &(*_paths)[k] : 0;
+      if(path && light.power() != _power)
+        path->add(RayPath::SCALE, 0, 0, light.power()/_power);
 
       // call function ray_tracing to process a single ray
-      ray_tracing(light);
+      _solver.ray_tracing(light, _buffers[tid], *_band[t], *_total[t], _footprints ? &(*_footprints)[k] : 0, path);
+
+#if defined(HAVE_FENV_H) && defined(DEBUG)
+      genius_assert( !fetestexcept(FE_INVALID) );
+#endif
+    }
 
-      //indicator
-      if(k%(1+(n_on_processor_rays)/20)==0) // +1 for prevent divide by zero error
+    Threads::ScopedLock lock(_mutex);
+    _n_traced += end - begin;
+    //indicator, only the calling thread writes message
+    if(tid == 0)
+    {
+      for(; _n_indicator < 20*_n_traced/(_n_rays+1); ++_n_indicator)
       {
         MESSAGE<< ".";
         RECORD();
       }
-#if defined(HAVE_FENV_H) && defined(DEBUG)
-      genius_assert( !fetestexcept(FE_INVALID) );
-#endif
+    }
+  }
+
+  /**
+   * add the energy deposit of other threads to solver
+   */
+  void reduce()
+  {
+    std::vector<double> & band  = *_band[0];
+    std::vector<double> & total = *_total[0];
+    for(unsigned int t=1; t<_band.size(); ++t)
+      for(unsigned int i=0; i<band.size(); ++i)
+      {
+        band[i]  += (*_band[t])[i];
+        total[i] += (*_total[t])[i];
+      }
+  }
+
+private:
+
+  const RayTraceSolver & _solver;
+
+  const std::vector<Point> & _start_points;
+
+  const double _lamda;
+
+  const double _power;
+
+  std::vector<RayFootprint> * _footprints;
+
+  std::vector<RayPath> * _paths;
+
+  bool _replay;
+
+  const unsigned int _n_rays;
+
+  /**
+   * ray buffer of each thread
+   */
+  std::vector<RayBuffer> _buffers;
+
+  /**
+   * energy deposit of each thread
+   */
+  std::vector< std::vector<double> * > _band;
+  std::vector< std::vector<double> * > _total;
+
+  /**
+   * protect the progress counter
+   */
+  Threads::Mutex _mutex;
+
+  unsigned int _n_traced;
+
+  unsigned int _n_indicator;
+};
+
+
+
+int RayTraceSolver::solve()
+{
+  START_LOG("solve()", "RayTraceSolver");
 
+  // the optical fields of identical problem are loaded from disk
+  OpticalCache cache(_system, _card);
+  if(cache.enabled())
+  {
+    hash_optical_inputs(cache);
+    if(cache.load())
+    {
+      STOP_LOG("solve()", "RayTraceSolver");
+      return 0;
     }
+    cache.snapshot();
+  }
+
+  // wave lengths with the same refractive index share the ray paths
+  std::vector< std::vector<unsigned int> > groups;
+  group_optical_sources(groups);
 
+  for(unsigned int g=0; g<groups.size(); ++g)
+  {
+    // the ray paths of the first wave length in group, replayed by the others
+    std::vector<RayPath> paths;
+    if(groups[g].size() > 1)
+      paths.resize(_wave_plane.n_on_processor_rays());
+
+    // for each wavelentgh
+    for(unsigned int s=0; s<groups[g].size(); ++s)
+    {
+      const unsigned int n = groups[g][s];
+      double lamda     = _optical_sources[n].wave_length;
+      double intensity = _optical_sources[n].power;
 
-    // gather energy deposit from all the processors
-    Parallel::sum(_band_absorption_energy_in_elem);
-    Parallel::sum(_total_absorption_energy_in_elem);
+      build_region_refractive_index(lamda);
 
-    // convert energy deposit to carrier optical generation
-    optical_generation(n);
+      // clear and re-create the array to record energy deposition
+      _band_absorption_energy_in_elem.clear();
+      _band_absorption_energy_in_elem.resize(_system.mesh().n_elem(), 0.0);
 
-    MESSAGE<< "ok" <<std::endl;
-    RECORD();
+      _total_absorption_energy_in_elem.clear();
+      _total_absorption_energy_in_elem.resize(_system.mesh().n_elem(), 0.0);
+
+      MESSAGE<< "  process light of " /*<< std::setiosflags(std::ios::fixed)*/  << lamda/um << " um";
+      if(s > 0) MESSAGE<< " (replay)";
+      RECORD();
+
+      //process all the rays
+      if(_adaptive_rays)
+        adaptive_ray_tracing(lamda, intensity);
+      else
+      {
+        double power = _dim==2 ? intensity*_wave_plane.min_dist : intensity*_wave_plane.ray_area();
+        unsigned int n_on_processor_rays = _wave_plane.n_on_processor_rays();
+        RayBatchTracer tracer(*this, _wave_plane.ray_start_points, lamda, power, _n_threads);
+        if(!paths.empty())
+          tracer.set_ray_paths(&paths, s > 0);
+        // small batches keep the threads balanced, since the cost of ray varies a lot
+        unsigned int batch = std::max(1u, std::min(64u, n_on_processor_rays/(8*_n_threads)));
+        Threads::parallel_for_dynamic(0, n_on_processor_rays, batch, tracer, _n_threads);
+        tracer.reduce();
+      }
+
+
+      // gather energy deposit from all the processors
+      Parallel::sum(_band_absorption_energy_in_elem);
+      Parallel::sum(_total_absorption_energy_in_elem);
+
+      // convert energy deposit to carrier optical generation
+      optical_generation(n);
+
+      MESSAGE<< "ok" <<std::endl;
+      RECORD();
+    }
   }
 
 
   statistic();
 
+  cache.save();
 
 #if defined(HAVE_FENV_H) && defined(DEBUG)
   genius_assert( !fetestexcept(FE_INVALID) );
@@ -164,26 +338,201 @@ int RayTraceSolver::solve()
 }
 
 
-int RayTraceSolver::destroy_solver()
+void RayTraceSolver::hash_optical_inputs(OpticalCache & cache)
 {
-  delete surface_elem_tree;
+  for(unsigned int n=0; n<_optical_sources.size(); ++n)
+  {
+    const double lamda = _optical_sources[n].wave_length;
+    cache.add(lamda);
+    cache.add(_optical_sources[n].power);
+    cache.add(_optical_sources[n].eta);
+    cache.add(_optical_sources[n].eta_auto);
+    for(unsigned int r=0; r<_system.n_regions(); ++r)
+    {
+      SimulationRegion * region = _system.region(r);
+      cache.add(region->get_optical_refraction(lamda));
+      cache.add(region->get_optical_Eg(region->T_external()));
+    }
+  }
 
+  std::vector<double> lenses = _lenses->active_lens_parameters();
+  for(unsigned int i=0; i<lenses.size(); ++i)
+    cache.add(lenses[i]);
+
+  std::map<short int, ARCoatings *>::const_iterator arc_it = _arc_surface.begin();
+  for(; arc_it != _arc_surface.end(); ++arc_it)
   {
-    std::map<const Elem *, std::vector<const Elem *>,  lt_edge>::iterator it = _elems_shared_this_edge.begin();
-    for(; it!=_elems_shared_this_edge.end(); ++it)
-      delete it->first;
-    _elems_shared_this_edge.clear();
+    const ARCoatings * arc = arc_it->second;
+    cache.add(static_cast<int>(arc_it->first));
+    cache.add(arc->inner_region);
+    for(unsigned int i=0; i<arc->layers; ++i)
+    {
+      cache.add(arc->layer_refractive_index[i]);
+      cache.add(arc->layer_thickness[i]);
+    }
+  }
 
+  // free carrier absorption depends on the carrier density
+  std::map<unsigned int, std::pair<double, double> >::const_iterator it = _elem_carrier_density.begin();
+  for(; it != _elem_carrier_density.end(); ++it)
+  {
+    cache.add(it->first);
+    cache.add(it->second.first);
+    cache.add(it->second.second);
   }
+}
+
 
+void RayTraceSolver::group_optical_sources(std::vector< std::vector<unsigned int> > & groups)
+{
+  groups.clear();
+
+  // the ray path depends on the wave length when anti-reflection coating exists,
+  // and adaptive rays differ among wave lengths
+  if(!_cache_ray_paths || _adaptive_rays || !_arc_surface.empty())
+  {
+    for(unsigned int n=0; n<_optical_sources.size(); ++n)
+      groups.push_back(std::vector<unsigned int>(1, n));
+    return;
+  }
+
+  // key of refractive index (real part) of all the regions
+  std::map< std::vector<long>, unsigned int > group_map;
+  std::vector<double> absorption;
+  for(unsigned int n=0; n<_optical_sources.size(); ++n)
   {
-    std::map<const Elem *, std::vector<std::pair<const Elem*, unsigned int> >, lt_edge>::iterator it = _boundary_edge_to_elem_side_map.begin();
-    for(; it!=_boundary_edge_to_elem_side_map.end(); ++it)
-      delete it->first;
-    _boundary_edge_to_elem_side_map.clear();
+    double lamda = _optical_sources[n].wave_length;
+    build_region_refractive_index(lamda);
 
+    std::vector<long> key;
+    double a_max = 0.0;
+    std::map<unsigned int, std::pair<double, double> >::const_iterator it = _region_refractive_index.begin();
+    for(; it!=_region_refractive_index.end(); ++it)
+    {
+      key.push_back(static_cast<long>(floor(it->second.first*1e6 + 0.5)));
+      a_max = std::max(a_max, it->second.second/lamda);
+    }
+    absorption.push_back(a_max);
+
+    if(group_map.find(key) == group_map.end())
+    {
+      group_map[key] = groups.size();
+      groups.push_back(std::vector<unsigned int>());
+    }
+
+    std::vector<unsigned int> & group = groups[group_map[key]];
+    group.push_back(n);
+    // the wave length with weakest absorption is traced, so the recorded path reaches deepest
+    if(absorption[n] < absorption[group[0]])
+      std::swap(group[0], group.back());
   }
 
+  MESSAGE<< groups.size() <<" ray path set(s) for "<< _optical_sources.size() <<" wave lengths." << std::endl;
+  RECORD();
+}
+
+
+void RayTraceSolver::adaptive_ray_tracing(double lamda, double intensity)
+{
+  // rays of current level and their grid index. at level l, the ray spacing is min_dist/2^l,
+  // and ray (i, j) starts at center + ((i+0.5)/2^l-0.5)*min_dist*d1 + ((j+0.5)/2^l-0.5)*min_dist*d2
+  std::vector<Point> start_points = _wave_plane.ray_start_points;
+  std::vector< std::pair<int, int> > start_index = _wave_plane.ray_start_index;
+
+  unsigned int n_traced = 0;
+  for(unsigned int level=0; !start_points.empty(); ++level)
+  {
+    const double h = _wave_plane.min_dist/(1<<level);
+    const double power = _dim==2 ? intensity*h : intensity*h*h;
+
+    std::vector<RayFootprint> footprints(start_points.size());
+    RayBatchTracer tracer(*this, start_points, lamda, power, _n_threads, &footprints);
+    unsigned int batch = std::max(1u, std::min(64u, static_cast<unsigned int>(start_points.size())/(8*_n_threads)));
+    Threads::parallel_for_dynamic(0, start_points.size(), batch, tracer, _n_threads);
+    n_traced += start_points.size();
+
+    std::map<std::pair<int, int>, unsigned int> ray_map;
+    for(unsigned int k=0; k<start_index.size(); ++k)
+      ray_map[start_index[k]] = k;
+
+    std::vector<Point> next_start_points;
+    std::vector< std::pair<int, int> > next_start_index;
+    for(unsigned int k=0; k<start_points.size(); ++k)
+    {
+      const RayFootprint & footprint = footprints[k];
+
+      bool refine = false;
+      if(level < _adapt_level)
+      {
+        // the ray is too sparse for the elements it deposits energy in
+        if(footprint.energy > 0.0 && h > footprint.hmin/_ray_density)
+          refine = true;
+
+        // the ray diverges from its neighbors in path or energy deposit
+        const int di[4] = {1, -1, 0, 0};
+        const int dj[4] = {0, 0, 1, -1};
+        for(unsigned int nb=0; nb<(_dim==2 ? 2u : 4u) && !refine; ++nb)
+        {
+          std::map<std::pair<int, int>, unsigned int>::const_iterator it =
+            ray_map.find(std::make_pair(start_index[k].first+di[nb], start_index[k].second+dj[nb]));
+          if(it == ray_map.end()) continue;
+
+          const RayFootprint & neighbor = footprints[it->second];
+          if(neighbor.path_key != footprint.path_key)
+            refine = true;
+          double energy_max = std::max(footprint.energy, neighbor.energy);
+          if(energy_max > 0.0 && std::abs(footprint.energy - neighbor.energy) > _adapt_tol*energy_max)
+            refine = true;
+        }
+      }
+
+      if(refine)
+      {
+        // replace the ray by 2 (2D) or 4 (3D) rays with half spacing
+        const int i = start_index[k].first;
+        const int j = start_index[k].second;
+        for(int a=0; a<2; ++a)
+          for(int b=0; b<(_dim==2 ? 1 : 2); ++b)
+          {
+            Point d = (a ? 0.25 : -0.25)*h*_wave_plane.d1 + (b ? 0.25 : -0.25)*h*_wave_plane.d2;
+            next_start_points.push_back(start_points[k] + d);
+            next_start_index.push_back(std::make_pair(2*i+a, _dim==2 ? 0 : 2*j+b));
+          }
+        continue;
+      }
+
+      // accept the energy deposit of this ray
+      for(unsigned int d=0; d<footprint.deposit.size(); ++d)
+      {
+        _band_absorption_energy_in_elem[footprint.deposit[d].first]  += footprint.deposit[d].second.first;
+        _total_absorption_energy_in_elem[footprint.deposit[d].first] += footprint.deposit[d].second.second;
+      }
+    }
+
+    start_points.swap(next_start_points);
+    start_index.swap(next_start_index);
+  }
+
+  Parallel::sum(n_traced);
+  MESSAGE<< n_traced << " rays ";
+  RECORD();
+}
+
+
+int RayTraceSolver::destroy_solver()
+{
+  delete surface_elem_tree;
+
+  _elems_shared_this_node.clear();
+  _edges.clear();
+  _elems_shared_this_edge.clear();
+  _boundary_node_to_elem_side_map.clear();
+  _boundary_edges.clear();
+  _boundary_edge_to_elem_side_map.clear();
+  _face_info.clear();
+  _face_offset.clear();
+  _face_neighbor.clear();
+
   {
     std::map<short int, ARCoatings *>::const_iterator it = _arc_surface.begin();
     for( ; it != _arc_surface.end(); ++it)
@@ -321,13 +670,24 @@ void RayTraceSolver::create_rays()
     _wave_plane.R      = _card.get_real("ray.radius",  100.0)*um;
   else
     _wave_plane.R      = bounding_sphere.radius();
+  _ray_density = _card.get_real("ray.density", 10.0);
   if(_card.is_parameter_exist("ray.distance"))
     _wave_plane.min_dist = _card.get_real("ray.distance", 0.1)*um;
   else
-    _wave_plane.min_dist = min_dist/_card.get_real("ray.density", 10.0);
+    _wave_plane.min_dist = min_dist/_ray_density;
+
+  // adaptive rays start from a coarse grid, which reaches above ray distance after max subdivision
+  _adaptive_rays = _card.get_bool("ray.adaptive", false);
+  if(_adaptive_rays)
+  {
+    _adapt_level = _card.get_int("ray.adapt.level", 4);
+    _adapt_tol   = _card.get_real("ray.adapt.tol", 0.1);
+    _wave_plane.min_dist *= (1<<_adapt_level);
+  }
 
-  // this vector stores all the ray start points
+  // this vector stores all the ray start points and their grid index
   std::vector<Point> ray_start_points;
+  std::vector< std::pair<int, int> > ray_start_index;
 
   //3D mesh
   if(surface_elem_tree->is_octree())
@@ -357,8 +717,13 @@ void RayTraceSolver::create_rays()
       {
         Point s = _wave_plane.center + i*_wave_plane.min_dist*d1 + j*_wave_plane.min_dist*d2;
         if(surface_elem_tree->hit_boundbox(s, dir))
+        {
           ray_start_points.push_back(s);
+          ray_start_index.push_back(std::make_pair(i, j));
+        }
       }
+    _wave_plane.d1 = d1;
+    _wave_plane.d2 = d2;
     _dim = 3;
   }
 
@@ -373,8 +738,13 @@ void RayTraceSolver::create_rays()
     {
       Point s = _wave_plane.center + i*_wave_plane.min_dist*d;
       if(surface_elem_tree->hit_boundbox(s, dir))
+      {
         ray_start_points.push_back(s);
+        ray_start_index.push_back(std::make_pair(i, 0));
+      }
     }
+    _wave_plane.d1 = d;
+    _wave_plane.d2 = Point(0, 0, 0);
 
     _dim = 2;
   }
@@ -385,7 +755,10 @@ void RayTraceSolver::create_rays()
   unsigned int begin = on_process_rays*Genius::processor_id();
   unsigned int end   = std::min(begin+on_process_rays, ray_start_points.size());
   for(unsigned int n=begin; n<end; ++n)
+  {
     _wave_plane.ray_start_points.push_back(ray_start_points[n]);
+    _wave_plane.ray_start_index.push_back(ray_start_index[n]);
+  }
 
 }
 
@@ -579,7 +952,35 @@ double RayTraceSolver::get_free_carrier_absorption(const Elem* elem, double wave
 
 void RayTraceSolver::build_elems_node_map()
 {
-  MeshTools::build_nodes_to_elem_map(_system.mesh(), _elems_shared_this_node);
+  const MeshBase &mesh = _system.mesh();
+  MeshBase::const_element_iterator       el  = mesh.elements_begin();
+  const MeshBase::const_element_iterator end = mesh.elements_end();
+
+  // count the elems of each node, then fill them in the order of elems
+  std::vector<unsigned int> & offset = _elems_shared_this_node.offset;
+  offset.assign(mesh.max_node_id()+1, 0);
+  for (; el != end; ++el)
+    for (unsigned int n=0; n<(*el)->n_nodes(); n++)
+      offset[(*el)->node(n)+1]++;
+  for(unsigned int n=0; n<mesh.max_node_id(); ++n)
+    offset[n+1] += offset[n];
+
+  std::vector<unsigned int> fill(offset.begin(), offset.end()-1);
+  _elems_shared_this_node.items.resize(offset.back());
+  for (el = mesh.elements_begin(); el != end; ++el)
+    for (unsigned int n=0; n<(*el)->n_nodes(); n++)
+      _elems_shared_this_node.items[fill[(*el)->node(n)]++] = *el;
+}
+
+
+RayTraceSolver::EdgeKey RayTraceSolver::edge_key(const Elem * elem, unsigned int e)
+{
+  std::pair<unsigned int, unsigned int> local;
+  elem->nodes_on_edge(e, local);
+  unsigned int n1 = elem->node(local.first);
+  unsigned int n2 = elem->node(local.second);
+  if(n1>n2) std::swap(n1, n2);
+  return std::make_pair(n1, n2);
 }
 
 
@@ -589,18 +990,25 @@ void RayTraceSolver::build_elems_edge_map()
   MeshBase::const_element_iterator       el  = mesh.elements_begin();
   const MeshBase::const_element_iterator end = mesh.elements_end();
 
+  // (edge, elem id) pairs, sorted by edge then elem
+  std::vector< std::pair<EdgeKey, unsigned int> > edge_elems;
   for (; el != end; ++el)
     for (unsigned int e=0; e<(*el)->n_edges(); e++)
-    {
-      bool edge_exist = false;
-      const Elem * edge_elem = (*el)->build_edge(e).release();
-      if(_elems_shared_this_edge.find(edge_elem) != _elems_shared_this_edge.end())
-        edge_exist = true;
-
-      _elems_shared_this_edge[edge_elem].push_back(*el);
+      edge_elems.push_back(std::make_pair(edge_key(*el, e), (*el)->id()));
+  std::sort(edge_elems.begin(), edge_elems.end());
 
-      if(edge_exist) delete edge_elem;
+  _edges.clear();
+  _elems_shared_this_edge.clear();
+  for(unsigned int i=0; i<edge_elems.size(); ++i)
+  {
+    if(i==0 || edge_elems[i].first != edge_elems[i-1].first)
+    {
+      _edges.push_back(edge_elems[i].first);
+      _elems_shared_this_edge.offset.push_back(i);
     }
+    _elems_shared_this_edge.items.push_back(mesh.elem(edge_elems[i].second));
+  }
+  _elems_shared_this_edge.offset.push_back(edge_elems.size());
 }
 
 
@@ -635,77 +1043,127 @@ void RayTraceSolver::build_boundary_elems_map()
 {
 
   const MeshBase &mesh = _system.mesh();
+
+  // flat elem-side table indexed by elem id
+  _face_offset.assign(mesh.max_elem_id()+1, 0);
+  {
+    MeshBase::const_element_iterator       it  = mesh.elements_begin();
+    const MeshBase::const_element_iterator end = mesh.elements_end();
+    for (; it != end; ++it)
+      _face_offset[(*it)->id()+1] = (*it)->n_sides();
+    for(unsigned int n=0; n<mesh.max_elem_id(); ++n)
+      _face_offset[n+1] += _face_offset[n];
+    _face_info.assign(_face_offset.back(), FaceInfo());
+  }
+
+  // the elem-side across each elem-side, the ray walks through it
+  _face_neighbor.assign(_face_offset.back(), ElemSide(static_cast<const Elem *>(0), invalid_uint));
+  {
+    MeshBase::const_element_iterator       it  = mesh.elements_begin();
+    const MeshBase::const_element_iterator end = mesh.elements_end();
+    for (; it != end; ++it)
+      for(unsigned int s=0; s<(*it)->n_sides(); ++s)
+      {
+        const Elem * neighbor = (*it)->neighbor(s);
+        if(neighbor)
+          _face_neighbor[_face_offset[(*it)->id()] + s] = std::make_pair(neighbor, neighbor->which_neighbor_am_i(*it));
+      }
+  }
+
   std::vector<unsigned int>        el;
   std::vector<unsigned short int>  sl;
   std::vector<short int>           il;
 
   mesh.boundary_info->build_side_list(el, sl, il);
+
+  // boundary node and boundary edge of each boundary elem-side, as (node, n) and (edge, n) pairs
+  std::vector< std::pair<unsigned int, unsigned int> > node_sides;
+  std::vector< std::pair<EdgeKey, unsigned int> > edge_sides;
+
   for(unsigned int n=0; n<el.size(); ++n)
   {
     const Elem * boundary_elem = mesh.elem(el[n]);
     AutoPtr<Elem> side = boundary_elem->build_side(sl[n], false);
 
     for(unsigned int nd=0; nd<side->n_nodes(); ++nd)
-    {
-      const Node * node = side->get_node(nd);
-      _boundary_node_to_elem_side_map[node].push_back(std::make_pair(boundary_elem, sl[n]));
-    }
+      node_sides.push_back(std::make_pair(side->node(nd), n));
 
     for(unsigned int ne=0; ne<side->n_edges(); ++ne)
-    {
-      bool edge_exist = false;
-      const Elem * edge = side->build_side(ne, false).release();
-      if(_boundary_edge_to_elem_side_map.find(edge)!=_boundary_edge_to_elem_side_map.end())
-        edge_exist = true;
-
-      _boundary_edge_to_elem_side_map[edge].push_back(std::make_pair(boundary_elem, sl[n]));
-
-      if(edge_exist) delete edge;
-    }
+      edge_sides.push_back(std::make_pair(edge_key(side.get(), ne), n));
 
     const BoundaryCondition * bc =  _system.get_bcs()->get_bc_by_bd_id(il[n]);
     genius_assert(bc);
-    _elem_to_surface_map[std::make_pair(boundary_elem, sl[n])] = bc;
+
+    FaceInfo & info = _face_info[_face_offset[boundary_elem->id()] + sl[n]];
+    info.bc = bc;
+    info.reflect = bc->has_flag("reflection") && bc->flag("reflection");
+    std::map<short int, ARCoatings *>::const_iterator arc = _arc_surface.find(bc->boundary_id());
+    info.arc = ( arc == _arc_surface.end() ? 0 : arc->second );
+  }
+
+  // boundary node table indexed by node id, the elem-sides of a node keep the order of side list
+  std::vector<unsigned int> & node_offset = _boundary_node_to_elem_side_map.offset;
+  node_offset.assign(mesh.max_node_id()+1, 0);
+  for(unsigned int i=0; i<node_sides.size(); ++i)
+    node_offset[node_sides[i].first+1]++;
+  for(unsigned int n=0; n<mesh.max_node_id(); ++n)
+    node_offset[n+1] += node_offset[n];
+  std::vector<unsigned int> node_fill(node_offset.begin(), node_offset.end()-1);
+  _boundary_node_to_elem_side_map.items.resize(node_sides.size());
+  for(unsigned int i=0; i<node_sides.size(); ++i)
+  {
+    unsigned int n = node_sides[i].second;
+    _boundary_node_to_elem_side_map.items[node_fill[node_sides[i].first]++] = std::make_pair(mesh.elem(el[n]), sl[n]);
+  }
+
+  // boundary edge table, sorted by edge
+  std::sort(edge_sides.begin(), edge_sides.end());
+  _boundary_edges.clear();
+  _boundary_edge_to_elem_side_map.clear();
+  for(unsigned int i=0; i<edge_sides.size(); ++i)
+  {
+    if(i==0 || edge_sides[i].first != edge_sides[i-1].first)
+    {
+      _boundary_edges.push_back(edge_sides[i].first);
+      _boundary_edge_to_elem_side_map.offset.push_back(i);
+    }
+    unsigned int n = edge_sides[i].second;
+    _boundary_edge_to_elem_side_map.items.push_back(std::make_pair(mesh.elem(el[n]), sl[n]));
   }
+  _boundary_edge_to_elem_side_map.offset.push_back(edge_sides.size());
 
 }
 
 
 bool RayTraceSolver::is_surface(const Elem *elem, unsigned int side) const
 {
-  return ( _elem_to_surface_map.find(std::make_pair(elem, side)) != _elem_to_surface_map.end() );
+  return face_info(elem, side).bc != 0;
 }
 
 
 bool RayTraceSolver::is_full_reflect_surface(const Elem *elem, unsigned int side) const
 {
-  const BoundaryCondition * bc = _elem_to_surface_map.find(std::make_pair(elem, side))->second;
-  if(bc->has_flag("reflection") && bc->flag("reflection"))
-    return true;
-  return false;
+  return face_info(elem, side).reflect;
 }
 
 
 const ARCoatings * RayTraceSolver::is_anti_reflection_coating_surface(const Elem *elem, unsigned int side) const
 {
-  const BoundaryCondition * bc = _elem_to_surface_map.find(std::make_pair(elem, side))->second;
-  std::map<short int, ARCoatings *>::const_iterator pair = _arc_surface.find(bc->boundary_id());
-  if( pair == _arc_surface.end() )
-    return 0;
-  return pair->second;
+  return face_info(elem, side).arc;
 }
 
 
 
 
-const Elem * RayTraceSolver::ray_hit(const Point &p, const Point &dir, const std::vector<const Elem *> &elems, IntersectionResult & result) const
+const Elem * RayTraceSolver::ray_hit(const Point &p, const Point &dir, const Elem * const * elems, unsigned int n_elems, IntersectionResult & result) const
 {
   const Elem * hit_elem = NULL;
   double dist = 1e10;
-  for(unsigned int n=0; n<elems.size(); ++n)
+  IntersectionResult ret;
+  for(unsigned int n=0; n<n_elems; ++n)
   {
     const Elem * elem = elems[n];
-    IntersectionResult ret;
+    ret.hit_points.clear();
     elem->ray_hit(p, dir, ret, _dim);
     if(ret.hit_points.size()<2) continue; //missed or only one intersection point
     if(ret.hit_points[0].t<-1e-10) continue; //when t<0, it is not ray hit..
@@ -741,19 +1199,15 @@ const Elem * RayTraceSolver::ray_hit(const Point &p, const Point &dir, const Ele
     case  on_side  : return elem; break; //impossible!
     case  on_edge  :
       {
-        unsigned int edge_index = hit_point.mark;
-        AutoPtr<Elem> edge = elem->build_edge(edge_index);
-        const std::vector<const Elem *> & elems = _elems_shared_this_edge.find(edge.get())->second;
-        const Elem * next_elem = this->ray_hit(p, dir, elems, result);
+        unsigned int e = edge_index(_edges, edge_key(elem, hit_point.mark));
+        const Elem * next_elem = this->ray_hit(p, dir, _elems_shared_this_edge.begin(e), _elems_shared_this_edge.size(e), result);
         assert(next_elem!=elem);
         return next_elem;
       }
     case on_vertex :
       {
-        unsigned int vertex_index = hit_point.mark;
-        const Node * node = elem->get_node(vertex_index);
-        const std::vector<const Elem *> & elems = _elems_shared_this_node[node->id()];
-        const Elem * next_elem = this->ray_hit(p, dir, elems, result);
+        unsigned int node = elem->node(hit_point.mark);
+        const Elem * next_elem = this->ray_hit(p, dir, _elems_shared_this_node.begin(node), _elems_shared_this_node.size(node), result);
         assert(next_elem!=elem);
         return next_elem;
       }
@@ -767,68 +1221,180 @@ const Elem * RayTraceSolver::ray_hit(const Point &p, const Point &dir, const Ele
 
 
 
-void RayTraceSolver::ray_tracing(LightThread *ray)
+void RayTraceSolver::record_spawn(RayPath * path, const LightThread & parent, LightThread & child) const
 {
+  if(!path) return;
+  child.path_id = path->n_rays++;
+  path->add(RayPath::SPAWN, parent.path_id, child.path_id, parent.power() > 0.0 ? child.power()/parent.power() : 0.0);
+}
 
-  // use stack to save all the rays (origin and secondary)
-  std::stack<LightThread *> ray_stack;
-  ray_stack.push(ray);
 
-  while(!ray_stack.empty())
+
+void RayTraceSolver::replay_ray_path(const RayPath & path, double power, double lamda,
+                                     std::vector<double> & band_absorption_energy_in_elem,
+                                     std::vector<double> & total_absorption_energy_in_elem) const
+{
+  const MeshBase & mesh = _system.mesh();
+
+  // power of each ray
+  std::vector<double> ray_power(path.n_rays, 0.0);
+  ray_power[0] = power;
+
+  // energy lost in last segment
+  double band_loss = 0.0, total_loss = 0.0;
+
+  for(unsigned int n=0; n<path.events.size(); ++n)
   {
-    LightThread * current_ray = ray_stack.top();
-    ray_stack.pop();
+    const RayPath::Event & e = path.events[n];
+    switch(e.type)
+    {
+    case RayPath::SPAWN   :
+      ray_power[e.target] = e.value*ray_power[e.ray];
+      break;
+    case RayPath::SCALE   :
+      ray_power[e.ray] *= e.value;
+      break;
+    case RayPath::ADVANCE :
+      {
+        // the same as LightThread::advance_to
+        const Elem * elem = mesh.elem(e.target);
+        double a_band = 4*3.14159265358979*this->get_refractive_index_im(elem->subdomain_id())/lamda;
+        double a_tail = 0.0;
+        double a_fc   = this->get_free_carrier_absorption(elem, lamda);
+        double a      = a_band+a_tail+a_fc;
+
+        double dpower = ray_power[e.ray]*(1.0 - exp(-a*e.value));
+        ray_power[e.ray] -= dpower;
+        band_loss  = dpower*a_band/(a+1e-30);
+        total_loss = dpower*a/(a+1e-30);
+        break;
+      }
+    case RayPath::DEPOSIT :
+      band_absorption_energy_in_elem[e.target]  += e.value*band_loss;
+      total_absorption_energy_in_elem[e.target] += e.value*total_loss;
+      break;
+    }
+  }
+}
+
 
-    if(current_ray==NULL) continue;
+
+void RayTraceSolver::deposit_energy(const Elem * elem, double weight, double band, double total,
+                                    std::vector<double> & band_absorption_energy_in_elem,
+                                    std::vector<double> & total_absorption_energy_in_elem,
+                                    RayFootprint * footprint, RayPath * path) const
+{
+  if(path)
+    path->add(RayPath::DEPOSIT, 0, elem->id(), weight);
+
+  band  *= weight;
+  total *= weight;
+
+  if(!footprint)
+  {
+    band_absorption_energy_in_elem[elem->id()]  += band;
+    total_absorption_energy_in_elem[elem->id()] += total;
+    return;
+  }
+
+  if(elem->subdomain_id() != footprint->last_region)
+  {
+    footprint->last_region = elem->subdomain_id();
+    footprint->path_key = 31*footprint->path_key + footprint->last_region + 1;
+  }
+  if(total > 0.0)
+  {
+    footprint->deposit.push_back(std::make_pair(elem->id(), std::make_pair(band, total)));
+    footprint->hmin = std::min(footprint->hmin, elem->hmin());
+    footprint->energy += total;
+  }
+}
+
+
+
+void RayTraceSolver::ray_tracing(const LightThread & ray, RayBuffer & buffer,
+                                 std::vector<double> & band_absorption_energy_in_elem,
+                                 std::vector<double> & total_absorption_energy_in_elem,
+                                 RayFootprint * footprint, RayPath * path) const
+{
+
+  // use stack to save all the rays (origin and secondary)
+  buffer.n_rays = 0;
+  buffer.push(ray);
+
+  // the ray being traced, and the reflect/refract rays it generates, all of them live in buffer
+  LightThread & current_ray = buffer.current;
+  LightThread & reflect_ray = buffer.reflect;
+  LightThread & refract_ray = buffer.refract;
+
+  // scratch buffer for the candidate elems around an interior edge
+  std::vector<const Elem *> & edge_candidates = buffer.edge_candidates;
+
+  // the current ray walks into the next elem, keep tracing it without going through the stack
+  bool walk = false;
+
+  while(walk || buffer.n_rays)
+  {
+    if(!walk) buffer.pop();
+    walk = false;
 
     // the ray doesn't hit any elem yet?
-    if(current_ray->hit_elem==NULL)
+    if(current_ray.hit_elem==NULL)
     {
       // find the first element this ray hit
       const Elem * elem = surface_elem_tree->hit(current_ray);
-      if(elem==NULL) {delete current_ray; continue;}
+      if(elem==NULL) continue;
 
-      current_ray->hit_elem = elem;
+      current_ray.hit_elem = elem;
 
       assert(elem->on_boundary());
       // get the intersection result
-      elem->ray_hit(current_ray->start_point(), current_ray->dir(), current_ray->result, _dim);
+      current_ray.result.hit_points.clear();
+      elem->ray_hit(current_ray.start_point(), current_ray.dir(), current_ray.result, _dim);
 
       // the first intersection point
-      assert(current_ray->result.hit_points.size());
+      assert(current_ray.result.hit_points.size());
 
-      std::vector<std::pair<const Elem*, unsigned int> > hit_elems;
-      Hit_Point & hit_point = current_ray->result.hit_points[0];
+      // points into the boundary tables, no copy is made
+      ElemSide face_hit;
+      const ElemSide * hit_elems = NULL;
+      unsigned int n_hit_elems = 0;
+      const Hit_Point & hit_point = current_ray.result.hit_points[0];
       switch(hit_point.point_location)
       {
       case on_face   :  //the ray-mesh intersection point is on elem face
       case on_side   :  //2d case
         {
           if(elem->on_boundary(hit_point.mark)) //safe guard
-            hit_elems.push_back( std::make_pair(elem, hit_point.mark) );
+          {
+            face_hit = std::make_pair(elem, hit_point.mark);
+            hit_elems = &face_hit;
+            n_hit_elems = 1;
+          }
           break;
         }
       case on_edge   : //the ray-mesh intersection point is on elem edge, we must split the ray
         {
           assert(_dim==3); //only valid for 3d mesh
-          unsigned int edge_index = hit_point.mark;
-          AutoPtr<Elem> edge = elem->build_edge(edge_index);
-          assert(_boundary_edge_to_elem_side_map.find(edge.get())!=_boundary_edge_to_elem_side_map.end());
-          hit_elems = _boundary_edge_to_elem_side_map.find(edge.get())->second;
+          unsigned int e = edge_index(_boundary_edges, edge_key(elem, hit_point.mark));
+          assert(e!=invalid_uint);
+          hit_elems = _boundary_edge_to_elem_side_map.begin(e);
+          n_hit_elems = _boundary_edge_to_elem_side_map.size(e);
           break;
         }
       case on_vertex :  //the ray-mesh intersection point is on elem vertex, we must split the ray
         {
-          unsigned int vertex_index = hit_point.mark;
-          const Node * current_node = elem->get_node(vertex_index);
-          assert(_boundary_node_to_elem_side_map.find(current_node)!=_boundary_node_to_elem_side_map.end());
-          hit_elems = _boundary_node_to_elem_side_map.find(current_node)->second;
+          unsigned int node = elem->node(hit_point.mark);
+          assert(_boundary_node_to_elem_side_map.size(node));
+          hit_elems = _boundary_node_to_elem_side_map.begin(node);
+          n_hit_elems = _boundary_node_to_elem_side_map.size(node);
           break;
         }
       }
 
-      current_ray->power() = current_ray->power()/(hit_elems.size()+1e-10);
-      for(unsigned int n=0; n<hit_elems.size(); ++n)
+      current_ray.power() = current_ray.power()/(n_hit_elems+1e-10);
+      if(path) path->add(RayPath::SCALE, current_ray.path_id, 0, 1.0/(n_hit_elems+1e-10));
+      for(unsigned int n=0; n<n_hit_elems; ++n)
       {
         const Elem * boundary_elem = hit_elems[n].first;
         unsigned int side = hit_elems[n].second;
@@ -837,26 +1403,23 @@ void RayTraceSolver::ray_tracing(LightThread *ray)
         Point p = hit_point.p;
         Point norm = boundary_elem->outside_unit_normal(side);
         //the surface norm should has a angle >90 degree to ray dir
-        if(norm.dot(current_ray->dir()) > -1e-10) continue;
+        if(norm.dot(current_ray.dir()) > -1e-10) continue;
 
         // if reflect surface
         if(is_full_reflect_surface(boundary_elem, side))
         {
-          LightThread * reflect_ray = current_ray->reflection(p, norm);
+          current_ray.reflection(p, norm, reflect_ray);
+          record_spawn(path, current_ray, reflect_ray);
           // some stupid skill: shift the reflect ray to prevent it hit this elem again
-          reflect_ray->start_point() = reflect_ray->start_point() + 1e-6*reflect_ray->dir();
-          // the reflect ray hit the mesh again?
+          reflect_ray.start_point() = reflect_ray.start_point() + 1e-6*reflect_ray.dir();
+          // the reflect ray is outside the mesh, only the surface tree knows if it hit the mesh again
           const Elem *surface_elem = surface_elem_tree->hit(reflect_ray);
           if(surface_elem && surface_elem!=elem)
           {
-            reflect_ray->hit_elem = this->ray_hit(reflect_ray->start_point(), reflect_ray->dir(), surface_elem, reflect_ray->result);
-            if(reflect_ray->hit_elem)
-              ray_stack.push(reflect_ray);
-            else
-              delete reflect_ray;
+            reflect_ray.hit_elem = this->ray_hit(reflect_ray.start_point(), reflect_ray.dir(), surface_elem, reflect_ray.result);
+            if(reflect_ray.hit_elem)
+              buffer.push(reflect_ray);
           }
-          else
-            delete reflect_ray;
           continue;
         }
 
@@ -869,98 +1432,88 @@ void RayTraceSolver::ray_tracing(LightThread *ray)
         bool inv = (arc && arc->inner_region != boundary_elem->subdomain_id());
 
         //generate reflect/refract rays
-        std::pair<LightThread *, LightThread *> ray_pair = current_ray->interface_light_gen_linear_polarized(p, norm, n1, n2, arc, inv);
+        std::pair<bool, bool> ray_pair = current_ray.interface_light_gen_linear_polarized(p, norm, n1, n2, reflect_ray, refract_ray, arc, inv);
+        if(ray_pair.first)  record_spawn(path, current_ray, reflect_ray);
+        if(ray_pair.second) record_spawn(path, current_ray, refract_ray);
 
         // for refract ray
-        LightThread *refract_ray = ray_pair.second;
-        if(refract_ray)
+        if(ray_pair.second)
         {
-          refract_ray->hit_elem = this->ray_hit(refract_ray->start_point(), refract_ray->dir(), boundary_elem, refract_ray->result);
-          if(refract_ray->hit_elem)
-            ray_stack.push(refract_ray);
-          else
-            delete refract_ray;
+          refract_ray.hit_elem = this->ray_hit(refract_ray.start_point(), refract_ray.dir(), boundary_elem, refract_ray.result);
+          if(refract_ray.hit_elem)
+            buffer.push(refract_ray);
         }
 
         // for reflect ray
-        LightThread *reflect_ray = ray_pair.first;
-        if(reflect_ray)
+        if(ray_pair.first)
         {
           // some stupid skill: shift the reflect ray to prevent it hit this elem again
-          reflect_ray->start_point() = reflect_ray->start_point() + 1e-8*reflect_ray->dir();
-          // the refract ray hit the mesh again?
+          reflect_ray.start_point() = reflect_ray.start_point() + 1e-8*reflect_ray.dir();
+          // the reflect ray is outside the mesh, only the surface tree knows if it hit the mesh again
           const Elem *surface_elem = surface_elem_tree->hit(reflect_ray);
           if(surface_elem && surface_elem!=elem)
           {
-            reflect_ray->hit_elem = this->ray_hit(reflect_ray->start_point(), reflect_ray->dir(), surface_elem, reflect_ray->result);
-            if(reflect_ray->hit_elem)
-              ray_stack.push(reflect_ray);
-            else
-              delete reflect_ray;
+            reflect_ray.hit_elem = this->ray_hit(reflect_ray.start_point(), reflect_ray.dir(), surface_elem, reflect_ray.result);
+            if(reflect_ray.hit_elem)
+              buffer.push(reflect_ray);
           }
-          else
-            delete reflect_ray;
         }
       }
 
-      delete current_ray;
       continue;
     }
 
 
-    //assert(current_ray->result.hit_points.size()==2);
-    if( current_ray->result.hit_points.size() != 2 )
+    //assert(current_ray.result.hit_points.size()==2);
+    if( current_ray.result.hit_points.size() != 2 )
     {
       // FIXME, should not happen...
-      delete current_ray;
       continue;
     }
 
     // calculate energy deposit
-    const Elem * elem = current_ray->hit_elem;
-    Hit_Point  end_point = current_ray->result.hit_points[1];
+    const Elem * elem = current_ray.hit_elem;
+    Hit_Point  end_point = current_ray.result.hit_points[1];
 
 
-    double a_band = 4*3.14159265358979*this->get_refractive_index_im(elem->subdomain_id())/current_ray->wavelength();
+    double a_band = 4*3.14159265358979*this->get_refractive_index_im(elem->subdomain_id())/current_ray.wavelength();
     double a_tail = 0.0;
-    double a_fc   = this->get_free_carrier_absorption(elem, current_ray->wavelength());
+    double a_fc   = this->get_free_carrier_absorption(elem, current_ray.wavelength());
 
-    std::vector<double> energy_deposit = current_ray->advance_to(end_point.p, a_band, a_tail, a_fc);
-    double total_energy_deposit = std::accumulate(energy_deposit.begin(), energy_deposit.end(), 0.0);
+    if(path) path->add(RayPath::ADVANCE, current_ray.path_id, elem->id(), (end_point.p - current_ray.start_point()).size());
+    double energy_deposit[3];
+    current_ray.advance_to(end_point.p, a_band, a_tail, a_fc, energy_deposit);
+    double total_energy_deposit = energy_deposit[0] + energy_deposit[1] + energy_deposit[2];
 
-    switch(current_ray->result.state)
+    switch(current_ray.result.state)
     {
       // all the energy deposited in this elem
     case Intersect_Body :
-      _band_absorption_energy_in_elem[elem->id()] += energy_deposit[0];
-      _total_absorption_energy_in_elem[elem->id()] += total_energy_deposit;
+      deposit_energy(elem, 1.0, energy_deposit[0], total_energy_deposit,
+                     band_absorption_energy_in_elem, total_absorption_energy_in_elem, footprint, path);
       break;
       // two elem shares the energy deposite
     case On_Face        :
       {
-        _band_absorption_energy_in_elem[elem->id()] += 0.5*energy_deposit[0];
-        _total_absorption_energy_in_elem[elem->id()] += 0.5*total_energy_deposit;
-        unsigned int side = current_ray->result.mark;
-        const Elem * neighbor = elem->neighbor(side);
+        deposit_energy(elem, 0.5, energy_deposit[0], total_energy_deposit,
+                       band_absorption_energy_in_elem, total_absorption_energy_in_elem, footprint, path);
+        unsigned int side = current_ray.result.mark;
+        const Elem * neighbor = face_neighbor(elem, side).first;
         if(neighbor)
-        {
-          _band_absorption_energy_in_elem[neighbor->id()] += 0.5*energy_deposit[0];
-          _total_absorption_energy_in_elem[neighbor->id()] += 0.5*total_energy_deposit;
-        }
+          deposit_energy(neighbor, 0.5, energy_deposit[0], total_energy_deposit,
+                         band_absorption_energy_in_elem, total_absorption_energy_in_elem, footprint, path);
         break;
       }
       // all the elems have this edge shares the deposited energy
     case Overlap_Edge   :
       {
-        unsigned int e = current_ray->result.mark;
-        AutoPtr<Elem> edge = elem->build_edge(e);
-        const std::vector<const Elem *> & elems = _elems_shared_this_edge.find(edge.get())->second;
-        assert(elems.size());
-        for(unsigned int n=0; n<elems.size(); ++n)
-        {
-          _band_absorption_energy_in_elem[elems[n]->id()] += energy_deposit[0]/elems.size();
-          _total_absorption_energy_in_elem[elems[n]->id()] += total_energy_deposit/elems.size();
-        }
+        unsigned int e = edge_index(_edges, edge_key(elem, current_ray.result.mark));
+        const Elem * const * elems = _elems_shared_this_edge.begin(e);
+        const unsigned int n_elems = _elems_shared_this_edge.size(e);
+        assert(n_elems);
+        for(unsigned int n=0; n<n_elems; ++n)
+          deposit_energy(elems[n], 1.0/n_elems, energy_deposit[0], total_energy_deposit,
+                         band_absorption_energy_in_elem, total_absorption_energy_in_elem, footprint, path);
         break;
       }
       //we should never reach here
@@ -968,113 +1521,107 @@ void RayTraceSolver::ray_tracing(LightThread *ray)
     }
 
 
-    if(current_ray->is_dead())
-    { delete current_ray; continue; }
+    if(current_ray.is_dead()) continue;
 
     // safe guard: when the number of rays in stack exceed 1000, we may fall into endless loop
     // force to exit
-    if(ray_stack.size()>1000)
+    if(buffer.n_rays>1000)
     {
-      while(!ray_stack.empty())
-      {
-        LightThread * current_ray = ray_stack.top();
-        ray_stack.pop();
-        delete current_ray;
-      }
+      buffer.n_rays = 0;
       return;
     }
 
     // find next ray elem intersection
 
-    current_ray->result.hit_points.clear();
+    current_ray.result.hit_points.clear();
     switch(end_point.point_location)
     {
     case  on_face   : //3d
     case  on_side   : //2d
       {
         unsigned int side = end_point.mark;
-        const Elem * next_elem = elem->neighbor(side);
+        // walk across the side
+        const Elem * next_elem = face_neighbor(elem, side).first;
         if(next_elem && next_elem->subdomain_id() == elem->subdomain_id())
         {
-          current_ray->hit_elem = next_elem;
-          next_elem->ray_hit(current_ray->start_point(), current_ray->dir(), current_ray->result, _dim);
-          ray_stack.push(current_ray);
+          current_ray.hit_elem = next_elem;
+          next_elem->ray_hit(current_ray.start_point(), current_ray.dir(), current_ray.result, _dim);
+          walk = true;
         }
         else //we are on material interface
         {
           // if reflect surface
           if(is_surface(elem, side) && is_full_reflect_surface(elem, side))
-          {  delete current_ray; continue; }
+            continue;
 
           Point p = end_point.p;
           Point norm = - elem->outside_unit_normal(side);
           double n1 = get_refractive_index_re(elem->subdomain_id());
           double n2 = get_refractive_index_re(elem->subdomain_id(side));
           //generate reflect/refract rays
-          std::pair<LightThread *, LightThread *> ray_pair = current_ray->interface_light_gen_linear_polarized(p, norm, n1, n2);
+          std::pair<bool, bool> ray_pair = current_ray.interface_light_gen_linear_polarized(p, norm, n1, n2, reflect_ray, refract_ray);
+          if(ray_pair.first)  record_spawn(path, current_ray, reflect_ray);
+          if(ray_pair.second) record_spawn(path, current_ray, refract_ray);
 
           // for refract ray
-          LightThread *refract_ray = ray_pair.second;
-          if(refract_ray)
+          if(ray_pair.second)
           {
-            refract_ray->hit_elem = next_elem;
+            refract_ray.hit_elem = next_elem;
             if(next_elem)
-              next_elem->ray_hit(refract_ray->start_point(), refract_ray->dir(), refract_ray->result, _dim);
+              next_elem->ray_hit(refract_ray.start_point(), refract_ray.dir(), refract_ray.result, _dim);
             else
-              refract_ray->start_point() = refract_ray->start_point() + 1e-8*refract_ray->dir();
-            ray_stack.push(refract_ray);
+              refract_ray.start_point() = refract_ray.start_point() + 1e-8*refract_ray.dir();
+            buffer.push(refract_ray);
           }
 
           // for reflect ray
-          LightThread *reflect_ray = ray_pair.first;
-          if(reflect_ray)
+          if(ray_pair.first)
           {
-            reflect_ray->hit_elem = elem;
-            elem->ray_hit(reflect_ray->start_point(), reflect_ray->dir(), reflect_ray->result, _dim);
-            assert(reflect_ray->result.state!=Missed);
-            ray_stack.push(reflect_ray);
+            reflect_ray.hit_elem = elem;
+            elem->ray_hit(reflect_ray.start_point(), reflect_ray.dir(), reflect_ray.result, _dim);
+            assert(reflect_ray.result.state!=Missed);
+            buffer.push(reflect_ray);
           }
-          delete current_ray;
         }
       }
       break;
     case  on_edge   :
       {
-        unsigned int edge_index = end_point.mark;
-        AutoPtr<Elem> edge = elem->build_edge(edge_index);
+        const EdgeKey edge = edge_key(elem, end_point.mark);
+        const unsigned int boundary_edge = edge_index(_boundary_edges, edge);
         // the edge is not on boundary
-        if(_boundary_edge_to_elem_side_map.find(edge.get())==_boundary_edge_to_elem_side_map.end())
+        if(boundary_edge == invalid_uint)
         {
-          const std::vector<const Elem *> & edge_elems = _elems_shared_this_edge.find(edge.get())->second;
-          const std::vector<const Elem *> & node1_elems = _elems_shared_this_node[edge->node(0)];
-          const std::vector<const Elem *> & node2_elems = _elems_shared_this_node[edge->node(1)];
-          std::set<const Elem *> elems_set;
-          elems_set.insert(edge_elems.begin(), edge_elems.end());
-          elems_set.insert(node1_elems.begin(), node1_elems.end());
-          elems_set.insert(node2_elems.begin(), node2_elems.end());
-          std::vector<const Elem *> elems;
-          elems.insert(elems.end(), elems_set.begin(), elems_set.end());
-
-          const Elem * next_elem = this->ray_hit(current_ray->start_point(), current_ray->dir(), elems, current_ray->result);
+          const unsigned int e = edge_index(_edges, edge);
+          const Elem * const * edge_elems = _elems_shared_this_edge.begin(e);
+          const Elem * const * node1_elems = _elems_shared_this_node.begin(edge.first);
+          const Elem * const * node2_elems = _elems_shared_this_node.begin(edge.second);
+          edge_candidates.clear();
+          edge_candidates.insert(edge_candidates.end(), edge_elems, edge_elems + _elems_shared_this_edge.size(e));
+          edge_candidates.insert(edge_candidates.end(), node1_elems, node1_elems + _elems_shared_this_node.size(edge.first));
+          edge_candidates.insert(edge_candidates.end(), node2_elems, node2_elems + _elems_shared_this_node.size(edge.second));
+          std::sort(edge_candidates.begin(), edge_candidates.end());
+          edge_candidates.erase(std::unique(edge_candidates.begin(), edge_candidates.end()), edge_candidates.end());
+
+          const Elem * next_elem = this->ray_hit(current_ray.start_point(), current_ray.dir(), &edge_candidates[0], edge_candidates.size(), current_ray.result);
           if(next_elem && next_elem!=elem)
           {
-            current_ray->hit_elem = next_elem;
-            ray_stack.push(current_ray);
-            continue;
+            current_ray.hit_elem = next_elem;
+            walk = true;
           }
         }
         else // the edge is on boundary
         {
           Point p = end_point.p;
-          unsigned int edge_index = end_point.mark;
-          AutoPtr<Elem> edge = elem->build_edge(edge_index);
-          const std::vector<std::pair<const Elem*, unsigned int> > & elems = _boundary_edge_to_elem_side_map.find(edge.get())->second;
+          const ElemSide * elems = _boundary_edge_to_elem_side_map.begin(boundary_edge);
+          const unsigned int n_elems = _boundary_edge_to_elem_side_map.size(boundary_edge);
 
           //split current_ray, each edge on boundary shoud be shared by 2 elem
           unsigned int effective_faces = 2;
-          current_ray->power() = current_ray->power()/effective_faces;
+          current_ray.power() = current_ray.power()/effective_faces;
+          if(path) path->add(RayPath::SCALE, current_ray.path_id, 0, 1.0/effective_faces);
 
-          for(unsigned int n=0; n<elems.size(); ++n)
+          for(unsigned int n=0; n<n_elems; ++n)
           {
             const Elem * boundary_elem = elems[n].first;
             unsigned int side = elems[n].second;
@@ -1084,73 +1631,65 @@ void RayTraceSolver::ray_tracing(LightThread *ray)
 
             Point norm = boundary_elem->outside_unit_normal(side);
             //the surface norm should has a angle >90 degree to ray dir
-            if(norm.dot(current_ray->dir()) > -1e-10) continue;
+            if(norm.dot(current_ray.dir()) > -1e-10) continue;
 
             double n1 = get_refractive_index_re(boundary_elem->subdomain_id(side));
             double n2 = get_refractive_index_re(boundary_elem->subdomain_id());
             //generate reflect/refract rays
-            std::pair<LightThread *, LightThread *> ray_pair = current_ray->interface_light_gen_linear_polarized(p, norm, n1, n2);
+            std::pair<bool, bool> ray_pair = current_ray.interface_light_gen_linear_polarized(p, norm, n1, n2, reflect_ray, refract_ray);
+            if(ray_pair.first)  record_spawn(path, current_ray, reflect_ray);
+            if(ray_pair.second) record_spawn(path, current_ray, refract_ray);
 
             // for refract ray
-            LightThread *refract_ray = ray_pair.second;
-            if(refract_ray)
+            if(ray_pair.second)
             {
-              refract_ray->hit_elem = this->ray_hit(refract_ray->start_point(), refract_ray->dir(), boundary_elem, refract_ray->result);
-              if(refract_ray->hit_elem)
-                ray_stack.push(refract_ray);
-              else
-                delete refract_ray;
+              refract_ray.hit_elem = this->ray_hit(refract_ray.start_point(), refract_ray.dir(), boundary_elem, refract_ray.result);
+              if(refract_ray.hit_elem)
+                buffer.push(refract_ray);
             }
 
             // for reflect ray
-            LightThread *reflect_ray = ray_pair.first;
-            if(reflect_ray)
+            if(ray_pair.first)
             {
-              reflect_ray->hit_elem = this->ray_hit(reflect_ray->start_point(), reflect_ray->dir(), elem, reflect_ray->result);
-              if(reflect_ray->hit_elem)
-                ray_stack.push(reflect_ray);
-              else
-                delete reflect_ray;
+              reflect_ray.hit_elem = this->ray_hit(reflect_ray.start_point(), reflect_ray.dir(), elem, reflect_ray.result);
+              if(reflect_ray.hit_elem)
+                buffer.push(reflect_ray);
             }
           }
-
-          delete current_ray;
         }
       }
       break;
     case  on_vertex :
       {
-        unsigned int vertex_index = end_point.mark;
-        const Node * node = elem->get_node(vertex_index);
-        std::vector<const Elem *> & elems = _elems_shared_this_node[node->id()];
+        const unsigned int node = elem->node(end_point.mark);
         // the node is not on boundary
-        if( _boundary_node_to_elem_side_map.find(node)==_boundary_node_to_elem_side_map.end())
+        if(_boundary_node_to_elem_side_map.size(node) == 0)
         {
-          const Elem * next_elem = this->ray_hit(current_ray->start_point(), current_ray->dir(), elems, current_ray->result);
+          const Elem * next_elem = this->ray_hit(current_ray.start_point(), current_ray.dir(),
+                                                 _elems_shared_this_node.begin(node), _elems_shared_this_node.size(node), current_ray.result);
           assert(next_elem && next_elem!=elem);
-          current_ray->hit_elem = next_elem;
-          ray_stack.push(current_ray);
-          continue;
+          current_ray.hit_elem = next_elem;
+          walk = true;
         }
         else
         {
           Point p = end_point.p;
-          unsigned int vertex_index = end_point.mark;
-          const Node * current_node = elem->get_node(vertex_index);
-          const std::vector<std::pair<const Elem*, unsigned int> > & elems = _boundary_node_to_elem_side_map.find(current_node)->second;
+          const ElemSide * elems = _boundary_node_to_elem_side_map.begin(node);
+          const unsigned int n_elems = _boundary_node_to_elem_side_map.size(node);
 
           //split current_ray
           unsigned int effective_faces = 0;
-          for(unsigned int n=0; n<elems.size(); ++n)
+          for(unsigned int n=0; n<n_elems; ++n)
           {
             Point norm = elems[n].first->outside_unit_normal(elems[n].second);
             //the surface norm should has a angle >90 degree to ray dir
-            if(norm.dot(current_ray->dir()) > -1e-10) continue;
+            if(norm.dot(current_ray.dir()) > -1e-10) continue;
             effective_faces++;
           }
-          current_ray->power() = current_ray->power()/effective_faces;
+          current_ray.power() = current_ray.power()/effective_faces;
+          if(path) path->add(RayPath::SCALE, current_ray.path_id, 0, 1.0/effective_faces);
 
-          for(unsigned int n=0; n<elems.size(); ++n)
+          for(unsigned int n=0; n<n_elems; ++n)
           {
             const Elem * boundary_elem = elems[n].first;
             unsigned int side = elems[n].second;
@@ -1160,36 +1699,31 @@ void RayTraceSolver::ray_tracing(LightThread *ray)
 
             Point norm = boundary_elem->outside_unit_normal(side);
             //the surface norm should has a angle >90 degree to ray dir
-            if(norm.dot(current_ray->dir()) > -1e-10) continue;
+            if(norm.dot(current_ray.dir()) > -1e-10) continue;
 
             double n1 = get_refractive_index_re(boundary_elem->subdomain_id(side));
             double n2 = get_refractive_index_re(boundary_elem->subdomain_id());
             //generate reflect/refract rays
-            std::pair<LightThread *, LightThread *> ray_pair = current_ray->interface_light_gen_linear_polarized(p, norm, n1, n2);
+            std::pair<bool, bool> ray_pair = current_ray.interface_light_gen_linear_polarized(p, norm, n1, n2, reflect_ray, refract_ray);
+            if(ray_pair.first)  record_spawn(path, current_ray, reflect_ray);
+            if(ray_pair.second) record_spawn(path, current_ray, refract_ray);
 
             // for refract ray
-            LightThread *refract_ray = ray_pair.second;
-            if(refract_ray)
+            if(ray_pair.second)
             {
-              refract_ray->hit_elem = this->ray_hit(refract_ray->start_point(), refract_ray->dir(), boundary_elem, refract_ray->result);
-              if(refract_ray->hit_elem)
-                ray_stack.push(refract_ray);
-              else
-                delete refract_ray;
+              refract_ray.hit_elem = this->ray_hit(refract_ray.start_point(), refract_ray.dir(), boundary_elem, refract_ray.result);
+              if(refract_ray.hit_elem)
+                buffer.push(refract_ray);
             }
 
             // for reflect ray
-            LightThread *reflect_ray = ray_pair.first;
-            if(reflect_ray)
+            if(ray_pair.first)
             {
-              reflect_ray->hit_elem = this->ray_hit(reflect_ray->start_point(), reflect_ray->dir(), elem, reflect_ray->result);
-              if(reflect_ray->hit_elem)
-                ray_stack.push(reflect_ray);
-              else
-                delete reflect_ray;
+              reflect_ray.hit_elem = this->ray_hit(reflect_ray.start_point(), reflect_ray.dir(), elem, reflect_ray.result);
+              if(reflect_ray.hit_elem)
+                buffer.push(reflect_ray);
             }
           }
-          delete current_ray;
         }
       }
       break;
@@ -452,6 +452,24 @@ namespace SolverSpecify
    */
   int       DC_Cycles;
 
+  /**
+   * number of accepted DC/transient steps between two mesh adaptations,
+   * 0 means no adaptation during the solve
+   */
+  int       AdaptInterval;
+
+  /**
+   * set by the solver when it stops to let the mesh be adapted,
+   * the sweep will be continued on the new mesh
+   */
+  bool      AdaptRequest;
+
+  /**
+   * true for the solver passes after a mesh adaptation, the output hooks
+   * continue the files written by previous pass instead of creating them
+   */
+  bool      AdaptResume;
+
   /**
    * use node set, only for mixA solver
    */
@@ -696,6 +714,10 @@ namespace SolverSpecify
     VStepMax          = 1.0;
     IStepMax          = 1.0;
 
+    AdaptInterval     = 0;
+    AdaptRequest      = false;
+    AdaptResume       = false;
+
     NodeSet           = true;
     RampUpSteps       = 1;
     RampUpVStep       = std::numeric_limits<double>::infinity();
@@ -131,10 +131,31 @@ Sphere LightLenses::bounding_sphere() const
 }
 
 
+std::vector<double> LightLenses::active_lens_parameters() const
+{
+  std::vector<double> parameters;
+  for(unsigned int i=0; i<_effect_lenses.size(); ++i)
+  {
+    const Lens * lens = _lenses.find(_effect_lenses[i])->second;
+    for(unsigned int d=0; d<3; ++d)
+    {
+      parameters.push_back(lens->center[d]);
+      parameters.push_back(lens->norm[d]);
+    }
+    parameters.push_back(lens->radius);
+    parameters.push_back(lens->A);
+    parameters.push_back(lens->B);
+    parameters.push_back(lens->C);
+    parameters.push_back(lens->D);
+  }
+  return parameters;
+}
+
+
 
-LightThread * LightLenses::operator << (LightThread *light) const
+bool LightLenses::operator << (LightThread &light) const
 {
-  const double energy = light->power();
+  const double energy = light.power();
   do
   {
     //find intersection lens
@@ -145,9 +166,9 @@ LightThread * LightLenses::operator << (LightThread *light) const
       const Lens * lens = _lenses.find(_effect_lenses[n])->second;
       Plane lens_plane(lens->center, lens->norm);
       double dist;
-      if(lens_plane.intersect_point(light->start_point(), light->dir(), dist) )
+      if(lens_plane.intersect_point(light.start_point(), light.dir(), dist) )
       {
-        if( (lens->center - (light->start_point() + dist*light->dir()) ).size() > lens->radius) continue;
+        if( (lens->center - (light.start_point() + dist*light.dir()) ).size() > lens->radius) continue;
         if(dist > 0 && dist<t)
         {
           t = dist;
@@ -158,7 +179,7 @@ LightThread * LightLenses::operator << (LightThread *light) const
 
     if(!active_lens)
     {
-      return light;
+      return true;
     }
 
     // do ABCD transform
@@ -178,29 +199,29 @@ LightThread * LightLenses::operator << (LightThread *light) const
 
 
       // the light incident point
-      Point aim_point = light->start_point() + t*light->dir();
+      Point aim_point = light.start_point() + t*light.dir();
       // set y axis as lens center to light incident point
       Point y_axis = (aim_point - active_lens->center).unit(true);
       Point z_axis = active_lens->norm.cross(y_axis);
       // the parallel and perpendicular E
-      const double Et = light->E_dir()*z_axis;
-      const double Ep = light->E_dir()*(z_axis.cross(light->dir()));
+      const double Et = light.E_dir()*z_axis;
+      const double Ep = light.E_dir()*(z_axis.cross(light.dir()));
       //
       double aim_distance = (aim_point - active_lens->center).size();
-      double aim_angle = active_lens->norm.angle(light->dir());
-      if(y_axis*light->dir() < 0.0)
+      double aim_angle = active_lens->norm.angle(light.dir());
+      if(y_axis*light.dir() < 0.0)
         aim_angle = 2*M_PI-aim_angle;
       // ABCD transform
       double t_distance = active_lens->A*aim_distance + active_lens->B*aim_angle;
       double t_angle = active_lens->C*aim_distance + active_lens->D*aim_angle;
       // recalculate startpoint, dir and E_dir of light
-      light->dir() =  cos(t_angle)*active_lens->norm + sin(t_angle)*y_axis;
-      light->start_point() = active_lens->center + t_distance*y_axis + 1e-6*active_lens->radius*light->dir();
-      light->E_dir() =  Ep*z_axis.cross(light->dir()) + Et*z_axis;
+      light.dir() =  cos(t_angle)*active_lens->norm + sin(t_angle)*y_axis;
+      light.start_point() = active_lens->center + t_distance*y_axis + 1e-6*active_lens->radius*light.dir();
+      light.E_dir() =  Ep*z_axis.cross(light.dir()) + Et*z_axis;
     }
-  } while(light->power() > 0.01*energy);
+  } while(light.power() > 0.01*energy);
 
-  return 0;
+  return false;
 }
 
 
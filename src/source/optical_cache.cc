@@ -0,0 +1,295 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+
+#include "optical_cache.h"
+#include "simulation_system.h"
+#include "simulation_region.h"
+#include "mesh_base.h"
+#include "elem.h"
+#include "boundary_info.h"
+#include "fvm_node_info.h"
+#include "fvm_node_data.h"
+#include "parser.h"
+#include "parallel.h"
+#include "log.h"
+
+
+OpticalCache::OpticalCache(SimulationSystem & system, const Parser::Card & c)
+  : _system(system), _key(14695981039346656037ULL)
+{
+  _dir = c.get_string("optical.cache", "");
+  if(_dir.empty()) return;
+
+  add(Genius::n_processors());
+
+  // the mesh
+  const MeshBase & mesh = system.mesh();
+  add(mesh.n_nodes());
+  add(mesh.n_elem());
+  MeshBase::const_node_iterator node_it = mesh.nodes_begin();
+  MeshBase::const_node_iterator node_it_end = mesh.nodes_end();
+  for(; node_it != node_it_end; ++node_it)
+  {
+    const Node * node = *node_it;
+    add(node->id());
+    for(unsigned int d=0; d<3; ++d)
+      add((*node)(d));
+  }
+
+  MeshBase::const_element_iterator elem_it = mesh.elements_begin();
+  MeshBase::const_element_iterator elem_it_end = mesh.elements_end();
+  for(; elem_it != elem_it_end; ++elem_it)
+  {
+    const Elem * elem = *elem_it;
+    add(static_cast<int>(elem->type()));
+    add(elem->subdomain_id());
+    add(elem->processor_id());
+    for(unsigned int i=0; i<elem->n_nodes(); ++i)
+      add(elem->node(i));
+  }
+
+  std::vector<unsigned int> el;
+  std::vector<unsigned short int> sl;
+  std::vector<short int> il;
+  mesh.boundary_info->build_side_list(el, sl, il);
+  for(unsigned int n=0; n<el.size(); ++n)
+  {
+    add(el[n]);
+    add(static_cast<unsigned int>(sl[n]));
+    add(static_cast<int>(il[n]));
+  }
+
+  // the regions
+  for(unsigned int r=0; r<system.n_regions(); ++r)
+  {
+    const SimulationRegion * region = system.region(r);
+    add(region->name());
+    add(region->material());
+    add(region->type_name());
+    add(region->T_external());
+  }
+
+  // the light source card, except the parameters do not change the result
+  add(c.key());
+  for(unsigned int idx=0; idx<c.parameter_size(); idx++)
+  {
+    const Parser::Parameter p = c.get_parameter(idx);
+    if(p.name() == "optical.cache" || p.name() == "threads") continue;
+    add(p.name());
+    add(static_cast<int>(p.type()));
+    for(unsigned int i=0; i<p.array_size(); ++i)
+    {
+      switch(p.type())
+      {
+        case Parser::BOOL    : add(p.get_bool(i) ? 1 : 0); break;
+        case Parser::INTEGER : add(p.get_int(i)); break;
+        case Parser::REAL    : add(p.get_real(i)); break;
+        case Parser::STRING  :
+        case Parser::ENUM    : add(p.get_string(i)); break;
+        default: break;
+      }
+    }
+  }
+}
+
+
+void OpticalCache::_add_bytes(const void * p, size_t n)
+{
+  // 64bit FNV-1a
+  const unsigned char * c = static_cast<const unsigned char *>(p);
+  for(size_t i=0; i<n; ++i)
+  {
+    _key ^= c[i];
+    _key *= 1099511628211ULL;
+  }
+}
+
+
+void OpticalCache::add(const std::string & s)
+{
+  add(static_cast<unsigned int>(s.size()));
+  _add_bytes(s.data(), s.size());
+}
+
+
+void OpticalCache::add(double v)
+{ _add_bytes(&v, sizeof(double)); }
+
+
+void OpticalCache::add(int v)
+{ _add_bytes(&v, sizeof(int)); }
+
+
+void OpticalCache::add(unsigned int v)
+{ _add_bytes(&v, sizeof(unsigned int)); }
+
+
+void OpticalCache::add(const Complex & v)
+{
+  add(v.real());
+  add(v.imag());
+}
+
+
+std::string OpticalCache::_file_name() const
+{
+  std::ostringstream name;
+  name << _dir << "/" << std::hex << std::setw(16) << std::setfill('0') << _key
+       << std::dec << ".p" << Genius::processor_id();
+  return name.str();
+}
+
+
+void OpticalCache::_read_records(std::vector<Record> & records) const
+{
+  records.clear();
+  for(unsigned int r=0; r<_system.n_regions(); ++r)
+  {
+    const SimulationRegion * region = _system.region(r);
+    SimulationRegion::const_local_node_iterator node_it = region->on_local_nodes_begin();
+    SimulationRegion::const_local_node_iterator node_it_end = region->on_local_nodes_end();
+    for(; node_it!=node_it_end; ++node_it)
+    {
+      const FVM_Node * fvm_node = *node_it;
+      const FVM_NodeData * node_data = fvm_node->node_data();
+
+      Record record;
+      record.region = r;
+      record.node   = fvm_node->root_node()->id();
+      record.value[0] = node_data->OptG();
+      record.value[1] = node_data->OptQ();
+      record.value[2] = node_data->OptE();
+      record.value[3] = node_data->OptE_complex().real();
+      record.value[4] = node_data->OptE_complex().imag();
+      record.value[5] = node_data->OptH_complex().real();
+      record.value[6] = node_data->OptH_complex().imag();
+      records.push_back(record);
+    }
+  }
+}
+
+
+void OpticalCache::snapshot()
+{
+  if(!enabled()) return;
+  _read_records(_snapshot);
+}
+
+
+void OpticalCache::save()
+{
+  if(!enabled()) return;
+
+  std::vector<Record> records;
+  _read_records(records);
+  genius_assert(records.size() == _snapshot.size());
+
+  for(unsigned int n=0; n<records.size(); ++n)
+    for(unsigned int i=0; i<_n_values; ++i)
+      records[n].value[i] -= _snapshot[n].value[i];
+
+  // write to a temporary file first, a partial file never has a valid name
+  const std::string file_name = _file_name();
+  const std::string tmp_name  = file_name + ".tmp";
+  bool ok = false;
+  {
+    std::ofstream out(tmp_name.c_str(), std::ios::binary);
+    if(out.good())
+    {
+      const unsigned int n_records = records.size();
+      out.write(reinterpret_cast<const char *>(&_key), sizeof(_key));
+      out.write(reinterpret_cast<const char *>(&n_records), sizeof(n_records));
+      if(n_records)
+        out.write(reinterpret_cast<const char *>(&records[0]), n_records*sizeof(Record));
+      ok = out.good();
+    }
+  }
+  if(ok) ok = std::rename(tmp_name.c_str(), file_name.c_str()) == 0;
+
+  Parallel::min(ok);
+  if(!ok)
+  {
+    std::remove(tmp_name.c_str());
+    MESSAGE<<"Warning: can not write optical cache to directory "<< _dir << "." << std::endl; RECORD();
+    return;
+  }
+
+  MESSAGE<<"Optical fields saved to cache." << std::endl; RECORD();
+}
+
+
+bool OpticalCache::load()
+{
+  if(!enabled()) return false;
+
+  std::vector<Record> records;
+  _read_records(records);
+
+  std::vector<Record> deltas;
+  bool hit = false;
+  {
+    std::ifstream in(_file_name().c_str(), std::ios::binary);
+    unsigned long long key = 0;
+    unsigned int n_records = 0;
+    in.read(reinterpret_cast<char *>(&key), sizeof(key));
+    in.read(reinterpret_cast<char *>(&n_records), sizeof(n_records));
+    if(in.good() && key == _key && n_records == records.size())
+    {
+      deltas.resize(n_records);
+      if(n_records)
+        in.read(reinterpret_cast<char *>(&deltas[0]), n_records*sizeof(Record));
+      hit = in.good();
+    }
+  }
+
+  // the entry must match the local nodes one by one
+  for(unsigned int n=0; hit && n<records.size(); ++n)
+    hit = deltas[n].region == records[n].region && deltas[n].node == records[n].node;
+
+  Parallel::min(hit);
+  if(!hit) return false;
+
+  for(unsigned int r=0, n=0; r<_system.n_regions(); ++r)
+  {
+    SimulationRegion * region = _system.region(r);
+    SimulationRegion::local_node_iterator node_it = region->on_local_nodes_begin();
+    SimulationRegion::local_node_iterator node_it_end = region->on_local_nodes_end();
+    for(; node_it!=node_it_end; ++node_it, ++n)
+    {
+      FVM_NodeData * node_data = (*node_it)->node_data();
+      const double * delta = deltas[n].value;
+      node_data->OptG()         += delta[0];
+      node_data->OptQ()         += delta[1];
+      node_data->OptE()         += delta[2];
+      node_data->OptE_complex() += Complex(delta[3], delta[4]);
+      node_data->OptH_complex() += Complex(delta[5], delta[6]);
+    }
+  }
+
+  MESSAGE<<"Optical fields loaded from cache." << std::endl; RECORD();
+  return true;
+}
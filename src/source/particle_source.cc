@@ -33,6 +33,7 @@
 #include "interpolation_3d_nbtet.h"
 #include "nearest_node_locator.h"
 #include "parallel.h"
+#include "threads.h"
 #include "mathfunc.h"
 #include "log.h"
 
@@ -444,107 +445,308 @@ void Particle_Source_Track::_read_particle_profile_track(const std::string & fil
 
 
 
-#if 1
-void Particle_Source_Track::update_system()
+/**
+ * on processor FVM nodes of all the regions are binned into a uniform grid, and the tracks are
+ * processed by threads. the deposition is done in two passes: the first one computes the energy
+ * each track deposits to nodes on this processor, which is summed over processors in one reduction
+ * to get the normalization factor of each track; the second one accumulates the normalized energy
+ * density into per-thread flat arrays.
+ */
+class Particle_Source_Track::TrackBatch
 {
-  START_LOG("update_system()", "Particle_Source_Track");
+public:
 
-  MESSAGE<< "  process particle generation";
-  RECORD();
+  TrackBatch(SimulationSystem & system, const std::vector<track_t> & tracks, unsigned int n_threads);
 
-  const double pi = 3.1415926536;
-  genius_assert(_system.mesh().mesh_dimension() == 3);
+  /**
+   * first pass, energy of each track deposited to nodes on this processor
+   */
+  void track_energy(std::vector<double> & energy);
 
-  std::vector<double> region_energy(_system.n_regions(), 0.0);
-  double total_energy=0.0;
+  /**
+   * second pass, energy density of each node with track normalization factor alpha
+   */
+  void deposit(const std::vector<double> & alpha, std::vector<double> & energy_density);
 
-  AutoPtr<NearestNodeLocator> nn_locator( new NearestNodeLocator(_system.mesh()) );
+  /**
+   * the on processor FVM nodes, the order of energy density array
+   */
+  const std::vector<FVM_Node *> & nodes() const { return _nodes; }
 
-  for(unsigned int t=0; t<_tracks.size(); ++t)
+  /**
+   * thread body, process tracks [begin, end)
+   */
+  void operator()(unsigned int begin, unsigned int end, unsigned int tid);
+
+private:
+
+  const std::vector<track_t> & _tracks;
+
+  unsigned int _n_threads;
+
+  /// flat node arrays
+  std::vector<FVM_Node *> _nodes;
+  std::vector<Point>      _loc;
+  std::vector<double>     _volume;
+
+  /// uniform bins, nodes in bin b are _bin_nodes[_bin_offset[b], _bin_offset[b+1])
+  Point _bmin;
+  double _h;
+  unsigned int _nx, _ny, _nz;
+  std::vector<unsigned int> _bin_offset;
+  std::vector<unsigned int> _bin_nodes;
+
+  /// state of current pass
+  bool _deposit_pass;
+  std::vector<double> * _energy;
+  const std::vector<double> * _alpha;
+  std::vector< std::vector<double> > _thread_density;
+
+  unsigned int _bin(double x, double lo, unsigned int n) const
+  {
+    double i = floor((x-lo)/_h);
+    if(i < 0) return 0;
+    if(i >= n) return n-1;
+    return static_cast<unsigned int>(i);
+  }
+
+  void _process_track(unsigned int t, unsigned int tid);
+};
+
+
+/**
+ * distance from p to segment p1-p2 with unit direction dir and length
+ */
+static double _distance_to_segment(const Point &p, const Point &p1, const Point &p2, const Point &dir, double length)
+{
+  double z = (p-p1)*dir;
+  if(z <= 0) return (p-p1).size();
+  if(z >= length) return (p-p2).size();
+  return (p-(p1+z*dir)).size();
+}
+
+
+Particle_Source_Track::TrackBatch::TrackBatch(SimulationSystem & system, const std::vector<track_t> & tracks, unsigned int n_threads)
+  : _tracks(tracks), _n_threads(n_threads ? n_threads : 1), _h(1.0), _nx(1), _ny(1), _nz(1),
+    _deposit_pass(false), _energy(0), _alpha(0)
+{
+  for(unsigned int r=0; r<system.n_regions(); r++)
   {
-    if( t%(1+_tracks.size()/20) ==0 )
+    SimulationRegion * region = system.region(r);
+    SimulationRegion::processor_node_iterator it = region->on_processor_nodes_begin();
+    SimulationRegion::processor_node_iterator it_end = region->on_processor_nodes_end();
+    for(; it!=it_end; ++it)
     {
-      MESSAGE<< ".";
-      RECORD();
+      _nodes.push_back(*it);
+      _loc.push_back(*(*it)->root_node());
+      _volume.push_back((*it)->volume());
     }
+  }
 
-    const track_t & track = _tracks[t];
-    genius_assert(track.energy > 0.0 && (track.end - track.start).size() > 0.0);
+  if(_nodes.empty())
+  {
+    _bin_offset.assign(2, 0);
+    return;
+  }
 
-    /*
-    // prevent bad tracks
-    int bad_track = 0;
-    if( track.energy == 0.0 || (track.end - track.start).size() == 0.0) bad_track=1;
-    Parallel::broadcast(bad_track);
-    if(bad_track) continue;
-    */
+  // bounding box of the nodes
+  _bmin = _loc[0];
+  Point bmax = _loc[0];
+  for(unsigned int n=1; n<_loc.size(); ++n)
+    for(unsigned int i=0; i<3; ++i)
+    {
+      _bmin(i) = std::min(_bmin(i), _loc[n](i));
+      bmax(i)  = std::max(bmax(i),  _loc[n](i));
+    }
 
-    double track_energy = 0.0;
-    std::map<FVM_Node *, double> track_energy_density;
+  // bin size, about 8 nodes in each bin
+  double volume = 1.0;
+  unsigned int dims = 0;
+  for(unsigned int i=0; i<3; ++i)
+    if(bmax(i) - _bmin(i) > 0) { volume *= bmax(i) - _bmin(i); dims++; }
+  if(dims)
+    _h = 2.0*pow(volume/_nodes.size(), 1.0/dims);
+  _nx = static_cast<unsigned int>((bmax(0)-_bmin(0))/_h) + 1;
+  _ny = static_cast<unsigned int>((bmax(1)-_bmin(1))/_h) + 1;
+  _nz = static_cast<unsigned int>((bmax(2)-_bmin(2))/_h) + 1;
+
+  // counting sort nodes into bins
+  std::vector<unsigned int> node_bin(_nodes.size());
+  _bin_offset.assign(_nx*_ny*_nz+1, 0);
+  for(unsigned int n=0; n<_nodes.size(); ++n)
+  {
+    unsigned int i = _bin(_loc[n](0), _bmin(0), _nx);
+    unsigned int j = _bin(_loc[n](1), _bmin(1), _ny);
+    unsigned int k = _bin(_loc[n](2), _bmin(2), _nz);
+    node_bin[n] = (k*_ny + j)*_nx + i;
+    _bin_offset[node_bin[n]+1]++;
+  }
+  for(unsigned int b=0; b<_nx*_ny*_nz; ++b)
+    _bin_offset[b+1] += _bin_offset[b];
 
-    const Point track_dir = (track.end - track.start).unit(); // track direction
-    const double ed = track.energy/(track.end - track.start).size(); // linear energy density
-    const double lateral_char = track.lateral_char;
-    // find the nodes that near the track
-    for(unsigned int r=0; r<_system.n_regions(); r++)
-    {
-      const SimulationRegion * region = _system.region(r);
+  std::vector<unsigned int> cursor(_bin_offset.begin(), _bin_offset.end()-1);
+  _bin_nodes.resize(_nodes.size());
+  for(unsigned int n=0; n<_nodes.size(); ++n)
+    _bin_nodes[cursor[node_bin[n]]++] = n;
+}
 
-      // fast return
-      const std::pair<Point, Real> bsphere = region->boundingsphere();
-      const Point cent = 0.5*(track.start+track.end);
-      const double diag = 0.5*(track.start-track.end).size();
-      if( (bsphere.first - cent).size() > bsphere.second + diag + 5*lateral_char ) continue;
 
+void Particle_Source_Track::TrackBatch::track_energy(std::vector<double> & energy)
+{
+  energy.assign(_tracks.size(), 0.0);
+  _deposit_pass = false;
+  _energy = &energy;
+  Threads::parallel_for_dynamic(0, _tracks.size(), 64, *this, _n_threads);
+  _energy = 0;
+}
 
-      std::vector<const Node *> nn = nn_locator->nearest_nodes(track.start, track.end, 5*lateral_char, r);
-      for(unsigned int n=0; n<nn.size(); ++n)
-      {
-        Point loc = *nn[n];
-        FVM_Node * fvm_node = region->region_fvm_node(nn[n]); // may be NULL, if not on local
-        if(!fvm_node || !fvm_node->on_processor()) continue;
 
-        Point loc_pp = track.start + (loc-track.start)*track_dir*track_dir;
-        Real r = (loc-loc_pp).size();
-        double e_r = exp(-r*r/(lateral_char*lateral_char));
-        double e_z = Erf((loc_pp-track.start)*track_dir/lateral_char) - Erf((loc_pp-track.end)*track_dir/lateral_char);
-        double energy_density = ed/(2*pi*lateral_char*lateral_char)*e_r*e_z;
-        track_energy += energy_density*fvm_node->volume();
-        track_energy_density[fvm_node] += energy_density;
-      }
-    }
+void Particle_Source_Track::TrackBatch::deposit(const std::vector<double> & alpha, std::vector<double> & energy_density)
+{
+  _deposit_pass = true;
+  _alpha = &alpha;
+  _thread_density.assign(_n_threads, std::vector<double>(_nodes.size(), 0.0));
+  Threads::parallel_for_dynamic(0, _tracks.size(), 64, *this, _n_threads);
+  _alpha = 0;
+
+  energy_density.swap(_thread_density[0]);
+  for(unsigned int t=1; t<_thread_density.size(); ++t)
+    for(unsigned int n=0; n<_nodes.size(); ++n)
+      energy_density[n] += _thread_density[t][n];
+  _thread_density.clear();
+}
 
-    Parallel::sum(track_energy);
 
-    if(track_energy > 0.0)
-    {
-      double alpha = track.energy/track_energy; //used for keep energy conservation track.energy;
-      std::map<FVM_Node *, double>::const_iterator it = track_energy_density.begin();
-      for(; it != track_energy_density.end(); ++it)
-      {
-        FVM_Node * fvm_node = it->first;
-        if(!fvm_node) continue;
+void Particle_Source_Track::TrackBatch::operator()(unsigned int begin, unsigned int end, unsigned int tid)
+{
+  for(unsigned int t=begin; t<end; ++t)
+    _process_track(t, tid);
+}
+
+
+void Particle_Source_Track::TrackBatch::_process_track(unsigned int t, unsigned int tid)
+{
+  const double pi = 3.1415926536;
+
+  const track_t & track = _tracks[t];
+
+  double alpha = 0.0;
+  double * density = 0;
+  if(_deposit_pass)
+  {
+    alpha = (*_alpha)[t];
+    if(alpha == 0.0) return;
+    density = &_thread_density[tid][0];
+  }
+
+  if(_nodes.empty()) return;
+
+  const double length = (track.end - track.start).size();
+  const Point track_dir = (track.end - track.start)/length; // track direction
+  const double ed = track.energy/length; // linear energy density
+  const double lateral_char = track.lateral_char;
+  const double radius = 5*lateral_char;
+  const double G0 = ed/(2*pi*lateral_char*lateral_char);
+
+  // the bins overlap bounding box of the track cylinder
+  unsigned int lo[3], hi[3], nb[3] = {_nx, _ny, _nz};
+  for(unsigned int i=0; i<3; ++i)
+  {
+    lo[i] = _bin(std::min(track.start(i), track.end(i)) - radius, _bmin(i), nb[i]);
+    hi[i] = _bin(std::max(track.start(i), track.end(i)) + radius, _bmin(i), nb[i]);
+  }
 
-        double energy_density = it->second;
+  // bins farther than this from the track contain no node near the track
+  const double bin_radius = radius + 0.8660254038*_h;
 
-        SimulationRegion * region = _system.region(fvm_node->subdomain_id());
-        //if( region->type() != SemiconductorRegion) continue;
+  double energy = 0.0;
+  for(unsigned int k=lo[2]; k<=hi[2]; ++k)
+    for(unsigned int j=lo[1]; j<=hi[1]; ++j)
+      for(unsigned int i=lo[0]; i<=hi[0]; ++i)
+      {
+        const Point center = _bmin + Point((i+0.5)*_h, (j+0.5)*_h, (k+0.5)*_h);
+        if(_distance_to_segment(center, track.start, track.end, track_dir, length) > bin_radius) continue;
 
-        if(fvm_node && fvm_node->on_local())
+        const unsigned int b = (k*_ny + j)*_nx + i;
+        for(unsigned int m=_bin_offset[b]; m<_bin_offset[b+1]; ++m)
         {
-          FVM_NodeData * node_data = fvm_node->node_data();
-          node_data->PatG() += alpha*energy_density/_quan_eff/(_t_char/2.0*sqrt(pi)*(1+Erf((_t_max-_t0)/_t_char)));
-          node_data->PatE() += alpha*energy_density;
-          total_energy += alpha*energy_density*fvm_node->volume();
-          region_energy[ fvm_node->subdomain_id() ] += alpha*energy_density*fvm_node->volume();
+          const unsigned int n = _bin_nodes[m];
+          const Point & loc = _loc[n];
+          if(_distance_to_segment(loc, track.start, track.end, track_dir, length) > radius) continue;
+
+          const double z = (loc-track.start)*track_dir;
+          const double r2 = (loc - (track.start + z*track_dir)).size_sq();
+          double e_r = exp(-r2/(lateral_char*lateral_char));
+          double e_z = Erf(z/lateral_char) - Erf((z-length)/lateral_char);
+          double energy_density = G0*e_r*e_z;
+
+          if(_deposit_pass)
+            density[n] += alpha*energy_density;
+          else
+            energy += energy_density*_volume[n];
         }
       }
-    }
+
+  if(!_deposit_pass)
+    (*_energy)[t] = energy;
+}
+
+
+
+void Particle_Source_Track::update_system()
+{
+  START_LOG("update_system()", "Particle_Source_Track");
+
+  MESSAGE<< "  process particle generation of "<<_tracks.size()<<" tracks...";
+  RECORD();
+
+  const double pi = 3.1415926536;
+  genius_assert(_system.mesh().mesh_dimension() == 3);
+
+  for(unsigned int t=0; t<_tracks.size(); ++t)
+    genius_assert(_tracks[t].energy > 0.0 && (_tracks[t].end - _tracks[t].start).size() > 0.0);
+
+  TrackBatch batch(_system, _tracks, Threads::n_threads());
+
+  // energy of each track deposited to all the processors, one reduction for all the tracks
+  std::vector<double> track_energy;
+  batch.track_energy(track_energy);
+  Parallel::sum(track_energy);
+
+  // alpha is used for keep energy conservation of each track
+  std::vector<double> alpha(_tracks.size(), 0.0);
+  std::vector<unsigned int> lost_tracks;
+  for(unsigned int t=0; t<_tracks.size(); ++t)
+  {
+    if(track_energy[t] > 0.0)
+      alpha[t] = _tracks[t].energy/track_energy[t];
     else
+      lost_tracks.push_back(t);
+  }
+
+  std::vector<double> energy_density;
+  batch.deposit(alpha, energy_density);
+
+  const double G_factor = 1.0/_quan_eff/(_t_char/2.0*sqrt(pi)*(1+Erf((_t_max-_t0)/_t_char)));
+  const std::vector<FVM_Node *> & nodes = batch.nodes();
+  for(unsigned int n=0; n<nodes.size(); ++n)
+  {
+    if(energy_density[n] == 0.0) continue;
+    FVM_NodeData * node_data = nodes[n]->node_data();
+    node_data->PatG() += energy_density[n]*G_factor;
+    node_data->PatE() += energy_density[n];
+  }
+
+  // the track is too far away from any node, deposit all the energy to the nearest node
+  if(!lost_tracks.empty())
+  {
+    AutoPtr<NearestNodeLocator> nn_locator( new NearestNodeLocator(_system.mesh()) );
+
+    std::vector<double> distance(lost_tracks.size(), std::numeric_limits<double>::infinity());
+    std::vector<FVM_Node *> nearest_node(lost_tracks.size(), static_cast<FVM_Node *>(0));
+    for(unsigned int l=0; l<lost_tracks.size(); ++l)
     {
-      // find the nearest node of the track
-      FVM_Node * neraset_node=0;
-      double distance=std::numeric_limits<double>::infinity();
+      const track_t & track = _tracks[lost_tracks[l]];
       for(unsigned int r=0; r<_system.n_regions(); r++)
       {
         const SimulationRegion * region = _system.region(r);
@@ -555,27 +757,28 @@ void Particle_Source_Track::update_system()
         FVM_Node * fvm_node = region->region_fvm_node(n); // may be NULL, if not on local
         if(!fvm_node || !fvm_node->on_processor()) continue;
 
-        if( dist < distance)
+        if( dist < distance[l])
         {
-          distance = dist;
-          neraset_node = fvm_node;
+          distance[l] = dist;
+          nearest_node[l] = fvm_node;
         }
       }
+    }
 
-      double min_distance=distance;
-      Parallel::min(min_distance);
+    std::vector<double> min_distance(distance);
+    Parallel::min(min_distance);
 
-      if( min_distance == distance && neraset_node)
+    for(unsigned int l=0; l<lost_tracks.size(); ++l)
+    {
+      if( min_distance[l] == distance[l] && nearest_node[l])
       {
-        double energy_density = track.energy/neraset_node->volume();
-        FVM_NodeData * node_data = neraset_node->node_data();
-        node_data->PatG() += energy_density/_quan_eff/(_t_char/2.0*sqrt(pi)*(1+Erf((_t_max-_t0)/_t_char)));
+        const track_t & track = _tracks[lost_tracks[l]];
+        double energy_density = track.energy/nearest_node[l]->volume();
+        FVM_NodeData * node_data = nearest_node[l]->node_data();
+        node_data->PatG() += energy_density*G_factor;
         node_data->PatE() += energy_density;
-        total_energy += track.energy;
-        region_energy[neraset_node->subdomain_id()] += track.energy;
       }
     }
-
   }
 
   MESSAGE<< "ok" <<std::endl;
@@ -585,8 +788,6 @@ void Particle_Source_Track::update_system()
 
 }
 
-#endif
-
 #if 0
 void Particle_Source_Track::update_system()
 {
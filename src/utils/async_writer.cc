@@ -0,0 +1,123 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include "genius_common.h"
+#include "async_writer.h"
+
+
+class AsyncWriter::IOThread : public Threads::Thread
+{
+public:
+  IOThread(AsyncWriter & writer): _writer(writer) {}
+
+protected:
+  virtual void run()
+  { _writer._process(); }
+
+private:
+  AsyncWriter & _writer;
+};
+
+
+
+AsyncWriter::AsyncWriter(unsigned int max_queue)
+  : _max_queue(max_queue > 0 ? max_queue : 1), _busy(false), _stop(false), _thread(0)
+{
+  // the I/O loop never returns until the writer stops, it must not run in the caller.
+  // if the thread can not be created, the jobs are written synchronously in submit()
+  _thread = new IOThread(*this);
+  if( !_thread->start() )
+  {
+    delete _thread;
+    _thread = 0;
+  }
+}
+
+
+AsyncWriter::~AsyncWriter()
+{
+  if( !_thread ) return;
+
+  {
+    Threads::ScopedLock lock(_mutex);
+    _stop = true;
+    _job_ready.broadcast();
+  }
+  _thread->join();
+  delete _thread;
+}
+
+
+void AsyncWriter::submit(Job * job)
+{
+  if( !_thread )
+  {
+    job->write();
+    delete job;
+    return;
+  }
+
+  Threads::ScopedLock lock(_mutex);
+  while( _queue.size() >= _max_queue )
+    _job_done.wait(_mutex);
+  _queue.push_back(job);
+  _job_ready.signal();
+}
+
+
+void AsyncWriter::flush()
+{
+  if( !_thread ) return;
+
+  Threads::ScopedLock lock(_mutex);
+  while( !_queue.empty() || _busy )
+    _job_done.wait(_mutex);
+}
+
+
+void AsyncWriter::_process()
+{
+  while(true)
+  {
+    Job * job = 0;
+    {
+      Threads::ScopedLock lock(_mutex);
+      while( _queue.empty() && !_stop )
+        _job_ready.wait(_mutex);
+      // finish all the pending jobs before exit
+      if( _queue.empty() ) break;
+      job = _queue.front();
+      _queue.pop_front();
+      _busy = true;
+    }
+
+    job->write();
+    delete job;
+
+    {
+      Threads::ScopedLock lock(_mutex);
+      _busy = false;
+      _job_done.broadcast();
+    }
+  }
+}
+
@@ -0,0 +1,127 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <new>
+#include <algorithm>
+
+#include "object_pool.h"
+
+
+ObjectPool::ObjectPool(const std::string & name, size_t objects_per_chunk)
+  : _name(name), _objects_per_chunk(objects_per_chunk)
+{}
+
+
+ObjectPool::~ObjectPool()
+{
+  for(unsigned int n=0; n<_block_pools.size(); ++n)
+  {
+    if(!_block_pools[n]) continue;
+    for(unsigned int c=0; c<_block_pools[n]->chunks.size(); ++c)
+      ::operator delete(_block_pools[n]->chunks[c]);
+    delete _block_pools[n];
+  }
+}
+
+
+void * ObjectPool::allocate(size_t size)
+{
+  // round the size up to pointer size, which keeps the alignment of blocks
+  const size_t unit = sizeof(void *);
+  const size_t index = (std::max(size, unit) + unit - 1)/unit;
+
+  Threads::ScopedLock lock(_mutex);
+
+  if(index >= _block_pools.size())
+    _block_pools.resize(index+1, static_cast<BlockPool *>(0));
+  if(!_block_pools[index])
+  {
+    BlockPool * pool = new BlockPool;
+    pool->block_size = index*unit;
+    pool->free_list  = 0;
+    pool->next       = 0;
+    pool->end        = 0;
+    pool->n_used     = 0;
+    _block_pools[index] = pool;
+  }
+
+  BlockPool & pool = *_block_pools[index];
+  pool.n_used++;
+
+  if(pool.free_list)
+  {
+    void * p = pool.free_list;
+    pool.free_list = *static_cast<void **>(p);
+    return p;
+  }
+
+  if(pool.next == pool.end)
+  {
+    const size_t chunk_size = pool.block_size*_objects_per_chunk;
+    pool.next = static_cast<char *>(::operator new(chunk_size));
+    pool.end  = pool.next + chunk_size;
+    pool.chunks.push_back(pool.next);
+  }
+
+  void * p = pool.next;
+  pool.next += pool.block_size;
+  return p;
+}
+
+
+void ObjectPool::deallocate(void * p, size_t size)
+{
+  if(!p) return;
+
+  const size_t unit = sizeof(void *);
+  const size_t index = (std::max(size, unit) + unit - 1)/unit;
+
+  Threads::ScopedLock lock(_mutex);
+
+  BlockPool & pool = *_block_pools[index];
+  *static_cast<void **>(p) = pool.free_list;
+  pool.free_list = p;
+  pool.n_used--;
+}
+
+
+size_t ObjectPool::n_objects() const
+{
+  Threads::ScopedLock lock(_mutex);
+
+  size_t n = 0;
+  for(unsigned int i=0; i<_block_pools.size(); ++i)
+    if(_block_pools[i]) n += _block_pools[i]->n_used;
+  return n;
+}
+
+
+size_t ObjectPool::memory_size() const
+{
+  Threads::ScopedLock lock(_mutex);
+
+  size_t counter = sizeof(*this);
+  for(unsigned int i=0; i<_block_pools.size(); ++i)
+    if(_block_pools[i])
+      counter += _block_pools[i]->chunks.size()*_block_pools[i]->block_size*_objects_per_chunk;
+  return counter;
+}
@@ -0,0 +1,153 @@
+/********************************************************************************/
+/*     888888    888888888   88     888  88888   888      888    88888888       */
+/*   8       8   8           8 8     8     8      8        8    8               */
+/*  8            8           8  8    8     8      8        8    8               */
+/*  8            888888888   8   8   8     8      8        8     8888888        */
+/*  8      8888  8           8    8  8     8      8        8            8       */
+/*   8       8   8           8     8 8     8      8        8            8       */
+/*     888888    888888888  888     88   88888     88888888     88888888        */
+/*                                                                              */
+/*       A Three-Dimensional General Purpose Semiconductor Simulator.           */
+/*                                                                              */
+/*                                                                              */
+/*  Copyright (C) 2007-2008                                                     */
+/*  Cogenda Pte Ltd                                                             */
+/*                                                                              */
+/*  Please contact Cogenda Pte Ltd for license information                      */
+/*                                                                              */
+/*  Author: Gong Ding   gdiso@ustc.edu                                          */
+/*                                                                              */
+/********************************************************************************/
+
+
+#include <cstdlib>
+
+#include "genius_common.h"
+#include "threads.h"
+
+
+namespace Threads
+{
+
+  // 0 means not initialized
+  static unsigned int _n_threads = 0;
+
+  unsigned int n_threads()
+  {
+#ifdef HAVE_PTHREAD
+    if( _n_threads == 0 )
+    {
+      _n_threads = 1;
+
+      const char * env = getenv("GENIUS_NUM_THREADS");
+      if( env != NULL && atoi(env) > 0 )
+        _n_threads = atoi(env);
+    }
+    return _n_threads;
+#else
+    return 1;
+#endif
+  }
+
+
+  void set_n_threads(unsigned int n)
+  {
+    _n_threads = n > 0 ? n : 1;
+  }
+
+
+
+#ifdef HAVE_PTHREAD
+
+  Mutex::Mutex()
+  { pthread_mutex_init(&_mutex, NULL); }
+
+  Mutex::~Mutex()
+  { pthread_mutex_destroy(&_mutex); }
+
+  void Mutex::lock()
+  { pthread_mutex_lock(&_mutex); }
+
+  void Mutex::unlock()
+  { pthread_mutex_unlock(&_mutex); }
+
+
+  ConditionVariable::ConditionVariable()
+  { pthread_cond_init(&_cond, NULL); }
+
+  ConditionVariable::~ConditionVariable()
+  { pthread_cond_destroy(&_cond); }
+
+  void ConditionVariable::wait(Mutex & m)
+  { pthread_cond_wait(&_cond, &m._mutex); }
+
+  void ConditionVariable::signal()
+  { pthread_cond_signal(&_cond); }
+
+  void ConditionVariable::broadcast()
+  { pthread_cond_broadcast(&_cond); }
+
+
+  Thread::Thread(): _started(false)
+  {}
+
+  Thread::~Thread()
+  { genius_assert(!_started); }
+
+  bool Thread::start()
+  {
+    genius_assert(!_started);
+    _started = ( pthread_create(&_thread, NULL, &Thread::_entry, this) == 0 );
+    return _started;
+  }
+
+  void Thread::join()
+  {
+    if( !_started ) return;
+    pthread_join(_thread, NULL);
+    _started = false;
+  }
+
+  void * Thread::_entry(void * p)
+  {
+    static_cast<Thread *>(p)->run();
+    return NULL;
+  }
+
+#else
+
+  // serial version
+
+  Mutex::Mutex() {}
+
+  Mutex::~Mutex() {}
+
+  void Mutex::lock() {}
+
+  void Mutex::unlock() {}
+
+
+  ConditionVariable::ConditionVariable() {}
+
+  ConditionVariable::~ConditionVariable() {}
+
+  void ConditionVariable::wait(Mutex &) {}
+
+  void ConditionVariable::signal() {}
+
+  void ConditionVariable::broadcast() {}
+
+
+  Thread::Thread(): _started(false) {}
+
+  Thread::~Thread() {}
+
+  bool Thread::start()
+  { return false; }
+
+  void Thread::join() {}
+
+#endif
+
+}
+